@@ -27,6 +27,7 @@
 #ifndef FNFT_ERRWARN_H
 #define FNFT_ERRWARN_H
 
+#include <stdint.h>
 #include "fnft_numtypes.h"
 
 /**
@@ -91,6 +92,14 @@ typedef FNFT_INT (* fnft_printf_ptr_t) (const char *, ...);
  */
 #define FNFT_EC_ASSERTION_FAILED 8
 
+/**
+ * Code that routines with callbacks (e.g., \link fnft_nsev_sink \endlink)
+ * return if a callback has stopped the computation. It is not an error of
+ * the routine and therefore not printed or recorded.
+ * @ingroup errwarn
+ */
+#define FNFT_EC_STOPPED 9
+
 /**
  * Sets the printf function that FNFT uses to print errors
  * and warnings.
@@ -105,6 +114,120 @@ void fnft_errwarn_setprintf(fnft_printf_ptr_t printf_ptr);
  */
 fnft_printf_ptr_t fnft_errwarn_getprintf();
 
+/**
+ * @brief Error or warning that has been recorded instead of printed.
+ *
+ * See \link fnft_errwarn_setdiag \endlink.
+ * @ingroup errwarn
+ *
+ * @var fnft_errwarn_event_t::ec
+ *  Error code, or \link FNFT_SUCCESS \endlink for warnings. Negative codes
+ *  indicate that a subroutine failed (see FNFT_EC_...).
+ * @var fnft_errwarn_event_t::func
+ *  Name of the function in which the event occurred.
+ * @var fnft_errwarn_event_t::line
+ *  Line in the source file.
+ * @var fnft_errwarn_event_t::msg
+ *  Message that would have been printed.
+ * @var fnft_errwarn_event_t::thread
+ *  Number of the buffer in which the event has been recorded. Buffers are
+ *  numbered in the order in which they have been created, starting at
+ *  zero. Every buffer is used by one thread at a time.
+ */
+typedef struct {
+    FNFT_INT ec;
+    const char *func;
+    FNFT_INT line;
+    const char *msg;
+    FNFT_UINT thread;
+} fnft_errwarn_event_t;
+
+/**
+ * @brief Counters of the recorded diagnostics.
+ * @ingroup errwarn
+ *
+ * @var fnft_errwarn_summary_t::errors
+ *  Number of errors that have been recorded in all buffers so far.
+ * @var fnft_errwarn_summary_t::warnings
+ *  Number of warnings that have been recorded in all buffers so far.
+ * @var fnft_errwarn_summary_t::dropped
+ *  Number of events that have been counted but not stored since the buffer
+ *  was full.
+ * @var fnft_errwarn_summary_t::pending
+ *  Number of stored events that have not yet been drained.
+ * @var fnft_errwarn_summary_t::buffers
+ *  Number of buffers.
+ */
+typedef struct {
+    uint64_t errors;
+    uint64_t warnings;
+    uint64_t dropped;
+    uint64_t pending;
+    FNFT_UINT buffers;
+} fnft_errwarn_summary_t;
+
+/**
+ * @brief Records the errors and warnings of the calling thread instead of
+ *  printing them.
+ * @ingroup errwarn
+ *
+ * Printing errors and warnings synchronously can dominate the run time if
+ * many threads run into the same warning, since the threads are serialized
+ * on the lock of the output stream. In the diagnostics mode, the events are
+ * stored as codes in a ring buffer of the calling thread instead. Every
+ * buffer has only one writer, so no locks are taken. The events can be
+ * retrieved by any thread with \link fnft_errwarn_drain \endlink and
+ * printed with \link fnft_errwarn_print_event \endlink. If a buffer is
+ * full, new events are only counted.
+ *
+ * The buffers are not freed while the program runs. If a thread disables
+ * the diagnostics mode, its buffer (including the events that have not yet
+ * been drained) can be taken over by the next thread that enables it.
+ *
+ * @param[in] capacity Number of events that the buffer of the thread can
+ *  hold. Zero disables the diagnostics mode for the calling thread.
+ *  Ignored if the thread already has a buffer.
+ * @return \link FNFT_SUCCESS \endlink, FNFT_EC_NOMEM, or
+ *  FNFT_EC_NOT_YET_IMPLEMENTED if atomic operations or thread local storage
+ *  are not available on this platform. Errors are not printed.
+ */
+FNFT_INT fnft_errwarn_setdiag(const FNFT_UINT capacity);
+
+/**
+ * @brief Retrieves recorded errors and warnings.
+ * @ingroup errwarn
+ *
+ * Removes up to max_events of the recorded events from the buffers and
+ * copies them into events. The events of a buffer are returned in the order
+ * in which they occurred. Can be called by any thread while other threads
+ * record events. Concurrent calls are serialized.
+ *
+ * @param[out] events Array of length max_events.
+ * @param[in] max_events Length of events.
+ * @return Number of events that have been copied into events.
+ */
+FNFT_UINT fnft_errwarn_drain(fnft_errwarn_event_t * const events,
+    const FNFT_UINT max_events);
+
+/**
+ * @brief Returns the counters of the recorded diagnostics.
+ * @ingroup errwarn
+ *
+ * The counters are updated by the recording threads concurrently and might
+ * lag slightly.
+ */
+fnft_errwarn_summary_t fnft_errwarn_summary(void);
+
+/**
+ * @brief Prints a recorded event in the same way as it would have been
+ *  printed without the diagnostics mode.
+ * @ingroup errwarn
+ *
+ * Uses the printf function of the calling thread (see \link
+ * fnft_errwarn_setprintf \endlink).
+ */
+void fnft_errwarn_print_event(fnft_errwarn_event_t const * const event);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define SUCCESS             FNFT_SUCCESS
 #endif
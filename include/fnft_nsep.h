@@ -94,9 +94,9 @@ typedef enum {
  *
  * @var fnft_nsep_opts_t::max_evals
  *  Maximum number of function evaluations per root allowed for the refinement
- *  step during localization. Note that this is not necessarily the number
- *  of Newton iterations as Newton's method for higher order roots is used for
- *  some parts of the spectra.
+ *  step during localization. Every evaluation provides the first two
+ *  derivatives, which are used to estimate the multiplicity of the roots of
+ *  the main spectrum and to apply Halley's method to simple roots.
  *
  * @var fnft_nsep_opts_t::discretization
  *  See \link fnft_nsev_opts_t::discretization \endlink.
@@ -28,6 +28,7 @@
 #define FNFT_NSEV_H
 
 #include "fnft_nse_discretization_t.h"
+#include "fnft_samples_t.h"
 
 /**
  * Enum that specifies how the bound states are filtered. Used in
@@ -55,10 +56,12 @@ typedef enum {
  *  \f$ a(\lambda) \f$. (Note: FNFT incorporates a development version of this
  *  routine as no release was available yet.) This method is relatively slow,
  *  but very reliable. \n \n
- *  fnft_nsev_bsloc_NEWTON: Newton's method is used to refine a given set of initial guesses.
+ *  fnft_nsev_bsloc_NEWTON: A Newton-type method (Halley's method, which converges
+ *  cubically) is used to refine a given set of initial guesses.
  *  The discretization used for the the refinement is the one due to Boffetta and Osborne.
- *  The number of iterations is specified through the field \link fnft_nsev_opts_t::niter 
- *  \endlink.
+ *  The maximum number of iterations is specified through the field \link fnft_nsev_opts_t::niter 
+ *  \endlink. The iterations stop earlier once the steps are far below the
+ *  discretization error.
  *  The array bound_states passed to \link fnft_nsev \endlink
  *  should contain the initial guesses and *K_ptr should specify the number of
  *  initial guesses. It is sufficient if bound_states and normconst_or_residues
@@ -115,6 +118,52 @@ typedef enum {
     fnft_nsev_cstype_BOTH
 } fnft_nsev_cstype_t;
 
+/**
+ * Enum that specifies which symmetries of the signal the routine may
+ * exploit. Used in \link fnft_nsev_opts_t \endlink.\n \n
+ * @ingroup data_types
+ *  fnft_nsev_symmetry_NONE: No symmetries are exploited.\n\n
+ *  fnft_nsev_symmetry_REAL: The user guarantees that the signal is real.
+ *  Then \f$ a(-\lambda^*)=a(\lambda)^* \f$ and
+ *  \f$ b(-\lambda^*)=b(\lambda)^* \f$. If the grid of the continuous
+ *  spectrum is symmetric (XI[0]=-XI[1]), only its first half is computed
+ *  and the rest is mirrored. The bound states are symmetric with respect to
+ *  the imaginary axis. Only the bound states in the right half plane
+ *  (including the imaginary axis) are refined and get norming constants or
+ *  residues computed. The bound states in the left half plane are their
+ *  mirror images \f$ -\lambda_k^* \f$ with norming constants
+ *  \f$ b_k^* \f$ and residues \f$ -\rho_k^* \f$. They are appended
+ *  after those in the right half plane. The transfer matrix, i.e. the
+ *  product tree of the scattering matrices, and the roots of its entries
+ *  are still computed in complex arithmetic, exactly as for
+ *  fnft_nsev_symmetry_NONE. The option thus does not reduce the costs of
+ *  these steps.\n\n
+ *  fnft_nsev_symmetry_DETECT: Same as fnft_nsev_symmetry_REAL if the
+ *  imaginary parts of all samples are zero, and as fnft_nsev_symmetry_NONE
+ *  otherwise. The check takes O(D) operations.
+ */
+typedef enum {
+    fnft_nsev_symmetry_NONE,
+    fnft_nsev_symmetry_REAL,
+    fnft_nsev_symmetry_DETECT
+} fnft_nsev_symmetry_t;
+
+/**
+ * Enum that specifies which Jost solution is computed by
+ * \link fnft_nsev_tm_jost \endlink.\n \n
+ * @ingroup data_types
+ *  fnft_nsev_jost_LEFT: The solution \f$ \phi(t,\lambda) \f$ that is
+ *  normalized at the left end, i.e., \f$ \phi(t,\lambda) \to
+ *  [\exp(-j\lambda t); 0] \f$ for \f$ t\to-\infty \f$. \n\n
+ *  fnft_nsev_jost_RIGHT: The solution \f$ \psi(t,\lambda) \f$ that is
+ *  normalized at the right end, i.e., \f$ \psi(t,\lambda) \to
+ *  [0; \exp(j\lambda t)] \f$ for \f$ t\to+\infty \f$.
+ */
+typedef enum {
+    fnft_nsev_jost_LEFT,
+    fnft_nsev_jost_RIGHT
+} fnft_nsev_jost_t;
+
 /**
  * @struct fnft_nsev_opts_t
  * @brief Stores additional options for the routine \link fnft_nsev \endlink. 
@@ -134,7 +183,7 @@ typedef enum {
  * Should be of type \link fnft_nsev_bsloc_t \endlink.  
  *
  * @var fnft_nsev_opts_t::niter
- *  Number of Newton iterations to be carried out when either the fnft_nsev_bsloc_NEWTON or
+ *  Maximum number of Newton-type iterations to be carried out when either the fnft_nsev_bsloc_NEWTON or
  *  the fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE method is used.
  *
  * @var fnft_nsev_opts_t::discspec_type
@@ -157,6 +206,27 @@ typedef enum {
  * @var fnft_nsev_opts_t::discretization
  *  Controls which discretization is applied to the continuous-time Zakharov-
  *  Shabat scattering problem. See \link fnft_nse_discretization_t \endlink.
+ *
+ * @var fnft_nsev_opts_t::symmetry
+ *  Controls whether symmetries of the signal are exploited to save work.
+ *  Should be of type \link fnft_nsev_symmetry_t \endlink. Currently, only
+ *  the evaluation of the continuous spectrum and the refinement of the
+ *  bound states are reduced. The transfer matrix is computed as for
+ *  general signals.
+ *
+ * @var fnft_nsev_opts_t::nthreads
+ *  Number of threads that \link fnft_nsev \endlink may start internally.
+ *  Zero and one mean that no threads are started, which is the default.
+ *  (Options that have been zero-initialized instead of set with \link
+ *  fnft_nsev_default_opts \endlink thus do not start threads either.)
+ *  Larger values set the number of threads, and negative values select
+ *  the number of online processors. Within \link fnft_nsev \endlink,
+ *  only the fnft_nsev_bsloc_FAST_EIGENVALUE method uses several threads,
+ *  via the multishift QR algorithm. On a single processor, this algorithm
+ *  has been measured to be slightly slower than the default single shift
+ *  one. \link fnft_nsev_tm_jost \endlink uses the value stored in the
+ *  transfer matrix object.
+ *  The field has been appended to the end of the struct.
  */
 typedef struct {
     fnft_nsev_bsfilt_t bound_state_filtering;
@@ -166,6 +236,8 @@ typedef struct {
     fnft_nsev_cstype_t contspec_type;
     FNFT_INT normalization_flag;
     fnft_nse_discretization_t discretization;
+    fnft_nsev_symmetry_t symmetry;
+    FNFT_INT nthreads;
 } fnft_nsev_opts_t;
 
 /**
@@ -180,6 +252,8 @@ typedef struct {
  *  contspec_type = fnft_nsev_cstype_REFLECTION_COEFFICIENT\n
  *  normalization_flag = 1\n
  *  discretization = fnft_nse_discretization_2SPLIT4B\n
+ *  symmetry = fnft_nsev_symmetry_NONE\n
+ *  nthreads = 0\n
  *
   * @ingroup fnft
  */
@@ -279,6 +353,749 @@ FNFT_INT fnft_nsev(const FNFT_UINT D, FNFT_COMPLEX * const q,
     FNFT_COMPLEX * const normconsts_or_residues, const FNFT_INT kappa, 
     fnft_nsev_opts_t *opts);
 
+/**
+ * @brief Fast nonlinear Fourier transform for signals that are not stored as
+ *  arrays of FNFT_COMPLEX values.
+ *
+ * Same as \link fnft_nsev \endlink, but the samples are described by a
+ * \link fnft_samples_t \endlink. This allows, e.g., to transform
+ * interleaved int16 or float32 IQ samples from an acquisition device
+ * directly. The samples are converted while the scattering matrices are set
+ * up and while the signal is subsampled, so that the computation of the
+ * continuous spectrum and the fast eigenvalue method do not create a
+ * converted copy of the signal. A converted copy is created internally if
+ * the bound states are refined with Newton's method (this includes the
+ * default fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE) or if norming constants or
+ * residues are requested.
+ *
+ * @param[in] D Number of samples
+ * @param[in] samples Description of the D samples, see \link fnft_samples_t
+ *  \endlink. The n-th sample corresponds to q[n] in \link fnft_nsev
+ *  \endlink.
+ * @param[in] T See \link fnft_nsev \endlink.
+ * @param[in] M See \link fnft_nsev \endlink.
+ * @param[out] contspec See \link fnft_nsev \endlink.
+ * @param[in] XI See \link fnft_nsev \endlink.
+ * @param[in,out] K_ptr See \link fnft_nsev \endlink.
+ * @param[out] bound_states See \link fnft_nsev \endlink.
+ * @param[out] normconsts_or_residues See \link fnft_nsev \endlink.
+ * @param[in] kappa See \link fnft_nsev \endlink.
+ * @param[in] opts See \link fnft_nsev \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_samples(const FNFT_UINT D,
+    fnft_samples_t const * const samples, FNFT_REAL const * const T,
+    const FNFT_UINT M, FNFT_COMPLEX * const contspec,
+    FNFT_REAL const * const XI, FNFT_UINT * const K_ptr,
+    FNFT_COMPLEX * const bound_states,
+    FNFT_COMPLEX * const normconsts_or_residues, const FNFT_INT kappa,
+    fnft_nsev_opts_t *opts);
+
+/**
+ * @brief Receives the results of \link fnft_nsev_sink \endlink.
+ *
+ * The callbacks are passed arrays that belong to the routine and are only
+ * valid during the call. A callback can stop the computation by returning a
+ * value other than \link FNFT_SUCCESS \endlink. The routine then returns
+ * \link FNFT_EC_STOPPED \endlink without printing an error message.
+ *
+ * @var fnft_nsev_sink_t::ctx
+ *  Pointer that is passed to the callbacks, e.g. to the state of the
+ *  consumer.
+ * @var fnft_nsev_sink_t::contspec
+ *  Called once for every block of consecutive points of the continuous
+ *  spectrum, in ascending order. The block consists of the n points
+ *  first, ..., first+n-1 of the grid. The values have the same layout as
+ *  the contspec array of \link fnft_nsev \endlink for a grid with n
+ *  points, e.g. n values of a followed by n values of b for
+ *  fnft_nsev_cstype_AB. If NULL, the continuous spectrum is not computed.
+ * @var fnft_nsev_sink_t::discspec
+ *  Called once for every block of bound states that have survived the
+ *  filtering. The n bound states are followed by their norming constants
+ *  and/or residues, which have the same layout as the
+ *  normconsts_or_residues array of \link fnft_nsev \endlink for K=n. The
+ *  latter is NULL if normconsts_flag is zero. If NULL, the discrete
+ *  spectrum is not computed.
+ * @var fnft_nsev_sink_t::block_len
+ *  Maximum number of points or bound states per block. Zero means that
+ *  every spectrum is delivered in one block. Every block of the
+ *  continuous spectrum costs one chirp transform of length about deg+n,
+ *  where deg is the degree of the transfer matrix. Blocks that are much
+ *  shorter than deg thus increase the run time.
+ * @var fnft_nsev_sink_t::normconsts_flag
+ *  If nonzero, norming constants and/or residues are computed, see
+ *  fnft_nsev_opts_t::discspec_type.
+ * @ingroup data_types
+ */
+typedef struct {
+    void *ctx;
+    FNFT_INT (*contspec)(void *ctx, FNFT_UINT first, FNFT_UINT n,
+        FNFT_COMPLEX const *vals);
+    FNFT_INT (*discspec)(void *ctx, FNFT_UINT n,
+        FNFT_COMPLEX const *bound_states,
+        FNFT_COMPLEX const *normconsts_or_residues);
+    FNFT_UINT block_len;
+    FNFT_INT normconsts_flag;
+} fnft_nsev_sink_t;
+
+/**
+ * @brief Fast nonlinear Fourier transform that delivers the results to
+ *  callbacks instead of preallocated arrays.
+ *
+ * Same as \link fnft_nsev \endlink, but the continuous spectrum is passed
+ * to sink->contspec block by block as soon as each block has been computed,
+ * and the bound states are passed to sink->discspec once they have survived
+ * the filtering. The user therefore does not have to allocate arrays for
+ * the worst case (see \link fnft_nsev_max_K \endlink), and consumers can
+ * start to process the first blocks early. Internally, the memory needed
+ * for the results is proportional to the block length and to the number of
+ * bound states that have actually been found. (The fast eigenvalue method
+ * still needs a buffer for all roots of the polynomial while it runs.)
+ *
+ * The bound states can only be localized with
+ * fnft_nsev_bsloc_FAST_EIGENVALUE or fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE,
+ * since fnft_nsev_bsloc_NEWTON needs initial guesses.
+ *
+ * @param[in] D See \link fnft_nsev \endlink.
+ * @param[in] q See \link fnft_nsev \endlink.
+ * @param[in] T See \link fnft_nsev \endlink.
+ * @param[in] M See \link fnft_nsev \endlink.
+ * @param[in] XI See \link fnft_nsev \endlink. Can be NULL if
+ *  sink->contspec is NULL.
+ * @param[in] kappa See \link fnft_nsev \endlink.
+ * @param[in] opts See \link fnft_nsev \endlink.
+ * @param[in] sink Callbacks that receive the results, see \link
+ *  fnft_nsev_sink_t \endlink.
+ * @return \link FNFT_SUCCESS \endlink, \link FNFT_EC_STOPPED \endlink if
+ *  a callback has stopped the computation, or one of the other FNFT_EC_...
+ *  error codes defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_sink(const FNFT_UINT D, FNFT_COMPLEX * const q,
+    FNFT_REAL const * const T, const FNFT_UINT M,
+    FNFT_REAL const * const XI, const FNFT_INT kappa,
+    fnft_nsev_opts_t *opts, fnft_nsev_sink_t const * const sink);
+
+/**
+ * @brief Stages of \link fnft_nsev_progressive \endlink, in the order in
+ *  which they are delivered.
+ *
+ * fnft_nsev_stage_COARSE_CONTSPEC: Continuous spectrum of a subsampled
+ *  version of the signal. Skipped if the continuous spectrum is not
+ *  computed.\n
+ * fnft_nsev_stage_COARSE_BOUND_STATES: Bound states of the subsampled
+ *  signal. Skipped if the bound states are not computed.\n
+ * fnft_nsev_stage_CONTSPEC: Continuous spectrum of the full signal. Skipped
+ *  if the continuous spectrum is not computed.\n
+ * fnft_nsev_stage_REFINED: Refined bound states and their norming constants
+ *  and/or residues. Always delivered last.
+ *
+ * @ingroup data_types
+ */
+typedef enum {
+    fnft_nsev_stage_COARSE_CONTSPEC,
+    fnft_nsev_stage_COARSE_BOUND_STATES,
+    fnft_nsev_stage_CONTSPEC,
+    fnft_nsev_stage_REFINED
+} fnft_nsev_stage_t;
+
+/**
+ * @brief Receives the results of \link fnft_nsev_progressive \endlink.
+ *
+ * @var fnft_nsev_progress_t::ctx
+ *  Pointer that is passed to the callback, e.g. to the state of the
+ *  consumer.
+ * @var fnft_nsev_progress_t::deliver
+ *  Called once after every stage with the current results: the stage, the
+ *  number of samples D_used of the signal that the new results are based
+ *  on, the number of points M and the continuous spectrum contspec (same
+ *  layout as in \link fnft_nsev \endlink, NULL if M is zero), the K bound
+ *  states bound_states (NULL if they are not computed or not known yet;
+ *  their values are from the coarse stage until the final stage, K=0 if
+ *  bound_states is NULL) and the norming constants
+ *  and/or residues normconsts_or_residues (same layout as in \link
+ *  fnft_nsev \endlink, NULL before the final stage or if normconsts_flag is
+ *  zero). The arrays belong to the routine and are only valid during the
+ *  call. If the callback returns a value other than \link FNFT_SUCCESS
+ *  \endlink, the computation stops, and the routine returns \link
+ *  FNFT_EC_STOPPED \endlink without printing an error message. The return
+ *  value of the call for the final stage is ignored.
+ * @var fnft_nsev_progress_t::discspec_flag
+ *  If nonzero, the bound states are computed (only in the focusing case).
+ * @var fnft_nsev_progress_t::normconsts_flag
+ *  If nonzero, norming constants and/or residues are computed in the final
+ *  stage, see fnft_nsev_opts_t::discspec_type.
+ * @ingroup data_types
+ */
+typedef struct {
+    void *ctx;
+    FNFT_INT (*deliver)(void *ctx, fnft_nsev_stage_t stage,
+        FNFT_UINT D_used, FNFT_UINT M, FNFT_COMPLEX const *contspec,
+        FNFT_UINT K, FNFT_COMPLEX const *bound_states,
+        FNFT_COMPLEX const *normconsts_or_residues);
+    FNFT_INT discspec_flag;
+    FNFT_INT normconsts_flag;
+} fnft_nsev_progress_t;
+
+/**
+ * @brief Fast nonlinear Fourier transform that delivers coarse results
+ *  first and refines them afterwards.
+ *
+ * Same as \link fnft_nsev \endlink, but the results are passed to
+ * progress->deliver in several stages (see \link fnft_nsev_stage_t
+ * \endlink), so that interactive consumers can show coarse results quickly
+ * and stop early. The coarse stages use the subsampled signal of
+ * fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE, which has about
+ * sqrt(D)*log2(D) samples. Its transfer matrix is computed once. The
+ * coarse continuous spectrum is computed from it with a chirp transform
+ * and is typically available after a small fraction of the total run time.
+ * It is only accurate for small |xi|. The coarse bound states are the roots
+ * of the transfer matrix found by the fast eigenvalue method. They are
+ * reused as the initial guesses of Newton's method in the final stage,
+ * i.e., the bound states are always localized as with
+ * fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE. The final results agree with those
+ * of \link fnft_nsev \endlink for this method. fnft_nsev_opts_t::symmetry
+ * is ignored.
+ *
+ * @param[in] D See \link fnft_nsev \endlink.
+ * @param[in] q See \link fnft_nsev \endlink.
+ * @param[in] T See \link fnft_nsev \endlink.
+ * @param[in] M See \link fnft_nsev \endlink. The continuous spectrum is not
+ *  computed if M is zero.
+ * @param[in] XI See \link fnft_nsev \endlink. Can be NULL if M is zero.
+ * @param[in] kappa See \link fnft_nsev \endlink.
+ * @param[in] opts See \link fnft_nsev \endlink.
+ * @param[in] progress Callback that receives the results, see \link
+ *  fnft_nsev_progress_t \endlink.
+ * @return \link FNFT_SUCCESS \endlink, \link FNFT_EC_STOPPED \endlink if
+ *  the callback has stopped the computation, or one of the other
+ *  FNFT_EC_... error codes defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_progressive(const FNFT_UINT D, FNFT_COMPLEX * const q,
+    FNFT_REAL const * const T, const FNFT_UINT M,
+    FNFT_REAL const * const XI, const FNFT_INT kappa,
+    fnft_nsev_opts_t *opts, fnft_nsev_progress_t const * const progress);
+
+/**
+ * @brief Fast nonlinear Fourier transform of several signals with the same
+ *  number of samples.
+ *
+ * Computes the same spectra as nsig calls of \link fnft_nsev \endlink for
+ * signals that share D, T, kappa and the options, but processes the
+ * signals in lockstep where this pays off. The scattering matrices of all
+ * signals are multiplied together on the lower levels of the product trees
+ * with loops over the signals that the compiler vectorizes, the FFT plans of
+ * the higher levels are created only once, and the continuous spectra of
+ * all signals are computed with chirp transforms that share one plan. This
+ * is considerably faster than separate calls for many short signals (e.g.
+ * D between 64 and 1024). The discrete spectra are computed signal by
+ * signal from the transfer matrices that have been computed in lockstep.
+ *
+ * The results agree with those of \link fnft_nsev \endlink up to rounding
+ * errors. fnft_nsev_opts_t::symmetry only affects the discrete spectra.
+ *
+ * @param[in] nsig Number of signals.
+ * @param[in] D Number of samples per signal.
+ * @param[in] q Array of length nsig*D. The samples of the t-th signal are
+ *  q[t*D], ..., q[t*D+D-1], see \link fnft_nsev \endlink.
+ * @param[in] T See \link fnft_nsev \endlink.
+ * @param[in] M See \link fnft_nsev \endlink.
+ * @param[out] contspec Array of length nsig*M (nsig*2*M for
+ *  fnft_nsev_cstype_AB, nsig*3*M for fnft_nsev_cstype_BOTH) or NULL. The
+ *  continuous spectrum of the t-th signal is stored from
+ *  contspec[t*M] (contspec[t*2*M], contspec[t*3*M]) on in the same layout
+ *  as in \link fnft_nsev \endlink.
+ * @param[in] XI See \link fnft_nsev \endlink.
+ * @param[in] K_max Maximum number of bound states per signal.
+ * @param[out] K Array of length nsig. Upon return, K[t] is the number of
+ *  bound states of the t-th signal. Can be NULL if bound_states is NULL.
+ * @param[out] bound_states Array of length nsig*K_max or NULL. The bound
+ *  states of the t-th signal are stored in bound_states[t*K_max], ...,
+ *  bound_states[t*K_max+K[t]-1].
+ * @param[out] normconsts_or_residues Array of length nsig*K_max
+ *  (nsig*2*K_max for fnft_nsev_dstype_BOTH) or NULL. The values of the t-th
+ *  signal are stored from normconsts_or_residues[t*K_max]
+ *  (normconsts_or_residues[t*2*K_max]) on in the same layout as in \link
+ *  fnft_nsev \endlink.
+ * @param[in] kappa See \link fnft_nsev \endlink.
+ * @param[in] opts See \link fnft_nsev \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink. The computation stops at the
+ *  first signal for which an error occurs.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_multi(const FNFT_UINT nsig, const FNFT_UINT D,
+    FNFT_COMPLEX * const q, FNFT_REAL const * const T, const FNFT_UINT M,
+    FNFT_COMPLEX * const contspec, FNFT_REAL const * const XI,
+    const FNFT_UINT K_max, FNFT_UINT * const K,
+    FNFT_COMPLEX * const bound_states,
+    FNFT_COMPLEX * const normconsts_or_residues, const FNFT_INT kappa,
+    fnft_nsev_opts_t *opts);
+
+/**
+ * @brief Fast nonlinear Fourier transform with an automatically chosen
+ *  number of samples.
+ *
+ * Signals are often sampled much finer than needed to be safe, which makes
+ * \link fnft_nsev \endlink unnecessarily expensive. This routine applies
+ * \link fnft_nsev \endlink to subsampled versions of the given signal (every
+ * r-th sample, starting with the first one) and returns the results of the
+ * coarsest subsampled signal whose estimated discretization error is below
+ * tol.
+ *
+ * All discretizations converge quadratically, i.e., the error for the step
+ * size r*eps_t is approximately C*r^2, where eps_t=(T[1]-T[0])/(D-1). The
+ * routine starts with runs for about 32 and 64 samples, estimates the error
+ * from the difference of two consecutive runs (Richardson extrapolation) and
+ * predicts the largest subsampling factor r for which the error will be
+ * below tol. This is repeated with the new run until the estimated error is
+ * below tol or all samples are used. The number of samples grows by at most
+ * a factor of eight per run. Since the errors of coarse runs are often
+ * larger than predicted, one coarser run is tried at the end if the last
+ * run is more accurate than needed. The estimated error is the larger one of the
+ * maximum absolute error of the values in contspec and the Hausdorff
+ * distance of the bound states. The norming constants and residues are not
+ * taken into account.
+ *
+ * The subsampled signals cover the interval [T[0], T[0]+(D_used-1)*r*eps_t],
+ * where D_used=(D-1)/r+1. The signal thus should have decayed at the end.
+ *
+ * @param[in] D Number of samples. Should be at least three.
+ * @param[in] q See \link fnft_nsev \endlink.
+ * @param[in] T See \link fnft_nsev \endlink.
+ * @param[in] M See \link fnft_nsev \endlink.
+ * @param[out] contspec See \link fnft_nsev \endlink.
+ * @param[in] XI See \link fnft_nsev \endlink.
+ * @param[in,out] K_ptr See \link fnft_nsev \endlink.
+ * @param[in,out] bound_states See \link fnft_nsev \endlink. For
+ *  fnft_nsev_bsloc_NEWTON, the same initial guesses are used for every
+ *  run.
+ * @param[out] normconsts_or_residues See \link fnft_nsev \endlink.
+ * @param[in] kappa See \link fnft_nsev \endlink.
+ * @param[in] opts See \link fnft_nsev \endlink.
+ * @param[in] tol Target accuracy (absolute). Should be positive. At least
+ *  one of contspec and bound_states should not be NULL.
+ * @param[out] D_used_ptr Upon return, *D_used_ptr contains the number of
+ *  samples of the subsampled signal whose results have been returned.
+ * @param[out] err_est_ptr Upon return, *err_est_ptr contains the estimated
+ *  error of the returned results. If it is larger than tol, the target
+ *  accuracy could not be reached with the given samples (D_used=D), and a
+ *  warning is printed.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_auto(const FNFT_UINT D, FNFT_COMPLEX * const q,
+    FNFT_REAL const * const T, const FNFT_UINT M,
+    FNFT_COMPLEX * const contspec, FNFT_REAL const * const XI,
+    FNFT_UINT * const K_ptr, FNFT_COMPLEX * const bound_states,
+    FNFT_COMPLEX * const normconsts_or_residues, const FNFT_INT kappa,
+    fnft_nsev_opts_t *opts, const FNFT_REAL tol,
+    FNFT_UINT * const D_used_ptr, FNFT_REAL * const err_est_ptr);
+
+/**
+ * @brief Opaque object that stores the transfer matrix of a signal.
+ *
+ * Objects of this type are created with \link fnft_nsev_tm_create \endlink
+ * and released with \link fnft_nsev_tm_free \endlink. They store a copy of
+ * the signal and, once it has been computed, the polynomial approximation of
+ * the transfer matrix (including its normalization exponent) that
+ * \link fnft_nsev \endlink computes internally. The continuous spectrum,
+ * the discrete spectrum and the values of \f$ a(\lambda) \f$ and
+ * \f$ b(\lambda) \f$ can then be queried several times without repeating
+ * the fast forward scattering step.
+ * @ingroup data_types
+ */
+typedef struct fnft_nsev_tm_s fnft_nsev_tm_t;
+
+/**
+ * @brief Creates a transfer matrix object for a given signal.
+ *
+ * The transfer matrix is computed when the first query that needs it is
+ * made. Queries on the same object must not be run concurrently.
+ *
+ * @param[in] D Number of samples. See \link fnft_nsev \endlink.
+ * @param[in] q Array of length D with the samples of the signal. See
+ *  \link fnft_nsev \endlink. The object keeps its own copy of q.
+ * @param[in] T Array of length 2 with the position in time of the first and
+ *  of the last sample. See \link fnft_nsev \endlink.
+ * @param[in] kappa =+1 for the focusing nonlinear Schroedinger equation,
+ *  =-1 for the defocusing one
+ * @param[in] opts Pointer to a \link fnft_nsev_opts_t \endlink object. The
+ *  options are used by all queries unless a query is passed options of its
+ *  own. The fields discretization and normalization_flag are fixed for the
+ *  lifetime of the object. If NULL is passed, the default options are used.
+ * @param[out] tm_ptr Upon successful return, *tm_ptr points to the new
+ *  object. It has to be released with \link fnft_nsev_tm_free \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_create(const FNFT_UINT D, FNFT_COMPLEX const * const q,
+    FNFT_REAL const * const T, const FNFT_INT kappa,
+    fnft_nsev_opts_t const * const opts, fnft_nsev_tm_t ** const tm_ptr);
+
+/**
+ * @brief Computes the continuous spectrum from a transfer matrix object.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ * @param[in] M Number of points in the grid. See \link fnft_nsev \endlink.
+ * @param[out] contspec Array in which the continuous spectrum is stored. Its
+ *  length and content depend on opts->contspec_type as in
+ *  \link fnft_nsev \endlink.
+ * @param[in] XI Array of length 2 with the first and last point of the
+ *  grid. It should be XI[0]<XI[1].
+ * @param[in] opts Options for this query. Only the field contspec_type is
+ *  used. If NULL is passed, the options of the object are used.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_contspec(fnft_nsev_tm_t * const tm, const FNFT_UINT M,
+    FNFT_COMPLEX * const contspec, FNFT_REAL const * const XI,
+    fnft_nsev_opts_t const * const opts);
+
+/**
+ * @brief Computes the discrete spectrum from a transfer matrix object.
+ *
+ * The transfer matrix is only computed (or reused) if the localization
+ * method is fnft_nsev_bsloc_FAST_EIGENVALUE. The other methods work on the
+ * stored copy of the signal. See \link fnft_nsev_tm_import \endlink for
+ * objects that do not store the signal.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ * @param[in,out] K_ptr See \link fnft_nsev \endlink.
+ * @param[in,out] bound_states See \link fnft_nsev \endlink.
+ * @param[out] normconsts_or_residues See \link fnft_nsev \endlink. Can be
+ *  NULL.
+ * @param[in] opts Options for this query. The fields discretization and
+ *  normalization_flag are ignored. If NULL is passed, the options of the
+ *  object are used.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_discspec(fnft_nsev_tm_t * const tm,
+    FNFT_UINT * const K_ptr, FNFT_COMPLEX * const bound_states,
+    FNFT_COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t const * const opts);
+
+/**
+ * @brief Evaluates \f$ a(\lambda) \f$ and \f$ b(\lambda) \f$ at
+ * arbitrary points using a transfer matrix object.
+ *
+ * The polynomials in the transfer matrix are evaluated directly, which
+ * costs \f$ O(D) \f$ operations per point. On real grids with many
+ * points, \link fnft_nsev_tm_contspec \endlink is faster. For real
+ * \f$ \lambda \f$, the results match those of
+ * \link fnft_nsev_tm_contspec \endlink with contspec_type
+ * fnft_nsev_cstype_AB.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ * @param[in] N Number of points.
+ * @param[in] lambda Array of length N with the (complex) points.
+ * @param[out] a_vals Array of length N in which the values of
+ *  \f$ a(\lambda) \f$ are stored. Can be NULL.
+ * @param[out] b_vals Array of length N in which the values of
+ *  \f$ b(\lambda) \f$ are stored. Can be NULL.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_ab(fnft_nsev_tm_t * const tm, const FNFT_UINT N,
+    FNFT_COMPLEX const * const lambda, FNFT_COMPLEX * const a_vals,
+    FNFT_COMPLEX * const b_vals);
+
+/**
+ * @brief Evaluates \f$ a(\lambda) \f$ and \f$ b(\lambda) \f$ on a
+ * rectangular grid in the complex plane using a transfer matrix object.
+ *
+ * The grid consists of the points \f$ \lambda_{r,m} = \xi_m + j\eta_r \f$,
+ * where \f$ \xi_m = XI[0] + m(XI[1]-XI[0])/(M-1) \f$ and \f$ \eta_r =
+ * ETA[0] + r(ETA[1]-ETA[0])/(N-1) \f$. Every row of the grid is mapped onto
+ * an arc of a circle around the origin in the domain of the polynomials in
+ * the transfer matrix. The polynomials are therefore evaluated with one
+ * chirp transform per row and polynomial, where the FFT plans are shared
+ * between the rows. The costs are \f$ O(N(D+M)\log(D+M)) \f$ operations,
+ * compared to \f$ O(NMD) \f$ for \link fnft_nsev_tm_ab \endlink. This is
+ * useful, e.g., to plot \f$ |a(\lambda)| \f$ over a region of the upper
+ * half plane in order to diagnose missed or spurious bound states.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ * @param[in] M Number of points per row, M>=2.
+ * @param[in] XI Array of length 2 with the real parts of the first and the
+ *  last point in every row. It should be XI[0]<XI[1].
+ * @param[in] N Number of rows.
+ * @param[in] ETA Array of length 2 with the imaginary parts of the first and
+ *  the last row. It should be ETA[0]<ETA[1] if N>1. If N=1, only ETA[0] is
+ *  used.
+ * @param[out] a_vals Array of length N*M. The value of \f$ a(\lambda_{r,m})
+ *  \f$ is stored in a_vals[r*M+m]. Can be NULL.
+ * @param[out] b_vals Array of length N*M. The value of \f$ b(\lambda_{r,m})
+ *  \f$ is stored in b_vals[r*M+m]. Can be NULL.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_ab_grid(fnft_nsev_tm_t * const tm, const FNFT_UINT M,
+    FNFT_REAL const * const XI, const FNFT_UINT N,
+    FNFT_REAL const * const ETA, FNFT_COMPLEX * const a_vals,
+    FNFT_COMPLEX * const b_vals);
+
+/**
+ * @brief Computes the left or right Jost solutions of the signal stored in a
+ * transfer matrix object at all sample times.
+ *
+ * The Jost solutions are computed with the Boffetta-Osborne scheme (see
+ * \link fnft_nse_discretization_t \endlink), independently of the
+ * discretization of the object. For a bound state \f$ \lambda_k \f$, the
+ * left and right Jost solutions are related by \f$ \phi(t,\lambda_k) =
+ * b_k\psi(t,\lambda_k) \f$, where \f$ b_k \f$ is the norming constant.
+ * The values of \f$ \lambda \f$ are propagated through the signal together
+ * in blocks of eight, which are distributed over the number of threads given
+ * by \link fnft_nsev_opts_t::nthreads \endlink in the options of the
+ * object. The costs are \f$ O(DK) \f$ operations.
+ *
+ * @param[in] tm Object created with \link fnft_nsev_tm_create \endlink. Objects
+ *  that do not store the signal (see \link fnft_nsev_tm_import \endlink) are
+ *  not supported.
+ * @param[in] K Number of values of \f$ \lambda \f$.
+ * @param[in] lambda Array of length K with the (complex) values of
+ *  \f$ \lambda \f$.
+ * @param[out] jost Array of length 2*D*K. The first and second components of
+ *  the Jost solution for lambda[k] at the sample time \f$ t_n \f$ (see
+ *  \link fnft_nsev \endlink) are stored in jost[2*D*k+n] and
+ *  jost[2*D*k+D+n], respectively.
+ * @param[in] type Specifies which Jost solution is computed. See
+ *  \link fnft_nsev_jost_t \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_jost(fnft_nsev_tm_t const * const tm, const FNFT_UINT K,
+    FNFT_COMPLEX const * const lambda, FNFT_COMPLEX * const jost,
+    const fnft_nsev_jost_t type);
+
+/**
+ * @brief Exports a transfer matrix object into a compact binary format.
+ *
+ * The exported data contains the polynomial entries of the transfer matrix,
+ * their normalization exponent and the information that is needed to
+ * compute spectra from them (number of samples, time window, kappa,
+ * discretization, squared L2 norm of the signal). The signal itself is not
+ * exported. The format is versioned. Numbers are stored in the native byte
+ * order. Exported transfer matrices of consecutive segments of a signal can
+ * be imported on another machine with \link fnft_nsev_tm_import \endlink
+ * and combined with \link fnft_nsev_tm_merge \endlink.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ *  The transfer matrix is computed if this has not been done before.
+ * @param[in,out] len_ptr Upon entry, *len_ptr should contain the length of
+ *  buf in bytes. Upon return, *len_ptr contains the number of bytes used.
+ * @param[out] buf Buffer for the exported data. If NULL is passed, only the
+ *  required length is stored in *len_ptr.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_export(fnft_nsev_tm_t * const tm,
+    FNFT_UINT * const len_ptr, void * const buf);
+
+/**
+ * @brief Imports a transfer matrix object that has been exported with
+ * \link fnft_nsev_tm_export \endlink.
+ *
+ * Since the signal is not part of the exported data, imported objects only
+ * support the localization method fnft_nsev_bsloc_FAST_EIGENVALUE.
+ * (fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE falls back to this method.) Their
+ * norming constants and residues are obtained by evaluating the polynomials
+ * in the transfer matrix at the bound states. This is ill-conditioned for
+ * bound states far away from the real axis, in particular for long time
+ * windows.
+ *
+ * @param[in] len Length of buf in bytes.
+ * @param[in] buf Exported data.
+ * @param[in] opts Options for the queries on the new object, see
+ *  \link fnft_nsev_tm_create \endlink. The discretization and the
+ *  normalization flag are taken from the exported data.
+ * @param[out] tm_ptr Upon successful return, *tm_ptr points to the new
+ *  object. It has to be released with \link fnft_nsev_tm_free \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_import(const FNFT_UINT len, void const * const buf,
+    fnft_nsev_opts_t const * const opts, fnft_nsev_tm_t ** const tm_ptr);
+
+/**
+ * @brief Saves a transfer matrix object to a file.
+ *
+ * Writes the data produced by \link fnft_nsev_tm_export \endlink to the
+ * given file.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ * @param[in] filename Name of the file.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_save(fnft_nsev_tm_t * const tm,
+    char const * const filename);
+
+/**
+ * @brief Loads a transfer matrix object from a file written by
+ * \link fnft_nsev_tm_save \endlink.
+ *
+ * See \link fnft_nsev_tm_import \endlink.
+ *
+ * @param[in] filename Name of the file.
+ * @param[in] opts See \link fnft_nsev_tm_import \endlink.
+ * @param[out] tm_ptr See \link fnft_nsev_tm_import \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_load(char const * const filename,
+    fnft_nsev_opts_t const * const opts, fnft_nsev_tm_t ** const tm_ptr);
+
+/**
+ * @brief Merges the transfer matrix objects of consecutive segments of a
+ * signal.
+ *
+ * The transfer matrices are multiplied pairwise with the same FFT-based
+ * polynomial multiplication that \link fnft_nsev \endlink uses. The
+ * phase factors that relate the polynomials to \f$ a(\lambda) \f$ and
+ * \f$ b(\lambda) \f$ are determined by the time window of the merged
+ * object. The result is therefore the same (up to rounding errors) as if
+ * the transfer matrix had been computed for the whole signal at once.
+ *
+ * @param[in] n Number of segments.
+ * @param[in] tms Array of n objects. The segments have to be given in
+ *  ascending order w.r.t. time. They must have the same step size,
+ *  discretization, normalization flag and kappa, and the first sample of
+ *  each segment must follow the last sample of the previous segment after
+ *  one step. The objects are not released.
+ * @param[out] tm_ptr Upon successful return, *tm_ptr points to the merged
+ *  object. It has to be released with \link fnft_nsev_tm_free \endlink.
+ *  It stores the combined signal only if all segments store their signals.
+ *  Its options are those of the first segment.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_merge(const FNFT_UINT n,
+    fnft_nsev_tm_t * const * const tms, fnft_nsev_tm_t ** const tm_ptr);
+
+/**
+ * @brief Replaces samples of the signal of a transfer matrix object.
+ *
+ * On the first call, the scattering matrices of the individual samples and
+ * all intermediate products that occur during their multiplication are
+ * computed and stored in the object. This requires about log2(D)+1 times
+ * the memory of the transfer matrix. Subsequent calls only recompute the
+ * products on the paths from the changed samples to the transfer matrix,
+ * which for a few changed samples is much faster than recomputing the
+ * transfer matrix from scratch.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ *  It has to store the signal.
+ * @param[in] N Number of changed samples.
+ * @param[in] indices Array of length N with the (zero-based) indices of the
+ *  changed samples.
+ * @param[in] q_new Array of length N with the new values of the samples.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_update(fnft_nsev_tm_t * const tm, const FNFT_UINT N,
+    FNFT_UINT const * const indices, FNFT_COMPLEX const * const q_new);
+
+/**
+ * @brief Computes the gradient of a real-valued function of the spectrum
+ * w.r.t. the samples of the signal of a transfer matrix object.
+ *
+ * Let \f$ L \f$ be a real-valued function of the continuous spectrum
+ * \f$ c_i \f$ returned by \link fnft_nsev_tm_contspec \endlink, of bound
+ * states \f$ \lambda_k \f$ and of the norming constants \f$ b_k \f$. Given
+ * the partial derivatives \f$ \partial L/\partial \Re c_i + j\partial
+ * L/\partial \Im c_i \f$ (and similarly for \f$ \lambda_k \f$ and
+ * \f$ b_k \f$), this routine computes \f$ \partial L/\partial \Re q_n +
+ * j\partial L/\partial \Im q_n \f$ for all samples \f$ q_n \f$. The
+ * derivatives are propagated backwards through the stored intermediate
+ * products of the transfer matrix (see \link fnft_nsev_tm_update \endlink),
+ * which costs about as much as two computations of the transfer matrix
+ * instead of D as with finite differences. The derivatives of the
+ * scattering matrices of the individual samples are computed analytically.
+ *
+ * The derivatives w.r.t. the discrete spectrum are those of the roots of the
+ * polynomial approximation of \f$ a(\lambda) \f$, as found with
+ * fnft_nsev_bsloc_FAST_EIGENVALUE, and of the norming constants obtained by
+ * evaluating the polynomial approximation of \f$ b(\lambda) \f$ at these
+ * roots (see \link fnft_nsev_tm_import \endlink). They approximate the
+ * derivatives of the results of the other methods up to the discretization
+ * error. Derivatives w.r.t. residues are not supported.
+ *
+ * @param[in,out] tm Object created with \link fnft_nsev_tm_create \endlink.
+ *  It has to store the signal.
+ * @param[in] M Number of points in the grid of the continuous spectrum.
+ * @param[in] XI Array of length 2 with the first and last point of the
+ *  grid. See \link fnft_nsev_tm_contspec \endlink.
+ * @param[in] contspec_grad Partial derivatives w.r.t. the continuous
+ *  spectrum. The length and layout are the same as those of the continuous
+ *  spectrum returned by \link fnft_nsev_tm_contspec \endlink for
+ *  opts->contspec_type. Can be NULL.
+ * @param[in] K Number of bound states.
+ * @param[in] bound_states Array of length K with bound states as returned by
+ *  \link fnft_nsev_tm_discspec \endlink.
+ * @param[in] bound_states_grad Array of length K with the partial derivatives
+ *  w.r.t. the bound states. Can be NULL.
+ * @param[in] normconsts_grad Array of length K with the partial derivatives
+ *  w.r.t. the norming constants. Can be NULL.
+ * @param[out] q_grad Array of length D in which the gradient is stored.
+ * @param[in] opts Options for this query. Only the field contspec_type is
+ *  used. If NULL is passed, the options of the object are used.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ *
+ * @ingroup fnft
+ */
+FNFT_INT fnft_nsev_tm_gradient(fnft_nsev_tm_t * const tm, const FNFT_UINT M,
+    FNFT_REAL const * const XI, FNFT_COMPLEX const * const contspec_grad,
+    const FNFT_UINT K, FNFT_COMPLEX const * const bound_states,
+    FNFT_COMPLEX const * const bound_states_grad,
+    FNFT_COMPLEX const * const normconsts_grad, FNFT_COMPLEX * const q_grad,
+    fnft_nsev_opts_t const * const opts);
+
+/**
+ * @brief Releases a transfer matrix object.
+ *
+ * @param[in] tm Object created with \link fnft_nsev_tm_create \endlink.
+ *  Passing NULL is allowed.
+ *
+ * @ingroup fnft
+ */
+void fnft_nsev_tm_free(fnft_nsev_tm_t * const tm);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define nsev_bsfilt_NONE fnft_nsev_bsfilt_NONE
 #define nsev_bsfilt_BASIC fnft_nsev_bsfilt_BASIC
@@ -292,6 +1109,15 @@ FNFT_INT fnft_nsev(const FNFT_UINT D, FNFT_COMPLEX * const q,
 #define nsev_cstype_REFLECTION_COEFFICIENT fnft_nsev_cstype_REFLECTION_COEFFICIENT
 #define nsev_cstype_AB fnft_nsev_cstype_AB
 #define nsev_cstype_BOTH fnft_nsev_cstype_BOTH
+#define nsev_symmetry_NONE fnft_nsev_symmetry_NONE
+#define nsev_symmetry_REAL fnft_nsev_symmetry_REAL
+#define nsev_symmetry_DETECT fnft_nsev_symmetry_DETECT
+#define nsev_jost_LEFT fnft_nsev_jost_LEFT
+#define nsev_jost_RIGHT fnft_nsev_jost_RIGHT
+#define nsev_stage_COARSE_CONTSPEC fnft_nsev_stage_COARSE_CONTSPEC
+#define nsev_stage_COARSE_BOUND_STATES fnft_nsev_stage_COARSE_BOUND_STATES
+#define nsev_stage_CONTSPEC fnft_nsev_stage_CONTSPEC
+#define nsev_stage_REFINED fnft_nsev_stage_REFINED
 #endif
 
 #endif
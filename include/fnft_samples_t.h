@@ -0,0 +1,90 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+/**
+ * @file fnft_samples_t.h
+ * @brief Describes signals that are stored in formats other than arrays of
+ *  FNFT_COMPLEX values.
+ * @ingroup fnft
+ */
+#ifndef FNFT_SAMPLES_T_H
+#define FNFT_SAMPLES_T_H
+
+#include "fnft.h"
+
+/**
+ * Enum that specifies how the samples of a signal are stored. Used in
+ * \link fnft_samples_t \endlink.\n \n
+ * fnft_samples_format_COMPLEX: Array of FNFT_COMPLEX values.\n \n
+ * fnft_samples_format_INT16_INTERLEAVED and
+ * fnft_samples_format_FLOAT32_INTERLEAVED: Array of int16_t or float values
+ * in which the real part of every sample is followed by its imaginary part
+ * (IQ format).\n \n
+ * fnft_samples_format_INT16_SPLIT and fnft_samples_format_FLOAT32_SPLIT: Two
+ * arrays of int16_t or float values that contain the real and the imaginary
+ * parts of the samples, respectively.
+ * @ingroup data_types
+ */
+typedef enum {
+    fnft_samples_format_COMPLEX,
+    fnft_samples_format_INT16_INTERLEAVED,
+    fnft_samples_format_FLOAT32_INTERLEAVED,
+    fnft_samples_format_INT16_SPLIT,
+    fnft_samples_format_FLOAT32_SPLIT
+} fnft_samples_format_t;
+
+/**
+ * @brief Describes the samples of a signal.
+ *
+ * The n-th sample of the signal is scale*(re[n] + j*im[n]), where re[n] and
+ * im[n] are the real and imaginary parts of the n-th stored value. Routines
+ * that accept signals in this form convert the samples when they are
+ * needed instead of creating a converted copy of the signal.
+ *
+ * @var fnft_samples_t::format
+ *  Format of the stored values, see \link fnft_samples_format_t \endlink.
+ * @var fnft_samples_t::data
+ *  Array of values in the given format. For the split formats, this array
+ *  contains the real parts.
+ * @var fnft_samples_t::imag
+ *  Array of the imaginary parts for the split formats. Ignored for the other
+ *  formats.
+ * @var fnft_samples_t::scale
+ *  Scale factor that is applied to all samples, e.g. to convert integer
+ *  values into physical units.
+ * @ingroup data_types
+ */
+typedef struct {
+    fnft_samples_format_t format;
+    void const *data;
+    void const *imag;
+    FNFT_REAL scale;
+} fnft_samples_t;
+
+#ifdef FNFT_ENABLE_SHORT_NAMES
+#define samples_format_COMPLEX fnft_samples_format_COMPLEX
+#define samples_format_INT16_INTERLEAVED fnft_samples_format_INT16_INTERLEAVED
+#define samples_format_FLOAT32_INTERLEAVED fnft_samples_format_FLOAT32_INTERLEAVED
+#define samples_format_INT16_SPLIT fnft_samples_format_INT16_SPLIT
+#define samples_format_FLOAT32_SPLIT fnft_samples_format_FLOAT32_SPLIT
+#define samples_format_t fnft_samples_format_t
+#define samples_t fnft_samples_t
+#endif
+
+#endif
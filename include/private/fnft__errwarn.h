@@ -162,4 +162,15 @@ FNFT_INT fnft__errmsg_aux(const FNFT_INT ec, const char *func,
  */
 void fnft__warn_aux(const char *func, const FNFT_INT line, const char *msg);
 
+/**
+ * Auxiliary function that records an error (ec!=0) or a warning (ec=0) in
+ * the diagnostics buffer of the calling thread, see \link
+ * fnft_errwarn_setdiag \endlink. Returns 1 if the diagnostics mode is
+ * active for the calling thread (then nothing should be printed) and 0
+ * otherwise. Do not call directly.
+ * @ingroup private_errwarn
+ */
+FNFT_INT fnft__errwarn_record(const FNFT_INT ec, const char *func,
+    const FNFT_INT line, const char *msg);
+
 #endif
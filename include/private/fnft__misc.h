@@ -26,6 +26,7 @@
 #define FNFT__MISC_H
 
 #include "fnft.h"
+#include "fnft_samples_t.h"
 
 /**
  * @brief Helper function for debugging. Prints an array in MATLAB style.
@@ -57,6 +58,9 @@ FNFT_REAL fnft__misc_rel_err(FNFT_INT len, FNFT_COMPLEX *vec_numer,
  * 
  * @ingroup misc
  * This function computes the Hausdorff distance between two vectors vecA and vecB.
+ * The nearest neighbors are found with a k-d tree, so that typical spectra
+ * with N points need O(N log N) operations. Values that are not finite
+ * have the distance infinity to all other values.
  * @param[in] lenA Length of vector vecA.
  * @param[in] vecA Complex vector of length lenA.
  * @param[in] lenB length of vector vecB.
@@ -92,6 +96,21 @@ FNFT_COMPLEX fnft__misc_sech(FNFT_COMPLEX Z);
 FNFT_REAL fnft__misc_l2norm2(const FNFT_UINT N, FNFT_COMPLEX const * const Z,
     const FNFT_REAL a, const FNFT_REAL b);
 
+/**
+ * @brief Squared l2 norm of a signal in any sample format.
+ *
+ * @ingroup misc
+ * Same as \link fnft__misc_l2norm2 \endlink, but the signal is passed as
+ * a \link fnft_samples_t \endlink.
+ * @param[in] N Number of samples.
+ * @param[in] Z Description of the samples.
+ * @param[in] a Real number corresponding to first sample.
+ * @param[in] b Real number corresponding to last sample.
+ * @return Returns the quantity val. Returns NAN if N<2 or a>=b.
+ */
+FNFT_REAL fnft__misc_l2norm2_samples(const FNFT_UINT N,
+    fnft_samples_t const * const Z, const FNFT_REAL a, const FNFT_REAL b);
+
 /**
  * @brief Filters array by retaining elements inside a bounding box
  * 
@@ -160,6 +179,10 @@ FNFT_INT fnft__misc_filter_inv(FNFT_UINT * const N_ptr, FNFT_COMPLEX * const val
  * 
  * @ingroup misc
  * This function filters an array by merging elements if distance between the elements is less than tol.
+ * The values are processed in order. A value is removed if its distance to
+ * one of the values that have been kept before is less than tol. Values
+ * that are not finite are always kept. The kept values are stored in a
+ * hash table of grid cells, so that O(N) operations are needed on average.
  * @param[in,out] N_ptr It is the pointer to the number of elements to be filtered. On exit *N_ptr is overwritten with
  * the number of values that have survived fitering. Their values will be
  * moved to the beginning of vals. 
@@ -170,6 +193,17 @@ FNFT_INT fnft__misc_filter_inv(FNFT_UINT * const N_ptr, FNFT_COMPLEX * const val
 FNFT_INT fnft__misc_merge(FNFT_UINT *N_ptr, FNFT_COMPLEX * const vals,
     FNFT_REAL tol);
 
+/**
+ * @brief Number of samples of the subsampled signal.
+ *
+ * @ingroup misc
+ * Returns the number of samples Dsub that \link fnft__misc_downsample
+ * \endlink chooses for a signal with D>2 samples.
+ * @param[in] D Number of samples.
+ * @return Number of samples of the subsampled signal.
+ */
+FNFT_UINT fnft__misc_downsample_len(const FNFT_UINT D);
+
 /**
  * @brief Computes a subsampled version of array q.
  * 
@@ -178,19 +212,102 @@ FNFT_INT fnft__misc_merge(FNFT_UINT *N_ptr, FNFT_COMPLEX * const vals,
  * will allocate memory for the subsampled signal qsub and updates the
  * pointer *qsub_ptr such that it points to the newly allocated qsub. The
  * user is responsible to freeing the memory later. The new number of samples
- * Dsub>=2 and the subsampling factor D/Dsub are stored in *Dsub_ptr and
- * *subsampling_factor_ptr.
+ * Dsub>=2 and the subsampling factor are stored in *Dsub_ptr and
+ * *subsampling_factor_ptr. The subsampled signal consists of every
+ * subsampling_factor-th sample of q, starting with the first one. It
+ * thus covers (Dsub-1)*subsampling_factor+1<=D samples of q. For powers of
+ * two, Dsub is a power of two as well. Otherwise, Dsub may be arbitrary.
  * @param[in] q Complex valued array to be subsampled.
  * @param[in] D Number of samples in array q.
  * @param[out] qsub_ptr Pointer to the starting location of subsampled signal.
  * @param[out] Dsub_ptr Pointer to new number of samples.
- * @param[out] subsampling_factor_ptr Pointer to subsampling factor D/Dsub.
+ * @param[out] subsampling_factor_ptr Pointer to subsampling factor.
  * @return Returns SUCCESS or an error code.
  */
 FNFT_INT fnft__misc_downsample(FNFT_COMPLEX const * const q, const FNFT_UINT D,
     FNFT_COMPLEX ** qsub_ptr, FNFT_UINT * const Dsub_ptr,
     FNFT_UINT * const subsampling_factor_ptr);
 
+/**
+ * @brief Subsamples a signal in any sample format.
+ *
+ * @ingroup misc
+ * Same as \link fnft__misc_downsample \endlink, but the signal is passed
+ * as a \link fnft_samples_t \endlink. Only the samples that are kept are
+ * converted.
+ * @param[in] q Description of the samples to be subsampled.
+ * @param[in] D Number of samples.
+ * @param[out] qsub_ptr Pointer to the starting location of subsampled signal.
+ * @param[out] Dsub_ptr Pointer to new number of samples.
+ * @param[out] subsampling_factor_ptr Pointer to subsampling factor.
+ * @return Returns SUCCESS or an error code.
+ */
+FNFT_INT fnft__misc_downsample_samples(fnft_samples_t const * const q,
+    const FNFT_UINT D, FNFT_COMPLEX ** qsub_ptr, FNFT_UINT * const Dsub_ptr,
+    FNFT_UINT * const subsampling_factor_ptr);
+
+/**
+ * @brief Returns a single sample of a signal.
+ *
+ * @ingroup misc
+ * The conversion is inlined so that loops over the samples can read the
+ * stored values directly.
+ * @param[in] q Description of the samples, see \link fnft_samples_t
+ *  \endlink. The format is not checked.
+ * @param[in] i Index of the sample.
+ * @return The i-th sample, scaled by q->scale.
+ */
+static inline FNFT_COMPLEX fnft__misc_sample(fnft_samples_t const * const q,
+    const FNFT_UINT i)
+{
+    FNFT_REAL re, im;
+
+    switch (q->format) {
+    case fnft_samples_format_INT16_INTERLEAVED:
+        re = ((int16_t const *)q->data)[2*i];
+        im = ((int16_t const *)q->data)[2*i + 1];
+        break;
+    case fnft_samples_format_FLOAT32_INTERLEAVED:
+        re = ((float const *)q->data)[2*i];
+        im = ((float const *)q->data)[2*i + 1];
+        break;
+    case fnft_samples_format_INT16_SPLIT:
+        re = ((int16_t const *)q->data)[i];
+        im = ((int16_t const *)q->imag)[i];
+        break;
+    case fnft_samples_format_FLOAT32_SPLIT:
+        re = ((float const *)q->data)[i];
+        im = ((float const *)q->imag)[i];
+        break;
+    default: // fnft_samples_format_COMPLEX
+        return q->scale * ((FNFT_COMPLEX const *)q->data)[i];
+    }
+    return q->scale*re + I*(q->scale*im);
+}
+
+/**
+ * @brief Checks a description of samples.
+ *
+ * @ingroup misc
+ * @param[in] q Description of the samples.
+ * @return Returns SUCCESS if the format is known and all required arrays
+ *  have been provided, and an error code otherwise.
+ */
+FNFT_INT fnft__misc_samples_check(fnft_samples_t const * const q);
+
+/**
+ * @brief Converts a signal in any sample format into an array of
+ * FNFT_COMPLEX values.
+ *
+ * @ingroup misc
+ * @param[in] D Number of samples.
+ * @param[in] q Description of the samples.
+ * @param[out] result Array of length D.
+ * @return Returns SUCCESS or an error code.
+ */
+FNFT_INT fnft__misc_samples_to_complex(const FNFT_UINT D,
+    fnft_samples_t const * const q, FNFT_COMPLEX * const result);
+
 /**
  * @brief Sinc function for complex arguments.
  * 
@@ -201,18 +318,102 @@ FNFT_INT fnft__misc_downsample(FNFT_COMPLEX const * const q, const FNFT_UINT D,
  */
 FNFT_COMPLEX fnft__misc_CSINC(FNFT_COMPLEX x);
 
+/**
+ * @brief Computes cosh(x) and sinh(x)/x from x^2, as well as derivatives of
+ * the latter with respect to x^2.
+ *
+ * @ingroup misc
+ * Both functions are even in x, which is why no square root is needed for
+ * small arguments. For |x2|<=1, the Taylor series in x2 are evaluated with
+ * Horner's scheme up to the term of degree 9. The relative truncation error
+ * is below 1e-18 for all four results. All coefficients are positive, so
+ * that the rounding errors are bounded by about 20*EPSILON times the
+ * condition number sum_n |a_n*x2^n| / |sum_n a_n*x2^n|, which is at most
+ * cosh(1)/(2-cosh(1))<3.4 here. For |x2|>1, the results are computed with
+ * CSQRT, CCOSH and CSINH. The function is inlined so that the loops of the
+ * scattering routines do not need calls.
+ * @param[in] x2 The square of the argument x.
+ * @param[out] c cosh(x).
+ * @param[out] s sinh(x)/x.
+ * @param[out] ds First derivative of sinh(x)/x with respect to x2. Can be
+ *  NULL.
+ * @param[out] d2s Second derivative of sinh(x)/x with respect to x2. Can be
+ *  NULL.
+ */
+static inline void fnft__misc_cosh_sinhc(const FNFT_COMPLEX x2,
+    FNFT_COMPLEX * const c, FNFT_COMPLEX * const s,
+    FNFT_COMPLEX * const ds, FNFT_COMPLEX * const d2s)
+{
+    // 1/(2n)!, 1/(2n+1)!, (n+1)/(2n+3)! and (n+1)*(n+2)/(2n+5)!
+    static const FNFT_REAL a_c[10] = { 1.0, 1.0/2, 1.0/24, 1.0/720,
+        1.0/40320, 1.0/3628800, 1.0/479001600, 1.0/87178291200.0,
+        1.0/20922789888000.0, 1.0/6402373705728000.0 };
+    static const FNFT_REAL a_s[10] = { 1.0, 1.0/6, 1.0/120, 1.0/5040,
+        1.0/362880, 1.0/39916800, 1.0/6227020800.0,
+        1.0/1307674368000.0, 1.0/355687428096000.0,
+        1.0/121645100408832000.0 };
+    static const FNFT_REAL a_ds[10] = { 1.0/6, 2.0/120, 3.0/5040,
+        4.0/362880, 5.0/39916800, 6.0/6227020800.0, 7.0/1307674368000.0,
+        8.0/355687428096000.0, 9.0/121645100408832000.0,
+        10.0/51090942171709440000.0 };
+    static const FNFT_REAL a_d2s[10] = { 2.0/120, 6.0/5040, 12.0/362880,
+        20.0/39916800, 30.0/6227020800.0, 42.0/1307674368000.0,
+        56.0/355687428096000.0, 72.0/121645100408832000.0,
+        90.0/51090942171709440000.0, 110.0/25852016738884976640000.0 };
+    FNFT_COMPLEX x;
+    FNFT_INT n;
+
+    if (FNFT_CREAL(x2)*FNFT_CREAL(x2) + FNFT_CIMAG(x2)*FNFT_CIMAG(x2)
+        <= 1.0) {
+        *c = a_c[9];
+        *s = a_s[9];
+        for (n=8; n>=0; n--) {
+            *c = *c*x2 + a_c[n];
+            *s = *s*x2 + a_s[n];
+        }
+        if (ds != NULL) {
+            *ds = a_ds[9];
+            for (n=8; n>=0; n--)
+                *ds = *ds*x2 + a_ds[n];
+        }
+        if (d2s != NULL) {
+            *d2s = a_d2s[9];
+            for (n=8; n>=0; n--)
+                *d2s = *d2s*x2 + a_d2s[n];
+        }
+    } else {
+        x = FNFT_CSQRT(x2);
+        *c = FNFT_CCOSH(x);
+        *s = FNFT_CSINH(x)/x;
+        if (ds != NULL || d2s != NULL) {
+            x = (*c - *s)/(2.0*x2);
+            if (ds != NULL)
+                *ds = x;
+            if (d2s != NULL)
+                *d2s = (0.5*(*s) - 3.0*x)/(2.0*x2);
+        }
+    }
+}
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define misc_print_buf(...) fnft__misc_print_buf(__VA_ARGS__)
 #define misc_rel_err(...) fnft__misc_rel_err(__VA_ARGS__)
 #define misc_hausdorff_dist(...) fnft__misc_hausdorff_dist(__VA_ARGS__)
 #define misc_sech(...) fnft__misc_sech(__VA_ARGS__)
 #define misc_l2norm2(...) fnft__misc_l2norm2(__VA_ARGS__)
+#define misc_l2norm2_samples(...) fnft__misc_l2norm2_samples(__VA_ARGS__)
 #define misc_filter(...) fnft__misc_filter(__VA_ARGS__)
 #define misc_filter_inv(...) fnft__misc_filter_inv(__VA_ARGS__)
 #define misc_filter_nonreal(...) fnft__misc_filter_nonreal(__VA_ARGS__)
 #define misc_merge(...) fnft__misc_merge(__VA_ARGS__)
+#define misc_downsample_len(...) fnft__misc_downsample_len(__VA_ARGS__)
 #define misc_downsample(...) fnft__misc_downsample(__VA_ARGS__)
+#define misc_downsample_samples(...) fnft__misc_downsample_samples(__VA_ARGS__)
+#define misc_sample(...) fnft__misc_sample(__VA_ARGS__)
+#define misc_samples_check(...) fnft__misc_samples_check(__VA_ARGS__)
+#define misc_samples_to_complex(...) fnft__misc_samples_to_complex(__VA_ARGS__)
 #define misc_CSINC(...) fnft__misc_CSINC(__VA_ARGS__)
+#define misc_cosh_sinhc(...) fnft__misc_cosh_sinhc(__VA_ARGS__)
 #endif
 
 #endif
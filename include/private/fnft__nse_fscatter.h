@@ -29,6 +29,7 @@
 
 
 #include "fnft_nse_discretization_t.h"
+#include "fnft_samples_t.h"
 
 
 /**
@@ -83,9 +84,152 @@ FNFT_INT fnft__nse_fscatter(const FNFT_UINT D, FNFT_COMPLEX const * const q,
     FNFT_COMPLEX * const result, FNFT_UINT * const deg_ptr,
     FNFT_INT * const W_ptr, fnft_nse_discretization_t discretization);
 
+/**
+ * @brief Fast forward scattering for several signals in lockstep.
+ *
+ * Computes the same transfer matrices as nsig calls of \link
+ * fnft__nse_fscatter \endlink for signals with the same number of samples
+ * D, but multiplies the scattering matrices of all signals in lockstep with
+ * \link fnft__poly_fmult2x2_multi \endlink. This is faster than separate
+ * calls for many short signals.
+ *
+ * @param[in] nsig Number of signals.
+ * @param[in] D Number of samples per signal.
+ * @param[in] q Array of length nsig*D. The samples of the t-th signal are
+ *  q[t*D], ..., q[t*D+D-1] (see \link fnft__nse_fscatter \endlink).
+ * @param[in] eps_t See \link fnft__nse_fscatter \endlink.
+ * @param[in] kappa See \link fnft__nse_fscatter \endlink.
+ * @param[out] result Array of length
+ *  nsig*`nse_fscatter_numel(D,discretization)`. The transfer matrix of the
+ *  t-th signal is stored in the format of \link fnft__nse_fscatter
+ *  \endlink in result[t*4*(deg+1)], ..., result[(t+1)*4*(deg+1)-1], where
+ *  deg is the degree that is returned in *deg_ptr.
+ * @param[out] deg_ptr Upon return, the degree of the transfer matrices.
+ * @param[out] W If not NULL, an array of length nsig. The transfer matrix of
+ *  the t-th signal has then been normalized by a factor 2^W[t].
+ * @param[in] discretization See \link fnft__nse_fscatter \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_fscatter_multi(const FNFT_UINT nsig, const FNFT_UINT D,
+    FNFT_COMPLEX const * const q, const FNFT_REAL eps_t,
+    const FNFT_INT kappa, FNFT_COMPLEX * const result,
+    FNFT_UINT * const deg_ptr, FNFT_INT * const W,
+    fnft_nse_discretization_t discretization);
+
+/**
+ * @brief Computes the individual scattering matrices of the samples.
+ *
+ * This routine computes the individual scattering matrices that are
+ * multiplied together by \link fnft__nse_fscatter \endlink. They are stored
+ * in the format expected by \link fnft__poly_fmult2x2 \endlink: First the
+ * coefficients of the upper left entries of all D matrices, then those of the
+ * upper right, lower left and lower right entries. The matrices are stored in
+ * reverse order, i.e., the matrix of the last sample comes first.
+ *
+ * @param[in] D Number of samples
+ * @param[in] q Array of length D, contains samples of the signal as in
+ *  \link fnft__nse_fscatter \endlink.
+ * @param[in] eps_t Step-size, eps_t \f$= (T[1]-T[0])/(D-1) \f$.
+ * @param[in] kappa =+1 for the focusing nonlinear Schroedinger equation,
+ *  =-1 for the defocusing one
+ * @param[out] p array of length `nse_fscatter_numel(D,discretization)`, will
+ *  contain the individual scattering matrices.
+ * @param[in] discretization The type of discretization to be used. See
+ *  \link fnft__nse_fscatter \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_fscatter_leaves(const FNFT_UINT D,
+    FNFT_COMPLEX const * const q, const FNFT_REAL eps_t, const FNFT_INT kappa,
+    FNFT_COMPLEX * const p, fnft_nse_discretization_t discretization);
+
+/**
+ * @brief Same as \link fnft__nse_fscatter \endlink, but for signals in any
+ * sample format.
+ *
+ * The samples are converted while the individual scattering matrices are set
+ * up, so that no converted copy of the signal is created.
+ *
+ * @param[in] D Number of samples
+ * @param[in] q Description of the D samples, see \link fnft_samples_t
+ *  \endlink.
+ * @param[in] eps_t See \link fnft__nse_fscatter \endlink.
+ * @param[in] kappa See \link fnft__nse_fscatter \endlink.
+ * @param[out] result See \link fnft__nse_fscatter \endlink.
+ * @param[out] deg_ptr See \link fnft__nse_fscatter \endlink.
+ * @param[in] W_ptr See \link fnft__nse_fscatter \endlink.
+ * @param[in] discretization See \link fnft__nse_fscatter \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_fscatter_samples(const FNFT_UINT D,
+    fnft_samples_t const * const q, const FNFT_REAL eps_t,
+    const FNFT_INT kappa, FNFT_COMPLEX * const result,
+    FNFT_UINT * const deg_ptr, FNFT_INT * const W_ptr,
+    fnft_nse_discretization_t discretization);
+
+/**
+ * @brief Same as \link fnft__nse_fscatter_leaves \endlink, but for signals
+ * in any sample format.
+ *
+ * @param[in] D Number of samples
+ * @param[in] q Description of the D samples, see \link fnft_samples_t
+ *  \endlink.
+ * @param[in] eps_t See \link fnft__nse_fscatter_leaves \endlink.
+ * @param[in] kappa See \link fnft__nse_fscatter_leaves \endlink.
+ * @param[out] p See \link fnft__nse_fscatter_leaves \endlink.
+ * @param[in] discretization See \link fnft__nse_fscatter_leaves \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_fscatter_leaves_samples(const FNFT_UINT D,
+    fnft_samples_t const * const q, const FNFT_REAL eps_t,
+    const FNFT_INT kappa, FNFT_COMPLEX * const p,
+    fnft_nse_discretization_t discretization);
+
+/**
+ * @brief Derivatives of the scattering matrix of a single sample with
+ * respect to the sample.
+ *
+ * The scattering matrices of \link fnft__nse_fscatter_leaves \endlink are
+ * not holomorphic in the sample q. This routine therefore returns the
+ * Wirtinger derivatives with respect to q and conj(q), which are computed
+ * analytically. The derivative in the direction of a complex perturbation
+ * dq is dp_dq*dq + dp_dqc*conj(dq).
+ *
+ * @param[in] q The sample.
+ * @param[in] eps_t See \link fnft__nse_fscatter_leaves \endlink.
+ * @param[in] kappa See \link fnft__nse_fscatter_leaves \endlink.
+ * @param[out] dp_dq Array of length
+ *  `nse_fscatter_numel(1,discretization)`, will contain the derivatives of
+ *  the coefficients of the scattering matrix with respect to q. The layout
+ *  is the same as that of p in \link fnft__nse_fscatter_leaves \endlink
+ *  for D=1.
+ * @param[out] dp_dqc Same as dp_dq, but for the derivatives with respect to
+ *  conj(q).
+ * @param[in] discretization The type of discretization to be used. See
+ *  \link fnft__nse_fscatter \endlink. The BO scheme is not supported.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_fscatter_leaf_derivs(const FNFT_COMPLEX q,
+    const FNFT_REAL eps_t, const FNFT_INT kappa, FNFT_COMPLEX * const dp_dq,
+    FNFT_COMPLEX * const dp_dqc, fnft_nse_discretization_t discretization);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define nse_fscatter_numel(...) fnft__nse_fscatter_numel(__VA_ARGS__)
 #define nse_fscatter(...) fnft__nse_fscatter(__VA_ARGS__)
+#define nse_fscatter_leaves(...) fnft__nse_fscatter_leaves(__VA_ARGS__)
+#define nse_fscatter_multi(...) fnft__nse_fscatter_multi(__VA_ARGS__)
+#define nse_fscatter_samples(...) fnft__nse_fscatter_samples(__VA_ARGS__)
+#define nse_fscatter_leaves_samples(...) fnft__nse_fscatter_leaves_samples(__VA_ARGS__)
+#define nse_fscatter_leaf_derivs(...) fnft__nse_fscatter_leaf_derivs(__VA_ARGS__)
 #endif
 
 #endif
@@ -103,9 +103,115 @@ FNFT_INT fnft__nse_scatter_matrix(const FNFT_UINT D, FNFT_COMPLEX const * const
     FNFT_COMPLEX const * const lambda,
     FNFT_COMPLEX * const result, fnft_nse_discretization_t discretization);
 
+/**
+ * @brief Computes the scattering matrix and its first and second
+ * derivatives.
+ *
+ * The function computes the same scattering matrix as \link
+ * fnft__nse_scatter_matrix \endlink, but additionally its second
+ * derivative with respect to \f$\lambda\f$. This enables root finding
+ * methods of higher order such as Halley's method, and estimates of the
+ * multiplicity of roots. The cost per sample is lower than that of
+ * \link fnft__nse_scatter_matrix \endlink, which propagates 4x4 block
+ * matrices.
+ *
+ * @param[in] D Number of samples
+ * @param[in] q Array of length D, contains samples \f$ q(t_n)=q(x_0, t_n) \f$,
+ *  where \f$ t_n = T[0] + n(T[1]-T[0])/(D-1) \f$ and \f$n=0,1,\dots,D-1\f$, of
+ *  the to-be-transformed signal in ascending order
+ *  (i.e., \f$ q(t_0), q(t_1), \dots, q(t_{D-1}) \f$)
+ * @param[in] eps_t Step-size, eps_t \f$= (T[1]-T[0])/(D-1) \f$.
+ * @param[in] kappa =+1 for the focusing nonlinear Schroedinger equation,
+ *  =-1 for the defocusing one
+ * @param[in] K Number of values of \f$\lambda\f$.
+ * @param[in] lambda Array of length K, contains the values of \f$\lambda\f$.
+ * @param[out] result Array of length 12*K, contains the values
+ *  [S11 S12 S21 S22 S11' S12' S21' S22' S11'' S12'' S21'' S22''] for every
+ *  \f$\lambda\f$, where S = [S11, S12; S21, S22] is the scattering matrix.
+ * @param[in] discretization The type of discretization to be used. Currently,
+ *  only nse_discretization_BO is supported.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_scatter_matrix_d2(const FNFT_UINT D,
+    FNFT_COMPLEX const * const q, const FNFT_REAL eps_t,
+    const FNFT_INT kappa, const FNFT_UINT K,
+    FNFT_COMPLEX const * const lambda,
+    FNFT_COMPLEX * const result, fnft_nse_discretization_t discretization);
+
+/**
+ * @brief Tolerance for the steps of iterative root refinements.
+ *
+ * The roots of scattering coefficients that are computed with the BO
+ * scheme differ from the exact ones by \f$O(\epsilon_t^2)\f$. Steps of
+ * an iterative refinement that are far below this level cannot improve the
+ * accuracy any more. The routine returns a heuristic for this level, which
+ * is three orders of magnitude below an estimate of the discretization
+ * error, but not below a multiple of the machine precision.
+ *
+ * @param[in] eps_t Step-size.
+ * @param[in] qmax Maximum of \f$|q(t_n)|\f$.
+ * @param[in] lam Current estimate of the root.
+ * @return The tolerance.
+ * @ingroup nse
+ */
+FNFT_REAL fnft__nse_scatter_refine_tol(const FNFT_REAL eps_t,
+    const FNFT_REAL qmax, const FNFT_COMPLEX lam);
+
+/**
+ * @brief Computes the left or right Jost solutions at the sample times.
+ *
+ * The left Jost solution satisfies \f$ \phi(t,\lambda) \to
+ * [\exp(-j\lambda t); 0] \f$ for \f$ t\to-\infty \f$, and the right
+ * one satisfies \f$ \psi(t,\lambda) \to [0; \exp(j\lambda t)] \f$ for
+ * \f$ t\to+\infty \f$. They are computed with the same scheme as
+ * \link fnft__nse_scatter_matrix \endlink, where the step matrix of each
+ * sample is split into two half steps in order to obtain the values at the
+ * sample times. The values of \f$ \lambda \f$ are propagated through the
+ * signal in blocks of eight, with the real and imaginary parts in separate
+ * arrays such that the compiler can vectorize the loops over each block.
+ * The remaining values are propagated one by one. The costs are
+ * \f$ O(DK) \f$ operations.
+ *
+ * @param[in] D Number of samples, D>=2
+ * @param[in] q Array of length D, contains samples \f$ q(t_n)=q(x_0, t_n) \f$,
+ *  where \f$ t_n = T[0] + n(T[1]-T[0])/(D-1) \f$ and \f$n=0,1,\dots,D-1\f$, of
+ *  the to-be-transformed signal in ascending order
+ *  (i.e., \f$ q(t_0), q(t_1), \dots, q(t_{D-1}) \f$)
+ * @param[in] T Array of length 2, contains the position in time of the first and
+ *  of the last sample. It should be T[0]<T[1].
+ * @param[in] kappa =+1 for the focusing nonlinear Schroedinger equation,
+ *  =-1 for the defocusing one
+ * @param[in] K Number of values of \f$\lambda\f$.
+ * @param[in] lambda Array of length K, contains the values of \f$\lambda\f$.
+ * @param[in] right_flag Computes the right Jost solutions if non-zero, and
+ *  the left ones otherwise.
+ * @param[out] result Array of length 2*D*K. The first and second components
+ *  of the Jost solution for lambda[k] at the time \f$ t_n \f$ are stored in
+ *  result[2*D*k+n] and result[2*D*k+D+n], respectively.
+ * @param[in] discretization The type of discretization to be used. Currently,
+ *  only nse_discretization_BO is supported.
+ * @param[in] nthreads Number of threads over which the blocks of values of
+ *  \f$\lambda\f$ are distributed. The values 0 and 1 mean that no threads
+ *  are started, and negative values that the number of online processors is
+ *  used. Without pthreads, the routine is always single-threaded.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ * @ingroup nse
+ */
+FNFT_INT fnft__nse_scatter_jost(const FNFT_UINT D, FNFT_COMPLEX const * const q,
+    FNFT_REAL const * const T, const FNFT_INT kappa, const FNFT_UINT K,
+    FNFT_COMPLEX const * const lambda, const FNFT_INT right_flag,
+    FNFT_COMPLEX * const result, fnft_nse_discretization_t discretization,
+    const FNFT_INT nthreads);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define nse_scatter_bound_states(...) fnft__nse_scatter_bound_states(__VA_ARGS__)
 #define nse_scatter_matrix(...) fnft__nse_scatter_matrix(__VA_ARGS__)
+#define nse_scatter_matrix_d2(...) fnft__nse_scatter_matrix_d2(__VA_ARGS__)
+#define nse_scatter_refine_tol(...) fnft__nse_scatter_refine_tol(__VA_ARGS__)
+#define nse_scatter_jost(...) fnft__nse_scatter_jost(__VA_ARGS__)
 #endif
 
 #endif
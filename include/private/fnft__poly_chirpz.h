@@ -62,8 +62,76 @@ FNFT_INT fnft__poly_chirpz(const FNFT_UINT deg, FNFT_COMPLEX const * const p, \
     const FNFT_COMPLEX A, const FNFT_COMPLEX W, const FNFT_UINT M, \
     FNFT_COMPLEX * const result);
 
+/**
+ * @brief Fast evaluation of a polynomial on several spirals in the complex
+ * plane that share the same step.
+ *
+ * @ingroup poly
+ * Evaluates the polynomial \f$ p(z) \f$ (see \link fnft__poly_chirpz
+ * \endlink) at the \a M points \f$ z=1/w_{r,m} \f$, where
+ *
+ *  \f[ w_{r,m}=A_rW^{-m}, \quad m=0,1,\dots,M-1, \quad r=0,1,\dots,R-1. \f]
+ *
+ * The result is the same as for \a R calls of \link fnft__poly_chirpz
+ * \endlink, but the FFT plans and the transformed chirp, which only depend
+ * on \a W, are computed only once. For example, polynomials in
+ * \f$ z=e^{j\lambda\epsilon} \f$ can be evaluated on rectangular grids in
+ * the \f$ \lambda \f$-domain in this way since every row of such a grid
+ * is mapped onto an arc of a circle around the origin.
+ *
+ * @param[in] deg Degree of the polynomial
+ * @param[in] p Array containing the deg+1 coefficients of the polynomial in
+ *  descending order (i.e., \f$ p_{deg}, p_{deg-1}, \dots, p_1, p_0 \f$).
+ * @param[in] R Number of spirals.
+ * @param[in] A Array of length R with the first constants of the spirals.
+ * @param[in] W Second constant, shared by all spirals.
+ * @param[in] M Number of points per spiral.
+ * @param[out] result Array of length R*M. The values on the r-th spiral are
+ *  stored in result[r*M], ..., result[r*M+M-1].
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_chirpz_multi(const FNFT_UINT deg,
+    FNFT_COMPLEX const * const p, const FNFT_UINT R,
+    FNFT_COMPLEX const * const A, const FNFT_COMPLEX W, const FNFT_UINT M,
+    FNFT_COMPLEX * const result);
+
+/**
+ * @brief Fast evaluation of several polynomials on the same spiral in the
+ * complex plane.
+ *
+ * @ingroup poly
+ * Evaluates the \a R polynomials \f$ p_r(z) \f$ of degree \a deg (see
+ * \link fnft__poly_chirpz \endlink) at the \a M points \f$ z=1/w_m \f$,
+ * where \f$ w_m=AW^{-m} \f$ for \f$ m=0,1,\dots,M-1 \f$. The result is the
+ * same as for \a R calls of \link fnft__poly_chirpz \endlink up to
+ * rounding errors, but the FFT plans, the transformed chirp and the chirp
+ * factors are computed only once.
+ *
+ * @param[in] deg Degree of the polynomials.
+ * @param[in] R Number of polynomials.
+ * @param[in] p Array with the coefficients of the polynomials in descending
+ *  order. The deg+1 coefficients of the r-th polynomial are stored in
+ *  p[r*stride], ..., p[r*stride+deg].
+ * @param[in] stride Distance between the first coefficients of consecutive
+ *  polynomials.
+ * @param[in] A First constant defining the spiral.
+ * @param[in] W Second constant defining the spiral.
+ * @param[in] M Number of points per polynomial.
+ * @param[out] result Array of length R*M. The values of the r-th polynomial
+ *  are stored in result[r*M], ..., result[r*M+M-1].
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_chirpz_batch(const FNFT_UINT deg, const FNFT_UINT R,
+    FNFT_COMPLEX const * const p, const FNFT_UINT stride,
+    const FNFT_COMPLEX A, const FNFT_COMPLEX W, const FNFT_UINT M,
+    FNFT_COMPLEX * const result);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define poly_chirpz(...) fnft__poly_chirpz(__VA_ARGS__)
+#define poly_chirpz_multi(...) fnft__poly_chirpz_multi(__VA_ARGS__)
+#define poly_chirpz_batch(...) fnft__poly_chirpz_batch(__VA_ARGS__)
 #endif
 
 #endif
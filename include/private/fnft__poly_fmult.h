@@ -33,10 +33,11 @@
  * 
  * @ingroup poly
  * Fast multiplication of n polynomials of degree d. Their coefficients are
- * stored in the array p and will be overwritten. If W_ptr != NULL, the
- * result has been normalized by a factor 2^W. Upon exit, W has been stored
- * in *W_ptr.
- * @param[in] d Degree of the polynomials.
+ * stored in the array p and will be overwritten. The number n does not
+ * have to be a power of two. If W_ptr != NULL, the result has been
+ * normalized by a factor 2^W. Upon exit, W has been stored in *W_ptr.
+ * @param[in,out] d Degree of the polynomials. Upon exit, the degree n*d of
+ *  the product.
  * @param[in] n Number of polynomials.
  * @param[in,out] p Complex valued array which initially holds the coefficients of 
  * the polynomials being multiplied and on exit holds the result.
@@ -52,14 +53,17 @@ FNFT_INT fnft__poly_fmult(FNFT_UINT * const d, FNFT_UINT n, FNFT_COMPLEX * const
  * 
  * @ingroup poly
  * Fast multiplication of n 2x2 matrix-valued polynomials of degree d. Their
- * coefficients are stored in the array p and will be overwritten. If
- * W_ptr != NULL, the result has been normalized by a factor 2^W. Upon exit,
- * W has been stored in *W_ptr.
- * @param[in] d Degree of the polynomials.
+ * coefficients are stored in the array p and will be overwritten. The
+ * number n does not have to be a power of two. If W_ptr != NULL, the result
+ * has been normalized by a factor 2^W. Upon exit, W has been stored in
+ * *W_ptr.
+ * @param[in,out] d Degree of the polynomials. Upon exit, the degree n*d of
+ *  the product.
  * @param[in] n Number of 2x2 matrix-valued polynomials.
  * @param[in] p Complex valued array which holds the coefficients of 
  * the polynomials being multiplied.
  * @param[out] result Complex valued array that hold the result of the mulitplication.
+ *  Its length has to be at least 4*(n*d+(n+1)/2).
  * @param[in] W_ptr Pointer to normalization flag. 
  * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
  *  defined in \link fnft_errwarn.h \endlink.
@@ -67,9 +71,221 @@ FNFT_INT fnft__poly_fmult(FNFT_UINT * const d, FNFT_UINT n, FNFT_COMPLEX * const
 FNFT_INT fnft__poly_fmult2x2(FNFT_UINT *d, FNFT_UINT n, FNFT_COMPLEX * const p, 
     FNFT_COMPLEX * const result, FNFT_INT * const W_ptr);
 
+/**
+ * @brief Fast multiplication of multiple 2x2 matrix-valued polynomials of
+ * same degree, with the intermediate products in the frequency domain.
+ *
+ * @ingroup poly
+ * Computes the same product as \link fnft__poly_fmult2x2 \endlink, but the
+ * intermediate products are not converted back to coefficients. They are
+ * kept as values on roots of unity, which are extended to the finer grid of
+ * the next level by computing only the new (odd) samples. Only the final
+ * product is converted to coefficients. This saves about one IFFT/FFT pair
+ * per level. The normalization factors are based on the values instead of
+ * the coefficients, which is why W may differ from the one of
+ * \link fnft__poly_fmult2x2 \endlink.
+ * @param[in,out] d Degree of the polynomials. Upon exit, the degree n*d of
+ *  the product.
+ * @param[in] n Number of 2x2 matrix-valued polynomials.
+ * @param[in] p Complex valued array of length 4*n*(d+1) which holds the
+ *  coefficients of the polynomials in the same format as in
+ *  \link fnft__poly_fmult2x2 \endlink. It is not modified.
+ * @param[out] result Complex valued array of length 4*(n*d+1) in which the
+ *  coefficients of the product are stored.
+ * @param[out] W_ptr If not NULL, the result has been normalized by a factor
+ *  2^W. Upon exit, W has been stored in *W_ptr.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_fd(FNFT_UINT * const d, const FNFT_UINT n,
+    FNFT_COMPLEX const * const p, FNFT_COMPLEX * const result,
+    FNFT_INT * const W_ptr);
+
+/**
+ * @brief Fast multiplication of several sets of 2x2 matrix-valued
+ * polynomials of same degree in lockstep.
+ *
+ * @ingroup poly
+ * Computes the same products as nsets calls of \link fnft__poly_fmult2x2
+ * \endlink, where every set consists of n polynomials of degree d. This is
+ * faster than separate calls for many small sets (e.g., the scattering
+ * matrices of many short signals). On the lower levels of the product
+ * trees, the coefficients of all sets are interleaved and multiplied
+ * directly with loops over the sets that the compiler can vectorize. On the
+ * higher levels, the sets are multiplied with FFTs whose configurations are
+ * computed only once for all sets.
+ * @param[in,out] d Degree of the polynomials. Upon exit, the degree n*d of
+ *  the products.
+ * @param[in] n Number of 2x2 matrix-valued polynomials per set.
+ * @param[in] nsets Number of sets.
+ * @param[in] p Complex valued array of length nsets*4*n*(d+1). The
+ *  coefficients of the t-th set start at p[t*4*n*(d+1)] and are stored in
+ *  the same format as in \link fnft__poly_fmult2x2 \endlink. It is not
+ *  modified.
+ * @param[out] result Complex valued array of length nsets*4*(n*d+1). The
+ *  coefficients of the product of the t-th set are stored in
+ *  result[t*4*(n*d+1)], ..., result[(t+1)*4*(n*d+1)-1].
+ * @param[out] W If not NULL, an array of length nsets. The product of the
+ *  t-th set has then been normalized by a factor 2^W[t].
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_multi(FNFT_UINT * const d, const FNFT_UINT n,
+    const FNFT_UINT nsets, FNFT_COMPLEX const * const p,
+    FNFT_COMPLEX * const result, FNFT_INT * const W);
+
+/**
+ * @brief Fast multiplication of two 2x2 matrix-valued polynomials of
+ * possibly different degrees.
+ *
+ * @ingroup poly
+ * Computes the product p1*p2 of a 2x2 matrix-valued polynomial p1 of degree
+ * deg1 and a 2x2 matrix-valued polynomial p2 of degree deg2. The
+ * coefficients of both factors are stored as in
+ * \link fnft__poly_fmult2x2 \endlink, i.e., first the coefficients of the
+ * upper left entry, then those of the upper right, lower left and lower
+ * right entries. If W_ptr != NULL, the result has been normalized by a
+ * factor 2^W. Upon exit, W has been stored in *W_ptr.
+ * @param[in] deg1 Degree of the first factor.
+ * @param[in] p1 Complex valued array of length 4*(deg1+1) with the
+ *  coefficients of the first factor.
+ * @param[in] deg2 Degree of the second factor.
+ * @param[in] p2 Complex valued array of length 4*(deg2+1) with the
+ *  coefficients of the second factor.
+ * @param[out] result Complex valued array of length 4*(deg1+deg2+1) in
+ *  which the coefficients of the product are stored.
+ * @param[out] W_ptr Pointer to normalization flag.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_pair(const FNFT_UINT deg1,
+    FNFT_COMPLEX const * const p1, const FNFT_UINT deg2,
+    FNFT_COMPLEX const * const p2, FNFT_COMPLEX * const result,
+    FNFT_INT * const W_ptr);
+
+/**
+ * @brief Product tree of 2x2 matrix-valued polynomials.
+ *
+ * @ingroup poly
+ * Stores the intermediate products that occur during the multiplication of
+ * n 2x2 matrix-valued polynomials in \link fnft__poly_fmult2x2 \endlink.
+ * This allows to update the product quickly when only a few factors change,
+ * and to propagate adjoints (gradients) from the product back to the
+ * factors. Objects are created with \link fnft__poly_fmult2x2_tree_create
+ * \endlink and released with \link fnft__poly_fmult2x2_tree_free \endlink.
+ */
+typedef struct fnft__poly_fmult2x2_tree_s fnft__poly_fmult2x2_tree_t;
+
+/**
+ * @brief Creates the product tree of multiple 2x2 matrix-valued polynomials
+ * of same degree.
+ *
+ * @ingroup poly
+ * The product of the n factors is the same as in
+ * \link fnft__poly_fmult2x2 \endlink. All intermediate products are stored.
+ * They require about log2(n)+1 times the memory of the factors.
+ * @param[in] deg Degree of the factors.
+ * @param[in] n Number of factors.
+ * @param[in] p Complex valued array of length 4*n*(deg+1) which holds the
+ *  coefficients of the factors in the same format as in
+ *  \link fnft__poly_fmult2x2 \endlink. It is not modified.
+ * @param[in] normalization_flag If nonzero, the intermediate products are
+ *  normalized as in \link fnft__poly_fmult2x2 \endlink.
+ * @param[out] tree_ptr Upon successful return, *tree_ptr points to the new
+ *  tree.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_tree_create(const FNFT_UINT deg,
+    const FNFT_UINT n, FNFT_COMPLEX const * const p,
+    const FNFT_INT normalization_flag,
+    fnft__poly_fmult2x2_tree_t ** const tree_ptr);
+
+/**
+ * @brief Replaces some factors in a product tree.
+ *
+ * @ingroup poly
+ * Only the intermediate products on the paths from the replaced factors to
+ * the root of the tree are recomputed. For m replaced factors, this requires
+ * at most about m/n times the effort for the computation of the full tree.
+ * @param[in,out] tree Tree created with
+ *  \link fnft__poly_fmult2x2_tree_create \endlink.
+ * @param[in] m Number of replaced factors.
+ * @param[in] idx Array of length m with the (zero-based) indices of the
+ *  replaced factors.
+ * @param[in] p Complex valued array of length 4*m*(deg+1) with the new
+ *  factors in the same format as in \link fnft__poly_fmult2x2 \endlink.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_tree_update(
+    fnft__poly_fmult2x2_tree_t * const tree, const FNFT_UINT m,
+    FNFT_UINT const * const idx, FNFT_COMPLEX const * const p);
+
+/**
+ * @brief Returns the product of all factors in a product tree.
+ *
+ * @ingroup poly
+ * @param[in] tree Tree created with
+ *  \link fnft__poly_fmult2x2_tree_create \endlink.
+ * @param[out] deg_ptr If not NULL, *deg_ptr is set to the degree deg*n of
+ *  the product.
+ * @param[out] result If not NULL, the 4*(deg*n+1) coefficients of the
+ *  product are stored in result.
+ * @param[out] W_ptr If not NULL, *W_ptr is set to the exponent of the
+ *  normalization factor 2^W of the product.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_tree_root(fnft__poly_fmult2x2_tree_t * const tree,
+    FNFT_UINT * const deg_ptr, FNFT_COMPLEX * const result,
+    FNFT_INT * const W_ptr);
+
+/**
+ * @brief Propagates an adjoint of the product back to the factors.
+ *
+ * @ingroup poly
+ * Let \f$ L \f$ be a real-valued function of the coefficients \f$ c_k \f$ of
+ * the (normalized) product returned by \link fnft__poly_fmult2x2_tree_root
+ * \endlink. Given the adjoint \f$ G_k = \partial L/\partial \Re c_k +
+ * j\partial L/\partial \Im c_k \f$, this routine computes the corresponding
+ * adjoint for the coefficients of the factors. The normalization factors are
+ * treated as constants. The effort is about twice that of the computation
+ * of the full tree.
+ * @param[in] tree Tree created with
+ *  \link fnft__poly_fmult2x2_tree_create \endlink.
+ * @param[in] G Complex valued array of length 4*(deg*n+1) with the adjoint of
+ *  the product.
+ * @param[out] G_leaves Complex valued array of length 4*n*(deg+1) in which
+ *  the adjoint of the factors is stored, in the same format as the factors.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_fmult2x2_tree_adjoint(
+    fnft__poly_fmult2x2_tree_t * const tree, FNFT_COMPLEX const * const G,
+    FNFT_COMPLEX * const G_leaves);
+
+/**
+ * @brief Releases a product tree.
+ *
+ * @ingroup poly
+ * @param[in] tree Tree created with
+ *  \link fnft__poly_fmult2x2_tree_create \endlink or NULL.
+ */
+void fnft__poly_fmult2x2_tree_free(fnft__poly_fmult2x2_tree_t * const tree);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define poly_fmult(...) fnft__poly_fmult(__VA_ARGS__)
 #define poly_fmult2x2(...) fnft__poly_fmult2x2(__VA_ARGS__)
+#define poly_fmult2x2_fd(...) fnft__poly_fmult2x2_fd(__VA_ARGS__)
+#define poly_fmult2x2_multi(...) fnft__poly_fmult2x2_multi(__VA_ARGS__)
+#define poly_fmult2x2_pair(...) fnft__poly_fmult2x2_pair(__VA_ARGS__)
+#define poly_fmult2x2_tree_t fnft__poly_fmult2x2_tree_t
+#define poly_fmult2x2_tree_create(...) fnft__poly_fmult2x2_tree_create(__VA_ARGS__)
+#define poly_fmult2x2_tree_update(...) fnft__poly_fmult2x2_tree_update(__VA_ARGS__)
+#define poly_fmult2x2_tree_root(...) fnft__poly_fmult2x2_tree_root(__VA_ARGS__)
+#define poly_fmult2x2_tree_adjoint(...) fnft__poly_fmult2x2_tree_adjoint(__VA_ARGS__)
+#define poly_fmult2x2_tree_free(...) fnft__poly_fmult2x2_tree_free(__VA_ARGS__)
 #endif
 
 #endif
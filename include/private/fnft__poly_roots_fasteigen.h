@@ -51,8 +51,142 @@
 FNFT_INT fnft__poly_roots_fasteigen(const FNFT_UINT deg,
     FNFT_COMPLEX const * const p, FNFT_COMPLEX * const roots);
 
+/**
+ * @brief Workspace for \link fnft__poly_roots_fasteigen_ws \endlink.
+ *
+ * @ingroup poly
+ * Holds the work arrays of the eigenvalue solver for polynomials of a fixed
+ * degree, so that many polynomials can be solved without allocating memory
+ * for each of them. A workspace must not be used by several threads at the
+ * same time. Objects are created with \link
+ * fnft__poly_roots_fasteigen_ws_create \endlink and released with \link
+ * fnft__poly_roots_fasteigen_ws_free \endlink.
+ */
+typedef struct fnft__poly_roots_fasteigen_ws_s fnft__poly_roots_fasteigen_ws_t;
+
+/**
+ * @brief Creates a workspace for polynomials of a given degree.
+ *
+ * @ingroup poly
+ * @param[in] deg Degree of the polynomials, deg>=2.
+ * @param[out] ws_ptr Upon successful return, *ws_ptr points to the new
+ *  workspace.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_roots_fasteigen_ws_create(const FNFT_UINT deg,
+    fnft__poly_roots_fasteigen_ws_t ** const ws_ptr);
+
+/**
+ * @brief Fast computation of polynomial roots with a given workspace.
+ *
+ * @ingroup poly
+ * Same as \link fnft__poly_roots_fasteigen \endlink, but the work arrays
+ * are taken from a workspace instead of being allocated.
+ * @param[in,out] ws Workspace created with
+ *  \link fnft__poly_roots_fasteigen_ws_create \endlink. Its degree is the
+ *  degree of the polynomial.
+ * @param[in] p Array containing the deg+1 coefficients of the polynomial in
+ *  descending order.
+ * @param[out] roots Array of deg points. Will be filled with the roots of
+ *  \f$ p(z) \f$.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_roots_fasteigen_ws(
+    fnft__poly_roots_fasteigen_ws_t * const ws,
+    FNFT_COMPLEX const * const p, FNFT_COMPLEX * const roots);
+
+/**
+ * @brief Releases a workspace.
+ *
+ * @ingroup poly
+ * @param[in] ws Workspace created with
+ *  \link fnft__poly_roots_fasteigen_ws_create \endlink or NULL.
+ */
+void fnft__poly_roots_fasteigen_ws_free(
+    fnft__poly_roots_fasteigen_ws_t * const ws);
+
+/**
+ * @brief Fast computation of the roots of many polynomials of the same
+ * degree.
+ *
+ * @ingroup poly
+ * The polynomials are distributed over several threads (if POSIX threads
+ * are available), each of which solves its polynomials one after another in
+ * its own workspace. The result for a polynomial is the same as that of
+ * \link fnft__poly_roots_fasteigen \endlink up to the random shifts of the
+ * eigenvalue solver. The failure of the solver for one polynomial does not
+ * affect the others. It is reported in the status array only.
+ * @param[in] deg Degree of the polynomials, deg>=2.
+ * @param[in] npoly Number of polynomials.
+ * @param[in] p Array of length npoly*(deg+1). The coefficients of the i-th
+ *  polynomial are stored in descending order in p[i*(deg+1)], ...,
+ *  p[i*(deg+1)+deg].
+ * @param[out] roots Array of length npoly*deg. The roots of the i-th
+ *  polynomial are stored in roots[i*deg], ..., roots[i*deg+deg-1].
+ * @param[out] status Array of length npoly. status[i] is set to
+ *  \link FNFT_SUCCESS \endlink if the roots of the i-th polynomial have been
+ *  found and to \link FNFT_EC_OTHER \endlink otherwise.
+ * @param[in] nthreads Maximum number of threads. If zero, the number of
+ *  online processors is used. At most npoly threads are started. The
+ *  polynomials are solved in the calling thread if nthreads is one.
+ * @return \link FNFT_SUCCESS \endlink if all polynomials have been processed
+ *  (check the status array), or one of the FNFT_EC_... error codes defined in
+ *  \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_roots_fasteigen_batch(const FNFT_UINT deg,
+    const FNFT_UINT npoly, FNFT_COMPLEX const * const p,
+    FNFT_COMPLEX * const roots, FNFT_INT * const status,
+    const FNFT_UINT nthreads);
+
+/**
+ * @brief Fast computation of polynomial roots with a multishift QR
+ * algorithm.
+ *
+ * @ingroup poly
+ * Computes the same roots as \link fnft__poly_roots_fasteigen \endlink
+ * with the same \f$ O\{ deg^2 \}\f$ complexity and backward stability, but
+ * is faster for large degrees. \link fnft__poly_roots_fasteigen \endlink
+ * chases one bulge at a time through the factored companion matrix. Here,
+ * each sweep chases nshifts bulges in a pipelined fashion. Their shifts are
+ * the eigenvalues of the trailing nshifts x nshifts submatrix of the active
+ * block. Consecutive bulges move down in a tight bundle, so that the parts
+ * of the factorization that they touch stay in the cache, and the bundle is
+ * split into groups that are chased by different threads (if POSIX threads
+ * are available). Operations of different bulges on the same part of the
+ * factorization are carried out in the same order as if the bulges were
+ * chased one after another, which is why the result does not depend on the
+ * number of threads. Small active blocks are treated with single shift
+ * iterations. If the polynomial is such that \link
+ * fnft__poly_roots_fasteigen \endlink would use the QZ algorithm, this
+ * routine uses it as well.
+ * @param[in] deg Degree of the polynomial, deg>=2.
+ * @param[in] p Array containing the deg+1 coefficients of the polynomial in
+ *  descending order.
+ * @param[out] roots Array of deg points. Will be filled with the roots of
+ *  \f$ p(z) \f$.
+ * @param[in] nshifts Number of shifts per sweep. If zero, two shifts per
+ *  thread that can be used for the active block are used (at most 64), and
+ *  single shift iterations if only one thread can be used.
+ * @param[in] nthreads Maximum number of threads. If zero, the number of
+ *  online processors is used. Each thread gets at least two bulges and 512
+ *  rows.
+ * @return \link FNFT_SUCCESS \endlink or one of the FNFT_EC_... error codes
+ *  defined in \link fnft_errwarn.h \endlink.
+ */
+FNFT_INT fnft__poly_roots_fasteigen_multishift(const FNFT_UINT deg,
+    FNFT_COMPLEX const * const p, FNFT_COMPLEX * const roots,
+    const FNFT_UINT nshifts, const FNFT_UINT nthreads);
+
 #ifdef FNFT_ENABLE_SHORT_NAMES
 #define poly_roots_fasteigen(...) fnft__poly_roots_fasteigen(__VA_ARGS__)
+#define poly_roots_fasteigen_ws_t fnft__poly_roots_fasteigen_ws_t
+#define poly_roots_fasteigen_ws_create(...) fnft__poly_roots_fasteigen_ws_create(__VA_ARGS__)
+#define poly_roots_fasteigen_ws(...) fnft__poly_roots_fasteigen_ws(__VA_ARGS__)
+#define poly_roots_fasteigen_ws_free(...) fnft__poly_roots_fasteigen_ws_free(__VA_ARGS__)
+#define poly_roots_fasteigen_batch(...) fnft__poly_roots_fasteigen_batch(__VA_ARGS__)
+#define poly_roots_fasteigen_multishift(...) fnft__poly_roots_fasteigen_multishift(__VA_ARGS__)
 #endif
 
 #endif
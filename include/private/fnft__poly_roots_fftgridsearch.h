@@ -60,7 +60,7 @@
  * @see poly_roots_fftgridsearch_paraherm
  * @see poly_chirpz
  *
- * @param[in] deg The degree of the polynomial.
+ * @param[in] deg The degree of the polynomial, deg>=1.
  * @param[in] p Array containing the deg+1 coefficients of the Laurent
  *  polynomial in descending order (i.e.,
  *  \f$ p_{deg}, p_{deg-1}, \dots, p_{1}, p_{0} \f$).
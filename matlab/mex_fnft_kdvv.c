@@ -55,8 +55,8 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     XI = mxGetPr(prhs[2]);
 
     /* Check values of first four inputs */
-    if ( D<2 || (D & (D-1)) != 0 )
-        mexErrMsgTxt("Length of the first input q should be a positive power of two.");
+    if ( D<2 )
+        mexErrMsgTxt("Length of the first input q should be at least two.");
     if ( T[0] >= T[1] )
         mexErrMsgTxt("T(1) >= T(2).");
     if ( XI[0] >= XI[1] )
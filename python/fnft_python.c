@@ -0,0 +1,837 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+/*
+ * Python interface of fnft_nsev.
+ *
+ * Samples and results are exchanged through the buffer protocol. Only
+ * C-contiguous buffers of complex128 values (format "Zd", e.g. NumPy arrays
+ * with dtype=complex128) are accepted, so that they can be passed to FNFT
+ * without copying. New result arrays are created with numpy.empty. The GIL
+ * is released while FNFT runs.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include <string.h>
+#include "fnft_nsev.h"
+
+static PyObject *fnft_error = NULL; // fnft.Error
+static PyObject *numpy_empty = NULL; // numpy.empty, imported on first use
+
+/* Raises fnft.Error for an FNFT return code. */
+static void set_fnft_error(const char *fun, FNFT_INT ret_code)
+{
+    PyErr_Format(fnft_error, "%s failed with error code %d.", fun,
+        (int)ret_code);
+}
+
+/* Returns a new NumPy array with the given shape (rows==0 for 1-D) and
+ * dtype. */
+static PyObject *new_array(Py_ssize_t rows, Py_ssize_t cols,
+    const char *dtype)
+{
+    PyObject *numpy, *shape, *args, *kwargs, *arr;
+
+    if (numpy_empty == NULL) {
+        numpy = PyImport_ImportModule("numpy");
+        if (numpy == NULL)
+            return NULL;
+        numpy_empty = PyObject_GetAttrString(numpy, "empty");
+        Py_DECREF(numpy);
+        if (numpy_empty == NULL)
+            return NULL;
+    }
+
+    if (rows == 0)
+        shape = Py_BuildValue("(n)", cols);
+    else
+        shape = Py_BuildValue("(nn)", rows, cols);
+    if (shape == NULL)
+        return NULL;
+    args = PyTuple_Pack(1, shape);
+    Py_DECREF(shape);
+    if (args == NULL)
+        return NULL;
+    kwargs = Py_BuildValue("{s:s}", "dtype", dtype);
+    if (kwargs == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+    arr = PyObject_Call(numpy_empty, args, kwargs);
+    Py_DECREF(args);
+    Py_DECREF(kwargs);
+    return arr;
+}
+
+/* Gets a C-contiguous buffer of complex128 values from obj. The number of
+ * values is stored in *len_ptr. On success, the buffer has to be released
+ * with PyBuffer_Release. */
+static int get_complex_buffer(PyObject *obj, Py_buffer *view, int writable,
+    const char *name, Py_ssize_t *len_ptr)
+{
+    const char *fmt;
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+
+    if (writable)
+        flags |= PyBUF_WRITABLE;
+    if (PyObject_GetBuffer(obj, view, flags) != 0) {
+        PyErr_Format(PyExc_TypeError, "%s should be a C-contiguous%s "
+            "complex128 array.", name, writable ? ", writable" : "");
+        return -1;
+    }
+
+    // Skip byte order marks that denote the native byte order
+    fmt = view->format;
+    if (fmt != NULL && (*fmt == '@' || *fmt == '='))
+        fmt++;
+    if (fmt == NULL || strcmp(fmt, "Zd") != 0
+    || view->itemsize != sizeof(FNFT_COMPLEX)) {
+        PyErr_Format(PyExc_TypeError, "%s should have dtype complex128.",
+            name);
+        PyBuffer_Release(view);
+        return -1;
+    }
+
+    *len_ptr = view->len / view->itemsize;
+    return 0;
+}
+
+/* Parses a sequence of two floats a<b. */
+static int parse_interval(PyObject *obj, FNFT_REAL *vals, const char *name)
+{
+    PyObject *seq;
+
+    seq = PySequence_Fast(obj, "");
+    if (seq == NULL || PySequence_Fast_GET_SIZE(seq) != 2) {
+        Py_XDECREF(seq);
+        PyErr_Format(PyExc_ValueError, "%s should be a sequence of two "
+            "floats.", name);
+        return -1;
+    }
+    vals[0] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, 0));
+    vals[1] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, 1));
+    Py_DECREF(seq);
+    if (PyErr_Occurred())
+        return -1;
+    if (!(vals[0] < vals[1])) {
+        PyErr_Format(PyExc_ValueError, "%s[0] should be less than %s[1].",
+            name, name);
+        return -1;
+    }
+    return 0;
+}
+
+/* Maps the name of an enum value to the value. */
+static int parse_enum(const char *str, const char * const *names,
+    const int *vals, const char *name, int *val_ptr)
+{
+    int i;
+
+    for (i=0; names[i] != NULL; i++) {
+        if (strcmp(str, names[i]) == 0) {
+            *val_ptr = vals[i];
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Invalid value '%s' for %s.", str, name);
+    return -1;
+}
+
+static const char * const disc_names[] = { "2SPLIT2A", "2SPLIT4A",
+    "2SPLIT4B", "2SPLIT2_MODAL", "BO", NULL };
+static const int disc_vals[] = { fnft_nse_discretization_2SPLIT2A,
+    fnft_nse_discretization_2SPLIT4A, fnft_nse_discretization_2SPLIT4B,
+    fnft_nse_discretization_2SPLIT2_MODAL, fnft_nse_discretization_BO };
+static const char * const cstype_names[] = { "REFLECTION_COEFFICIENT", "AB",
+    "BOTH", NULL };
+static const int cstype_vals[] = { fnft_nsev_cstype_REFLECTION_COEFFICIENT,
+    fnft_nsev_cstype_AB, fnft_nsev_cstype_BOTH };
+// "NONE" skips the norming constants and residues
+static const char * const dstype_names[] = { "NORMING_CONSTANTS",
+    "RESIDUES", "BOTH", "NONE", NULL };
+static const int dstype_vals[] = { fnft_nsev_dstype_NORMING_CONSTANTS,
+    fnft_nsev_dstype_RESIDUES, fnft_nsev_dstype_BOTH, -1 };
+static const char * const bsloc_names[] = { "FAST_EIGENVALUE", "NEWTON",
+    "SUBSAMPLE_AND_REFINE", NULL };
+static const int bsloc_vals[] = { fnft_nsev_bsloc_FAST_EIGENVALUE,
+    fnft_nsev_bsloc_NEWTON, fnft_nsev_bsloc_SUBSAMPLE_AND_REFINE };
+static const char * const bsfilt_names[] = { "NONE", "BASIC", "FULL", NULL };
+static const int bsfilt_vals[] = { fnft_nsev_bsfilt_NONE,
+    fnft_nsev_bsfilt_BASIC, fnft_nsev_bsfilt_FULL };
+static const char * const symmetry_names[] = { "NONE", "REAL", "DETECT",
+    NULL };
+static const int symmetry_vals[] = { fnft_nsev_symmetry_NONE,
+    fnft_nsev_symmetry_REAL, fnft_nsev_symmetry_DETECT };
+
+/*
+ * Plan objects
+ */
+
+typedef struct {
+    PyObject_HEAD
+    Py_ssize_t D;
+    Py_ssize_t M;
+    Py_ssize_t K_max;
+    int kappa;
+    FNFT_REAL T[2];
+    FNFT_REAL XI[2];
+    fnft_nsev_opts_t opts;
+    Py_ssize_t nvals; // 1, 2 or 3 values per point of the continuous spectrum
+    Py_ssize_t nncr; // 0, 1 or 2 norming constants/residues per bound state
+} plan_t;
+
+static int plan_init(plan_t *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = { "D", "T", "M", "XI", "K_max", "kappa",
+        "discretization", "contspec_type", "discspec_type",
+        "bound_state_localization", "bound_state_filtering", "niter",
+        "normalization", "symmetry", NULL };
+    Py_ssize_t D, M = 0, K_max = -1, niter = 10;
+    PyObject *T_obj, *XI_obj = Py_None, *K_max_obj = Py_None;
+    int kappa = 1, normalization = 1, val;
+    const char *disc = "2SPLIT4B", *cstype = "REFLECTION_COEFFICIENT";
+    const char *dstype = "NORMING_CONSTANTS";
+    const char *bsloc = "SUBSAMPLE_AND_REFINE", *bsfilt = "FULL";
+    const char *symmetry = "NONE";
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nO|nOOi$sssssnps",
+        kwlist, &D, &T_obj, &M, &XI_obj, &K_max_obj, &kappa, &disc, &cstype,
+        &dstype, &bsloc, &bsfilt, &niter, &normalization, &symmetry))
+        return -1;
+
+    if (D < 2) {
+        PyErr_SetString(PyExc_ValueError, "D should be at least two.");
+        return -1;
+    }
+    if (M < 0 || niter < 0) {
+        PyErr_SetString(PyExc_ValueError,
+            "M and niter should be non-negative.");
+        return -1;
+    }
+    if (kappa != 1 && kappa != -1) {
+        PyErr_SetString(PyExc_ValueError, "kappa should be +1 or -1.");
+        return -1;
+    }
+    if (K_max_obj != Py_None) {
+        K_max = PyNumber_AsSsize_t(K_max_obj, PyExc_OverflowError);
+        if (K_max == -1 && PyErr_Occurred())
+            return -1;
+        if (K_max < 0) {
+            PyErr_SetString(PyExc_ValueError,
+                "K_max should be non-negative.");
+            return -1;
+        }
+    }
+    if (parse_interval(T_obj, self->T, "T") != 0)
+        return -1;
+    self->XI[0] = 0.0;
+    self->XI[1] = 0.0;
+    if (M > 0 && parse_interval(XI_obj, self->XI, "XI") != 0)
+        return -1;
+
+    self->opts = fnft_nsev_default_opts();
+    if (parse_enum(disc, disc_names, disc_vals, "discretization", &val) != 0)
+        return -1;
+    self->opts.discretization = val;
+    if (parse_enum(cstype, cstype_names, cstype_vals, "contspec_type",
+        &val) != 0)
+        return -1;
+    self->opts.contspec_type = val;
+    if (parse_enum(dstype, dstype_names, dstype_vals, "discspec_type",
+        &val) != 0)
+        return -1;
+    self->nncr = 0;
+    if (val >= 0) {
+        self->opts.discspec_type = val;
+        self->nncr = (val == fnft_nsev_dstype_BOTH) ? 2 : 1;
+    }
+    if (parse_enum(bsloc, bsloc_names, bsloc_vals,
+        "bound_state_localization", &val) != 0)
+        return -1;
+    self->opts.bound_state_localization = val;
+    if (parse_enum(bsfilt, bsfilt_names, bsfilt_vals,
+        "bound_state_filtering", &val) != 0)
+        return -1;
+    self->opts.bound_state_filtering = val;
+    if (parse_enum(symmetry, symmetry_names, symmetry_vals, "symmetry",
+        &val) != 0)
+        return -1;
+    self->opts.symmetry = val;
+    self->opts.niter = (FNFT_UINT)niter;
+    self->opts.normalization_flag = normalization;
+
+    if (K_max < 0)
+        K_max = (Py_ssize_t)fnft_nsev_max_K((FNFT_UINT)D, &self->opts);
+    if (K_max == 0)
+        self->nncr = 0;
+
+    self->D = D;
+    self->M = M;
+    self->K_max = K_max;
+    self->kappa = kappa;
+    switch (self->opts.contspec_type) {
+    case fnft_nsev_cstype_AB:
+        self->nvals = 2;
+        break;
+    case fnft_nsev_cstype_BOTH:
+        self->nvals = 3;
+        break;
+    default:
+        self->nvals = 1;
+    }
+    return 0;
+}
+
+/* Returns obj, or a new 1-D complex array of length len if obj is None. */
+static PyObject *out_or_new(PyObject *obj, Py_ssize_t len)
+{
+    if (obj != Py_None) {
+        Py_INCREF(obj);
+        return obj;
+    }
+    return new_array(0, len, "complex128");
+}
+
+static PyObject *plan_transform(plan_t *self, PyObject *args,
+    PyObject *kwargs)
+{
+    static char *kwlist[] = { "q", "contspec", "bound_states",
+        "normconsts_or_residues", NULL };
+    PyObject *q_obj, *cs_obj = Py_None, *bs_obj = Py_None;
+    PyObject *ncr_obj = Py_None;
+    PyObject *cs = NULL, *bs = NULL, *ncr = NULL, *ret = NULL;
+    PyObject *bs_ret = NULL, *ncr_ret = NULL;
+    Py_buffer q_view, cs_view, bs_view, ncr_view;
+    int have_q = 0, have_cs = 0, have_bs = 0, have_ncr = 0;
+    Py_ssize_t len, K_len = 0;
+    FNFT_UINT K = 0;
+    FNFT_INT ret_code;
+    fnft_nsev_opts_t opts;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOO", kwlist, &q_obj,
+        &cs_obj, &bs_obj, &ncr_obj))
+        return NULL;
+
+    if (get_complex_buffer(q_obj, &q_view, 0, "q", &len) != 0)
+        goto release_mem;
+    have_q = 1;
+    if (len != self->D) {
+        PyErr_Format(PyExc_ValueError, "q should have %zd samples.",
+            self->D);
+        goto release_mem;
+    }
+
+    if (self->M > 0) {
+        cs = out_or_new(cs_obj, self->nvals*self->M);
+        if (cs == NULL)
+            goto release_mem;
+        if (get_complex_buffer(cs, &cs_view, 1, "contspec", &len) != 0)
+            goto release_mem;
+        have_cs = 1;
+        if (len < self->nvals*self->M) {
+            PyErr_Format(PyExc_ValueError, "contspec should have at least "
+                "%zd entries.", self->nvals*self->M);
+            goto release_mem;
+        }
+    }
+
+    // The length of bound_states determines the maximum number of bound
+    // states (and the number of initial guesses for NEWTON)
+    if (self->K_max > 0) {
+        if (bs_obj == Py_None && self->opts.bound_state_localization
+        == fnft_nsev_bsloc_NEWTON) {
+            PyErr_SetString(PyExc_ValueError, "bound_states should contain "
+                "the initial guesses for the NEWTON method.");
+            goto release_mem;
+        }
+        bs = out_or_new(bs_obj, self->K_max);
+        if (bs == NULL)
+            goto release_mem;
+        if (get_complex_buffer(bs, &bs_view, 1, "bound_states", &K_len) != 0)
+            goto release_mem;
+        have_bs = 1;
+        K = (FNFT_UINT)K_len;
+
+        if (self->nncr > 0) {
+            ncr = out_or_new(ncr_obj, self->nncr*K_len);
+            if (ncr == NULL)
+                goto release_mem;
+            if (get_complex_buffer(ncr, &ncr_view, 1,
+                "normconsts_or_residues", &len) != 0)
+                goto release_mem;
+            have_ncr = 1;
+            if (len < self->nncr*K_len) {
+                PyErr_Format(PyExc_ValueError, "normconsts_or_residues "
+                    "should have at least %zd entries.", self->nncr*K_len);
+                goto release_mem;
+            }
+        }
+    }
+
+    // fnft_nsev temporarily changes the options, so every call gets a copy.
+    // This allows several threads to use the same plan.
+    opts = self->opts;
+    Py_BEGIN_ALLOW_THREADS
+    ret_code = fnft_nsev((FNFT_UINT)self->D, (FNFT_COMPLEX *)q_view.buf,
+        self->T, (FNFT_UINT)self->M,
+        have_cs ? (FNFT_COMPLEX *)cs_view.buf : NULL, self->XI, &K,
+        have_bs ? (FNFT_COMPLEX *)bs_view.buf : NULL,
+        have_ncr ? (FNFT_COMPLEX *)ncr_view.buf : NULL, self->kappa, &opts);
+    Py_END_ALLOW_THREADS
+    if (ret_code != FNFT_SUCCESS) {
+        set_fnft_error("fnft_nsev", ret_code);
+        goto release_mem;
+    }
+
+    // Only the first K bound states (nncr*K norming constants/residues)
+    // are returned
+    if (bs != NULL) {
+        bs_ret = PySequence_GetSlice(bs, 0, (Py_ssize_t)K);
+        if (bs_ret == NULL)
+            goto release_mem;
+    } else {
+        bs_ret = Py_None;
+        Py_INCREF(bs_ret);
+    }
+    if (ncr != NULL) {
+        ncr_ret = PySequence_GetSlice(ncr, 0, self->nncr*(Py_ssize_t)K);
+        if (ncr_ret == NULL)
+            goto release_mem;
+    } else {
+        ncr_ret = Py_None;
+        Py_INCREF(ncr_ret);
+    }
+    ret = PyTuple_Pack(3, cs != NULL ? cs : Py_None, bs_ret, ncr_ret);
+
+release_mem:
+    if (have_q)
+        PyBuffer_Release(&q_view);
+    if (have_cs)
+        PyBuffer_Release(&cs_view);
+    if (have_bs)
+        PyBuffer_Release(&bs_view);
+    if (have_ncr)
+        PyBuffer_Release(&ncr_view);
+    Py_XDECREF(cs);
+    Py_XDECREF(bs);
+    Py_XDECREF(ncr);
+    Py_XDECREF(bs_ret);
+    Py_XDECREF(ncr_ret);
+    return ret;
+}
+
+static PyObject *plan_get_T(plan_t *self, void *closure)
+{
+    (void)closure;
+    return Py_BuildValue("(dd)", self->T[0], self->T[1]);
+}
+
+static PyObject *plan_get_XI(plan_t *self, void *closure)
+{
+    (void)closure;
+    if (self->M == 0)
+        Py_RETURN_NONE;
+    return Py_BuildValue("(dd)", self->XI[0], self->XI[1]);
+}
+
+static PyObject *plan_batch(plan_t *self, PyObject *args, PyObject *kwargs);
+
+static PyMethodDef plan_methods[] = {
+    { "transform", (PyCFunction)(void(*)(void))plan_transform,
+        METH_VARARGS | METH_KEYWORDS,
+        "transform(q, contspec=None, bound_states=None, "
+        "normconsts_or_residues=None)\n--\n\n"
+        "Computes the nonlinear Fourier transform of the D samples in q.\n\n"
+        "The results are written into the given arrays (C-contiguous,\n"
+        "complex128, writable) or into new arrays. The length of\n"
+        "bound_states is the maximum number of bound states (default K_max).\n"
+        "Returns (contspec, bound_states, normconsts_or_residues), where\n"
+        "the last two are views of the first K (2*K for BOTH) entries. Parts\n"
+        "that are not computed are None. The GIL is released while FNFT\n"
+        "runs, and several threads can use the same plan." },
+    { "batch", (PyCFunction)(void(*)(void))plan_batch,
+        METH_VARARGS | METH_KEYWORDS,
+        "batch(nsig)\n--\n\nReturns NsevBatch(self, nsig)." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMemberDef plan_members[] = {
+    { "D", T_PYSSIZET, offsetof(plan_t, D), READONLY,
+        "Number of samples per signal." },
+    { "M", T_PYSSIZET, offsetof(plan_t, M), READONLY,
+        "Number of points of the continuous spectrum (0: not computed)." },
+    { "K_max", T_PYSSIZET, offsetof(plan_t, K_max), READONLY,
+        "Default maximum number of bound states (0: not computed)." },
+    { "kappa", T_INT, offsetof(plan_t, kappa), READONLY,
+        "+1 (focusing) or -1 (defocusing)." },
+    { NULL, 0, 0, 0, NULL }
+};
+
+static PyGetSetDef plan_getset[] = {
+    { "T", (getter)plan_get_T, NULL, "Times of the first and last sample.",
+        NULL },
+    { "XI", (getter)plan_get_XI, NULL,
+        "First and last point of the continuous spectrum.", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject plan_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "fnft.NsevPlan",
+    .tp_basicsize = sizeof(plan_t),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "NsevPlan(D, T, M=0, XI=None, K_max=None, kappa=1, *, "
+        "discretization='2SPLIT4B', contspec_type='REFLECTION_COEFFICIENT', "
+        "discspec_type='NORMING_CONSTANTS', "
+        "bound_state_localization='SUBSAMPLE_AND_REFINE', "
+        "bound_state_filtering='FULL', niter=10, normalization=True, "
+        "symmetry='NONE')\n--\n\n"
+        "Parameters and options of fnft_nsev for signals of D samples.\n\n"
+        "The continuous spectrum is computed at M points in XI (M=0: not\n"
+        "computed). K_max is the default maximum number of bound states\n"
+        "(None: fnft_nsev_max_K, 0: not computed). The options have the\n"
+        "names of the values of the C enums. discspec_type='NONE' skips the\n"
+        "norming constants and residues. Plans are immutable.",
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)plan_init,
+    .tp_methods = plan_methods,
+    .tp_members = plan_members,
+    .tp_getset = plan_getset,
+};
+
+/*
+ * Batch objects
+ */
+
+typedef struct {
+    PyObject_HEAD
+    plan_t *plan;
+    Py_ssize_t nsig;
+    PyObject *contspec; // arrays of shape (nsig, ...) or None
+    PyObject *bound_states;
+    PyObject *normconsts_or_residues;
+    PyObject *K;
+    int busy; // set while a transform runs
+} batch_t;
+
+static int batch_init(batch_t *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = { "plan", "nsig", NULL };
+    plan_t *plan;
+    Py_ssize_t nsig;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!n", kwlist,
+        &plan_type, &plan, &nsig))
+        return -1;
+    if (nsig < 1) {
+        PyErr_SetString(PyExc_ValueError, "nsig should be positive.");
+        return -1;
+    }
+    if (plan->opts.bound_state_localization == fnft_nsev_bsloc_NEWTON
+    && plan->K_max > 0) {
+        PyErr_SetString(PyExc_ValueError, "Batches do not support the "
+            "NEWTON method.");
+        return -1;
+    }
+
+    Py_CLEAR(self->plan);
+    Py_CLEAR(self->contspec);
+    Py_CLEAR(self->bound_states);
+    Py_CLEAR(self->normconsts_or_residues);
+    Py_CLEAR(self->K);
+    Py_INCREF(plan);
+    self->plan = plan;
+    self->nsig = nsig;
+
+    // The result arrays are allocated once and reused by every transform
+    if (plan->M > 0) {
+        self->contspec = new_array(nsig, plan->nvals*plan->M, "complex128");
+        if (self->contspec == NULL)
+            return -1;
+    }
+    if (plan->K_max > 0) {
+        self->bound_states = new_array(nsig, plan->K_max, "complex128");
+        self->K = new_array(0, nsig, "uintp");
+        if (self->bound_states == NULL || self->K == NULL)
+            return -1;
+        if (plan->nncr > 0) {
+            self->normconsts_or_residues = new_array(nsig,
+                plan->nncr*plan->K_max, "complex128");
+            if (self->normconsts_or_residues == NULL)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int batch_traverse(batch_t *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->plan);
+    Py_VISIT(self->contspec);
+    Py_VISIT(self->bound_states);
+    Py_VISIT(self->normconsts_or_residues);
+    Py_VISIT(self->K);
+    return 0;
+}
+
+static int batch_clear(batch_t *self)
+{
+    Py_CLEAR(self->plan);
+    Py_CLEAR(self->contspec);
+    Py_CLEAR(self->bound_states);
+    Py_CLEAR(self->normconsts_or_residues);
+    Py_CLEAR(self->K);
+    return 0;
+}
+
+static void batch_dealloc(batch_t *self)
+{
+    PyObject_GC_UnTrack(self);
+    batch_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* Gets a writable buffer of one of the result arrays of a batch. */
+static int get_result_buffer(PyObject *obj, Py_buffer *view)
+{
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE)
+        != 0)
+        return -1;
+    return 0;
+}
+
+static PyObject *batch_transform(batch_t *self, PyObject *args,
+    PyObject *kwargs)
+{
+    static char *kwlist[] = { "q", NULL };
+    PyObject *q_obj, *ret = NULL;
+    Py_buffer q_view, cs_view, bs_view, ncr_view, K_view;
+    int have_q = 0, have_cs = 0, have_bs = 0, have_ncr = 0, have_K = 0;
+    Py_ssize_t len;
+    plan_t *plan = self->plan;
+    FNFT_INT ret_code;
+    fnft_nsev_opts_t opts;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", kwlist, &q_obj))
+        return NULL;
+    if (plan == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Batch is not initialized.");
+        return NULL;
+    }
+
+    // The result arrays are shared, so a batch can only be used by one
+    // thread at a time. The flag is tested and set while holding the GIL.
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError,
+            "Batch is used by another thread.");
+        return NULL;
+    }
+
+    if (get_complex_buffer(q_obj, &q_view, 0, "q", &len) != 0)
+        goto release_mem;
+    have_q = 1;
+    if (len != self->nsig*plan->D) {
+        PyErr_Format(PyExc_ValueError, "q should have nsig*D=%zd samples.",
+            self->nsig*plan->D);
+        goto release_mem;
+    }
+    if (self->contspec != NULL) {
+        if (get_result_buffer(self->contspec, &cs_view) != 0)
+            goto release_mem;
+        have_cs = 1;
+    }
+    if (self->bound_states != NULL) {
+        if (get_result_buffer(self->bound_states, &bs_view) != 0)
+            goto release_mem;
+        have_bs = 1;
+        if (get_result_buffer(self->K, &K_view) != 0)
+            goto release_mem;
+        have_K = 1;
+    }
+    if (self->normconsts_or_residues != NULL) {
+        if (get_result_buffer(self->normconsts_or_residues, &ncr_view) != 0)
+            goto release_mem;
+        have_ncr = 1;
+    }
+
+    self->busy = 1;
+    opts = plan->opts;
+    Py_BEGIN_ALLOW_THREADS
+    ret_code = fnft_nsev_multi((FNFT_UINT)self->nsig, (FNFT_UINT)plan->D,
+        (FNFT_COMPLEX *)q_view.buf, plan->T, (FNFT_UINT)plan->M,
+        have_cs ? (FNFT_COMPLEX *)cs_view.buf : NULL, plan->XI,
+        (FNFT_UINT)plan->K_max, have_K ? (FNFT_UINT *)K_view.buf : NULL,
+        have_bs ? (FNFT_COMPLEX *)bs_view.buf : NULL,
+        have_ncr ? (FNFT_COMPLEX *)ncr_view.buf : NULL, plan->kappa, &opts);
+    Py_END_ALLOW_THREADS
+    self->busy = 0;
+    if (ret_code != FNFT_SUCCESS) {
+        set_fnft_error("fnft_nsev_multi", ret_code);
+        goto release_mem;
+    }
+    Py_INCREF(Py_None);
+    ret = Py_None;
+
+release_mem:
+    if (have_q)
+        PyBuffer_Release(&q_view);
+    if (have_cs)
+        PyBuffer_Release(&cs_view);
+    if (have_bs)
+        PyBuffer_Release(&bs_view);
+    if (have_K)
+        PyBuffer_Release(&K_view);
+    if (have_ncr)
+        PyBuffer_Release(&ncr_view);
+    return ret;
+}
+
+static PyMethodDef batch_methods[] = {
+    { "transform", (PyCFunction)(void(*)(void))batch_transform,
+        METH_VARARGS | METH_KEYWORDS,
+        "transform(q)\n--\n\n"
+        "Transforms the nsig signals in q (C-contiguous complex128 array\n"
+        "with nsig*D entries, e.g. of shape (nsig, D)) with\n"
+        "fnft_nsev_multi. The results are written into the arrays contspec,\n"
+        "K, bound_states and normconsts_or_residues of the batch, which\n"
+        "are overwritten by the next call. The GIL is released while FNFT\n"
+        "runs. A batch can only be used by one thread at a time." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMemberDef batch_members[] = {
+    { "plan", T_OBJECT, offsetof(batch_t, plan), READONLY, "The plan." },
+    { "nsig", T_PYSSIZET, offsetof(batch_t, nsig), READONLY,
+        "Number of signals." },
+    { "contspec", T_OBJECT, offsetof(batch_t, contspec), READONLY,
+        "Continuous spectra, shape (nsig, M) ((nsig, 2*M) for AB, "
+        "(nsig, 3*M) for BOTH), or None." },
+    { "K", T_OBJECT, offsetof(batch_t, K), READONLY,
+        "Numbers of bound states, shape (nsig,), or None." },
+    { "bound_states", T_OBJECT, offsetof(batch_t, bound_states), READONLY,
+        "Bound states, shape (nsig, K_max). Row t holds K[t] values. "
+        "Or None." },
+    { "normconsts_or_residues", T_OBJECT,
+        offsetof(batch_t, normconsts_or_residues), READONLY,
+        "Norming constants or residues, shape (nsig, K_max) ((nsig, 2*K_max) "
+        "for BOTH), or None. Laid out as in fnft_nsev_multi." },
+    { NULL, 0, 0, 0, NULL }
+};
+
+static PyTypeObject batch_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "fnft.NsevBatch",
+    .tp_basicsize = sizeof(batch_t),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_doc = "NsevBatch(plan, nsig)\n--\n\n"
+        "Transforms nsig signals with the parameters of an NsevPlan in\n"
+        "lockstep (see fnft_nsev_multi). The result arrays are allocated\n"
+        "once and reused by every call of transform.",
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)batch_init,
+    .tp_dealloc = (destructor)batch_dealloc,
+    .tp_traverse = (traverseproc)batch_traverse,
+    .tp_clear = (inquiry)batch_clear,
+    .tp_methods = batch_methods,
+    .tp_members = batch_members,
+};
+
+static PyObject *plan_batch(plan_t *self, PyObject *args, PyObject *kwargs)
+{
+    static char *kwlist[] = { "nsig", NULL };
+    Py_ssize_t nsig;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n", kwlist, &nsig))
+        return NULL;
+    return PyObject_CallFunction((PyObject *)&batch_type, "On",
+        (PyObject *)self, nsig);
+}
+
+/*
+ * Module
+ */
+
+static PyObject *max_K(PyObject *module, PyObject *args)
+{
+    Py_ssize_t D;
+
+    (void)module;
+    if (!PyArg_ParseTuple(args, "n", &D))
+        return NULL;
+    if (D < 2) {
+        PyErr_SetString(PyExc_ValueError, "D should be at least two.");
+        return NULL;
+    }
+    return PyLong_FromSize_t(fnft_nsev_max_K((FNFT_UINT)D, NULL));
+}
+
+static PyMethodDef module_methods[] = {
+    { "nsev_max_K", max_K, METH_VARARGS,
+        "nsev_max_K(D)\n--\n\nMaximum number of bound states that fnft_nsev "
+        "can detect for D samples and the default options." },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "fnft",
+    .m_doc = "Python interface of FNFT (fast nonlinear Fourier transforms).",
+    .m_size = -1,
+    .m_methods = module_methods,
+};
+
+PyMODINIT_FUNC PyInit_fnft(void)
+{
+    PyObject *module;
+
+    if (PyType_Ready(&plan_type) < 0 || PyType_Ready(&batch_type) < 0)
+        return NULL;
+    module = PyModule_Create(&module_def);
+    if (module == NULL)
+        return NULL;
+
+    fnft_error = PyErr_NewExceptionWithDoc("fnft.Error",
+        "Raised if an FNFT routine returns an error code.",
+        PyExc_RuntimeError, NULL);
+    if (fnft_error == NULL)
+        goto on_error;
+    Py_INCREF(fnft_error);
+    if (PyModule_AddObject(module, "Error", fnft_error) < 0) {
+        Py_DECREF(fnft_error);
+        goto on_error;
+    }
+    Py_INCREF(&plan_type);
+    if (PyModule_AddObject(module, "NsevPlan", (PyObject *)&plan_type) < 0) {
+        Py_DECREF(&plan_type);
+        goto on_error;
+    }
+    Py_INCREF(&batch_type);
+    if (PyModule_AddObject(module, "NsevBatch", (PyObject *)&batch_type)
+        < 0) {
+        Py_DECREF(&batch_type);
+        goto on_error;
+    }
+    return module;
+
+on_error:
+    Py_DECREF(module);
+    return NULL;
+}
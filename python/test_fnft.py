@@ -0,0 +1,269 @@
+# This file is part of FNFT.
+#
+# FNFT is free software; you can redistribute it and/or
+# modify it under the terms of the version 2 of the GNU General
+# Public License as published by the Free Software Foundation.
+#
+# FNFT is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+# Contributors:
+# Sander Wahls (TU Delft) 2017-2018.
+
+"""Tests of the Python interface. Run with 'python -m pytest' in this folder
+(or 'ctest -R fnft_python' in the build folder). Add '-s' to see the
+throughput numbers."""
+
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import pytest
+
+import fnft
+
+T = (-25.0, 25.0)
+XI = (-7.0 / 5.0, 8.0 / 5.0)
+
+
+def sech_signal(D, A=3.2):
+    # Same signal as nsev_testcases_SECH_FOCUSING (Satsuma & Yajima)
+    t = np.linspace(T[0], T[1], D)
+    return 1j * A / np.cosh(t)
+
+
+def random_pulses(nsig, D, seed=1):
+    rng = np.random.default_rng(seed)
+    t = np.linspace(T[0], T[1], D)
+    q = np.empty((nsig, D), dtype=np.complex128)
+    for i in range(nsig):
+        A = rng.uniform(0.5, 3.0)
+        chirp = rng.uniform(-0.5, 0.5)
+        q[i] = A / np.cosh(t / 2) * np.exp(1j * chirp * t**2 / 10)
+    return q
+
+
+def match_error(x, y):
+    # Largest distance of a value in x to the nearest value in y
+    if len(x) == 0:
+        return 0.0
+    return max(np.min(np.abs(y - v)) for v in x)
+
+
+def test_sech_focusing():
+    D = 4096
+    plan = fnft.NsevPlan(D, T, 16, XI, kappa=1, contspec_type="AB")
+    ab, bs, nc = plan.transform(sech_signal(D))
+
+    xi = np.linspace(XI[0], XI[1], 16)
+    a, b = ab[:16], ab[16:]
+    b_exact = 1j * np.sin(np.pi * 3.2) / np.cosh(np.pi * xi)
+    assert np.max(np.abs(b - b_exact)) < 1e-5
+    assert np.max(np.abs(np.abs(a)**2 + np.abs(b)**2 - 1)) < 1e-5
+
+    assert len(bs) == 3 and len(nc) == 3
+    order = np.argsort(bs.imag)
+    assert np.max(np.abs(bs[order] - np.array([0.7j, 1.7j, 2.7j]))) < 1e-4
+    assert np.max(np.abs(nc[order] - np.array([1j, -1j, 1j]))) < 1e-4
+
+
+def test_caller_provided_arrays():
+    D = 1024
+    q = sech_signal(D)
+    plan = fnft.NsevPlan(D, T, 32, XI, discspec_type="BOTH")
+    cs_new, bs_new, ncr_new = plan.transform(q)
+
+    cs = np.zeros(32, dtype=np.complex128)
+    bs = np.zeros(10, dtype=np.complex128)
+    ncr = np.zeros(20, dtype=np.complex128)
+    cs_ret, bs_ret, ncr_ret = plan.transform(q, contspec=cs,
+                                             bound_states=bs,
+                                             normconsts_or_residues=ncr)
+
+    # The results are written into the given arrays without copies
+    assert cs_ret is cs
+    assert np.shares_memory(bs_ret, bs) and np.shares_memory(ncr_ret, ncr)
+    assert len(bs_ret) == 3 and len(ncr_ret) == 6
+    assert np.array_equal(cs, cs_new)
+    assert np.array_equal(bs_ret, bs_new)
+    assert np.array_equal(ncr_ret, ncr_new)
+
+    # Read-only samples are accepted, the samples are not modified
+    q_ro = q.copy()
+    q_ro.flags.writeable = False
+    cs_ro, _, _ = plan.transform(q_ro)
+    assert np.array_equal(cs_ro, cs_new)
+    assert np.array_equal(q_ro, q)
+
+
+def test_skipped_parts():
+    D = 512
+    q = sech_signal(D)
+    cs, bs, ncr = fnft.NsevPlan(D, T, 0, K_max=0).transform(q)
+    assert cs is None and bs is None and ncr is None
+    cs, bs, ncr = fnft.NsevPlan(D, T, discspec_type="NONE").transform(q)
+    assert cs is None and len(bs) == 3 and ncr is None
+
+
+def test_newton():
+    D = 2048
+    plan = fnft.NsevPlan(D, T, bound_state_localization="NEWTON")
+    guesses = np.array([0.65j, 1.75j, 2.6j])
+    _, bs, _ = plan.transform(sech_signal(D), bound_states=guesses)
+    assert np.shares_memory(bs, guesses)
+    assert match_error(bs, np.array([0.7j, 1.7j, 2.7j])) < 1e-4
+    with pytest.raises(ValueError):
+        plan.transform(sech_signal(D))
+
+
+def test_invalid_arguments():
+    D = 256
+    plan = fnft.NsevPlan(D, T, 16, XI)
+    q = sech_signal(D)
+    with pytest.raises(TypeError):
+        plan.transform(q.astype(np.complex64))
+    with pytest.raises(TypeError):
+        plan.transform(sech_signal(2 * D)[::2])  # not contiguous
+    with pytest.raises(TypeError):
+        plan.transform(bytearray(16 * D))
+    with pytest.raises(ValueError):
+        plan.transform(q[:-1])
+    with pytest.raises(ValueError):
+        plan.transform(q, contspec=np.empty(15, dtype=np.complex128))
+    with pytest.raises(TypeError):
+        ro = np.empty(16, dtype=np.complex128)
+        ro.flags.writeable = False
+        plan.transform(q, contspec=ro)
+    with pytest.raises(ValueError):
+        fnft.NsevPlan(D, T, 16, XI, discretization="UNKNOWN")
+    with pytest.raises(ValueError):
+        fnft.NsevPlan(D, (1.0, -1.0))
+    with pytest.raises(ValueError):
+        fnft.NsevPlan(D, T, 16)  # XI is missing
+    with pytest.raises(ValueError):
+        fnft.NsevPlan(D, T, kappa=2)
+    with pytest.raises(ValueError):
+        fnft.NsevBatch(plan, 0)
+
+
+def test_error_code():
+    # Too few samples for the fourth-order discretization
+    plan = fnft.NsevPlan(2, T, 4, XI)
+    with pytest.raises(fnft.Error):
+        plan.transform(np.zeros(2, dtype=np.complex128))
+
+
+@pytest.mark.parametrize("D,bsloc", [(64, "SUBSAMPLE_AND_REFINE"),
+                                     (300, "FAST_EIGENVALUE")])
+def test_batch_matches_plan(D, bsloc):
+    nsig = 6
+    q = random_pulses(nsig, D)
+    plan = fnft.NsevPlan(D, T, 40, XI, contspec_type="BOTH",
+                         discspec_type="BOTH", bound_state_localization=bsloc,
+                         discretization="2SPLIT2A")
+    batch = plan.batch(nsig)
+    assert batch.contspec.shape == (nsig, 3 * 40)
+    assert batch.normconsts_or_residues.shape == (nsig, 2 * plan.K_max)
+
+    batch.transform(q)
+    for i in range(nsig):
+        cs, bs, ncr = plan.transform(q[i])
+        K = int(batch.K[i])
+        assert K == len(bs)
+        rel_err = (np.max(np.abs(batch.contspec[i] - cs))
+                   / np.max(np.abs(cs)))
+        assert rel_err < 1e-10
+        bs_batch = batch.bound_states[i, :K]
+        assert match_error(bs_batch, bs) < 1e-10
+        assert match_error(bs, bs_batch) < 1e-10
+        nc = batch.normconsts_or_residues[i, :K]
+        res = batch.normconsts_or_residues[i, K:2 * K]
+        for j in range(K):
+            k = np.argmin(np.abs(bs - bs_batch[j]))
+            assert abs(nc[j] - ncr[k]) <= 1e-8 * max(1.0, abs(ncr[k]))
+            assert abs(res[j] - ncr[K + k]) <= 1e-8 * max(1.0, abs(ncr[K + k]))
+
+
+def test_batch_reuses_arrays():
+    D, nsig = 128, 4
+    plan = fnft.NsevPlan(D, T, 16, XI)
+    batch = fnft.NsevBatch(plan, nsig)
+    arrays = (batch.contspec, batch.bound_states,
+              batch.normconsts_or_residues, batch.K)
+    batch.transform(random_pulses(nsig, D, seed=2))
+    first = batch.contspec.copy()
+    batch.transform(random_pulses(nsig, D, seed=3).ravel())
+    assert all(a is b for a, b in zip(arrays, (batch.contspec,
+               batch.bound_states, batch.normconsts_or_residues, batch.K)))
+    assert not np.array_equal(first, batch.contspec)
+    with pytest.raises(ValueError):
+        batch.transform(random_pulses(nsig + 1, D))
+
+
+def test_plan_shared_by_threads():
+    D, nsig = 1024, 8
+    q = random_pulses(nsig, D, seed=4)
+    plan = fnft.NsevPlan(D, T, 64, XI)
+    expected = [plan.transform(q[i]) for i in range(nsig)]
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        results = list(pool.map(plan.transform, q))
+    for (cs, bs, nc), (cs_e, bs_e, nc_e) in zip(results, expected):
+        assert np.array_equal(cs, cs_e)
+        assert np.array_equal(bs, bs_e)
+        assert np.array_equal(nc, nc_e)
+
+
+def test_gil_released():
+    # While a long transform runs in another thread, this thread should
+    # keep running. If the GIL was held, it would be blocked for the whole
+    # transform.
+    D = 2**15
+    plan = fnft.NsevPlan(D, (-200.0, 200.0), D, (-10.0, 10.0), K_max=0)
+    q = sech_signal(D, A=1.0)
+    start = time.perf_counter()
+    plan.transform(q)
+    duration = time.perf_counter() - start
+
+    worker = threading.Thread(target=plan.transform, args=(q,))
+    worker.start()
+    last = time.perf_counter()
+    max_gap = 0.0
+    while worker.is_alive():
+        now = time.perf_counter()
+        max_gap = max(max_gap, now - last)
+        last = now
+    worker.join()
+    assert max_gap < 0.5 * duration
+
+
+def test_throughput():
+    # Many short signals: plan reuse in a loop vs. batch
+    D, nsig, M = 128, 256, 128
+    q = random_pulses(nsig, D, seed=5)
+    plan = fnft.NsevPlan(D, T, M, XI, K_max=0)
+    batch = plan.batch(nsig)
+    cs = np.empty(M, dtype=np.complex128)
+
+    def run_loop():
+        for i in range(nsig):
+            plan.transform(q[i], contspec=cs)
+
+    def best_of(fun, repeats=3):
+        times = []
+        for _ in range(repeats):
+            start = time.perf_counter()
+            fun()
+            times.append(time.perf_counter() - start)
+        return min(times)
+
+    t_loop = best_of(run_loop)
+    t_batch = best_of(lambda: batch.transform(q))
+    print("\nD=%d, M=%d: %.0f signals/s (plan), %.0f signals/s (batch)"
+          % (D, M, nsig / t_loop, nsig / t_batch))
+    assert t_batch < 1.5 * t_loop
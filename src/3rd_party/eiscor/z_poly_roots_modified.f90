@@ -4,6 +4,9 @@
 !   - Residuals are not computed
 !   - The roots are no longer printed (forgotten printf?)
 !   - Made the threshold used to decide whether QR or QZ is used an input
+!   - The work arrays can be provided by the caller (z_poly_roots_modified_ws),
+!     so that many polynomials of the same degree can be solved without
+!     allocating memory for each of them
 !
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 !
@@ -52,15 +55,82 @@ subroutine z_poly_roots_modified(N,COEFFS,ROOTS,THRESHOLD,INFO)
   real(8), intent(in) :: THRESHOLD
   
   ! compute variables
-  integer :: ii
-  real(8) :: scl
   logical, allocatable :: P(:)
   integer, allocatable :: ITS(:)
-  real(8), allocatable :: Q(:),D1(:),C1(:),B1(:)
-  real(8), allocatable :: D2(:),C2(:),B2(:)
+  real(8), allocatable :: RWORK(:)
+  complex(8), allocatable :: ZWORK(:)
+
+  ! allocate memory
+  allocate(P(N-2),ITS(N-1),RWORK(19*N+1),ZWORK(2*N))
+
+  ! compute roots
+  call z_poly_roots_modified_ws(N,COEFFS,ROOTS,THRESHOLD,INFO,P,ITS,RWORK,ZWORK)
+
+  ! free memory
+  deallocate(P,ITS,RWORK,ZWORK)
+
+end subroutine z_poly_roots_modified
+
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!
+! z_poly_roots_modified_ws
+!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!
+! Same as z_poly_roots_modified, but the work arrays are provided by the
+! caller. They are overwritten.
+!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!
+! WORK VARIABLES:
+!
+!  P               LOGICAL array of dimension (N-2)
+!
+!  ITS             INTEGER array of dimension (N-1)
+!
+!  RWORK           REAL(8) array of dimension (19*N+1)
+!
+!  ZWORK           COMPLEX(8) array of dimension (2*N)
+!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+subroutine z_poly_roots_modified_ws(N,COEFFS,ROOTS,THRESHOLD,INFO,P,ITS,RWORK,ZWORK)
+
+  implicit none
+  
+  ! input variables
+  integer, intent(in) :: N
+  integer, intent(inout) :: INFO
+  complex(8), intent(in) :: COEFFS(N+1)
+  complex(8), intent(inout) :: ROOTS(N)
+  real(8), intent(in) :: THRESHOLD
+
+  ! work variables
+  logical, intent(inout) :: P(N-2)
+  integer, intent(inout) :: ITS(N-1)
+  real(8), intent(inout) :: RWORK(19*N+1)
+  complex(8), intent(inout) :: ZWORK(2*N)
+
+  ! partition the work arrays
+  call compute(RWORK(1:3*(N-1)),RWORK(3*N-2:5*N-1),RWORK(5*N:8*N-1), &
+               RWORK(8*N:11*N-1),RWORK(11*N:13*N+1),RWORK(13*N+2:16*N+1), &
+               RWORK(16*N+2:19*N+1),ZWORK(1:N),ZWORK(N+1:2*N))
+
+contains
+
+subroutine compute(Q,D1,C1,B1,D2,C2,B2,V,W)
+
+  implicit none
+
+  ! work variables
+  real(8), intent(inout) :: Q(3*(N-1)),D1(2*(N+1)),C1(3*N),B1(3*N)
+  real(8), intent(inout) :: D2(2*(N+1)),C2(3*N),B2(3*N)
+  complex(8), intent(inout) :: V(N),W(N)
+
+  ! compute variables
+  integer :: ii
+  real(8) :: scl
   real(8) :: normc
   complex(8) :: sclc
-  complex(8), allocatable :: V(:),W(:)
   interface
     function l_upr1fact_hess(m,flags)
       logical :: l_upr1fact_hess
@@ -90,9 +160,6 @@ subroutine z_poly_roots_modified(N,COEFFS,ROOTS,THRESHOLD,INFO)
     end function l_upr1fact_random
   end interface
   
-  ! allocate memory
-  allocate(P(N-2),ITS(N-1),Q(3*(N-1)),D1(2*(N+1)),C1(3*N),B1(3*N))    
-  allocate(V(N),W(N),D2(2*(N+1)),C2(3*N),B2(3*N))    
 
   ! initialize INFO
   INFO = 0
@@ -161,7 +228,6 @@ subroutine z_poly_roots_modified(N,COEFFS,ROOTS,THRESHOLD,INFO)
 
   end if
         
-  ! free memory
-  deallocate(P,ITS,Q,D1,C1,B1,D2,C2,B2,V,W)
+end subroutine compute
 
-end subroutine z_poly_roots_modified
+end subroutine z_poly_roots_modified_ws
@@ -20,10 +20,27 @@
 #define FNFT_ENABLE_SHORT_NAMES
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include "fnft_errwarn.h"
+#include "fnft__errwarn.h"
 #include "fnft_config.h"
 
+#ifdef HAVE__THREAD_LOCAL
+#define FNFT__THREAD_LOCAL _Thread_local
+#else
+#ifdef HAVE___THREAD
+#define FNFT__THREAD_LOCAL __thread
+#else
+#define FNFT__THREAD_LOCAL
+#endif
+#endif
+
+#if defined(HAVE___ATOMIC) && (defined(HAVE__THREAD_LOCAL) \
+    || defined(HAVE___THREAD))
+#define FNFT__HAVE_DIAG
+#endif
+
 // Default printf function, prints to stderr
 INT fnft__default_printf(const char * format, ...)
 {
@@ -39,15 +56,8 @@ INT fnft__default_printf(const char * format, ...)
 
 // Pointer to printf functions used for error messages and warnings. Set to
 // NULL to disable those. Make thread local if possible. 
-static
-#ifdef HAVE__THREAD_LOCAL
-_Thread_local
-#else
-#ifdef HAVE___THREAD
-__thread
-#endif
-#endif
-fnft_printf_ptr_t fnft__printf_ptr = fnft__default_printf;
+static FNFT__THREAD_LOCAL fnft_printf_ptr_t fnft__printf_ptr =
+    fnft__default_printf;
 
 void fnft_errwarn_setprintf(fnft_printf_ptr_t printf_ptr)
 {
@@ -59,3 +69,173 @@ fnft_printf_ptr_t fnft_errwarn_getprintf()
     return fnft__printf_ptr;
 }
 
+// Ring buffer for the diagnostics of one thread. Only the thread that has
+// claimed the buffer (in_use=1) writes head and the counters. Drainers only
+// write tail. The buffers form a list that only grows, so that drainers can
+// traverse it without locks.
+struct fnft__diag_buffer {
+    struct fnft__diag_buffer *next;
+    UINT id;
+    UINT capacity;
+    INT in_use;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t errors;
+    uint64_t warnings;
+    uint64_t dropped;
+    fnft_errwarn_event_t events[];
+};
+
+static struct fnft__diag_buffer *fnft__diag_list = NULL;
+static UINT fnft__diag_count = 0;
+static INT fnft__diag_drain_lock = 0;
+static FNFT__THREAD_LOCAL struct fnft__diag_buffer *fnft__diag_buf = NULL;
+
+FNFT_INT fnft_errwarn_setdiag(const UINT capacity)
+{
+#ifdef FNFT__HAVE_DIAG
+    struct fnft__diag_buffer *b;
+    INT expected;
+
+    if (capacity == 0) {
+        if (fnft__diag_buf != NULL) {
+            __atomic_store_n(&fnft__diag_buf->in_use, 0, __ATOMIC_RELEASE);
+            fnft__diag_buf = NULL;
+        }
+        return SUCCESS;
+    }
+    if (fnft__diag_buf != NULL)
+        return SUCCESS;
+
+    // Take over a buffer that is not in use and large enough
+    b = __atomic_load_n(&fnft__diag_list, __ATOMIC_ACQUIRE);
+    for (; b != NULL; b = b->next) {
+        expected = 0;
+        if (b->capacity >= capacity && __atomic_compare_exchange_n(
+            &b->in_use, &expected, 1, 0, __ATOMIC_ACQ_REL,
+            __ATOMIC_RELAXED)) {
+            fnft__diag_buf = b;
+            return SUCCESS;
+        }
+    }
+
+    // Create a new buffer and prepend it to the list
+    b = malloc(sizeof(struct fnft__diag_buffer)
+        + capacity * sizeof(fnft_errwarn_event_t));
+    if (b == NULL)
+        return FNFT_EC_NOMEM;
+    b->capacity = capacity;
+    b->in_use = 1;
+    b->head = 0;
+    b->tail = 0;
+    b->errors = 0;
+    b->warnings = 0;
+    b->dropped = 0;
+    b->id = __atomic_fetch_add(&fnft__diag_count, 1, __ATOMIC_RELAXED);
+    b->next = __atomic_load_n(&fnft__diag_list, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&fnft__diag_list, &b->next, b, 1,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    fnft__diag_buf = b;
+    return SUCCESS;
+#else
+    return capacity == 0 ? SUCCESS : FNFT_EC_NOT_YET_IMPLEMENTED;
+#endif
+}
+
+INT fnft__errwarn_record(const INT ec, const char *func, const INT line,
+    const char *msg)
+{
+#ifdef FNFT__HAVE_DIAG
+    struct fnft__diag_buffer * const b = fnft__diag_buf;
+    fnft_errwarn_event_t *event;
+    uint64_t head;
+
+    if (b == NULL)
+        return 0;
+    if (ec == SUCCESS)
+        __atomic_store_n(&b->warnings, b->warnings + 1, __ATOMIC_RELAXED);
+    else
+        __atomic_store_n(&b->errors, b->errors + 1, __ATOMIC_RELAXED);
+
+    head = b->head;
+    if (head - __atomic_load_n(&b->tail, __ATOMIC_ACQUIRE) >= b->capacity) {
+        __atomic_store_n(&b->dropped, b->dropped + 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    event = &b->events[head % b->capacity];
+    event->ec = ec;
+    event->func = func;
+    event->line = line;
+    event->msg = msg;
+    event->thread = b->id;
+    __atomic_store_n(&b->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+#else
+    (void)ec;
+    (void)func;
+    (void)line;
+    (void)msg;
+    return 0;
+#endif
+}
+
+UINT fnft_errwarn_drain(fnft_errwarn_event_t * const events,
+    const UINT max_events)
+{
+#ifdef FNFT__HAVE_DIAG
+    struct fnft__diag_buffer *b;
+    uint64_t head, tail;
+    UINT n = 0;
+
+    if (events == NULL)
+        return 0;
+    while (__atomic_exchange_n(&fnft__diag_drain_lock, 1, __ATOMIC_ACQUIRE))
+        ;
+    b = __atomic_load_n(&fnft__diag_list, __ATOMIC_ACQUIRE);
+    for (; b != NULL && n < max_events; b = b->next) {
+        tail = b->tail;
+        head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+        while (tail < head && n < max_events)
+            events[n++] = b->events[tail++ % b->capacity];
+        __atomic_store_n(&b->tail, tail, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&fnft__diag_drain_lock, 0, __ATOMIC_RELEASE);
+    return n;
+#else
+    (void)events;
+    (void)max_events;
+    return 0;
+#endif
+}
+
+fnft_errwarn_summary_t fnft_errwarn_summary(void)
+{
+    fnft_errwarn_summary_t summary = { 0, 0, 0, 0, 0 };
+#ifdef FNFT__HAVE_DIAG
+    struct fnft__diag_buffer *b;
+
+    b = __atomic_load_n(&fnft__diag_list, __ATOMIC_ACQUIRE);
+    for (; b != NULL; b = b->next) {
+        summary.errors += __atomic_load_n(&b->errors, __ATOMIC_RELAXED);
+        summary.warnings += __atomic_load_n(&b->warnings, __ATOMIC_RELAXED);
+        summary.dropped += __atomic_load_n(&b->dropped, __ATOMIC_RELAXED);
+        summary.pending += __atomic_load_n(&b->head, __ATOMIC_RELAXED)
+            - __atomic_load_n(&b->tail, __ATOMIC_RELAXED);
+        summary.buffers++;
+    }
+#endif
+    return summary;
+}
+
+void fnft_errwarn_print_event(fnft_errwarn_event_t const * const event)
+{
+    fnft_printf_ptr_t printf_ptr = fnft_errwarn_getprintf();
+
+    if (printf_ptr == NULL || event == NULL)
+        return;
+    printf_ptr("FNFT %s: %s\n in %s(%i)-%d.%d.%d\n",
+        event->ec == SUCCESS ? "Warning" : "Error", event->msg, event->func,
+        event->line, FNFT_VERSION_MAJOR, FNFT_VERSION_MINOR,
+        FNFT_VERSION_PATCH);
+}
@@ -147,7 +147,7 @@ static INT tf2contspec_negxi(UINT deg,
     // Determine discretization-specific coefficients
     degree1step = kdv_discretization_degree(opts_ptr->discretization);
     boundary_coeff = kdv_discretization_boundary_coeff(opts_ptr->discretization);
-    if (degree1step == NAN || boundary_coeff == NAN)
+    if (degree1step == 0 || isnan(boundary_coeff))
         return E_INVALID_ARGUMENT(opts_ptr->discretization);
 
     // Allocate memory
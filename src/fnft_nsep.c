@@ -77,6 +77,8 @@ static inline INT gridsearch(const UINT D,
     INT warn_flags[2]);
 static inline void update_bounding_box_if_auto(const REAL eps_t,
     const REAL map_coeff, fnft_nsep_opts_t * const opts_ptr);
+static inline UINT mainspec_poly(const UINT deg,
+    COMPLEX const * const transfer_matrix, COMPLEX * const p);
 
 // Main routine.
 INT fnft_nsep(const UINT D, COMPLEX const * const q, 
@@ -189,8 +191,8 @@ static inline INT gridsearch(const UINT D,
     COMPLEX * p = NULL;
     COMPLEX * roots = NULL;
     REAL map_coeff;
-    REAL PHI[2] = { 0.0, 2.0*PI };
-	UINT deg;
+    REAL PHI[2] = { 0.0, 2.0*PI }, PHI_main[2];
+	UINT deg, deg_main;
     REAL eps_t;
     INT W = 0, *W_ptr = NULL;
     UINT K, K_filtered;
@@ -248,22 +250,26 @@ static inline INT gridsearch(const UINT D,
         // where Delta(z)=trace{monodromy matrix(z)}is the Floquet discriminant
 
         // Allocate memory for the polynomial p(z) approx z^{D/2} Delta(z)+/-2
-        // and its roots
-        p = malloc((deg + 1)*sizeof(COMPLEX));
+        // and its roots. For odd deg, p is a polynomial in w=z^(1/2) of
+        // degree 2*deg (see mainspec_poly), and the angles of its roots are
+        // half the angles of the z.
+        deg_main = deg%2 == 0 ? deg : 2*deg;
+        p = malloc((deg_main + 1)*sizeof(COMPLEX));
         if (p == NULL) {
             ret_code = E_NOMEM;
             goto release_mem;
         }
+        PHI_main[0] = PHI[0]*deg/deg_main;
+        PHI_main[1] = PHI[1]*deg/deg_main;
 
         // First, determine p(z) for the positive sign (+)
-        for (i=0; i<=deg; i++)
-            p[i] = transfer_matrix[i] + CONJ(transfer_matrix[deg-i]);
-        p[deg/2] += 2.0 * POW(2.0, -W); // the pow arises because
+        mainspec_poly(deg, transfer_matrix, p);
+        p[deg_main/2] += 2.0 * POW(2.0, -W); // the pow arises because
                                              // nse_fscatter rescales
 
         // Find the roots of p(z)
         K = oversampling_factor*deg;
-        ret_code = poly_roots_fftgridsearch(deg, p, &K, PHI, roots);
+        ret_code = poly_roots_fftgridsearch(deg_main, p, &K, PHI_main, roots);
         CHECK_RETCODE(ret_code, release_mem);
         if (K > deg) {
             ret_code = E_OTHER("Found more roots than memory is available.");
@@ -271,8 +277,11 @@ static inline INT gridsearch(const UINT D,
         }
 
         // Coordinate transform (from discrete-time to continuous-time domain)
-        for (i=0; i<K; i++)
+        for (i=0; i<K; i++) {
+            if (deg_main != deg)
+                roots[i] *= roots[i]; // z = w^2
             roots[i] = CLOG(roots[i]) / (map_coeff*I*eps_t);
+        }
 
         // Filter the roots
         if (opts_ptr->filtering != fnft_nsep_filt_NONE) {
@@ -291,12 +300,12 @@ static inline INT gridsearch(const UINT D,
         memcpy(main_spec, roots, K * sizeof(COMPLEX));
 
         // Second, determine p(z) for the negative sign (-)
-        p[deg/2] -= 4.0 * POW(2.0, -W);
+        p[deg_main/2] -= 4.0 * POW(2.0, -W);
 
         // Find the roots of the new p(z)
         K_filtered = oversampling_factor*deg;
-        ret_code = poly_roots_fftgridsearch(deg, p, &K_filtered, PHI,
-            roots);
+        ret_code = poly_roots_fftgridsearch(deg_main, p, &K_filtered,
+            PHI_main, roots);
         CHECK_RETCODE(ret_code, release_mem);
         if (K_filtered > deg) {
             ret_code = E_OTHER("Found more roots than memory is available.");
@@ -304,8 +313,11 @@ static inline INT gridsearch(const UINT D,
         }
 
         // Coordinate transform of the new roots
-        for (i=0; i<K_filtered; i++)
+        for (i=0; i<K_filtered; i++) {
+            if (deg_main != deg)
+                roots[i] *= roots[i]; // z = w^2
             roots[i] = CLOG(roots[i]) / (map_coeff*I*eps_t);
+        }
 
         // Filter the new roots
         if (opts_ptr->filtering != fnft_nsep_filt_NONE) {
@@ -386,13 +398,14 @@ static inline INT subsample_and_refine(const UINT D,
     COMPLEX * qsub = NULL;
     REAL map_coeff;
     REAL tol_im;
-	UINT deg;
+	UINT deg, deg_main;
     UINT Dsub, subsampling_factor;
     REAL eps_t, eps_t_sub;
     INT W = 0, *W_ptr = NULL;
     UINT K = 0, K_filtered = 0;
     UINT M = 0;
-    UINT i;
+    UINT i, npoly, K_plus = 0, K_minus = 0, off_minus, off_aux;
+    INT status[3];
     INT ret_code = SUCCESS;
 
     // To suppress unused parameter warnings.
@@ -433,38 +446,99 @@ static inline INT subsample_and_refine(const UINT D,
     tol_im = opts_ptr->bounding_box[1] - opts_ptr->bounding_box[0];
     tol_im /= oversampling_factor*(D - 1);
 
-    // Use unused part of transfer matrix as buffer for the roots
-    roots = transfer_matrix + 3*(deg+1);
- 
-    // Compute main spectrum if desired
+    // Allocate memory for the (up to three) polynomials whose roots are
+    // required and for their roots. For odd deg, the polynomial for the main
+    // spectrum is a polynomial in w=z^(1/2) of degree 2*deg (see
+    // mainspec_poly), and the roots for both signs are stored with up to
+    // 2*deg entries each.
+    if (deg%2 == 0) {
+        deg_main = deg;
+        off_minus = deg;
+        off_aux = 2*deg;
+    } else {
+        deg_main = 2*deg;
+        off_minus = 2*deg;
+        off_aux = 4*deg;
+    }
+    p = malloc((2*(deg_main + 1) + deg + 1)*sizeof(COMPLEX));
+    roots = malloc((off_aux + deg)*sizeof(COMPLEX));
+    if (p == NULL || roots == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    // The main spectrum is given by the z that solve Delta(z)=+/-2,
+    // where Delta(z)=trace{monodromy matrix(z)}is the Floquet discriminant.
+    // The polynomials p(z) approx z^{D/2} Delta(z)+/-2 are stored first.
+    npoly = 0;
     if (main_spec != NULL) {
+        mainspec_poly(deg, transfer_matrix, p);
+        p[deg_main/2] += 2.0 * POW(2.0, -W); // the pow arises because
+                                             // nse_fscatter rescales
+        if (deg_main == deg) {
+            memcpy(p + (deg + 1), p, (deg + 1)*sizeof(COMPLEX));
+            p[(deg + 1) + deg/2] -= 4.0 * POW(2.0, -W);
+            npoly = 2;
+        }
+    }
 
-        // The main spectrum is given by the z that solve Delta(z)=+/-2,
-        // where Delta(z)=trace{monodromy matrix(z)}is the Floquet discriminant
+    if (deg_main == deg) {
+        // The aux spectrum is given by the roots of the upper right element
+        if (aux_spec != NULL) {
+            memcpy(p + npoly*(deg + 1), transfer_matrix + (deg + 1),
+                (deg + 1)*sizeof(COMPLEX));
+            npoly++;
+        }
 
-        // Allocate memory for the polynomial p(z) approx z^{D/2} Delta(z)+/-2
-        p = malloc((deg + 1)*sizeof(COMPLEX));
-        if (p == NULL) {
-            ret_code = E_NOMEM;
-            goto release_mem;
+        // Find the roots of all polynomials at once. The eigenvalue solver
+        // reuses its work arrays and solves the polynomials in parallel.
+        ret_code = poly_roots_fasteigen_batch(deg, npoly, p, roots, status,
+            0);
+        CHECK_RETCODE(ret_code, release_mem);
+        for (i=0; i<npoly; i++) {
+            if (status[i] != SUCCESS) {
+                ret_code = E_SUBROUTINE(status[i]);
+                goto release_mem;
+            }
+        }
+        K_plus = deg;
+        K_minus = deg;
+        off_aux = (npoly - 1)*deg;
+    } else {
+        // If w solves p(w)=0 for the positive sign, then -w solves it for
+        // the negative sign since deg is odd. The roots with Re(w)>=0 belong
+        // to the positive sign, the others to the negative sign (z=w^2 for
+        // both).
+        if (main_spec != NULL) {
+            ret_code = poly_roots_fasteigen(deg_main, p, roots);
+            CHECK_RETCODE(ret_code, release_mem);
+            for (i=0; i<deg_main; i++) {
+                if (CREAL(roots[i]) >= 0)
+                    roots[K_plus++] = roots[i]*roots[i];
+                else
+                    roots[off_minus + K_minus++] = roots[i]*roots[i];
+            }
         }
 
-        // First, determine p(z) for the positive sign (+)
-        for (i=0; i<=deg; i++)
-            p[i] = transfer_matrix[i] + CONJ(transfer_matrix[deg-i]);
-        p[deg/2] += 2.0 * POW(2.0, -W); // the pow arises because
-                                             // nse_fscatter rescales
+        // The aux spectrum is given by the roots of the upper right element
+        if (aux_spec != NULL) {
+            ret_code = poly_roots_fasteigen(deg, transfer_matrix + (deg + 1),
+                roots + off_aux);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+    }
 
-        // Find the roots of p(z)
-        ret_code = poly_roots_fasteigen(deg, p, roots);
-        CHECK_RETCODE(ret_code, release_mem);
+    // Compute main spectrum if desired
+    if (main_spec != NULL) {
+
+        // First, process the roots of p(z) for the positive sign (+)
 
         // Coordinate transform (from discrete-time to continuous-time domain)
-        for (i=0; i<deg; i++)
+        for (i=0; i<K_plus; i++)
             roots[i] = CLOG(roots[i]) / (map_coeff*I*eps_t_sub);
 
         // Filter the roots
-        K = deg;
+        K = K_plus;
         if (opts_ptr->filtering != fnft_nsep_filt_NONE) {
             ret_code = misc_filter(&K, roots, NULL, opts_ptr->bounding_box);
             CHECK_RETCODE(ret_code, release_mem);
@@ -499,19 +573,15 @@ static inline INT subsample_and_refine(const UINT D,
         }
         memcpy(main_spec, roots, K * sizeof(COMPLEX));
 
-        // Second, determine p(z) for the negative sign (-)
-        p[deg/2] -= 4.0 * POW(2.0, -W);
-
-        // Find the roots of the new p(z)
-        ret_code = poly_roots_fasteigen(deg, p, roots);
-        CHECK_RETCODE(ret_code, release_mem);
+        // Second, process the roots of p(z) for the negative sign (-)
+        memcpy(roots, roots + off_minus, K_minus*sizeof(COMPLEX));
 
         // Coordinate transform of the new roots
-        for (i=0; i<deg; i++)
+        for (i=0; i<K_minus; i++)
             roots[i] = CLOG(roots[i]) / (map_coeff*I*eps_t_sub);
 
         // Filter the new roots
-        K_filtered = deg;
+        K_filtered = K_minus;
         if (opts_ptr->filtering != fnft_nsep_filt_NONE) {
             ret_code = misc_filter(&K_filtered, roots, NULL,
                 opts_ptr->bounding_box);
@@ -556,9 +626,7 @@ static inline INT subsample_and_refine(const UINT D,
 
     // Compute aux spectrum if desired
     if (aux_spec != NULL) {      
-        ret_code = poly_roots_fasteigen(deg, transfer_matrix + (deg + 1),
-            roots);
-        CHECK_RETCODE(ret_code, release_mem);
+        memcpy(roots, roots + off_aux, deg*sizeof(COMPLEX));
 
         // Set number of points in the aux spectrum
         M = deg;
@@ -606,12 +674,49 @@ static inline INT subsample_and_refine(const UINT D,
 release_mem:
     free(transfer_matrix);
     free(p);
+    free(roots);
 	free(qsub);
 
     return ret_code;
 }
 
-// Uses Newton's method for roots of higher order to refine the main spectrum.
+// Auxiliary function: Returns the maximum of |q[n]|.
+static inline REAL max_abs(const UINT D, COMPLEX const * const q)
+{
+    UINT n;
+    REAL qmax = 0.0;
+
+    for (n=0; n<D; n++) {
+        if (CABS(q[n]) > qmax)
+            qmax = CABS(q[n]);
+    }
+    return qmax;
+}
+
+// Auxiliary function: Returns the step of a root finding method for f that
+// adapts to the multiplicity of the root. The multiplicity is estimated by
+// m = f'^2/(f'^2 - f*f''). For simple roots (m close to one), the step of
+// Halley's method is returned, which converges cubically. Otherwise,
+// Newton's method for roots of order m is used (x <- x - m*f/f', also known
+// as Schroeder's method), which converges quadratically.
+static inline COMPLEX adaptive_step(const COMPLEX f, const COMPLEX f_prime,
+    const COMPLEX f_prime2)
+{
+    const COMPLEX tmp = f_prime*f_prime - f*f_prime2;
+    COMPLEX m;
+
+    if (tmp == 0.0)
+        return f / f_prime;
+    m = f_prime*f_prime / tmp;
+    if (CABS(m - 1.0) < 0.5)
+        return (f / f_prime) / (1.0 - 0.5*f*f_prime2/(f_prime*f_prime));
+    return m * f / f_prime;
+}
+
+// Refines the main spectrum. The main spectrum consists of the roots of
+// f(lam)=a(lam)+atil(lam)+rhs for rhs=+/-2.0, which are often of higher
+// order. Every iteration needs one evaluation of the monodromy matrix and
+// its first two derivatives.
 static inline INT refine_mainspec(
     const UINT D, COMPLEX const * const q,
     const REAL eps_t, const UINT K,
@@ -619,76 +724,56 @@ static inline INT refine_mainspec(
     const UINT max_evals, const REAL rhs, const INT kappa)
 {
     UINT k;
-    COMPLEX M[8];
-    COMPLEX lam, f, f_prime, incr, tmp, next_f, next_f_prime;
-    REAL cur_abs, min_abs;
+    COMPLEX M[12];
+    COMPLEX lam, f, f_prime, f_prime2, incr, next_f;
+    REAL qmax;
     UINT nevals;
     INT ret_code;
-    UINT m, best_m;
-    const UINT max_m = 4; // led to the lowest number of function evals in
-                            // an example
+
+    if (K == 0 || max_evals == 0)
+        return SUCCESS;
+    qmax = max_abs(D, q);
 
     for (k=0; k<K; k++) { // Iterate over the provided main spectrum estimates.
 
         // Initilization. Computes the monodromy matrix at the current main
-        // spectrum estimate lam and determines the value of
-        // f=a(lam)+a~(lam)+rhs as well as of f' = df/dlam. (The main spectrum
-        // consists of the roots of f for rhs=+/- 2.0.)
-
-        ret_code = nse_scatter_matrix(D, q, eps_t, kappa, 1,
+        // spectrum estimate lam and its derivatives.
+        ret_code = nse_scatter_matrix_d2(D, q, eps_t, kappa, 1,
             &mainspec[k], M, nse_discretization_BO);
         if (ret_code != SUCCESS)
             return E_SUBROUTINE(ret_code);
-        next_f = M[0] + M[3] + rhs; // f = a(lam) + atil(lam) + rhs
-        next_f_prime = 2.0*( M[4] + M[7] ); // f' = 2*[a'(lam) + atil'(lam)]
-
-        // Iteratively refine the current main spectrum poINT by applying
-        // Newton's method for higher order roots: next_x=x-m*f/f', where
-        // m is the order of the root. Since we do not know m, several values
-        // are tested in a line search-like procedure. Per iterion, max_m
-        // values of m are tested, leading to max_m monodromoy mat evaluations.
-        for (nevals=1; nevals<=max_evals; nevals+=max_m) {
-
-            // The current values of f and f' at lam = mainspec[k] 
-            f = next_f;
-            f_prime = next_f_prime;
+
+        for (nevals=1; nevals<max_evals; nevals++) {
+
+            // The current values of f, f' and f'' at lam = mainspec[k]
+            f = M[0] + M[3] + rhs;
+            f_prime = M[4] + M[7];
+            f_prime2 = M[8] + M[11];
             if (f_prime == 0.0)
                 return E_DIV_BY_ZERO;
-            incr = f / f_prime;
-          
-            // Test different increments to deal with the many higher order
-            // roots (Newton's method for a root of order m is x<-x-m*f/f').
-            min_abs = INFINITY;
-            best_m = 1;
-            for (m=1; m<=max_m; m++) {
-                lam = mainspec[k] - m*incr;
-                ret_code = nse_scatter_matrix(D, q, eps_t, kappa, 1, &lam, M, nse_discretization_BO);
-                if (ret_code != SUCCESS)
-                    return E_SUBROUTINE(ret_code);
-                tmp = M[0] + M[3] + rhs;
-                cur_abs = CABS(tmp);
-                // keep this m if the new value of |f| would be lower than the
-                // ones for the previously tested values of m
-                if ( cur_abs < min_abs ) {
-                    min_abs = cur_abs;
-                    best_m = m;
-                    next_f = tmp;
-                    next_f_prime = 2.0*( M[4] + M[7] );
-                } 
-            }
+            incr = adaptive_step(f, f_prime, f_prime2);
 
-            //printf("MAIN k=%zu, nevals=%zu: lam=%g+%gj, |f|=%g, |f_prime|=%g, |incr|=%g\n", k, nevals, CREAL(mainspec[k]), CIMAG(mainspec[k]), CABS(f), CABS(f_prime),CABS(incr));
-            if ( min_abs >= CABS(f) ) // stop if no improvement
+            // Evaluate at the new point and keep it only if |f| decreases
+            lam = mainspec[k] - incr;
+            ret_code = nse_scatter_matrix_d2(D, q, eps_t, kappa, 1, &lam, M,
+                nse_discretization_BO);
+            if (ret_code != SUCCESS)
+                return E_SUBROUTINE(ret_code);
+            next_f = M[0] + M[3] + rhs;
+            if ( !(CABS(next_f) < CABS(f)) ) // stop if no improvement
                 break;
+            mainspec[k] = lam;
 
-            mainspec[k] -= best_m*incr;
-        };
-        //printf("==> used %zu evaluations\n", nevals);
+            // Stop if further steps cannot improve the accuracy
+            if (CABS(incr) <= nse_scatter_refine_tol(eps_t, qmax, lam))
+                break;
+        }
     }
     return SUCCESS;
 }
 
-// Uses Newton's method to refine the aux spectrum.
+// Refines the aux spectrum, which consists of the (simple) roots of b(lam),
+// with Halley's method.
 static inline INT refine_auxspec(
     const UINT D, COMPLEX const * const q,
     const REAL eps_t, const UINT K,
@@ -696,38 +781,74 @@ static inline INT refine_auxspec(
     const INT kappa)
 {
     UINT k, nevals;
-    COMPLEX M[8];
-    COMPLEX f, f_prime, prev_f;
+    COMPLEX M[12];
+    COMPLEX lam, f, f_prime, f_prime2, incr;
+    REAL qmax;
     INT ret_code;
 
+    if (K == 0 || max_evals == 0)
+        return SUCCESS;
+    qmax = max_abs(D, q);
+
     for (k=0; k<K; k++) {
 
-        prev_f = NAN;
-        for (nevals=0; nevals<max_evals; nevals++) {
+        ret_code = nse_scatter_matrix_d2(D, q, eps_t, kappa, 1,
+            &auxspec[k], M, nse_discretization_BO);
+        if (ret_code != SUCCESS)
+            return E_SUBROUTINE(ret_code);
+
+        for (nevals=1; nevals<max_evals; nevals++) {
 
-            ret_code = nse_scatter_matrix(D, q, eps_t, kappa, 1,
-                &auxspec[k], M, nse_discretization_BO);
-            if (ret_code != SUCCESS)
-                return E_SUBROUTINE(ret_code);
-           
             f = M[2]; // f = b(lam)
             f_prime = M[6]; // f' = b'(lam)
+            f_prime2 = M[10]; // f'' = b''(lam)
             if (f_prime == 0.0)
                 return E_DIV_BY_ZERO;
+            incr = (f / f_prime) / (1.0 - 0.5*f*f_prime2/(f_prime*f_prime));
 
-            if ( CABS(f) >= CABS(prev_f) ) // stop if no improvement
+            // Evaluate at the new point and keep it only if |f| decreases
+            lam = auxspec[k] - incr;
+            ret_code = nse_scatter_matrix_d2(D, q, eps_t, kappa, 1, &lam, M,
+                nse_discretization_BO);
+            if (ret_code != SUCCESS)
+                return E_SUBROUTINE(ret_code);
+            if ( !(CABS(M[2]) < CABS(f)) ) // stop if no improvement
                 break;
+            auxspec[k] = lam;
 
-            // printf("AUX k=%zu, iter=%zu: lam=%g+%gj, |f|=%g, |f_prime|=%g\n", k, iter, CREAL(auxspec[k]), CIMAG(auxspec[k]), CABS(f), CABS(f_prime));
-
-            auxspec[k] -= f / f_prime;
-            prev_f = f;
-       }
+            // Stop if further steps cannot improve the accuracy
+            if (CABS(incr) <= nse_scatter_refine_tol(eps_t, qmax, lam))
+                break;
+        }
     }
 
     return SUCCESS;
 }
 
+// Auxiliary function: Stores the coefficients of T11(z)+T22(z), where T is
+// the transfer matrix of degree deg, in p and returns the degree of p. The
+// Floquet discriminant contains the factor z^(-deg/2). For odd deg, this is
+// a half-integer power. The coefficients are then stored as a polynomial in
+// w=z^(1/2) of degree 2*deg (every other coefficient is zero), so that the
+// term z^(deg/2) belongs to the middle coefficient of p in both cases.
+static inline UINT mainspec_poly(const UINT deg,
+    COMPLEX const * const transfer_matrix, COMPLEX * const p)
+{
+    UINT i;
+
+    if (deg%2 == 0) {
+        for (i=0; i<=deg; i++)
+            p[i] = transfer_matrix[i] + CONJ(transfer_matrix[deg-i]);
+        return deg;
+    }
+    for (i=0; i<=deg; i++) {
+        p[2*i] = transfer_matrix[i] + CONJ(transfer_matrix[deg-i]);
+        if (i < deg)
+            p[2*i + 1] = 0.0;
+    }
+    return 2*deg;
+}
+
 static inline void update_bounding_box_if_auto(const REAL eps_t,
     const REAL map_coeff, fnft_nsep_opts_t * const opts_ptr)
 {
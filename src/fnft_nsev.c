@@ -22,9 +22,11 @@
 
 #include <string.h> // for memcpy
 #include <stdio.h>
+#include <stdint.h>
 #include "fnft__errwarn.h"
 #include "fnft__poly_roots_fasteigen.h"
 #include "fnft__poly_chirpz.h"
+#include "fnft__poly_fmult.h"
 #include "fnft_nsev.h"
 #include "fnft__nse_fscatter.h"
 #include "fnft__nse_scatter.h"
@@ -38,7 +40,9 @@ static fnft_nsev_opts_t default_opts = {
     .discspec_type = nsev_dstype_NORMING_CONSTANTS,
     .contspec_type = nsev_cstype_REFLECTION_COEFFICIENT,
     .normalization_flag = 1,
-    .discretization = nse_discretization_2SPLIT4B
+    .discretization = nse_discretization_2SPLIT4B,
+    .symmetry = nsev_symmetry_NONE,
+    .nthreads = 0
 };
 
 /**
@@ -62,10 +66,118 @@ UINT fnft_nsev_max_K(const UINT D, fnft_nsev_opts_t const * const opts)
         return nse_discretization_degree(default_opts.discretization) * D;
 }
 
+/**
+ * Internal representation of the objects of type fnft_nsev_tm_t. The transfer
+ * matrix is computed lazily, i.e., not before a query actually needs it.
+ * Objects that have been imported or merged from segments without signal
+ * have q == NULL. For them, the squared L2 norm of the signal (needed for
+ * filtering) is stored in l2norm2. Otherwise, l2norm2 is computed from q
+ * when needed. It is negative as long as it is unknown. Once samples have
+ * been updated or a gradient has been requested, the product tree of the
+ * scattering matrices of the individual samples is kept in tree. The
+ * transfer matrix is then a copy of the root of the tree.
+ */
+struct fnft_nsev_tm_s {
+    UINT D;
+    COMPLEX *q;
+    REAL T[2];
+    REAL eps_t;
+    INT kappa;
+    fnft_nsev_opts_t opts;
+    COMPLEX *transfer_matrix;
+    UINT deg;
+    INT W;
+    REAL l2norm2;
+    poly_fmult2x2_tree_t *tree;
+    samples_t const *samples;
+};
+
+/**
+ * Binary format of exported transfer matrices. All numbers are stored in
+ * the native byte order of the exporting machine, which is identified by
+ * the byte order mark.
+ *
+ * offset  type        content
+ *      0  char[8]     magic string "FNFTNSTM"
+ *      8  uint32      format version (currently 1)
+ *     12  uint32      byte order mark 0x01020304
+ *     16  uint64      number of samples D
+ *     24  uint64      degree deg
+ *     32  int32       normalization exponent W
+ *     36  int32       kappa
+ *     40  int32       discretization
+ *     44  int32       normalization flag
+ *     48  double[2]   T
+ *     64  double      eps_t
+ *     72  double      squared L2 norm of the signal
+ *     80  double[]    real and imaginary parts of the 4*(deg+1)
+ *                     coefficients of the transfer matrix
+ */
+#define TM_FORMAT_MAGIC "FNFTNSTM"
+#define TM_FORMAT_VERSION 1
+#define TM_FORMAT_BOM 0x01020304
+#define TM_FORMAT_HEADER_LEN 80
+
 /**
  * Declare auxiliary routines used by the main routine fnft_nsev.
  * Their bodies follow below.
  */
+static inline INT tm_setup(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const INT kappa,
+    fnft_nsev_opts_t const * const opts);
+
+static inline INT tm_compute_transfer_matrix(
+    struct fnft_nsev_tm_s * const tm);
+
+static inline INT tm_convert_samples(
+    struct fnft_nsev_tm_s * const tm);
+
+static inline INT tm_transform(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t * const opts);
+
+static inline INT tm_build_tree(
+    struct fnft_nsev_tm_s * const tm);
+
+static inline INT tm_discspec(
+    struct fnft_nsev_tm_s * const tm,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t * const opts);
+
+static inline INT tm_is_real(
+    struct fnft_nsev_tm_s const * const tm,
+    fnft_nsev_opts_t const * const opts);
+
+static inline INT tm_contspec(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    fnft_nsev_opts_t * const opts);
+
+static inline INT fold_bound_states(
+    UINT * const K_ptr,
+    COMPLEX * const bound_states);
+
+static inline void unfold_bound_states(
+    UINT * const K_ptr,
+    const UINT K_max,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t const * const opts);
+
 static inline INT tf2contspec(
     const UINT deg,
     const INT W,
@@ -74,16 +186,26 @@ static inline INT tf2contspec(
     const UINT D,
     REAL const * const XI,
     const UINT M,
+    const UINT first,
+    const UINT n,
     COMPLEX *result,
     fnft_nsev_opts_t * const opts);
 
-static inline INT tf2boundstates(
-    UINT D,
-    COMPLEX const * const q,
-    const UINT deg,
-    COMPLEX * const transfer_matrix,
+static inline INT ab2contspec(
+    const INT W,
     REAL const * const T,
-    const REAL eps_t,
+    const UINT D,
+    REAL const * const XI,
+    const UINT M,
+    const UINT first,
+    const UINT n,
+    COMPLEX const * const a_vals,
+    COMPLEX const * const b_vals,
+    COMPLEX * const result,
+    fnft_nsev_opts_t const * const opts);
+
+static inline INT tf2boundstates(
+    struct fnft_nsev_tm_s * const tm,
     UINT * const K_ptr,
     COMPLEX * const bound_states,
     fnft_nsev_opts_t * const opts);
@@ -93,159 +215,2420 @@ static inline INT tf2normconsts_or_residues(
     COMPLEX const * const q,
     REAL const * const T,
     const UINT K,
-    COMPLEX * const transfer_matrix,
-    const UINT deg,
     COMPLEX * const bound_states,
     COMPLEX * const normconsts_or_residues,
     fnft_nsev_opts_t * const opts);
 
-static inline INT refine_roots_newton(
-    const UINT D,
-    COMPLEX const * const q,
-    REAL const * const T,
-    const UINT K,
-    COMPLEX * bound_states,
-    nse_discretization_t discretization,
-    const UINT niter);
+static inline INT tf2normconsts_or_residues_poly(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT K,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t * const opts);
+
+static inline INT refine_roots_newton(
+    const UINT D,
+    COMPLEX const * const q,
+    REAL const * const T,
+    const UINT K,
+    COMPLEX * bound_states,
+    const REAL map_coeff,
+    const UINT niter);
+
+/**
+ * Fast nonlinear Fourier transform for the nonlinear Schroedinger
+ * equation with vanishing boundary conditions.
+ * See the header file for documentation.
+ */
+INT fnft_nsev(
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    const INT kappa,
+    fnft_nsev_opts_t *opts)
+{
+    struct fnft_nsev_tm_s tm;
+    INT ret_code = SUCCESS;
+    
+    // Check inputs
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (opts == NULL)
+        opts = &default_opts;
+
+    // The signal is used in place. Note that the transfer matrix is only
+    // computed if one of the steps below needs it.
+    ret_code = tm_setup(&tm, D, q, T, kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = tm_transform(&tm, M, contspec, XI, K_ptr, bound_states,
+        normconsts_or_residues, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    
+release_mem:
+    free(tm.transfer_matrix);
+        
+    return ret_code;
+}
+
+/**
+ * Fast nonlinear Fourier transform of a signal in any sample format. See the
+ * header file for documentation.
+ */
+INT fnft_nsev_samples(
+    const UINT D,
+    samples_t const * const samples,
+    REAL const * const T,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    const INT kappa,
+    fnft_nsev_opts_t *opts)
+{
+    struct fnft_nsev_tm_s tm;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    ret_code = misc_samples_check(samples);
+    if (ret_code != SUCCESS)
+        return ret_code;
+    if (opts == NULL)
+        opts = &default_opts;
+
+    // The samples are converted on the fly by the steps that only sweep
+    // over the signal. A converted copy is created only if one of the
+    // steps below needs random access to the signal.
+    ret_code = tm_setup(&tm, D, NULL, T, kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    tm.samples = samples;
+    ret_code = tm_transform(&tm, M, contspec, XI, K_ptr, bound_states,
+        normconsts_or_residues, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+
+release_mem:
+    free(tm.transfer_matrix);
+    free(tm.q);
+
+    return ret_code;
+}
+
+/**
+ * Fast nonlinear Fourier transform that delivers the results to callbacks.
+ * See the header file for documentation.
+ */
+INT fnft_nsev_sink(
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const UINT M,
+    REAL const * const XI,
+    const INT kappa,
+    fnft_nsev_opts_t *opts,
+    fnft_nsev_sink_t const * const sink)
+{
+    struct fnft_nsev_tm_s tm;
+    COMPLEX *vals = NULL, *bound_states = NULL, *normconsts_or_residues = NULL;
+    COMPLEX *tmp;
+    UINT block_len, first, n, K, nvals;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (sink == NULL)
+        return E_INVALID_ARGUMENT(sink);
+    if (opts == NULL)
+        opts = &default_opts;
+    ret_code = tm_setup(&tm, D, q, T, kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Compute the continuous spectrum block by block. Each block is
+    // computed with chirp transforms that start at its first point.
+    if (sink->contspec != NULL && M > 0) {
+        if (XI == NULL || XI[0] >= XI[1]) {
+            ret_code = E_INVALID_ARGUMENT(XI);
+            goto release_mem;
+        }
+        block_len = M;
+        if (sink->block_len > 0 && sink->block_len < M)
+            block_len = sink->block_len;
+        switch (opts->contspec_type) {
+        case nsev_cstype_REFLECTION_COEFFICIENT:
+            nvals = 1;
+            break;
+        case nsev_cstype_AB:
+            nvals = 2;
+            break;
+        case nsev_cstype_BOTH:
+            nvals = 3;
+            break;
+        default:
+            ret_code = E_INVALID_ARGUMENT(opts->contspec_type);
+            goto release_mem;
+        }
+        vals = malloc(nvals * block_len * sizeof(COMPLEX));
+        if (vals == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+
+        ret_code = tm_compute_transfer_matrix(&tm);
+        CHECK_RETCODE(ret_code, release_mem);
+        for (first = 0; first < M; first += n) {
+            n = M - first;
+            if (n > block_len)
+                n = block_len;
+            ret_code = tf2contspec(tm.deg, tm.W, tm.transfer_matrix, tm.T,
+                tm.D, XI, M, first, n, vals, opts);
+            CHECK_RETCODE(ret_code, release_mem);
+            if (sink->contspec(sink->ctx, first, n, vals) != SUCCESS) {
+                ret_code = FNFT_EC_STOPPED; // stopped by the consumer
+                goto release_mem;
+            }
+        }
+    }
+
+    // Compute the discrete spectrum (only the focusing case has bound
+    // states). The buffer for the bound states is sized for the roots of
+    // the polynomial that is passed to the fast eigenvalue method and
+    // shrunk to the number of bound states that survive the filtering.
+    if (sink->discspec != NULL && kappa == +1) {
+        switch (opts->bound_state_localization) {
+        case nsev_bsloc_SUBSAMPLE_AND_REFINE:
+            // The transfer matrix of the full signal is not needed
+            free(tm.transfer_matrix);
+            tm.transfer_matrix = NULL;
+            K = fnft_nsev_max_K(misc_downsample_len(D), opts);
+            break;
+        case nsev_bsloc_FAST_EIGENVALUE:
+            ret_code = tm_compute_transfer_matrix(&tm);
+            CHECK_RETCODE(ret_code, release_mem);
+            K = tm.deg;
+            break;
+        default:
+            ret_code = E_INVALID_ARGUMENT(opts->bound_state_localization);
+            goto release_mem;
+        }
+        bound_states = malloc(K * sizeof(COMPLEX));
+        if (bound_states == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        ret_code = tm_discspec(&tm, &K, bound_states, NULL, opts);
+        CHECK_RETCODE(ret_code, release_mem);
+        free(tm.transfer_matrix);
+        tm.transfer_matrix = NULL;
+        if (K > 0) {
+            tmp = realloc(bound_states, K * sizeof(COMPLEX));
+            if (tmp != NULL)
+                bound_states = tmp;
+        }
+
+        // Deliver the bound states block by block, together with their
+        // norming constants and/or residues
+        block_len = K;
+        if (sink->block_len > 0 && sink->block_len < K)
+            block_len = sink->block_len;
+        if (sink->normconsts_flag && K > 0) {
+            normconsts_or_residues = malloc(2 * block_len * sizeof(COMPLEX));
+            if (normconsts_or_residues == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+        }
+        for (first = 0; first < K; first += n) {
+            n = K - first;
+            if (n > block_len)
+                n = block_len;
+            if (normconsts_or_residues != NULL) {
+                ret_code = tf2normconsts_or_residues(D, q, tm.T, n,
+                    bound_states + first, normconsts_or_residues, opts);
+                CHECK_RETCODE(ret_code, release_mem);
+            }
+            if (sink->discspec(sink->ctx, n, bound_states + first,
+                normconsts_or_residues) != SUCCESS) {
+                ret_code = FNFT_EC_STOPPED;
+                goto release_mem;
+            }
+        }
+    }
+
+release_mem:
+    free(tm.transfer_matrix);
+    free(vals);
+    free(bound_states);
+    free(normconsts_or_residues);
+
+    return ret_code;
+}
+
+/**
+ * Fast nonlinear Fourier transform that delivers coarse results first and
+ * refines them afterwards. See the header file for documentation.
+ */
+INT fnft_nsev_progressive(
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const UINT M,
+    REAL const * const XI,
+    const INT kappa,
+    fnft_nsev_opts_t *opts,
+    fnft_nsev_progress_t const * const progress)
+{
+    struct fnft_nsev_tm_s tm, tm_sub;
+    fnft_nsev_opts_t opts_bs;
+    COMPLEX *qsub = NULL, *contspec = NULL, *bound_states = NULL;
+    COMPLEX *normconsts_or_residues = NULL;
+    UINT Dsub, subsampling_factor, K = 0, nvals = 0, nncr;
+    REAL Tsub[2];
+    INT discspec_flag;
+    INT ret_code = SUCCESS;
+
+    tm.transfer_matrix = NULL;
+    tm_sub.transfer_matrix = NULL;
+
+    // Check inputs
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (progress == NULL || progress->deliver == NULL)
+        return E_INVALID_ARGUMENT(progress);
+    if (opts == NULL)
+        opts = &default_opts;
+    ret_code = tm_setup(&tm, D, q, T, kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (M > 0) {
+        if (XI == NULL || XI[0] >= XI[1])
+            return E_INVALID_ARGUMENT(XI);
+        switch (opts->contspec_type) {
+        case nsev_cstype_REFLECTION_COEFFICIENT:
+            nvals = 1;
+            break;
+        case nsev_cstype_AB:
+            nvals = 2;
+            break;
+        case nsev_cstype_BOTH:
+            nvals = 3;
+            break;
+        default:
+            return E_INVALID_ARGUMENT(opts->contspec_type);
+        }
+    }
+    nncr = (opts->discspec_type == nsev_dstype_BOTH) ? 2 : 1;
+
+    // Only the focusing case has bound states
+    discspec_flag = progress->discspec_flag && kappa == +1;
+
+    // The bound states are always found as with SUBSAMPLE_AND_REFINE, so
+    // that the bound states of the coarse stage serve as the initial guesses
+    // of the refinement. The symmetries of real signals are not exploited.
+    opts_bs = *opts;
+    opts_bs.symmetry = nsev_symmetry_NONE;
+
+    // Coarse stages: The transfer matrix of the subsampled signal that is
+    // also used by SUBSAMPLE_AND_REFINE yields the coarse continuous
+    // spectrum and the coarse bound states
+    ret_code = misc_downsample(q, D, &qsub, &Dsub, &subsampling_factor);
+    CHECK_RETCODE(ret_code, release_mem);
+    Tsub[0] = T[0];
+    Tsub[1] = T[0] + (Dsub - 1)*subsampling_factor*tm.eps_t;
+    ret_code = tm_setup(&tm_sub, Dsub, qsub, Tsub, kappa, &opts_bs);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = tm_compute_transfer_matrix(&tm_sub);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    if (nvals > 0) {
+        contspec = malloc(nvals*M * sizeof(COMPLEX));
+        if (contspec == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        ret_code = tm_contspec(&tm_sub, M, contspec, XI, &opts_bs);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (progress->deliver(progress->ctx, nsev_stage_COARSE_CONTSPEC,
+            Dsub, M, contspec, 0, NULL, NULL) != SUCCESS) {
+            ret_code = FNFT_EC_STOPPED; // stopped by the consumer
+            goto release_mem;
+        }
+    }
+    if (discspec_flag) {
+        K = tm_sub.deg;
+        bound_states = malloc(K * sizeof(COMPLEX));
+        if (bound_states == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        opts_bs.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+        ret_code = tf2boundstates(&tm_sub, &K, bound_states, &opts_bs);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (progress->deliver(progress->ctx, nsev_stage_COARSE_BOUND_STATES,
+            Dsub, M, contspec, K, bound_states, NULL) != SUCCESS) {
+            ret_code = FNFT_EC_STOPPED;
+            goto release_mem;
+        }
+    }
+    free(tm_sub.transfer_matrix);
+    tm_sub.transfer_matrix = NULL;
+
+    // Continuous spectrum of the full signal
+    if (nvals > 0) {
+        ret_code = tm_contspec(&tm, M, contspec, XI, &opts_bs);
+        CHECK_RETCODE(ret_code, release_mem);
+        free(tm.transfer_matrix);
+        tm.transfer_matrix = NULL;
+        if (progress->deliver(progress->ctx, nsev_stage_CONTSPEC, D, M,
+            contspec, K, discspec_flag ? bound_states : NULL, NULL)
+            != SUCCESS) {
+            ret_code = FNFT_EC_STOPPED;
+            goto release_mem;
+        }
+    }
+
+    // Final stage: Newton's method on the full signal refines the bound
+    // states of the coarse stage, followed by the norming constants and/or
+    // residues
+    if (discspec_flag) {
+        opts_bs.bound_state_localization = nsev_bsloc_NEWTON;
+        ret_code = tf2boundstates(&tm, &K, bound_states, &opts_bs);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (progress->normconsts_flag && K > 0) {
+            normconsts_or_residues = malloc(nncr*K * sizeof(COMPLEX));
+            if (normconsts_or_residues == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+            ret_code = tf2normconsts_or_residues(D, q, tm.T, K,
+                bound_states, normconsts_or_residues, &opts_bs);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+    }
+    progress->deliver(progress->ctx, nsev_stage_REFINED, D, M, contspec, K,
+        discspec_flag ? bound_states : NULL, normconsts_or_residues);
+
+release_mem:
+    free(tm.transfer_matrix);
+    free(tm_sub.transfer_matrix);
+    free(qsub);
+    free(contspec);
+    free(bound_states);
+    free(normconsts_or_residues);
+
+    return ret_code;
+}
+
+/**
+ * Fast nonlinear Fourier transform of several signals in lockstep. See the
+ * header file for documentation.
+ */
+INT fnft_nsev_multi(
+    const UINT nsig,
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    const UINT K_max,
+    UINT * const K,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    const INT kappa,
+    fnft_nsev_opts_t *opts)
+{
+    struct fnft_nsev_tm_s tm;
+    COMPLEX *transfer_matrices = NULL, *ab_vals = NULL;
+    COMPLEX A, V;
+    INT *W = NULL;
+    REAL eps_t, eps_xi, map_coeff;
+    UINT t, deg = 0, numel, nvals = 0, nncr = 1;
+    INT ret_code = SUCCESS;
+
+    tm.transfer_matrix = NULL;
+
+    // Check inputs
+    if (nsig == 0)
+        return E_INVALID_ARGUMENT(nsig);
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (opts == NULL)
+        opts = &default_opts;
+    ret_code = tm_setup(&tm, D, q, T, kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (contspec != NULL && M > 0) {
+        if (XI == NULL || XI[0] >= XI[1])
+            return E_INVALID_ARGUMENT(XI);
+        switch (opts->contspec_type) {
+        case nsev_cstype_REFLECTION_COEFFICIENT:
+            nvals = 1;
+            break;
+        case nsev_cstype_AB:
+            nvals = 2;
+            break;
+        case nsev_cstype_BOTH:
+            nvals = 3;
+            break;
+        default:
+            return E_INVALID_ARGUMENT(opts->contspec_type);
+        }
+    }
+    if (bound_states != NULL && K == NULL)
+        return E_INVALID_ARGUMENT(K);
+    if (opts->discspec_type == nsev_dstype_BOTH)
+        nncr = 2;
+
+    // The transfer matrices of all signals are computed in lockstep if the
+    // continuous spectrum or the fast eigenvalue method needs them
+    numel = nse_fscatter_numel(D, opts->discretization);
+    if (nvals > 0 || (bound_states != NULL && kappa == +1
+        && opts->bound_state_localization == nsev_bsloc_FAST_EIGENVALUE)) {
+        transfer_matrices = malloc(nsig * numel * sizeof(COMPLEX));
+        W = calloc(nsig, sizeof(INT));
+        if (transfer_matrices == NULL || W == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        ret_code = nse_fscatter_multi(nsig, D, q, tm.eps_t, kappa,
+            transfer_matrices, &deg,
+            opts->normalization_flag ? W : NULL, opts->discretization);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+
+    // Compute the continuous spectra. The values of a and b of all signals
+    // are computed with chirp transforms that share one plan (see
+    // tf2contspec).
+    if (nvals > 0) {
+        ab_vals = malloc(2 * nsig * M * sizeof(COMPLEX));
+        if (ab_vals == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        map_coeff = nse_discretization_mapping_coeff(opts->discretization);
+        eps_t = tm.eps_t;
+        eps_xi = (XI[1] - XI[0])/(M - 1);
+        V = CEXP(map_coeff*I*eps_xi*eps_t);
+        A = CEXP(-map_coeff*I*XI[0]*eps_t);
+        ret_code = poly_chirpz_batch(deg, nsig, transfer_matrices,
+            4*(deg + 1), A, V, M, ab_vals);
+        CHECK_RETCODE(ret_code, release_mem);
+        ret_code = poly_chirpz_batch(deg, nsig,
+            transfer_matrices + 2*(deg + 1), 4*(deg + 1), A, V, M,
+            ab_vals + nsig*M);
+        CHECK_RETCODE(ret_code, release_mem);
+        for (t = 0; t < nsig; t++) {
+            ret_code = ab2contspec(W[t], T, D, XI, M, 0, M, ab_vals + t*M,
+                ab_vals + (nsig + t)*M, contspec + t*nvals*M, opts);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+    }
+
+    // Compute the discrete spectra signal by signal, reusing the transfer
+    // matrices computed above
+    for (t = 0; t < nsig && bound_states != NULL; t++) {
+        ret_code = tm_setup(&tm, D, q + t*D, T, kappa, opts);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (transfer_matrices != NULL) {
+            tm.transfer_matrix = malloc(numel * sizeof(COMPLEX));
+            if (tm.transfer_matrix == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+            memcpy(tm.transfer_matrix, transfer_matrices + t*4*(deg + 1),
+                4*(deg + 1) * sizeof(COMPLEX));
+            tm.deg = deg;
+            tm.W = W[t];
+        }
+        K[t] = K_max;
+        ret_code = tm_discspec(&tm, K + t, bound_states + t*K_max,
+            normconsts_or_residues == NULL ? NULL
+            : normconsts_or_residues + t*nncr*K_max, opts);
+        CHECK_RETCODE(ret_code, release_mem);
+        free(tm.transfer_matrix);
+        tm.transfer_matrix = NULL;
+    }
+    if (bound_states == NULL && K != NULL) {
+        for (t = 0; t < nsig; t++)
+            K[t] = 0;
+    }
+
+release_mem:
+    free(tm.transfer_matrix);
+    free(transfer_matrices);
+    free(ab_vals);
+    free(W);
+
+    return ret_code;
+}
+
+// fnft_nsev_auto starts with about AUTO_D_START samples and increases the
+// number of samples by at most the factor AUTO_MAX_STEP per run. The
+// predicted subsampling factors are multiplied with AUTO_SAFETY to absorb
+// errors of the error estimates.
+#define AUTO_D_START 64
+#define AUTO_MAX_STEP 8
+#define AUTO_SAFETY 0.9
+
+// Auxiliary function for fnft_nsev_auto: Applies fnft_nsev to every r-th
+// sample of q. The subsampled signal covers the interval [T[0],
+// T[0]+(Dr-1)*r*eps_t] with Dr=(D-1)/r+1 samples. For NEWTON, the initial
+// guesses are restored before every run.
+static INT auto_run(const UINT D, COMPLEX * const q, REAL const * const T,
+    const UINT r, COMPLEX * const qsub, const UINT M,
+    COMPLEX * const contspec, REAL const * const XI, const UINT K_max,
+    UINT * const K_ptr, COMPLEX * const bound_states,
+    COMPLEX const * const guesses, COMPLEX * const normconsts_or_residues,
+    const INT kappa, fnft_nsev_opts_t * const opts)
+{
+    const UINT Dr = (D - 1)/r + 1;
+    REAL Tr[2];
+    UINT i;
+
+    Tr[0] = T[0];
+    Tr[1] = T[1];
+    if (r > 1) {
+        Tr[1] = T[0] + (Dr - 1)*r*((T[1] - T[0])/(D - 1));
+        for (i=0; i<Dr; i++)
+            qsub[i] = q[i*r];
+    }
+    if (bound_states != NULL) {
+        *K_ptr = K_max;
+        if (guesses != NULL)
+            memcpy(bound_states, guesses, K_max * sizeof(COMPLEX));
+    }
+    return fnft_nsev(Dr, r > 1 ? qsub : q, Tr, M, contspec, XI, K_ptr,
+        bound_states, normconsts_or_residues, kappa, opts);
+}
+
+// Auxiliary function for fnft_nsev_auto: Returns the distance between the
+// results of two runs, i.e., the larger one of the maximum distance between
+// the values of the continuous spectra and the Hausdorff distance between
+// the sets of bound states.
+static REAL auto_dist(const UINT len, COMPLEX const * const cs1,
+    COMPLEX const * const cs2, const UINT K1, COMPLEX const * const bs1,
+    const UINT K2, COMPLEX const * const bs2)
+{
+    REAL dist = 0.0, tmp;
+    UINT i;
+
+    for (i=0; i<len; i++) {
+        tmp = CABS(cs1[i] - cs2[i]);
+        if (!(tmp <= dist))
+            dist = isnan(tmp) ? INFINITY : tmp;
+    }
+    if (bs1 != NULL && (K1 > 0 || K2 > 0)) {
+        tmp = misc_hausdorff_dist(K1, bs1, K2, bs2);
+        if (tmp > dist)
+            dist = tmp;
+    }
+    return dist;
+}
+
+/**
+ * Fast nonlinear Fourier transform with automatic choice of the number of
+ * samples. See the header file for documentation.
+ */
+INT fnft_nsev_auto(
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    const INT kappa,
+    fnft_nsev_opts_t *opts,
+    const REAL tol,
+    UINT * const D_used_ptr,
+    REAL * const err_est_ptr)
+{
+    COMPLEX *buf = NULL, *qsub = NULL, *guesses = NULL;
+    COMPLEX *cs[2], *bs[2], *ncr[2];
+    UINT K[2] = { 0, 0 };
+    UINT len_cs = 0, K_max = 0, nncr = 0, len_set, r_cur, r_prev, r_new;
+    UINT cur = 0, prev = 1, i;
+    REAL err, err_new, rho2;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (D < 3)
+        return E_INVALID_ARGUMENT(D);
+    if (T == NULL || T[0] >= T[1])
+        return E_INVALID_ARGUMENT(T);
+    if (!(tol > 0.0))
+        return E_INVALID_ARGUMENT(tol);
+    if (D_used_ptr == NULL)
+        return E_INVALID_ARGUMENT(D_used_ptr);
+    if (err_est_ptr == NULL)
+        return E_INVALID_ARGUMENT(err_est_ptr);
+    if (opts == NULL)
+        opts = &default_opts;
+    if (contspec != NULL && M > 0) {
+        switch (opts->contspec_type) {
+        case nsev_cstype_REFLECTION_COEFFICIENT:
+            len_cs = M;
+            break;
+        case nsev_cstype_AB:
+            len_cs = 2*M;
+            break;
+        case nsev_cstype_BOTH:
+            len_cs = 3*M;
+            break;
+        default:
+            return E_INVALID_ARGUMENT(opts->contspec_type);
+        }
+    }
+    if (bound_states != NULL) {
+        if (K_ptr == NULL)
+            return E_INVALID_ARGUMENT(K_ptr);
+        K_max = *K_ptr;
+        if (normconsts_or_residues != NULL)
+            nncr = (opts->discspec_type == nsev_dstype_BOTH) ? 2 : 1;
+    }
+    if (len_cs == 0 && K_max == 0)
+        return E_INVALID_ARGUMENT(contspec);
+
+    // Allocate memory for the results of the two most recent runs. The
+    // subsampled signals have at most (D-1)/2+1 samples.
+    len_set = len_cs + (1 + nncr)*K_max;
+    buf = malloc(2*len_set * sizeof(COMPLEX));
+    qsub = malloc(((D - 1)/2 + 1) * sizeof(COMPLEX));
+    if (buf == NULL || qsub == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    for (i=0; i<2; i++) {
+        cs[i] = len_cs > 0 ? buf + i*len_set : NULL;
+        bs[i] = K_max > 0 ? buf + i*len_set + len_cs : NULL;
+        ncr[i] = nncr > 0 ? buf + i*len_set + len_cs + K_max : NULL;
+    }
+    if (K_max > 0
+        && opts->bound_state_localization == nsev_bsloc_NEWTON) {
+        guesses = malloc(K_max * sizeof(COMPLEX));
+        if (guesses == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        memcpy(guesses, bound_states, K_max * sizeof(COMPLEX));
+    }
+
+    // Start with two runs with about AUTO_D_START/2 and AUTO_D_START
+    // samples
+    r_cur = (D - 1)/AUTO_D_START;
+    if (r_cur < 1)
+        r_cur = 1;
+    r_prev = 2*r_cur;
+    if (r_prev > D - 1)
+        r_prev = D - 1;
+    ret_code = auto_run(D, q, T, r_prev, qsub, M, cs[prev], XI, K_max,
+        &K[prev], bs[prev], guesses, ncr[prev], kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = auto_run(D, q, T, r_cur, qsub, M, cs[cur], XI, K_max,
+        &K[cur], bs[cur], guesses, ncr[cur], kappa, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // All discretizations converge quadratically, i.e., the error of a run
+    // with step size r*eps_t is approximately C*r^2. The difference
+    // between two runs therefore yields an estimate of the error of the
+    // finer run (Richardson extrapolation).
+    rho2 = ((REAL)r_prev/r_cur)*((REAL)r_prev/r_cur);
+    err = auto_dist(len_cs, cs[prev], cs[cur], K[prev], bs[prev], K[cur],
+        bs[cur])/(rho2 - 1.0);
+
+    if (rho2*err <= tol) {
+        // Already the coarser run is accurate enough
+        cur = 1 - cur;
+        prev = 1 - prev;
+        r_cur = r_prev;
+        err *= rho2;
+    } else {
+        // Refine until the estimated error is below tol. The next
+        // subsampling factor is the largest one for which the error is
+        // predicted to be below tol.
+        while (err > tol && r_cur > 1) {
+            r_new = (UINT)(AUTO_SAFETY * r_cur * SQRT(tol/err));
+            if (r_new < (r_cur + AUTO_MAX_STEP - 1)/AUTO_MAX_STEP)
+                r_new = (r_cur + AUTO_MAX_STEP - 1)/AUTO_MAX_STEP;
+            if (r_new >= r_cur)
+                r_new = r_cur - 1;
+            if (r_new < 1)
+                r_new = 1;
+
+            ret_code = auto_run(D, q, T, r_new, qsub, M, cs[prev], XI,
+                K_max, &K[prev], bs[prev], guesses, ncr[prev], kappa, opts);
+            CHECK_RETCODE(ret_code, release_mem);
+            rho2 = ((REAL)r_cur/r_new)*((REAL)r_cur/r_new);
+            err = auto_dist(len_cs, cs[prev], cs[cur], K[prev], bs[prev],
+                K[cur], bs[cur])/(rho2 - 1.0);
+            cur = 1 - cur;
+            prev = 1 - prev;
+            r_prev = r_cur;
+            r_cur = r_new;
+        }
+
+        // The errors of coarse runs are often larger than predicted by
+        // C*r^2, so that the last run may have used more samples than
+        // needed. In that case, one coarser run is tried. Its error is
+        // estimated by comparison with the last (finer) run.
+        if (err <= tol && r_prev > r_cur + 1) {
+            if (err*r_prev*r_prev <= tol*r_cur*r_cur)
+                r_new = r_prev - 1;
+            else
+                r_new = (UINT)(AUTO_SAFETY * r_cur * SQRT(tol/err));
+            if (r_new >= r_prev)
+                r_new = r_prev - 1;
+            if (r_new > r_cur) {
+                ret_code = auto_run(D, q, T, r_new, qsub, M, cs[prev], XI,
+                    K_max, &K[prev], bs[prev], guesses, ncr[prev], kappa,
+                    opts);
+                CHECK_RETCODE(ret_code, release_mem);
+                rho2 = ((REAL)r_cur/r_new)*((REAL)r_cur/r_new);
+                err_new = auto_dist(len_cs, cs[prev], cs[cur], K[prev],
+                    bs[prev], K[cur], bs[cur])/(1.0 - rho2);
+                if (err_new <= tol) {
+                    cur = 1 - cur;
+                    prev = 1 - prev;
+                    r_cur = r_new;
+                    err = err_new;
+                }
+            }
+        }
+    }
+    if (err > tol)
+        WARN("The target accuracy could not be reached with the given samples.");
+
+    // Copy the results of the selected run
+    if (len_cs > 0)
+        memcpy(contspec, cs[cur], len_cs * sizeof(COMPLEX));
+    if (K_max > 0) {
+        *K_ptr = K[cur];
+        memcpy(bound_states, bs[cur], K[cur] * sizeof(COMPLEX));
+        if (nncr > 0) {
+            memcpy(normconsts_or_residues, ncr[cur],
+                nncr*K[cur] * sizeof(COMPLEX));
+        }
+    } else if (K_ptr != NULL) {
+        *K_ptr = 0;
+    }
+    *D_used_ptr = (D - 1)/r_cur + 1;
+    *err_est_ptr = err;
+
+release_mem:
+    free(buf);
+    free(qsub);
+    free(guesses);
+
+    return ret_code;
+}
+
+/**
+ * Creates a transfer matrix object. See the header file for documentation.
+ */
+INT fnft_nsev_tm_create(
+    const UINT D,
+    COMPLEX const * const q,
+    REAL const * const T,
+    const INT kappa,
+    fnft_nsev_opts_t const * const opts,
+    fnft_nsev_tm_t ** const tm_ptr)
+{
+    struct fnft_nsev_tm_s *tm = NULL;
+    INT ret_code = SUCCESS;
+
+    if (tm_ptr == NULL)
+        return E_INVALID_ARGUMENT(tm_ptr);
+    *tm_ptr = NULL;
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+
+    tm = malloc(sizeof(struct fnft_nsev_tm_s));
+    if (tm == NULL)
+        return E_NOMEM;
+    ret_code = tm_setup(tm, D, (COMPLEX *)q, T, kappa,
+        opts != NULL ? opts : &default_opts);
+    if (ret_code != SUCCESS) {
+        free(tm);
+        return ret_code;
+    }
+
+    // The object keeps its own copy of the signal since the discrete
+    // spectrum is refined w.r.t. the signal itself.
+    tm->q = malloc(D * sizeof(COMPLEX));
+    if (tm->q == NULL) {
+        free(tm);
+        return E_NOMEM;
+    }
+    memcpy(tm->q, q, D * sizeof(COMPLEX));
+
+    *tm_ptr = tm;
+    return SUCCESS;
+}
+
+/**
+ * Frees a transfer matrix object. See the header file for documentation.
+ */
+void fnft_nsev_tm_free(fnft_nsev_tm_t * const tm)
+{
+    if (tm == NULL)
+        return;
+    free(tm->transfer_matrix);
+    free(tm->q);
+    poly_fmult2x2_tree_free(tm->tree);
+    free(tm);
+}
+
+// Auxiliary function: Returns a copy of the options with which a query on
+// the transfer matrix object tm is carried out.
+static inline fnft_nsev_opts_t tm_query_opts(
+    struct fnft_nsev_tm_s const * const tm,
+    fnft_nsev_opts_t const * const opts)
+{
+    fnft_nsev_opts_t query_opts;
+
+    if (opts == NULL)
+        return tm->opts;
+
+    // These fields are fixed once the object has been created
+    query_opts = *opts;
+    query_opts.discretization = tm->opts.discretization;
+    query_opts.normalization_flag = tm->opts.normalization_flag;
+    return query_opts;
+}
+
+/**
+ * Continuous spectrum from a transfer matrix object. See the header file
+ * for documentation.
+ */
+INT fnft_nsev_tm_contspec(
+    fnft_nsev_tm_t * const tm,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    fnft_nsev_opts_t const * const opts)
+{
+    fnft_nsev_opts_t query_opts;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (M == 0)
+        return E_INVALID_ARGUMENT(M);
+    if (contspec == NULL)
+        return E_INVALID_ARGUMENT(contspec);
+    if (XI == NULL || XI[0] >= XI[1])
+        return E_INVALID_ARGUMENT(XI);
+    query_opts = tm_query_opts(tm, opts);
+
+    ret_code = tm_contspec(tm, M, contspec, XI, &query_opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    return ret_code;
+}
+
+/**
+ * Discrete spectrum from a transfer matrix object. See the header file
+ * for documentation.
+ */
+INT fnft_nsev_tm_discspec(
+    fnft_nsev_tm_t * const tm,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t const * const opts)
+{
+    fnft_nsev_opts_t query_opts;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (K_ptr == NULL)
+        return E_INVALID_ARGUMENT(K_ptr);
+    if (bound_states == NULL)
+        return E_INVALID_ARGUMENT(bound_states);
+    query_opts = tm_query_opts(tm, opts);
+
+    return tm_discspec(tm, K_ptr, bound_states, normconsts_or_residues,
+        &query_opts);
+}
+
+// Auxiliary function: Computes the phase factors that relate the polynomial
+// entries of the transfer matrix to a(lam) and b(lam). See tf2contspec.
+static inline void ab_phase_factors(
+    const UINT D,
+    REAL const * const T,
+    const REAL eps_t,
+    const REAL bnd_coeff,
+    REAL * const phase_factor_a,
+    REAL * const phase_factor_b)
+{
+    if (bnd_coeff == 0.0) {
+        *phase_factor_a = T[0] + T[1];
+        *phase_factor_b = T[0] - T[1];
+    } else {
+        *phase_factor_a =  2.0*D*eps_t + T[1] + T[0];
+        *phase_factor_b = 2.0*(D-bnd_coeff)*eps_t + T[0] - T[1];
+    }
+}
+
+// Auxiliary function: Evaluates the polynomial p of degree deg (coefficients
+// in descending order) at z=exp(w), multiplied with exp(v). For |z|>1, the
+// reversed polynomial is evaluated at 1/z and the factor z^deg is combined
+// with exp(v) in order to avoid overflows. If deriv_ptr != NULL, the value
+// of z*p'(z), multiplied with exp(v), is stored in *deriv_ptr.
+static inline COMPLEX poly_eval_exp(const UINT deg, COMPLEX const * const p,
+    const COMPLEX w, const COMPLEX v, COMPLEX * const deriv_ptr)
+{
+    COMPLEX z, val, dval = 0.0, scl;
+    UINT k;
+
+    if (CREAL(w) <= 0.0) {
+        z = CEXP(w);
+        val = p[0];
+        for (k = 1; k <= deg; k++) {
+            dval = dval*z + val;
+            val = val*z + p[k];
+        }
+        scl = CEXP(v);
+        if (deriv_ptr != NULL)
+            *deriv_ptr = z * dval * scl;
+    } else {
+        z = CEXP(-w);
+        val = p[deg];
+        for (k = deg; k-- > 0; ) {
+            dval = dval*z + val;
+            val = val*z + p[k];
+        }
+        scl = CEXP(deg*w + v);
+        if (deriv_ptr != NULL)
+            *deriv_ptr = (deg*val - z*dval) * scl;
+    }
+    return val * scl;
+}
+
+/**
+ * Values of a(lam) and b(lam) from a transfer matrix object. See the header
+ * file for documentation.
+ */
+INT fnft_nsev_tm_ab(
+    fnft_nsev_tm_t * const tm,
+    const UINT N,
+    COMPLEX const * const lambda,
+    COMPLEX * const a_vals,
+    COMPLEX * const b_vals)
+{
+    REAL map_coeff, bnd_coeff, scale;
+    REAL phase_factor_a, phase_factor_b;
+    COMPLEX w;
+    UINT i, deg;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (N == 0)
+        return SUCCESS;
+    if (lambda == NULL)
+        return E_INVALID_ARGUMENT(lambda);
+
+    ret_code = tm_compute_transfer_matrix(tm);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    map_coeff = nse_discretization_mapping_coeff(tm->opts.discretization);
+    bnd_coeff = nse_discretization_boundary_coeff(tm->opts.discretization);
+    if (isnan(map_coeff) || isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(tm->opts.discretization);
+    ab_phase_factors(tm->D, tm->T, tm->eps_t, bnd_coeff, &phase_factor_a,
+        &phase_factor_b);
+    scale = POW(2.0, tm->W);
+
+    // Since z=exp(map_coeff*j*lam*eps_t), the polynomials in the transfer
+    // matrix have to be evaluated at z=exp(w) with w as below.
+    deg = tm->deg;
+    for (i = 0; i < N; i++) {
+        w = map_coeff*I*lambda[i]*tm->eps_t;
+        if (a_vals != NULL)
+            a_vals[i] = scale * poly_eval_exp(deg, tm->transfer_matrix, w,
+                I*lambda[i]*phase_factor_a, NULL);
+        if (b_vals != NULL)
+            b_vals[i] = scale * poly_eval_exp(deg,
+                tm->transfer_matrix + 2*(deg+1), w,
+                I*lambda[i]*phase_factor_b, NULL);
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+/**
+ * Values of a(lam) and b(lam) on a rectangular grid from a transfer matrix
+ * object. See the header file for documentation.
+ */
+INT fnft_nsev_tm_ab_grid(
+    fnft_nsev_tm_t * const tm,
+    const UINT M,
+    REAL const * const XI,
+    const UINT N,
+    REAL const * const ETA,
+    COMPLEX * const a_vals,
+    COMPLEX * const b_vals)
+{
+    REAL map_coeff, bnd_coeff, scale, eps_xi, eta_r, eps_eta;
+    REAL phase_factor_a, phase_factor_b;
+    COMPLEX *A = NULL, *p = NULL, V, lam, w;
+    UINT deg, r0, r, r_end, m, k;
+    INT inside, ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (M < 2)
+        return E_INVALID_ARGUMENT(M);
+    if (XI == NULL || XI[0] >= XI[1])
+        return E_INVALID_ARGUMENT(XI);
+    if (N == 0)
+        return E_INVALID_ARGUMENT(N);
+    if (ETA == NULL || (N > 1 && ETA[0] >= ETA[1]))
+        return E_INVALID_ARGUMENT(ETA);
+    if (a_vals == NULL && b_vals == NULL)
+        return SUCCESS;
+
+    ret_code = tm_compute_transfer_matrix(tm);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    map_coeff = nse_discretization_mapping_coeff(tm->opts.discretization);
+    bnd_coeff = nse_discretization_boundary_coeff(tm->opts.discretization);
+    if (isnan(map_coeff) || isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(tm->opts.discretization);
+    ab_phase_factors(tm->D, tm->T, tm->eps_t, bnd_coeff, &phase_factor_a,
+        &phase_factor_b);
+    scale = POW(2.0, tm->W);
+    deg = tm->deg;
+    eps_xi = (XI[1] - XI[0])/(M - 1);
+    eps_eta = N > 1 ? (ETA[1] - ETA[0])/(N - 1) : 0.0;
+
+    A = malloc(N * sizeof(COMPLEX));
+    p = malloc((deg+1) * sizeof(COMPLEX));
+    if (A == NULL || p == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    // Since z=exp(map_coeff*j*lam*eps_t), the row with imaginary part eta_r
+    // is mapped onto an arc of the circle with radius
+    // exp(-map_coeff*eta_r*eps_t). The arcs inside the unit circle are
+    // evaluated with the chirp transform as in tf2contspec. On the arcs
+    // outside of the unit circle, the reversed polynomials are evaluated at
+    // 1/z in order to avoid overflows (see poly_eval_exp). Since eta_r is
+    // monotonic in r, both cases correspond to consecutive rows.
+    V = CEXP(map_coeff*I*eps_xi*tm->eps_t);
+    for (r0 = 0; r0 < N; r0 = r_end) {
+        inside = map_coeff*(ETA[0] + r0*eps_eta) >= 0.0;
+        for (r_end = r0; r_end < N; r_end++) {
+            eta_r = ETA[0] + r_end*eps_eta;
+            if ((map_coeff*eta_r >= 0.0) != inside)
+                break;
+            lam = XI[0] + I*eta_r;
+            if (inside)
+                A[r_end] = CEXP(-map_coeff*I*lam*tm->eps_t);
+            else
+                A[r_end] = CEXP(map_coeff*I*lam*tm->eps_t);
+        }
+
+        for (k = 0; k < 2; k++) {
+            COMPLEX * const vals = (k == 0) ? a_vals : b_vals;
+            const REAL phase_factor = (k == 0) ? phase_factor_a :
+                phase_factor_b;
+            if (vals == NULL)
+                continue;
+
+            if (inside) {
+                ret_code = poly_chirpz_multi(deg,
+                    tm->transfer_matrix + 2*k*(deg+1), r_end - r0, A + r0,
+                    V, M, vals + r0*M);
+                CHECK_RETCODE(ret_code, release_mem);
+            } else {
+                for (m = 0; m <= deg; m++)
+                    p[m] = tm->transfer_matrix[2*k*(deg+1) + deg - m];
+                ret_code = poly_chirpz_multi(deg, p, r_end - r0, A + r0,
+                    CONJ(V), M, vals + r0*M);
+                CHECK_RETCODE(ret_code, release_mem);
+            }
+
+            for (r = r0; r < r_end; r++) {
+                eta_r = ETA[0] + r*eps_eta;
+                for (m = 0; m < M; m++) {
+                    lam = XI[0] + m*eps_xi + I*eta_r;
+                    w = inside ? 0.0 : deg*map_coeff*I*lam*tm->eps_t;
+                    vals[r*M + m] *= scale * CEXP(w + I*lam*phase_factor);
+                }
+            }
+        }
+    }
+
+release_mem:
+    free(A);
+    free(p);
+    return ret_code;
+}
+
+/**
+ * Jost solutions of the signal in a transfer matrix object. See the header
+ * file for documentation.
+ */
+INT fnft_nsev_tm_jost(
+    fnft_nsev_tm_t const * const tm,
+    const UINT K,
+    COMPLEX const * const lambda,
+    COMPLEX * const jost,
+    const fnft_nsev_jost_t type)
+{
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (tm->q == NULL)
+        return E_INVALID_ARGUMENT(tm->q);
+    if (type != nsev_jost_LEFT && type != nsev_jost_RIGHT)
+        return E_INVALID_ARGUMENT(type);
+
+    return nse_scatter_jost(tm->D, tm->q, tm->T, tm->kappa, K, lambda,
+        type == nsev_jost_RIGHT, jost, nse_discretization_BO,
+        tm->opts.nthreads);
+}
+
+/**
+ * Exports a transfer matrix object. See the header file for documentation.
+ */
+INT fnft_nsev_tm_export(
+    fnft_nsev_tm_t * const tm,
+    UINT * const len_ptr,
+    void * const buf)
+{
+    UINT len;
+    uint32_t u32;
+    uint64_t u64;
+    int32_t i32;
+    unsigned char *pos;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (len_ptr == NULL)
+        return E_INVALID_ARGUMENT(len_ptr);
+
+    ret_code = tm_compute_transfer_matrix(tm);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (tm->l2norm2 < 0.0)
+        tm->l2norm2 = misc_l2norm2(tm->D, tm->q, tm->T[0], tm->T[1]);
+
+    len = TM_FORMAT_HEADER_LEN + 4*(tm->deg + 1)*2*sizeof(double);
+    if (buf == NULL) { // only the length has been requested
+        *len_ptr = len;
+        return SUCCESS;
+    }
+    if (*len_ptr < len)
+        return E_INVALID_ARGUMENT(*len_ptr);
+
+    pos = buf;
+    memcpy(pos, TM_FORMAT_MAGIC, 8);
+    u32 = TM_FORMAT_VERSION;
+    memcpy(pos + 8, &u32, 4);
+    u32 = TM_FORMAT_BOM;
+    memcpy(pos + 12, &u32, 4);
+    u64 = tm->D;
+    memcpy(pos + 16, &u64, 8);
+    u64 = tm->deg;
+    memcpy(pos + 24, &u64, 8);
+    i32 = tm->W;
+    memcpy(pos + 32, &i32, 4);
+    i32 = tm->kappa;
+    memcpy(pos + 36, &i32, 4);
+    i32 = tm->opts.discretization;
+    memcpy(pos + 40, &i32, 4);
+    i32 = tm->opts.normalization_flag;
+    memcpy(pos + 44, &i32, 4);
+    memcpy(pos + 48, tm->T, 2*sizeof(double));
+    memcpy(pos + 64, &tm->eps_t, sizeof(double));
+    memcpy(pos + 72, &tm->l2norm2, sizeof(double));
+    memcpy(pos + TM_FORMAT_HEADER_LEN, tm->transfer_matrix,
+        4*(tm->deg + 1)*sizeof(COMPLEX));
+
+    *len_ptr = len;
+leave_fun:
+    return ret_code;
+}
+
+/**
+ * Imports a transfer matrix object. See the header file for documentation.
+ */
+INT fnft_nsev_tm_import(
+    const UINT len,
+    void const * const buf,
+    fnft_nsev_opts_t const * const opts,
+    fnft_nsev_tm_t ** const tm_ptr)
+{
+    struct fnft_nsev_tm_s *tm = NULL;
+    fnft_nsev_opts_t tm_opts;
+    unsigned char const *pos;
+    uint32_t u32;
+    uint64_t D, deg;
+    int32_t W, kappa, discretization, normalization_flag;
+    REAL T[2], l2norm2;
+    UINT degree;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm_ptr == NULL)
+        return E_INVALID_ARGUMENT(tm_ptr);
+    *tm_ptr = NULL;
+    if (buf == NULL)
+        return E_INVALID_ARGUMENT(buf);
+    if (len < TM_FORMAT_HEADER_LEN)
+        return E_INVALID_ARGUMENT(len);
+
+    // Parse the header
+    pos = buf;
+    if (memcmp(pos, TM_FORMAT_MAGIC, 8) != 0)
+        return E_OTHER("Not an exported transfer matrix");
+    memcpy(&u32, pos + 8, 4);
+    if (u32 > TM_FORMAT_VERSION)
+        return E_OTHER("Unsupported version of the transfer matrix format");
+    memcpy(&u32, pos + 12, 4);
+    if (u32 != TM_FORMAT_BOM)
+        return E_OTHER("Transfer matrix has been exported on a machine with a different byte order");
+    memcpy(&D, pos + 16, 8);
+    memcpy(&deg, pos + 24, 8);
+    memcpy(&W, pos + 32, 4);
+    memcpy(&kappa, pos + 36, 4);
+    memcpy(&discretization, pos + 40, 4);
+    memcpy(&normalization_flag, pos + 44, 4);
+    memcpy(T, pos + 48, 2*sizeof(double));
+    memcpy(&l2norm2, pos + 72, sizeof(double));
+    if (!isfinite(T[0]) || !isfinite(T[1]) || T[0] >= T[1]
+        || abs(kappa) != 1 || !isfinite(l2norm2))
+        return E_OTHER("Corrupted transfer matrix header");
+
+    // The sizes are checked before they are multiplied, since they might
+    // overflow otherwise
+    degree = nse_discretization_degree(discretization);
+    if (degree == 0 || D < 2 || D > SIZE_MAX/degree || deg != degree*D)
+        return E_OTHER("Corrupted transfer matrix header");
+    if (deg >= (SIZE_MAX - TM_FORMAT_HEADER_LEN)/(8*sizeof(double))
+        || len != TM_FORMAT_HEADER_LEN + 4*(deg + 1)*2*sizeof(double))
+        return E_INVALID_ARGUMENT(len);
+
+    // Create the object
+    tm_opts = opts != NULL ? *opts : default_opts;
+    tm_opts.discretization = discretization;
+    tm_opts.normalization_flag = normalization_flag;
+    tm = malloc(sizeof(struct fnft_nsev_tm_s));
+    if (tm == NULL)
+        return E_NOMEM;
+    ret_code = tm_setup(tm, D, NULL, T, kappa, &tm_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    tm->transfer_matrix = malloc(4*(deg + 1)*sizeof(COMPLEX));
+    if (tm->transfer_matrix == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    memcpy(tm->transfer_matrix, pos + TM_FORMAT_HEADER_LEN,
+        4*(deg + 1)*sizeof(COMPLEX));
+    tm->deg = deg;
+    tm->W = W;
+    tm->l2norm2 = l2norm2;
+
+    *tm_ptr = tm;
+    return SUCCESS;
+
+release_mem:
+    fnft_nsev_tm_free(tm);
+    return ret_code;
+}
+
+/**
+ * Saves a transfer matrix object to a file. See the header file for
+ * documentation.
+ */
+INT fnft_nsev_tm_save(
+    fnft_nsev_tm_t * const tm,
+    char const * const filename)
+{
+    FILE *fp = NULL;
+    void *buf = NULL;
+    UINT len;
+    INT ret_code = SUCCESS;
+
+    if (filename == NULL)
+        return E_INVALID_ARGUMENT(filename);
+
+    ret_code = fnft_nsev_tm_export(tm, &len, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    buf = malloc(len);
+    if (buf == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    ret_code = fnft_nsev_tm_export(tm, &len, buf);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        ret_code = E_OTHER("Could not open file for writing");
+        goto release_mem;
+    }
+    if (fwrite(buf, 1, len, fp) != len) {
+        ret_code = E_OTHER("Could not write file");
+        goto release_mem;
+    }
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        ret_code = E_OTHER("Could not write file");
+        goto release_mem;
+    }
+    fp = NULL;
+
+release_mem:
+    if (fp != NULL)
+        fclose(fp);
+    free(buf);
+    return ret_code;
+}
+
+/**
+ * Loads a transfer matrix object from a file. See the header file for
+ * documentation.
+ */
+INT fnft_nsev_tm_load(
+    char const * const filename,
+    fnft_nsev_opts_t const * const opts,
+    fnft_nsev_tm_t ** const tm_ptr)
+{
+    FILE *fp = NULL;
+    void *buf = NULL;
+    long len;
+    INT ret_code = SUCCESS;
+
+    if (filename == NULL)
+        return E_INVALID_ARGUMENT(filename);
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return E_OTHER("Could not open file for reading");
+    if (fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0
+    || fseek(fp, 0, SEEK_SET) != 0) {
+        ret_code = E_OTHER("Could not determine size of file");
+        goto release_mem;
+    }
+    buf = malloc(len > 0 ? len : 1);
+    if (buf == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    if (fread(buf, 1, len, fp) != (size_t)len) {
+        ret_code = E_OTHER("Could not read file");
+        goto release_mem;
+    }
+
+    ret_code = fnft_nsev_tm_import(len, buf, opts, tm_ptr);
+    CHECK_RETCODE(ret_code, release_mem);
+
+release_mem:
+    fclose(fp);
+    free(buf);
+    return ret_code;
+}
+
+/**
+ * Merges transfer matrix objects of consecutive segments of a signal. See
+ * the header file for documentation.
+ */
+INT fnft_nsev_tm_merge(
+    const UINT n,
+    fnft_nsev_tm_t * const * const tms,
+    fnft_nsev_tm_t ** const tm_ptr)
+{
+    struct fnft_nsev_tm_s *tm = NULL;
+    COMPLEX **polys = NULL;
+    UINT *degs = NULL;
+    INT *Ws = NULL;
+    INT W, *W_ptr = NULL;
+    UINT i, j, m, D, len;
+    REAL T[2], eps_t, l2norm2;
+    INT have_q = 1;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm_ptr == NULL)
+        return E_INVALID_ARGUMENT(tm_ptr);
+    *tm_ptr = NULL;
+    if (n == 0)
+        return E_INVALID_ARGUMENT(n);
+    if (tms == NULL)
+        return E_INVALID_ARGUMENT(tms);
+    for (i=0; i<n; i++) {
+        if (tms[i] == NULL)
+            return E_INVALID_ARGUMENT(tms);
+    }
+
+    // The segments have to be compatible and consecutive, i.e., the first
+    // sample of a segment has to follow the last sample of the previous
+    // segment after one step.
+    eps_t = tms[0]->eps_t;
+    D = 0;
+    l2norm2 = 0.0;
+    for (i=0; i<n; i++) {
+        if (tms[i]->kappa != tms[0]->kappa)
+            return E_INVALID_ARGUMENT(tms[i]->kappa);
+        if (tms[i]->opts.discretization != tms[0]->opts.discretization)
+            return E_INVALID_ARGUMENT(tms[i]->opts.discretization);
+        if (tms[i]->opts.normalization_flag
+        != tms[0]->opts.normalization_flag)
+            return E_INVALID_ARGUMENT(tms[i]->opts.normalization_flag);
+        if (FABS(tms[i]->eps_t - eps_t) > 1e-9*eps_t)
+            return E_OTHER("Segments have different step sizes");
+        if (i > 0 && FABS(tms[i]->T[0] - tms[i-1]->T[1] - eps_t)
+        > 1e-6*eps_t)
+            return E_OTHER("Segments are not consecutive");
+
+        ret_code = tm_compute_transfer_matrix(tms[i]);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (tms[i]->q == NULL)
+            have_q = 0;
+        else if (tms[i]->l2norm2 < 0.0)
+            tms[i]->l2norm2 = misc_l2norm2(tms[i]->D, tms[i]->q,
+                tms[i]->T[0], tms[i]->T[1]);
+        l2norm2 += tms[i]->l2norm2;
+        D += tms[i]->D;
+    }
+    T[0] = tms[0]->T[0];
+    T[1] = tms[n-1]->T[1];
+    if (tms[0]->opts.normalization_flag)
+        W_ptr = &W;
+
+    // Create the new object
+    tm = malloc(sizeof(struct fnft_nsev_tm_s));
+    if (tm == NULL)
+        return E_NOMEM;
+    ret_code = tm_setup(tm, D, NULL, T, tms[0]->kappa, &tms[0]->opts);
+    if (ret_code != SUCCESS) {
+        free(tm);
+        return E_SUBROUTINE(ret_code);
+    }
+    tm->l2norm2 = l2norm2;
+    if (have_q) {
+        tm->q = malloc(D * sizeof(COMPLEX));
+        if (tm->q == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        for (i=0, j=0; i<n; j+=tms[i]->D, i++)
+            memcpy(tm->q + j, tms[i]->q, tms[i]->D * sizeof(COMPLEX));
+        tm->l2norm2 = -1.0; // recompute from the merged signal if needed
+    }
+
+    // Multiply the transfer matrices of the segments pairwise in a
+    // balanced way. Since the transfer matrix of a segment is applied after
+    // the transfer matrix of the preceding segment, the later segment is
+    // the left factor. The phase factors that relate the polynomials to a
+    // and b only depend on D and T, which is why they do not have to be
+    // taken care of here.
+    polys = calloc(n, sizeof(COMPLEX *));
+    degs = malloc(n * sizeof(UINT));
+    Ws = malloc(n * sizeof(INT));
+    if (polys == NULL || degs == NULL || Ws == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    for (i=0; i<n; i++) {
+        len = 4*(tms[i]->deg + 1);
+        polys[i] = malloc(len * sizeof(COMPLEX));
+        if (polys[i] == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        memcpy(polys[i], tms[i]->transfer_matrix, len * sizeof(COMPLEX));
+        degs[i] = tms[i]->deg;
+        Ws[i] = tms[i]->W;
+    }
+    for (m=n; m>1; m=(m+1)/2) {
+        for (i=0; i+1<m; i+=2) {
+            len = 4*(degs[i] + degs[i+1] + 1);
+            tm->transfer_matrix = malloc(len * sizeof(COMPLEX));
+            if (tm->transfer_matrix == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+            W = 0;
+            ret_code = poly_fmult2x2_pair(degs[i+1], polys[i+1], degs[i],
+                polys[i], tm->transfer_matrix, W_ptr);
+            CHECK_RETCODE(ret_code, release_mem);
+            free(polys[i]);
+            free(polys[i+1]);
+            polys[i] = NULL;
+            polys[i+1] = NULL;
+            polys[i/2] = tm->transfer_matrix;
+            tm->transfer_matrix = NULL;
+            degs[i/2] = degs[i] + degs[i+1];
+            Ws[i/2] = Ws[i] + Ws[i+1] + W;
+        }
+        if (m%2 != 0) { // the last segment is carried over
+            polys[m/2] = polys[m-1];
+            degs[m/2] = degs[m-1];
+            Ws[m/2] = Ws[m-1];
+        }
+        for (i=(m+1)/2; i<m; i++)
+            polys[i] = NULL;
+    }
+    tm->transfer_matrix = polys[0];
+    polys[0] = NULL;
+    tm->deg = degs[0];
+    tm->W = Ws[0];
+
+    *tm_ptr = tm;
+    tm = NULL;
+
+release_mem:
+    if (polys != NULL) {
+        for (i=0; i<n; i++)
+            free(polys[i]);
+    }
+    free(polys);
+    free(degs);
+    free(Ws);
+    fnft_nsev_tm_free(tm);
+    return ret_code;
+}
+
+/**
+ * Replaces samples of the signal of a transfer matrix object. See the header
+ * file for documentation.
+ */
+INT fnft_nsev_tm_update(
+    fnft_nsev_tm_t * const tm,
+    const UINT N,
+    UINT const * const indices,
+    COMPLEX const * const q_new)
+{
+    COMPLEX *leaves = NULL, *leaf = NULL;
+    UINT *idx = NULL;
+    UINT i, j, deg;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (N == 0)
+        return SUCCESS;
+    if (indices == NULL)
+        return E_INVALID_ARGUMENT(indices);
+    if (q_new == NULL)
+        return E_INVALID_ARGUMENT(q_new);
+    if (tm->q == NULL)
+        return E_INVALID_ARGUMENT(tm->q);
+    for (i = 0; i < N; i++) {
+        if (indices[i] >= tm->D)
+            return E_INVALID_ARGUMENT(indices);
+    }
+
+    // Update the signal
+    for (i = 0; i < N; i++)
+        tm->q[indices[i]] = q_new[i];
+    tm->l2norm2 = -1.0;
+
+    // If there is no product tree yet, it is built from the updated signal
+    if (tm->tree == NULL)
+        return tm_build_tree(tm);
+
+    // Otherwise, the scattering matrices of the new samples replace the old
+    // ones in the tree. (Note that nse_fscatter_leaves stores the scattering
+    // matrices in reverse order.)
+    deg = nse_discretization_degree(tm->opts.discretization);
+    leaves = malloc(4*N*(deg + 1) * sizeof(COMPLEX));
+    leaf = malloc(4*(deg + 1) * sizeof(COMPLEX));
+    idx = malloc(N * sizeof(UINT));
+    if (leaves == NULL || leaf == NULL || idx == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    for (i = 0; i < N; i++) {
+        ret_code = nse_fscatter_leaves(1, q_new + i, tm->eps_t, tm->kappa,
+            leaf, tm->opts.discretization);
+        CHECK_RETCODE(ret_code, release_mem);
+        for (j = 0; j < 4; j++)
+            memcpy(leaves + (j*N + i)*(deg + 1), leaf + j*(deg + 1),
+                (deg + 1) * sizeof(COMPLEX));
+        idx[i] = tm->D - 1 - indices[i];
+    }
+    ret_code = poly_fmult2x2_tree_update(tm->tree, N, idx, leaves);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_root(tm->tree, &tm->deg,
+        tm->transfer_matrix, &tm->W);
+    CHECK_RETCODE(ret_code, release_mem);
+
+release_mem:
+    if (ret_code != SUCCESS) {
+        // The tree might be inconsistent with the signal
+        poly_fmult2x2_tree_free(tm->tree);
+        tm->tree = NULL;
+        free(tm->transfer_matrix);
+        tm->transfer_matrix = NULL;
+    }
+    free(leaves);
+    free(leaf);
+    free(idx);
+    return ret_code;
+}
+
+// Auxiliary function: Adds the adjoint of the continuous spectrum (with
+// layout as in fnft_nsev_tm_contspec) w.r.t. the coefficients of the
+// polynomials P11 and P21 in the transfer matrix to G.
+static inline INT tm_contspec_adjoint(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT M,
+    REAL const * const XI,
+    COMPLEX const * const contspec_grad,
+    COMPLEX * const G,
+    fnft_nsev_opts_t * const opts)
+{
+    const UINT deg = tm->deg;
+    COMPLEX *buf = NULL, *a_vals, *b_vals, *Ga, *Gb;
+    COMPLEX A, V, r, G_r;
+    REAL eps_xi, xi, map_coeff, bnd_coeff, scale;
+    REAL phase_factor_rho, phase_factor_a, phase_factor_b;
+    UINT i, k, offset = 0;
+    INT ret_code = SUCCESS;
+
+    map_coeff = nse_discretization_mapping_coeff(opts->discretization);
+    bnd_coeff = nse_discretization_boundary_coeff(opts->discretization);
+    if (isnan(map_coeff) || isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(opts->discretization);
+    ab_phase_factors(tm->D, tm->T, tm->eps_t, bnd_coeff, &phase_factor_a,
+        &phase_factor_b);
+    phase_factor_rho = -2.0*(tm->T[1] + tm->eps_t*bnd_coeff);
+    scale = POW(2.0, tm->W);
+    eps_xi = M > 1 ? (XI[1] - XI[0])/(M - 1) : 0.0;
+
+    buf = malloc((4*M + deg + 1) * sizeof(COMPLEX));
+    if (buf == NULL)
+        return E_NOMEM;
+    a_vals = buf;
+    b_vals = a_vals + M;
+    Ga = b_vals + M;
+    Gb = Ga + M;
+    for (i = 0; i < M; i++) {
+        Ga[i] = 0.0;
+        Gb[i] = 0.0;
+    }
+
+    // The values of the polynomials on the grid, see tf2contspec
+    V = CEXP(map_coeff*I*eps_xi*tm->eps_t);
+    A = CEXP(-map_coeff*I*XI[0]*tm->eps_t);
+    ret_code = poly_chirpz(deg, tm->transfer_matrix, A, V, M, a_vals);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_chirpz(deg, tm->transfer_matrix + 2*(deg+1), A, V, M,
+        b_vals);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Adjoints of the values of the polynomials on the grid
+    switch (opts->contspec_type) {
+
+    case nsev_cstype_BOTH:
+
+        offset = M;
+        // fall through
+    case nsev_cstype_REFLECTION_COEFFICIENT:
+
+        for (i = 0; i < M; i++) {
+            xi = XI[0] + i*eps_xi;
+            if (a_vals[i] == 0.0) {
+                ret_code = E_DIV_BY_ZERO;
+                goto release_mem;
+            }
+            // r = (b/a)*exp(j*xi*phase_factor_rho)
+            r = b_vals[i] * CEXP(I*xi*phase_factor_rho) / a_vals[i];
+            G_r = contspec_grad[i];
+            Gb[i] += CONJ(CEXP(I*xi*phase_factor_rho) / a_vals[i]) * G_r;
+            Ga[i] += CONJ(-r / a_vals[i]) * G_r;
+        }
+
+        if (opts->contspec_type == nsev_cstype_REFLECTION_COEFFICIENT)
+            break;
+        // fall through
+    case nsev_cstype_AB:
+
+        for (i = 0; i < M; i++) {
+            xi = XI[0] + i*eps_xi;
+            Ga[i] += scale * CEXP(-I*xi*phase_factor_a)
+                * contspec_grad[offset + i];
+            Gb[i] += scale * CEXP(-I*xi*phase_factor_b)
+                * contspec_grad[offset + M + i];
+        }
+        break;
+
+    default:
+
+        ret_code = E_INVALID_ARGUMENT(opts->contspec_type);
+        goto release_mem;
+    }
+
+    // Since P(z_i) = sum_k p_{deg-k} z_i^k with z_i = 1/(A*V^-i), the adjoint
+    // of the coefficient p_{deg-k} is sum_i conj(z_i)^k G_i =
+    // conj(A)^-k sum_i G_i conj(V)^(i*k). The sums are evaluations of the
+    // polynomial with the coefficients G_i on a spiral and are computed
+    // with the chirp transform as well.
+    for (i = 0; i < M/2; i++) { // reverse the order of the coefficients
+        r = Ga[i]; Ga[i] = Ga[M-1-i]; Ga[M-1-i] = r;
+        r = Gb[i]; Gb[i] = Gb[M-1-i]; Gb[M-1-i] = r;
+    }
+    for (k = 0; k < 2; k++) {
+        ret_code = poly_chirpz(M - 1, k == 0 ? Ga : Gb, 1.0, CONJ(V), deg+1,
+            buf + 4*M);
+        CHECK_RETCODE(ret_code, release_mem);
+        for (i = 0; i <= deg; i++)
+            G[2*k*(deg+1) + deg - i] += CEXP(-map_coeff*I*XI[0]*tm->eps_t*i)
+                * buf[4*M + i];
+    }
+
+release_mem:
+    free(buf);
+    return ret_code;
+}
+
+// Auxiliary function: Adds the adjoint of the bound states and norming
+// constants w.r.t. the coefficients of the polynomials P11 and P21 in the
+// transfer matrix to G. The bound states have to be roots of a(lam).
+static inline INT tm_discspec_adjoint(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT K,
+    COMPLEX const * const bound_states,
+    COMPLEX const * const bound_states_grad,
+    COMPLEX const * const normconsts_grad,
+    COMPLEX * const G,
+    fnft_nsev_opts_t * const opts)
+{
+    const UINT deg = tm->deg;
+    COMPLEX * const G11 = G;
+    COMPLEX * const G21 = G + 2*(deg+1);
+    COMPLEX w, aprime_val, b_val, bprime_val, G_lam, G_b;
+    REAL map_coeff, bnd_coeff, scale, omega;
+    REAL phase_factor_a, phase_factor_b;
+    UINT i, j;
+
+    map_coeff = nse_discretization_mapping_coeff(opts->discretization);
+    bnd_coeff = nse_discretization_boundary_coeff(opts->discretization);
+    if (isnan(map_coeff) || isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(opts->discretization);
+    ab_phase_factors(tm->D, tm->T, tm->eps_t, bnd_coeff, &phase_factor_a,
+        &phase_factor_b);
+    scale = POW(2.0, tm->W);
+
+    for (i = 0; i < K; i++) {
+        w = map_coeff*I*bound_states[i]*tm->eps_t;
+        G_lam = bound_states_grad != NULL ? bound_states_grad[i] : 0.0;
+
+        // Norming constant b_k = b(lam_k) = 2^W*P21(z_k)*exp(j*lam_k*phase_
+        // factor_b) depends on P21 directly and on P11 through lam_k
+        if (normconsts_grad != NULL) {
+            G_b = normconsts_grad[i];
+            b_val = scale * poly_eval_exp(deg, tm->transfer_matrix + 2*(deg+1),
+                w, I*bound_states[i]*phase_factor_b, &bprime_val);
+            bprime_val = scale*bprime_val*map_coeff*I*tm->eps_t
+                + I*phase_factor_b*b_val;
+            G_lam += CONJ(bprime_val) * G_b;
+            for (j = 0; j <= deg; j++)
+                G21[j] += CONJ(CEXP((deg - j)*w
+                    + I*bound_states[i]*phase_factor_b + tm->W*LOG(2.0))) * G_b;
+        }
+
+        // Since P11(z_k)=0, a perturbation dP11 of the coefficients leads to
+        // dlam_k = -dP11(z_k)/(P11'(z_k)*dz/dlam) with dz/dlam =
+        // map_coeff*j*eps_t*z_k. A factor exp(-omega) is used to prevent
+        // overflows for |z_k|>1.
+        omega = CREAL(w) > 0.0 ? deg*CREAL(w) : 0.0;
+        poly_eval_exp(deg, tm->transfer_matrix, w, -omega, &aprime_val);
+        aprime_val *= map_coeff*I*tm->eps_t;
+        if (aprime_val == 0.0)
+            return E_DIV_BY_ZERO;
+        for (j = 0; j <= deg; j++)
+            G11[j] += CONJ(-CEXP((deg - j)*w - omega) / aprime_val) * G_lam;
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Gradient of a function of the spectrum w.r.t. the signal of a transfer
+ * matrix object. See the header file for documentation.
+ */
+INT fnft_nsev_tm_gradient(
+    fnft_nsev_tm_t * const tm,
+    const UINT M,
+    REAL const * const XI,
+    COMPLEX const * const contspec_grad,
+    const UINT K,
+    COMPLEX const * const bound_states,
+    COMPLEX const * const bound_states_grad,
+    COMPLEX const * const normconsts_grad,
+    COMPLEX * const q_grad,
+    fnft_nsev_opts_t const * const opts)
+{
+    fnft_nsev_opts_t query_opts;
+    COMPLEX *G = NULL, *G_leaves = NULL, *dp_dq = NULL, *dp_dqc = NULL;
+    COMPLEX G_leaf, dp;
+    REAL grad[2];
+    UINT i, j, l, deg;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tm == NULL)
+        return E_INVALID_ARGUMENT(tm);
+    if (q_grad == NULL)
+        return E_INVALID_ARGUMENT(q_grad);
+    if (contspec_grad != NULL && M > 0) {
+        if (XI == NULL || XI[0] >= XI[1])
+            return E_INVALID_ARGUMENT(XI);
+    }
+    if (K > 0 && (bound_states_grad != NULL || normconsts_grad != NULL)) {
+        if (bound_states == NULL)
+            return E_INVALID_ARGUMENT(bound_states);
+    }
+    query_opts = tm_query_opts(tm, opts);
+
+    ret_code = tm_build_tree(tm);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Adjoint of the transfer matrix
+    G = calloc(4*(tm->deg + 1), sizeof(COMPLEX));
+    G_leaves = malloc(nse_fscatter_numel(tm->D, query_opts.discretization)
+        * sizeof(COMPLEX));
+    deg = nse_discretization_degree(query_opts.discretization);
+    dp_dq = malloc(4*(deg + 1) * sizeof(COMPLEX));
+    dp_dqc = malloc(4*(deg + 1) * sizeof(COMPLEX));
+    if (G == NULL || G_leaves == NULL || dp_dq == NULL || dp_dqc == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    if (contspec_grad != NULL && M > 0) {
+        ret_code = tm_contspec_adjoint(tm, M, XI, contspec_grad, G,
+            &query_opts);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+    if (K > 0 && (bound_states_grad != NULL || normconsts_grad != NULL)) {
+        ret_code = tm_discspec_adjoint(tm, K, bound_states, bound_states_grad,
+            normconsts_grad, G, &query_opts);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+
+    // Adjoint of the scattering matrices of the individual samples
+    ret_code = poly_fmult2x2_tree_adjoint(tm->tree, G, G_leaves);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Chain rule for the scattering matrices of the individual samples. They
+    // are not holomorphic in q, which is why their Wirtinger derivatives
+    // w.r.t. q and conj(q) are combined into the derivatives w.r.t. the real
+    // and imaginary part of q. (The scattering matrix of the n-th sample is
+    // the (D-1-n)-th one in G_leaves.)
+    for (i = 0; i < tm->D; i++) {
+        ret_code = nse_fscatter_leaf_derivs(tm->q[i], tm->eps_t, tm->kappa,
+            dp_dq, dp_dqc, query_opts.discretization);
+        CHECK_RETCODE(ret_code, release_mem);
+        grad[0] = 0.0;
+        grad[1] = 0.0;
+        for (j = 0; j < 4; j++) {
+            for (l = 0; l <= deg; l++) {
+                G_leaf = G_leaves[(j*tm->D + tm->D - 1 - i)*(deg + 1) + l];
+                dp = dp_dq[j*(deg + 1) + l] + dp_dqc[j*(deg + 1) + l];
+                grad[0] += CREAL(CONJ(G_leaf) * dp);
+                dp = I*(dp_dq[j*(deg + 1) + l] - dp_dqc[j*(deg + 1) + l]);
+                grad[1] += CREAL(CONJ(G_leaf) * dp);
+            }
+        }
+        q_grad[i] = grad[0] + I*grad[1];
+    }
+
+release_mem:
+    free(G);
+    free(G_leaves);
+    free(dp_dq);
+    free(dp_dqc);
+    return ret_code;
+}
+
+// Auxiliary function: Checks the inputs and initializes the fields of a
+// transfer matrix object. The transfer matrix itself is not yet computed.
+static inline INT tm_setup(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT D,
+    COMPLEX * const q,
+    REAL const * const T,
+    const INT kappa,
+    fnft_nsev_opts_t const * const opts)
+{
+    tm->transfer_matrix = NULL;
+    tm->tree = NULL;
+    tm->q = NULL;
+    tm->samples = NULL;
+
+    // Check inputs (q may be NULL for imported transfer matrices)
+    if (D < 2)
+        return E_INVALID_ARGUMENT(D);
+    if (T == NULL || T[0] >= T[1])
+        return E_INVALID_ARGUMENT(T);
+    if (abs(kappa) != 1)
+        return E_INVALID_ARGUMENT(kappa);
+    if (nse_fscatter_numel(D, opts->discretization) == 0) // D>=2, this
+        // means unknown discretization
+        return E_INVALID_ARGUMENT(opts->discretization);
+
+    tm->D = D;
+    tm->q = q;
+    tm->T[0] = T[0];
+    tm->T[1] = T[1];
+    tm->eps_t = (T[1] - T[0])/(D - 1); // step size
+    tm->kappa = kappa;
+    tm->opts = *opts;
+    tm->deg = 0;
+    tm->W = 0;
+    tm->l2norm2 = -1.0;
+    return SUCCESS;
+}
+
+// Auxiliary function: Computes the spectra that have been requested from
+// fnft_nsev or fnft_nsev_samples.
+static inline INT tm_transform(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    UINT * const K_ptr,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (contspec != NULL) {
+        if (XI == NULL || XI[0] >= XI[1])
+            return E_INVALID_ARGUMENT(XI);
+    }
+    if (bound_states != NULL) {
+        if (K_ptr == NULL)
+            return E_INVALID_ARGUMENT(K_ptr);
+    }
+
+    // Compute the continuous spectrum
+    if (contspec != NULL && M > 0) {
+        ret_code = tm_contspec(tm, M, contspec, XI, opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+    }
+    
+    // Compute the discrete spectrum
+    if (bound_states != NULL) {
+        ret_code = tm_discspec(tm, K_ptr, bound_states,
+            normconsts_or_residues, opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+    } else if (K_ptr != NULL) {
+        *K_ptr = 0;
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+// Auxiliary function: Creates the converted copy of a signal that has been
+// passed to fnft_nsev_samples. Only needed by the steps that access the
+// samples repeatedly or in random order.
+static inline INT tm_convert_samples(
+    struct fnft_nsev_tm_s * const tm)
+{
+    INT ret_code;
+
+    if (tm->q != NULL || tm->samples == NULL)
+        return SUCCESS;
+    tm->q = malloc(tm->D * sizeof(COMPLEX));
+    if (tm->q == NULL)
+        return E_NOMEM;
+    ret_code = misc_samples_to_complex(tm->D, tm->samples, tm->q);
+    if (ret_code != SUCCESS) {
+        free(tm->q);
+        tm->q = NULL;
+        return E_SUBROUTINE(ret_code);
+    }
+    return SUCCESS;
+}
+
+// Auxiliary function: Computes the transfer matrix of a transfer matrix
+// object unless this has already been done before.
+static inline INT tm_compute_transfer_matrix(
+    struct fnft_nsev_tm_s * const tm)
+{
+    INT *W_ptr = NULL;
+    INT ret_code = SUCCESS;
+
+    if (tm->transfer_matrix != NULL)
+        return SUCCESS;
+    if (tm->q == NULL && tm->samples == NULL)
+        return E_INVALID_ARGUMENT(tm->q);
+
+    tm->transfer_matrix = malloc(nse_fscatter_numel(tm->D,
+        tm->opts.discretization) * sizeof(COMPLEX));
+    if (tm->transfer_matrix == NULL)
+        return E_NOMEM;
+
+    tm->W = 0;
+    if (tm->opts.normalization_flag)
+        W_ptr = &tm->W;
+    if (tm->q != NULL)
+        ret_code = nse_fscatter(tm->D, tm->q, tm->eps_t, tm->kappa,
+            tm->transfer_matrix, &tm->deg, W_ptr, tm->opts.discretization);
+    else // the samples are converted while the scattering matrices are set up
+        ret_code = nse_fscatter_samples(tm->D, tm->samples, tm->eps_t,
+            tm->kappa, tm->transfer_matrix, &tm->deg, W_ptr,
+            tm->opts.discretization);
+    if (ret_code != SUCCESS) {
+        free(tm->transfer_matrix);
+        tm->transfer_matrix = NULL;
+        return E_SUBROUTINE(ret_code);
+    }
+    return SUCCESS;
+}
+
+// Auxiliary function: Builds the product tree of the scattering matrices of
+// the individual samples unless this has already been done before. The
+// transfer matrix is replaced by the root of the tree.
+static inline INT tm_build_tree(
+    struct fnft_nsev_tm_s * const tm)
+{
+    COMPLEX *leaves = NULL;
+    INT ret_code = SUCCESS;
+
+    if (tm->tree != NULL)
+        return SUCCESS;
+    if (tm->q == NULL)
+        return E_INVALID_ARGUMENT(tm->q);
+
+    leaves = malloc(nse_fscatter_numel(tm->D, tm->opts.discretization)
+        * sizeof(COMPLEX));
+    if (tm->transfer_matrix == NULL) {
+        tm->transfer_matrix = malloc(nse_fscatter_numel(tm->D,
+            tm->opts.discretization) * sizeof(COMPLEX));
+    }
+    if (leaves == NULL || tm->transfer_matrix == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    ret_code = nse_fscatter_leaves(tm->D, tm->q, tm->eps_t, tm->kappa, leaves,
+        tm->opts.discretization);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_create(
+        nse_discretization_degree(tm->opts.discretization), tm->D, leaves,
+        tm->opts.normalization_flag, &tm->tree);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_root(tm->tree, &tm->deg,
+        tm->transfer_matrix, &tm->W);
+    CHECK_RETCODE(ret_code, release_mem);
+
+release_mem:
+    if (ret_code != SUCCESS) {
+        free(tm->transfer_matrix);
+        tm->transfer_matrix = NULL;
+    }
+    free(leaves);
+    return ret_code;
+}
 
-/**
- * Fast nonlinear Fourier transform for the nonlinear Schroedinger
- * equation with vanishing boundary conditions.
- * See the header file for documentation.
- */
-INT fnft_nsev(
-    const UINT D,
-    COMPLEX * const q,
-    REAL const * const T,
-    const UINT M,
-    COMPLEX * const contspec,
-    REAL const * const XI,
+// Auxiliary function: Computes the discrete spectrum of the signal
+// represented by a transfer matrix object.
+static inline INT tm_discspec(
+    struct fnft_nsev_tm_s * const tm,
     UINT * const K_ptr,
     COMPLEX * const bound_states,
     COMPLEX * const normconsts_or_residues,
-    const INT kappa,
-    fnft_nsev_opts_t *opts)
+    fnft_nsev_opts_t * const opts)
 {
-    COMPLEX *transfer_matrix = NULL;
     COMPLEX *qsub = NULL;
-    REAL eps_t;
     UINT subsampling_factor, Dsub;
-    UINT deg;
-    INT W = 0, *W_ptr = NULL;
+    REAL Tsub[2];
+    const UINT K_max = *K_ptr;
+    INT real_flag;
+    fnft_nsev_symmetry_t symmetry;
     INT ret_code = SUCCESS;
-    UINT i;
-    
-    // Check inputs
-    if (D < 2)
-        return E_INVALID_ARGUMENT(D);
-    if (q == NULL)
-        return E_INVALID_ARGUMENT(q);
-    if (T == NULL || T[0] >= T[1])
-        return E_INVALID_ARGUMENT(T);
-    if (contspec != NULL) {
-        if (XI == NULL || XI[0] >= XI[1])
-            return E_INVALID_ARGUMENT(XI);
-    }
-    if (abs(kappa) != 1)
-        return E_INVALID_ARGUMENT(kappa);
-    if (bound_states != NULL) {
-        if (K_ptr == NULL)
-            return E_INVALID_ARGUMENT(K_ptr);
-    }
-    if (opts == NULL)
-        opts = &default_opts;
-    
-    // Allocate memory for the transfer matrix. Note that after computation
-    // of the transfer matrix, the second and fourth quarter of the
-    // array carry redundant information that is not used. These quarters
-    // are therefore used as buffers and may be overwritten at some point.
-    i = nse_fscatter_numel(D, opts->discretization);
-    if (i == 0) { // size D>=2, this means unknown discretization
-        ret_code = E_INVALID_ARGUMENT(opts->discretization);
-        goto release_mem;
+
+    // Only the focusing case has bound states
+    if (tm->kappa != +1) {
+        *K_ptr = 0;
+        return SUCCESS;
     }
-    transfer_matrix = malloc(i*sizeof(COMPLEX));
-    if (transfer_matrix == NULL) {
-        ret_code = E_NOMEM;
-        goto release_mem;
+
+    // For real signals, only the bound states in the right half plane are
+    // refined. Their mirror images are added at the end.
+    real_flag = tm_is_real(tm, opts);
+
+    // Without the signal, only the fast eigenvalue method can be used
+    if (tm->q == NULL && tm->samples == NULL) {
+        if (opts->bound_state_localization == nsev_bsloc_NEWTON)
+            return E_INVALID_ARGUMENT(opts->bound_state_localization);
+        opts->bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
     }
-    
-    // Determine step size
-    eps_t = (T[1] - T[0])/(D - 1);
 
-    // Compute the transfer matrix
-    if (opts->normalization_flag)
-        W_ptr = &W;
-    ret_code = nse_fscatter(D, q, eps_t, kappa, transfer_matrix, &deg, W_ptr,
-        opts->discretization);
-    CHECK_RETCODE(ret_code, release_mem);
-    
-    // Compute the continuous spectrum
-    if (contspec != NULL && M > 0) {
-        ret_code = tf2contspec(deg, W, transfer_matrix, T, D, XI, M,
-            contspec, opts);
+    // Compute the bound states
+    switch (opts->bound_state_localization) {
+
+    case nsev_bsloc_SUBSAMPLE_AND_REFINE: // the mixed method gets special
+        // treatment
+
+        // First step: Find initial guesses for the bound states using the
+        // fast eigenvalue method. To bound the complexity, a subsampled
+        // version of q, qsub, will be passed to the fast eigenroutine.
+
+        if (tm->q != NULL)
+            ret_code = misc_downsample(tm->q, tm->D, &qsub, &Dsub,
+                &subsampling_factor);
+        else
+            ret_code = misc_downsample_samples(tm->samples, tm->D, &qsub,
+                &Dsub, &subsampling_factor);
         CHECK_RETCODE(ret_code, release_mem);
-    }
-    
-    // Compute the discrete spectrum
-    if (kappa == +1 && bound_states != NULL) {
-        
-        // Compute the bound states
-        if (opts->bound_state_localization == nsev_bsloc_SUBSAMPLE_AND_REFINE) { // the
-            // mixed method gets special treatment
-            
-            // First step: Find initial guesses for the bound states using the
-            // fast eigenvalue method. To bound the complexity, a subsampled
-            // version of q, qsub, will be passed to the fast eigenroutine.
-            
-            ret_code = misc_downsample(q, D, &qsub, &Dsub,&subsampling_factor);
-            CHECK_RETCODE(ret_code, release_mem);
-          
-            // Fixed bound states of qsub using the fast eigenvalue method
-            opts->bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
-            ret_code = fnft_nsev(Dsub, qsub, T, 0, NULL, XI, K_ptr,
-                bound_states, NULL, kappa, opts);
-            CHECK_RETCODE(ret_code, release_mem);
-           
-            // Second step: Refine the found bound states using Newton's method
-            // on the full signal.
-            opts->bound_state_localization = nsev_bsloc_NEWTON;
-            ret_code = tf2boundstates(D, q, deg, transfer_matrix, T,
-                    eps_t, K_ptr, bound_states, opts);
-            CHECK_RETCODE(ret_code, release_mem);
-           
-            // Restore original state of opts
-            opts->bound_state_localization = nsev_bsloc_SUBSAMPLE_AND_REFINE;
-            
-        } else { // any other method is handled directly by the subroutine
-            
-            ret_code = tf2boundstates(D, q, deg, transfer_matrix, T,
-                    eps_t, K_ptr, bound_states, opts);
-            CHECK_RETCODE(ret_code, release_mem);
 
-        }
-        // Norming constants and/or residues)
-        if (normconsts_or_residues != NULL && *K_ptr != 0) {
+        // The last sample of qsub is not necessarily the last one of q
+        Tsub[0] = tm->T[0];
+        Tsub[1] = tm->T[0] + (Dsub - 1)*subsampling_factor*tm->eps_t;
 
-            ret_code = tf2normconsts_or_residues(D, q, T, *K_ptr,
-                transfer_matrix, deg, bound_states, normconsts_or_residues,
-                opts);
+        // Fixed bound states of qsub using the fast eigenvalue method
+        opts->bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+        symmetry = opts->symmetry;
+        opts->symmetry = nsev_symmetry_NONE;
+        ret_code = fnft_nsev(Dsub, qsub, Tsub, 0, NULL, NULL, K_ptr,
+            bound_states, NULL, tm->kappa, opts);
+        opts->bound_state_localization = nsev_bsloc_SUBSAMPLE_AND_REFINE;
+        opts->symmetry = symmetry;
+        CHECK_RETCODE(ret_code, release_mem);
+        if (real_flag) {
+            ret_code = fold_bound_states(K_ptr, bound_states);
             CHECK_RETCODE(ret_code, release_mem);
+        }
+
+        // Second step: Refine the found bound states using Newton's method
+        // on the full signal.
+        ret_code = tm_convert_samples(tm);
+        CHECK_RETCODE(ret_code, release_mem);
+        opts->bound_state_localization = nsev_bsloc_NEWTON;
+        ret_code = tf2boundstates(tm, K_ptr, bound_states, opts);
+        opts->bound_state_localization = nsev_bsloc_SUBSAMPLE_AND_REFINE;
+        CHECK_RETCODE(ret_code, release_mem);
+        break;
+
+    case nsev_bsloc_FAST_EIGENVALUE: // needs the transfer matrix
+
+        ret_code = tm_compute_transfer_matrix(tm);
+        CHECK_RETCODE(ret_code, release_mem);
+        // fall through
+    default: // any other method is handled directly by the subroutine
 
+        ret_code = tm_convert_samples(tm);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (real_flag
+            && opts->bound_state_localization == nsev_bsloc_NEWTON) {
+            ret_code = fold_bound_states(K_ptr, bound_states);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+        ret_code = tf2boundstates(tm, K_ptr, bound_states, opts);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (real_flag
+            && opts->bound_state_localization != nsev_bsloc_NEWTON) {
+            ret_code = fold_bound_states(K_ptr, bound_states);
+            CHECK_RETCODE(ret_code, release_mem);
         }
-    } else if (K_ptr != NULL) {
-        *K_ptr = 0;
     }
-    
+
+    // Norming constants and/or residues
+    if (normconsts_or_residues != NULL && *K_ptr != 0) {
+        ret_code = tm_convert_samples(tm);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (tm->q != NULL)
+            ret_code = tf2normconsts_or_residues(tm->D, tm->q, tm->T, *K_ptr,
+                bound_states, normconsts_or_residues, opts);
+        else
+            ret_code = tf2normconsts_or_residues_poly(tm, *K_ptr,
+                bound_states, normconsts_or_residues, opts);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+    if (real_flag)
+        unfold_bound_states(K_ptr, K_max, bound_states,
+            normconsts_or_residues, opts);
+
 release_mem:
-    free(transfer_matrix);
     free(qsub);
-        
     return ret_code;
 }
 
+// Auxiliary function: Checks whether the symmetries of real signals may be
+// exploited for a query with the given options.
+static inline INT tm_is_real(
+    struct fnft_nsev_tm_s const * const tm,
+    fnft_nsev_opts_t const * const opts)
+{
+    UINT i;
+
+    switch (opts->symmetry) {
+    case nsev_symmetry_REAL:
+        return 1;
+    case nsev_symmetry_DETECT:
+        if (tm->q != NULL) {
+            for (i=0; i<tm->D; i++) {
+                if (CIMAG(tm->q[i]) != 0.0)
+                    return 0;
+            }
+            return 1;
+        } else if (tm->samples != NULL) {
+            for (i=0; i<tm->D; i++) {
+                if (CIMAG(misc_sample(tm->samples, i)) != 0.0)
+                    return 0;
+            }
+            return 1;
+        }
+        return 0; // imported transfer matrices cannot be checked
+    default:
+        return 0;
+    }
+}
+
+// Auxiliary function: Computes the continuous spectrum of the signal
+// represented by a transfer matrix object. For real signals, the
+// coefficients of the transfer matrix are real. If the grid is symmetric,
+// the values at -xi are then the complex conjugates of those at xi, and
+// only the first half of the grid is computed.
+static inline INT tm_contspec(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT M,
+    COMPLEX * const contspec,
+    REAL const * const XI,
+    fnft_nsev_opts_t * const opts)
+{
+    UINT i, c, nvals, M_half;
+    INT ret_code = SUCCESS;
+
+    ret_code = tm_compute_transfer_matrix(tm);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    if (M < 2 || XI[0] != -XI[1] || !tm_is_real(tm, opts)) {
+        ret_code = tf2contspec(tm->deg, tm->W, tm->transfer_matrix, tm->T,
+            tm->D, XI, M, 0, M, contspec, opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+        return SUCCESS;
+    }
+
+    // Compute the first half of the grid. The results are stored with the
+    // layout of a grid with M_half points and then moved to their final
+    // positions, starting with the last block.
+    M_half = (M + 1)/2;
+    ret_code = tf2contspec(tm->deg, tm->W, tm->transfer_matrix, tm->T,
+        tm->D, XI, M, 0, M_half, contspec, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    nvals = 1;
+    if (opts->contspec_type == nsev_cstype_AB)
+        nvals = 2;
+    else if (opts->contspec_type == nsev_cstype_BOTH)
+        nvals = 3;
+    for (c=nvals; c-->0; ) {
+        memmove(contspec + c*M, contspec + c*M_half,
+            M_half * sizeof(COMPLEX));
+        for (i=0; i<M-M_half; i++)
+            contspec[c*M + M-1-i] = CONJ(contspec[c*M + i]);
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+// Auxiliary function for real signals: Replaces bound states in the left
+// half plane by their mirror images -conj(lam) in the right half plane and
+// removes the resulting duplicates.
+static inline INT fold_bound_states(
+    UINT * const K_ptr,
+    COMPLEX * const bound_states)
+{
+    UINT i;
+
+    for (i=0; i<*K_ptr; i++) {
+        if (CREAL(bound_states[i]) < 0.0)
+            bound_states[i] = -CONJ(bound_states[i]);
+    }
+    return misc_merge(K_ptr, bound_states, SQRT(EPSILON));
+}
+
+// Auxiliary function for real signals: Appends the mirror images of the
+// bound states that are not on the imaginary axis (up to the tolerance
+// used for merging). The norming constants of the mirror images are the
+// complex conjugates, and the residues are the negative complex conjugates.
+static inline void unfold_bound_states(
+    UINT * const K_ptr,
+    const UINT K_max,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t const * const opts)
+{
+    const UINT K = *K_ptr;
+    UINT i, K_new;
+
+    K_new = K;
+    for (i=0; i<K; i++) {
+        if (CREAL(bound_states[i]) >= SQRT(EPSILON))
+            K_new++;
+    }
+    if (K_new > K_max) {
+        WARN("Found more than *K_ptr bound states. Returning as many as possible.");
+        K_new = K_max;
+    }
+
+    // The residues follow the norming constants if both are requested
+    if (normconsts_or_residues != NULL
+        && opts->discspec_type == nsev_dstype_BOTH)
+        memmove(normconsts_or_residues + K_new, normconsts_or_residues + K,
+            K * sizeof(COMPLEX));
+
+    *K_ptr = K;
+    for (i=0; i<K && *K_ptr<K_new; i++) {
+        if (CREAL(bound_states[i]) < SQRT(EPSILON))
+            continue;
+        bound_states[*K_ptr] = -CONJ(bound_states[i]);
+        if (normconsts_or_residues != NULL) {
+            switch (opts->discspec_type) {
+            case nsev_dstype_NORMING_CONSTANTS:
+                normconsts_or_residues[*K_ptr] =
+                    CONJ(normconsts_or_residues[i]);
+                break;
+            case nsev_dstype_RESIDUES:
+                normconsts_or_residues[*K_ptr] =
+                    -CONJ(normconsts_or_residues[i]);
+                break;
+            default:
+                normconsts_or_residues[*K_ptr] =
+                    CONJ(normconsts_or_residues[i]);
+                normconsts_or_residues[K_new + *K_ptr] =
+                    -CONJ(normconsts_or_residues[K_new + i]);
+            }
+        }
+        (*K_ptr)++;
+    }
+}
+
 // Auxiliary function: Computes continuous spectrum on a frequency grid
-// from a given transfer matrix.
+// from a given transfer matrix. Only the n points first, ..., first+n-1 of
+// the grid with M points are computed. The result has the same layout as
+// for a grid with n points.
 static inline INT tf2contspec(
     const UINT deg,
     const INT W,
@@ -254,21 +2637,16 @@ static inline INT tf2contspec(
     const UINT D,
     REAL const * const XI,
     const UINT M,
+    const UINT first,
+    const UINT n,
     COMPLEX * const result,
     fnft_nsev_opts_t * const opts)
 {
-    COMPLEX *a_vals;
+    COMPLEX *ab_vals = NULL;
     COMPLEX A, V;
     REAL eps_t, eps_xi;
-    REAL xi, map_coeff, bnd_coeff, scale;
-    REAL phase_factor_rho, phase_factor_a, phase_factor_b;
-    INT ret_code;
-    UINT i, offset = 0;
-    
-    // We reuse an unused part of the transfer matrix as buffer
-    a_vals = transfer_matrix + (deg+1);
-    if (M > deg+1)
-        return E_NOT_YET_IMPLEMENTED(M >> D, "Any M<=2*D should work. It is planned to remove this restriction in the next release.");
+    REAL map_coeff;
+    INT ret_code = SUCCESS;
     
     // Set step sizes
     eps_t = (T[1] - T[0])/(D - 1);
@@ -276,41 +2654,84 @@ static inline INT tf2contspec(
 
     // Retrieve some discretization-specific constants
     map_coeff = nse_discretization_mapping_coeff(opts->discretization);
-    bnd_coeff = nse_discretization_boundary_coeff(opts->discretization);
-    if (map_coeff == NAN || bnd_coeff == NAN)
+    if (isnan(map_coeff))
         return E_INVALID_ARGUMENT(opts->discretization);
 
+    // Allocate a buffer for the values of a and b. (The unused part of the
+    // transfer matrix cannot be used since transfer matrix objects might be
+    // queried or merged again.)
+    ab_vals = malloc(2 * n * sizeof(COMPLEX));
+    if (ab_vals == NULL)
+        return E_NOMEM;
+
     // Prepare the use of the chirp transform. The entries of the transfer
     // matrix that correspond to a and b will be evaluated on the frequency
-    // grid xi(i) = XI1 + i*eps_xi, where i=0,...,M-1. Since
+    // grid xi(i) = XI1 + (first+i)*eps_xi, where i=0,...,n-1. Since
     // z=exp(map_coeff*j*xi*eps_t), we find that the z at which z the transfer
     // matrix has to be evaluated are given by z(i) = 1/(A * V^-i), where:
     V = CEXP(map_coeff*I*eps_xi*eps_t);
-    A = CEXP(-map_coeff*I*XI[0]*eps_t);
+    A = CEXP(-map_coeff*I*(XI[0] + first*eps_xi)*eps_t);
+
+    // Evaluate a and b
+    ret_code = poly_chirpz(deg, transfer_matrix, A, V, n, ab_vals);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_chirpz(deg, transfer_matrix+2*(deg+1), A, V, n,
+        ab_vals + n);
+    CHECK_RETCODE(ret_code, release_mem);
 
     // Compute the continuous spectrum
+    ret_code = ab2contspec(W, T, D, XI, M, first, n, ab_vals, ab_vals + n,
+        result, opts);
+    
+release_mem:
+    free(ab_vals);
+    return ret_code;
+}
+
+// Auxiliary function: Computes the continuous spectrum at the n points
+// first, ..., first+n-1 of the frequency grid with M points from the values
+// of the polynomials a and b in the transfer matrix (see tf2contspec).
+static inline INT ab2contspec(
+    const INT W,
+    REAL const * const T,
+    const UINT D,
+    REAL const * const XI,
+    const UINT M,
+    const UINT first,
+    const UINT n,
+    COMPLEX const * const a_vals,
+    COMPLEX const * const b_vals,
+    COMPLEX * const result,
+    fnft_nsev_opts_t const * const opts)
+{
+    REAL eps_t, eps_xi;
+    REAL xi, bnd_coeff, scale;
+    REAL phase_factor_rho, phase_factor_a, phase_factor_b;
+    UINT i, offset = 0;
+
+    // Set step sizes
+    eps_t = (T[1] - T[0])/(D - 1);
+    eps_xi = (XI[1] - XI[0])/(M - 1);
+
+    // Retrieve some discretization-specific constants
+    bnd_coeff = nse_discretization_boundary_coeff(opts->discretization);
+    if (isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(opts->discretization);
+
     switch (opts->contspec_type) {
 
     case nsev_cstype_BOTH:
 
-        offset = M;
+        offset = n;
         // fall through
     case nsev_cstype_REFLECTION_COEFFICIENT:
 
-        ret_code = poly_chirpz(deg, transfer_matrix, A, V, M, a_vals);
-        if (ret_code != SUCCESS)
-            return E_SUBROUTINE(ret_code);
-
-        ret_code = poly_chirpz(deg, transfer_matrix+2*(deg+1), A, V, M,result);
-        if (ret_code != SUCCESS)
-            return E_SUBROUTINE(ret_code);
-
         phase_factor_rho = -2.0*(T[1] + eps_t*bnd_coeff);
-        for (i = 0; i < M; i++) {
-            xi = XI[0] + i*eps_xi;
+        for (i = 0; i < n; i++) {
+            xi = XI[0] + (first + i)*eps_xi;
             if (a_vals[i] == 0.0)
                 return E_DIV_BY_ZERO;
-            result[i] *= CEXP(I*xi*phase_factor_rho) / a_vals[i];
+            result[i] = b_vals[i] * (CEXP(I*xi*phase_factor_rho) / a_vals[i]);
         }
 
         if (opts->contspec_type == nsev_cstype_REFLECTION_COEFFICIENT)
@@ -318,30 +2739,18 @@ static inline INT tf2contspec(
         // fall through
     case nsev_cstype_AB:
 
-        ret_code = poly_chirpz(deg, transfer_matrix, A, V, M, result + offset);
-        if (ret_code != SUCCESS)
-            return E_SUBROUTINE(ret_code);
-
-        ret_code = poly_chirpz(deg, transfer_matrix+2*(deg+1), A, V, M,
-            result + offset + M);
-        if (ret_code != SUCCESS)
-            return E_SUBROUTINE(ret_code);
-
         scale = POW(2.0, W); // needed since the transfer matrix might
                                   // have been scaled by nse_fscatter
 
-        if (bnd_coeff == 0.0) {
-            phase_factor_a = T[0] + T[1];
-            phase_factor_b = T[0] - T[1];
-        } else {
-            phase_factor_a =  2.0*D*eps_t + T[1] + T[0];
-            phase_factor_b = 2.0*(D-bnd_coeff)*eps_t + T[0] - T[1];
-        }
+        ab_phase_factors(D, T, eps_t, bnd_coeff, &phase_factor_a,
+            &phase_factor_b);
 
-        for (i = 0; i < M; i++) {
-            xi = XI[0] + i*eps_xi;       
-            result[offset + i] *= scale * CEXP(I*xi*phase_factor_a);
-        	result[offset + M + i] *= scale * CEXP(I*xi*phase_factor_b);
+        for (i = 0; i < n; i++) {
+            xi = XI[0] + (first + i)*eps_xi;       
+            result[offset + i] = a_vals[i]
+                * (scale * CEXP(I*xi*phase_factor_a));
+            result[offset + n + i] = b_vals[i]
+                * (scale * CEXP(I*xi*phase_factor_b));
         }
 
         break;
@@ -384,16 +2793,15 @@ static inline REAL im_bound(const UINT D, COMPLEX const * const q,
 
 // Auxiliary function: Computes the bound states from a given transfer matrix.
 static inline INT tf2boundstates(
-    const UINT D,
-    COMPLEX const * const q,
-    const UINT deg,
-    COMPLEX * const transfer_matrix,
-    REAL const * const T,
-    const REAL eps_t,
+    struct fnft_nsev_tm_s * const tm,
     UINT * const K_ptr,
     COMPLEX * const bound_states,
     fnft_nsev_opts_t * const opts)
 {
+    const UINT D = tm->D;
+    const UINT deg = tm->deg;
+    COMPLEX * const transfer_matrix = tm->transfer_matrix;
+    const REAL eps_t = tm->eps_t;
     REAL map_coeff;
     UINT i, K;
     REAL bounding_box[4] = { NAN };
@@ -401,7 +2809,7 @@ static inline INT tf2boundstates(
     INT ret_code = SUCCESS;
 
     map_coeff = nse_discretization_mapping_coeff(opts->discretization);
-    if (map_coeff == NAN)
+    if (isnan(map_coeff))
         return E_INVALID_ARGUMENT(opts->discretization);
 
     // Localize bound states ...
@@ -415,8 +2823,8 @@ static inline INT tf2boundstates(
 
             // Perform Newton iterations. Initial guesses of bound-states
             // should be in the continuous-time domain.
-            ret_code = refine_roots_newton(D, q, T, K, buffer,
-                nse_discretization_BO, opts->niter);
+            ret_code = refine_roots_newton(D, tm->q, tm->T, K, buffer,
+                map_coeff, opts->niter);
             CHECK_RETCODE(ret_code, leave_fun);
             
             break;
@@ -428,15 +2836,28 @@ static inline INT tf2boundstates(
             if (*K_ptr >= K) {
                 buffer = bound_states;
             } else {
-                // Store intermediate results in unused part of transfer matrix.
-                // This buffer is large enough to store all deg roots of the
-                // polynomial, while bound_states provided by the user might be
-                // smaller. The latter only needs to store the bound states that
-                // survive the filtering.
-                buffer = transfer_matrix + (deg+1);
+                // Store intermediate results in a separate buffer that is
+                // large enough to store all deg roots of the polynomial,
+                // while bound_states provided by the user might be smaller.
+                // The latter only needs to store the bound states that
+                // survive the filtering. (The unused part of the transfer
+                // matrix cannot be used since the object might be queried
+                // again.)
+                buffer = malloc(deg * sizeof(COMPLEX));
+                if (buffer == NULL) {
+                    ret_code = E_NOMEM;
+                    goto leave_fun;
+                }
             }
 
-            ret_code = poly_roots_fasteigen(deg, transfer_matrix, buffer);
+            // The multishift variant is only used if threads have been
+            // requested explicitly (zero threads means all processors there)
+            if (opts->nthreads == 0 || opts->nthreads == 1)
+                ret_code = poly_roots_fasteigen(deg, transfer_matrix, buffer);
+            else
+                ret_code = poly_roots_fasteigen_multishift(deg,
+                    transfer_matrix, buffer, 0,
+                    opts->nthreads < 0 ? 0 : (UINT)opts->nthreads);
             CHECK_RETCODE(ret_code, leave_fun);
 
             // Roots are returned in discrete-time domain -> coordinate
@@ -469,7 +2890,12 @@ static inline INT tf2boundstates(
 
         bounding_box[1] = re_bound(eps_t, map_coeff);
         bounding_box[0] = -bounding_box[1];
-        bounding_box[3] = im_bound(D, q, T);
+        if (tm->l2norm2 < 0.0 && tm->q != NULL)
+            tm->l2norm2 = misc_l2norm2(D, tm->q, tm->T[0], tm->T[1]);
+        else if (tm->l2norm2 < 0.0)
+            tm->l2norm2 = misc_l2norm2_samples(D, tm->samples, tm->T[0],
+                tm->T[1]);
+        bounding_box[3] = 1.5 * 0.25 * tm->l2norm2; // see im_bound
         bounding_box[2] = 0;
         ret_code = misc_filter(&K, buffer, NULL, bounding_box);
         CHECK_RETCODE(ret_code, leave_fun);
@@ -487,7 +2913,9 @@ static inline INT tf2boundstates(
     // Update number of bound states
     *K_ptr = K;
 
-leave_fun:    
+leave_fun:
+    if (buffer != bound_states)
+        free(buffer);
     return ret_code;
 }
 
@@ -498,8 +2926,6 @@ static inline INT tf2normconsts_or_residues(
     COMPLEX const * const q,
     REAL const * const T,
     const UINT K,
-    COMPLEX * const transfer_matrix,
-    const UINT deg,
     COMPLEX * const bound_states,
     COMPLEX * const normconsts_or_residues,
     fnft_nsev_opts_t * const opts)
@@ -518,9 +2944,12 @@ static inline INT tf2normconsts_or_residues(
     if (q == NULL)
         return E_INVALID_ARGUMENT(q);
     
-    // Reuse no longer used parts of the transfer matrix as buffers
-    a_vals = transfer_matrix + (deg+1);
-    aprime_vals = transfer_matrix + 3*(deg+1);
+    // Allocate buffers. (The transfer matrix is not necessarily available
+    // at this point, so its unused parts cannot be reused here.)
+    a_vals = malloc(2*K * sizeof(COMPLEX));
+    if (a_vals == NULL)
+        return E_NOMEM;
+    aprime_vals = a_vals + K;
     
     // trunc_index is the index where we will split
     // trunc_index should be integer between 0 and D-1
@@ -540,40 +2969,102 @@ static inline INT tf2normconsts_or_residues(
             memcpy(normconsts_or_residues + offset,
                     normconsts_or_residues,
                     offset*sizeof(complex double));
-        } else
-            return E_INVALID_ARGUMENT(opts->discspec_type);
+        } else {
+            ret_code = E_INVALID_ARGUMENT(opts->discspec_type);
+            goto leave_fun;
+        }
         
         // Divide norming constants by derivatives to get residues
         for (i = 0; i < K; i++) {
-            if (aprime_vals[i] == 0.0)
-                return E_DIV_BY_ZERO;
+            if (aprime_vals[i] == 0.0) {
+                ret_code = E_DIV_BY_ZERO;
+                goto leave_fun;
+            }
             normconsts_or_residues[offset + i] /= aprime_vals[i];
         }
     }
 
 leave_fun:
+    free(a_vals);
     return ret_code;
 }
 
-// Auxiliary function: Refines the bound-states using Newtons method
+// Auxiliary function: Computes the norming constants and/or residues by
+// evaluating the polynomials in the transfer matrix at the bound states.
+// Used for objects that do not store the signal itself.
+static inline INT tf2normconsts_or_residues_poly(
+    struct fnft_nsev_tm_s * const tm,
+    const UINT K,
+    COMPLEX * const bound_states,
+    COMPLEX * const normconsts_or_residues,
+    fnft_nsev_opts_t * const opts)
+{
+    const UINT deg = tm->deg;
+    REAL map_coeff, bnd_coeff, scale;
+    REAL phase_factor_a, phase_factor_b;
+    COMPLEX w, a_val, b_val, aprime_val;
+    UINT i, offset = 0;
+
+    map_coeff = nse_discretization_mapping_coeff(opts->discretization);
+    bnd_coeff = nse_discretization_boundary_coeff(opts->discretization);
+    if (isnan(map_coeff) || isnan(bnd_coeff))
+        return E_INVALID_ARGUMENT(opts->discretization);
+    ab_phase_factors(tm->D, tm->T, tm->eps_t, bnd_coeff, &phase_factor_a,
+        &phase_factor_b);
+    scale = POW(2.0, tm->W);
+
+    if (opts->discspec_type == nsev_dstype_BOTH)
+        offset = K;
+    else if (opts->discspec_type != nsev_dstype_NORMING_CONSTANTS
+    && opts->discspec_type != nsev_dstype_RESIDUES)
+        return E_INVALID_ARGUMENT(opts->discspec_type);
+
+    for (i = 0; i < K; i++) {
+        w = map_coeff*I*bound_states[i]*tm->eps_t;
+
+        // Norming constant b_k = b(lam_k)
+        b_val = scale * poly_eval_exp(deg, tm->transfer_matrix + 2*(deg+1),
+            w, I*bound_states[i]*phase_factor_b, NULL);
+        if (opts->discspec_type != nsev_dstype_RESIDUES)
+            normconsts_or_residues[i] = b_val;
+        if (opts->discspec_type == nsev_dstype_NORMING_CONSTANTS)
+            continue;
+
+        // Residue b_k/a'(lam_k). Since z=exp(w), dz/dlam = map_coeff*j*eps_t*z.
+        a_val = scale * poly_eval_exp(deg, tm->transfer_matrix, w,
+            I*bound_states[i]*phase_factor_a, &aprime_val);
+        aprime_val = scale*aprime_val*map_coeff*I*tm->eps_t
+            + I*phase_factor_a*a_val;
+        if (aprime_val == 0.0)
+            return E_DIV_BY_ZERO;
+        normconsts_or_residues[offset + i] = b_val / aprime_val;
+    }
+
+    return SUCCESS;
+}
+
+// Auxiliary function: Refines the bound-states using Halley's method, which
+// converges cubically to simple roots of a(lam). The values of a, a' and a''
+// are obtained with a single pass of the BO scheme per iteration. The
+// iterations stop once the steps are so small that they cannot improve
+// the accuracy any further due to the discretization error of the BO
+// scheme. The real parts of the bound states are bounded according to the
+// discretization with the mapping coefficient map_coeff that has been used
+// to find the initial guesses.
 static inline INT refine_roots_newton(
     const UINT D,
     COMPLEX const * const q,
     REAL const * const T,
     const UINT K,
     COMPLEX * bound_states,
-    nse_discretization_t discretization,
-    const UINT niter)     
+    const REAL map_coeff,
+    const UINT niter)
 {
-    INT ret_code = SUCCESS;
-    UINT i, iter;
-    COMPLEX a_val, b_val, aprime_val, error;
-    REAL eprecision = EPSILON * 100;
-    REAL re_bound_val, im_bound_val, eps_t, map_coeff;
-    UINT trunc_index;
-    trunc_index = D;
-    eps_t = (T[1] - T[0])/(D - 1);
-    
+    UINT i, n, iter;
+    COMPLEX S[12], a_val, aprime_val, a2prime_val, error, denom;
+    REAL re_bound_val, im_bound_val, eps_t, L, qmax;
+    INT ret_code;
+
     // Check inputs
     if (K == 0) // no bound states to refine
         return SUCCESS;
@@ -585,41 +3076,58 @@ static inline INT refine_roots_newton(
         return E_INVALID_ARGUMENT(q);
     if (T == NULL)
         return E_INVALID_ARGUMENT(T);
-    
+    if (isnan(map_coeff))
+        return E_INVALID_ARGUMENT(map_coeff);
+
+    eps_t = (T[1] - T[0])/(D - 1);
     im_bound_val = im_bound(D, q, T);
-    if (im_bound_val == NAN)
+    if (isnan(im_bound_val))
         return E_OTHER("Upper bound on imaginary part of bound states is NaN");
-    
-    map_coeff = nse_discretization_mapping_coeff(discretization);
-    if (map_coeff == NAN)
-        return E_INVALID_ARGUMENT(discretization);
-    re_bound_val = re_bound(eps_t, discretization);
-        
-    // Perform iterations of Newton's method
+    re_bound_val = re_bound(eps_t, map_coeff);
+
+    qmax = 0.0;
+    for (n = 0; n < D; n++) {
+        if (CABS(q[n]) > qmax)
+            qmax = CABS(q[n]);
+    }
+
+    // a(lam) = S11(lam)*exp(j*lam*L), where S is the scattering matrix
+    // computed with the BO scheme. The exponential cancels in the updates.
+    L = T[1] - T[0] + eps_t;
+
+    // Perform iterations of Halley's method
     for (i = 0; i < K; i++) {
-        iter = 0;
-        do {
-            // Compute a(lam) and a'(lam) at the current root
-            ret_code = nse_scatter_bound_states(D, q, T, &trunc_index, 1,
-                bound_states + i, &a_val, &aprime_val, &b_val, discretization);
+        for (iter = 0; iter < niter; iter++) {
+            // Compute a(lam), a'(lam) and a''(lam) at the current root,
+            // up to the common factor exp(j*lam*L)
+            ret_code = nse_scatter_matrix_d2(D, q, eps_t, +1, 1,
+                bound_states + i, S, nse_discretization_BO);
             if (ret_code != SUCCESS)
                 return E_SUBROUTINE(ret_code);
+            a_val = S[0];
+            aprime_val = S[4] + I*L*S[0];
+            a2prime_val = S[8] + 2.0*I*L*S[4] - L*L*S[0];
 
-            // Perform Newton updates: lam[i] <- lam[i] - a(lam[i])/a'(lam[i])
+            // Halley update: lam <- lam - (a/a')/(1 - a*a''/(2*a'^2)). Falls
+            // back to Newton's method if the denominator vanishes.
             if (aprime_val == 0.0)
                 return E_DIV_BY_ZERO;
             error = a_val / aprime_val;
+            denom = 1.0 - 0.5*error*a2prime_val/aprime_val;
+            if (denom != 0.0)
+                error /= denom;
             bound_states[i] -= error;
-            iter++;
 
             if (CIMAG(bound_states[i]) > im_bound_val
                 || CREAL(bound_states[i]) > re_bound_val
                 || CREAL(bound_states[i]) < -re_bound_val
                 || CIMAG(bound_states[i]) < 0.0)
-            break;
-
-        } while (CABS(error) > eprecision && iter < niter);       
+                break;
+            if (CABS(error) <= nse_scatter_refine_tol(eps_t, qmax,
+                bound_states[i]))
+                break;
+        }
     }
-    
+
     return SUCCESS;
 }
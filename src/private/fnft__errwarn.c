@@ -28,7 +28,12 @@
 INT fnft__errmsg_aux(const INT ec, const char *func, const INT line,
     const char *msg)
 {
-    fnft_printf_ptr_t printf_ptr = fnft_errwarn_getprintf();
+    fnft_printf_ptr_t printf_ptr;
+
+    // Errors are only recorded in the diagnostics mode
+    if (fnft__errwarn_record(ec, func, line, msg))
+        return ec;
+    printf_ptr = fnft_errwarn_getprintf();
     if (printf_ptr != NULL)
         printf_ptr("FNFT Error: %s\n in %s(%i)-%d.%d.%d\n", msg, func, line,
 			FNFT_VERSION_MAJOR, FNFT_VERSION_MINOR, FNFT_VERSION_PATCH);
@@ -37,7 +42,11 @@ INT fnft__errmsg_aux(const INT ec, const char *func, const INT line,
 
 void fnft__warn_aux(const char *func, const INT line, const char *msg)
 {
-    fnft_printf_ptr_t printf_ptr = fnft_errwarn_getprintf();
+    fnft_printf_ptr_t printf_ptr;
+
+    if (fnft__errwarn_record(SUCCESS, func, line, msg))
+        return;
+    printf_ptr = fnft_errwarn_getprintf();
     if (printf_ptr != NULL)
         printf_ptr("FNFT Warning: %s\n in %s(%i)-%d.%d.%d\n", msg, func, line,
 			FNFT_VERSION_MAJOR, FNFT_VERSION_MINOR, FNFT_VERSION_PATCH);
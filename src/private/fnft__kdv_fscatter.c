@@ -877,7 +877,7 @@ INT kdv_fscatter(const UINT D, COMPLEX const * const q,
             goto release_mem;
     }
     // Multiply the individual scattering matrices
-    ret_code = poly_fmult2x2(deg_ptr, D, p, result, &W);
+    ret_code = poly_fmult2x2_fd(deg_ptr, D, p, result, &W);
     CHECK_RETCODE(ret_code, release_mem);
     
 release_mem:
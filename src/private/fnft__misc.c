@@ -21,6 +21,7 @@
 
 #include "fnft__errwarn.h"
 #include <stdio.h>
+#include <stdint.h>
 #include "fnft__misc.h"
 
 void misc_print_buf(INT len, COMPLEX *buf, char* varname)
@@ -46,13 +47,168 @@ REAL misc_rel_err(INT len, COMPLEX *vec_numer, COMPLEX *vec_exact)
     return n/d; 
 }
 
+// Auxiliary functions for misc_hausdorff_dist: The points of one of the
+// vectors are stored in a k-d tree. The tree is implicit, i.e., the node of
+// the range [lo,hi) of the array is the point at the position
+// mid=lo+(hi-lo)/2. The points in [lo,mid) are not greater than that point
+// in the coordinate along which the range has the larger spread, and the
+// points in [mid+1,hi) are not smaller. The bounding box of the range is
+// stored in box[4*mid], ..., box[4*mid+3] (min/max of the real and of the
+// imaginary parts).
+static inline REAL kdtree_coord(const COMPLEX z, const INT axis)
+{
+    return axis ? CIMAG(z) : CREAL(z);
+}
+
+static void kdtree_build(COMPLEX * const pts, REAL * const box,
+    const UINT lo, const UINT hi)
+{
+    UINT i, l, r, store, mid;
+    REAL min_re, max_re, min_im, max_im, pivot;
+    INT axis;
+    COMPLEX tmp;
+
+    if (hi <= lo)
+        return;
+
+    min_re = max_re = CREAL(pts[lo]);
+    min_im = max_im = CIMAG(pts[lo]);
+    for (i=lo+1; i<hi; i++) {
+        if (CREAL(pts[i]) < min_re) min_re = CREAL(pts[i]);
+        if (CREAL(pts[i]) > max_re) max_re = CREAL(pts[i]);
+        if (CIMAG(pts[i]) < min_im) min_im = CIMAG(pts[i]);
+        if (CIMAG(pts[i]) > max_im) max_im = CIMAG(pts[i]);
+    }
+    axis = (max_im - min_im > max_re - min_re) ? 1 : 0;
+
+    // Move the median to mid (quickselect)
+    mid = lo + (hi - lo)/2;
+    l = lo;
+    r = hi - 1;
+    while (l < r) {
+        i = l + (r - l)/2;
+        pivot = kdtree_coord(pts[i], axis);
+        tmp = pts[i]; pts[i] = pts[r]; pts[r] = tmp;
+        store = l;
+        for (i=l; i<r; i++) {
+            if (kdtree_coord(pts[i], axis) < pivot) {
+                tmp = pts[i]; pts[i] = pts[store]; pts[store] = tmp;
+                store++;
+            }
+        }
+        tmp = pts[store]; pts[store] = pts[r]; pts[r] = tmp;
+        if (store == mid)
+            break;
+        else if (store < mid)
+            l = store + 1;
+        else
+            r = store - 1;
+    }
+    box[4*mid] = min_re;
+    box[4*mid + 1] = max_re;
+    box[4*mid + 2] = min_im;
+    box[4*mid + 3] = max_im;
+
+    kdtree_build(pts, box, lo, mid);
+    kdtree_build(pts, box, mid + 1, hi);
+}
+
+static void kdtree_nearest(COMPLEX const * const pts,
+    REAL const * const box, const UINT lo, const UINT hi, const COMPLEX z,
+    REAL * const dist_ptr)
+{
+    UINT mid;
+    REAL tmp, dx = 0.0, dy = 0.0;
+    INT axis;
+
+    if (lo >= hi)
+        return;
+    mid = lo + (hi - lo)/2;
+
+    // Skip the range if its bounding box is farther away than the nearest
+    // point found so far
+    if (CREAL(z) < box[4*mid])
+        dx = box[4*mid] - CREAL(z);
+    else if (CREAL(z) > box[4*mid + 1])
+        dx = CREAL(z) - box[4*mid + 1];
+    if (CIMAG(z) < box[4*mid + 2])
+        dy = box[4*mid + 2] - CIMAG(z);
+    else if (CIMAG(z) > box[4*mid + 3])
+        dy = CIMAG(z) - box[4*mid + 3];
+    if (CABS(dx + I*dy) > *dist_ptr)
+        return;
+
+    tmp = CABS(z - pts[mid]);
+    if (tmp < *dist_ptr)
+        *dist_ptr = tmp;
+
+    // Search the half that is closer to z first (the splitting axis is
+    // determined as in kdtree_build)
+    axis = (box[4*mid + 3] - box[4*mid + 2] > box[4*mid + 1] - box[4*mid])
+        ? 1 : 0;
+    if (kdtree_coord(z, axis) < kdtree_coord(pts[mid], axis)) {
+        kdtree_nearest(pts, box, lo, mid, z, dist_ptr);
+        kdtree_nearest(pts, box, mid + 1, hi, z, dist_ptr);
+    } else {
+        kdtree_nearest(pts, box, mid + 1, hi, z, dist_ptr);
+        kdtree_nearest(pts, box, lo, mid, z, dist_ptr);
+    }
+}
+
+// Auxiliary function for misc_hausdorff_dist: Returns the maximum over the
+// points of vecA of the distance to the nearest point in vecB, or -1 if
+// lenA is zero. Points that are not finite are never the nearest point of
+// another point, so they are not stored in the tree.
+static REAL directed_hausdorff_dist(const UINT lenA,
+    COMPLEX const * const vecA, const UINT lenB,
+    COMPLEX const * const vecB, COMPLEX * const pts, REAL * const box)
+{
+    UINT i, j, n = 0;
+    REAL dist, max_dist = -1.0;
+
+    for (j=0; j<lenB; j++) {
+        if (isfinite(CREAL(vecB[j])) && isfinite(CIMAG(vecB[j])))
+            pts[n++] = vecB[j];
+    }
+    kdtree_build(pts, box, 0, n);
+
+    for (i=0; i<lenA; i++) {
+        dist = INFINITY;
+        if (isfinite(CREAL(vecA[i])) && isfinite(CIMAG(vecA[i])))
+            kdtree_nearest(pts, box, 0, n, vecA[i], &dist);
+        if (dist > max_dist)
+            max_dist = dist;
+    }
+    return max_dist;
+}
+
 REAL misc_hausdorff_dist(const UINT lenA,
     COMPLEX const * const vecA, const UINT lenB,
     COMPLEX const * const vecB)
 {
-    UINT i, j;
+    UINT i, j, len;
+    COMPLEX *pts;
+    REAL *box;
     double tmp, dist, max_dist = -1.0;
 
+    // The nearest neighbors are found with a k-d tree, which needs
+    // O(N log N) operations for typical spectra
+    len = lenA > lenB ? lenA : lenB;
+    pts = malloc(len * sizeof(COMPLEX) + 1);
+    box = malloc(4 * len * sizeof(REAL) + 1);
+    if (pts != NULL && box != NULL) {
+        max_dist = directed_hausdorff_dist(lenA, vecA, lenB, vecB, pts, box);
+        dist = directed_hausdorff_dist(lenB, vecB, lenA, vecA, pts, box);
+        if (dist > max_dist)
+            max_dist = dist;
+        free(pts);
+        free(box);
+        return max_dist;
+    }
+    free(pts);
+    free(box);
+
+    // Fall back to comparing all pairs if memory is short
     for (i=0; i<lenA; i++) {
         dist = INFINITY;
         for (j=0; j<lenB; j++) {
@@ -85,6 +241,13 @@ COMPLEX misc_sech(COMPLEX Z)
 
 REAL misc_l2norm2(const UINT N, COMPLEX const * const Z,
     const REAL a, const REAL b)
+{
+    const samples_t samples = { samples_format_COMPLEX, Z, NULL, 1.0 };
+    return misc_l2norm2_samples(N, &samples, a, b);
+}
+
+REAL misc_l2norm2_samples(const UINT N, samples_t const * const Z,
+    const REAL a, const REAL b)
 {
     REAL val, h, tmp;
     UINT i;
@@ -95,13 +258,13 @@ REAL misc_l2norm2(const UINT N, COMPLEX const * const Z,
     
     // Integrate |q(t)|^2 numerically
     h = (b - a)/N;
-    tmp = CABS(Z[0]);
+    tmp = CABS(misc_sample(Z, 0));
     val = 0.5 * h * tmp * tmp;
     for (i=1; i<N-1; i++) {
-        tmp = CABS(Z[i]);
+        tmp = CABS(misc_sample(Z, i));
         val += h * tmp * tmp;
     }
-    tmp = CABS(Z[N-1]);
+    tmp = CABS(misc_sample(Z, N-1));
     val += 0.5 * h * tmp * tmp;
 
     return val;
@@ -221,11 +384,40 @@ INT misc_filter_nonreal(UINT *N_ptr, COMPLEX * const vals, const REAL tol_im)
     return SUCCESS;
 }
 
+// Auxiliary function for misc_merge: Hash of a grid cell
+static inline size_t cell_hash(const int64_t ix, const int64_t iy)
+{
+    uint64_t h = (uint64_t)ix * 0x9e3779b97f4a7c15ull;
+    h ^= (uint64_t)iy + 0x7f4a7c159e3779b9ull + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    return (size_t)h;
+}
+
+// Auxiliary function for misc_merge: Index of the grid cell of width tol
+// that contains x. Coordinates whose index would not fit into a 64 bit
+// integer are clamped. Clamping does not move values closer than tol into
+// cells that are not neighbors.
+static inline int64_t cell_index(const REAL x, const REAL tol)
+{
+    const REAL limit = 0.25 * (REAL)INT64_MAX;
+    REAL y = FLOOR(x / tol);
+
+    if (y > limit)
+        y = limit;
+    else if (y < -limit)
+        y = -limit;
+    return (int64_t)y;
+}
+
 INT misc_merge(UINT *N_ptr, COMPLEX * const vals, REAL tol)
 {
-    REAL dist = -1.0;
-    UINT i, j, N, N_filtered;
-    
+    UINT i, k, N, N_filtered, nslots;
+    UINT *heads = NULL, *next = NULL;
+    int64_t *cells = NULL;
+    int64_t ix, iy, jx, jy;
+    size_t slot;
+    INT keep;
+
     if (N_ptr == NULL)
         return E_INVALID_ARGUMENT(N_ptr);
     if (*N_ptr == 0)
@@ -234,35 +426,128 @@ INT misc_merge(UINT *N_ptr, COMPLEX * const vals, REAL tol)
         return E_INVALID_ARGUMENT(vals);
     if (tol < 0.0)
         return E_INVALID_ARGUMENT(tol);
+    if (tol == 0.0) // no two values are closer than zero
+        return SUCCESS;
 
+    // A value is removed if it is closer than tol to one of the values that
+    // have been kept before. The kept values are stored in a hash table of
+    // grid cells of width tol, so that only the kept values in the
+    // neighboring cells have to be compared. Since the kept values in a
+    // cell are at least tol apart, a cell contains at most a few of them.
     N = *N_ptr;
-    N_filtered = 1;
-    for (i=1; i<N; i++) {
-        for (j = 0; j < i; j++) {
-            dist = CABS(vals[j] - vals[i]);
-            if (dist < tol)
-                break;
+    nslots = 2;
+    while (nslots < 2*N)
+        nslots *= 2;
+    heads = malloc(nslots * sizeof(UINT));
+    cells = malloc(2 * nslots * sizeof(int64_t));
+    next = malloc(N * sizeof(UINT));
+    if (heads == NULL || cells == NULL || next == NULL) {
+        free(heads);
+        free(cells);
+        free(next);
+        return E_NOMEM;
+    }
+    for (slot=0; slot<nslots; slot++)
+        heads[slot] = N; // empty
+
+    N_filtered = 0;
+    for (i=0; i<N; i++) {
+
+        // Values that are not finite are never closer than tol to another
+        // value. They are kept, but not stored in the table.
+        if (!isfinite(CREAL(vals[i])) || !isfinite(CIMAG(vals[i]))) {
+            vals[N_filtered++] = vals[i];
+            continue;
         }
-        if (dist < tol)
+
+        ix = cell_index(CREAL(vals[i]), tol);
+        iy = cell_index(CIMAG(vals[i]), tol);
+        keep = 1;
+        for (jx=ix-1; jx<=ix+1 && keep; jx++) {
+            for (jy=iy-1; jy<=iy+1 && keep; jy++) {
+                slot = cell_hash(jx, jy) & (nslots - 1);
+                while (heads[slot] != N && (cells[2*slot] != jx
+                    || cells[2*slot + 1] != jy))
+                    slot = (slot + 1) & (nslots - 1);
+                for (k=heads[slot]; k!=N && keep; k=next[k]) {
+                    if (CABS(vals[k] - vals[i]) < tol)
+                        keep = 0;
+                }
+            }
+        }
+        if (!keep)
             continue;
-           
-        // Keep bound value since it is not close to previous values
-        vals[N_filtered++] = vals[i];
+
+        // Keep value since it is not close to previously kept values
+        vals[N_filtered] = vals[i];
+        slot = cell_hash(ix, iy) & (nslots - 1);
+        while (heads[slot] != N && (cells[2*slot] != ix
+            || cells[2*slot + 1] != iy))
+            slot = (slot + 1) & (nslots - 1);
+        cells[2*slot] = ix;
+        cells[2*slot + 1] = iy;
+        next[N_filtered] = heads[slot];
+        heads[slot] = N_filtered;
+        N_filtered++;
     }
     *N_ptr = N_filtered;
 
+    free(heads);
+    free(cells);
+    free(next);
     return SUCCESS;
 }
 
+// Subsampling factor that misc_downsample uses for D samples
+static UINT downsample_factor(const UINT D)
+{
+    UINT Dsub;
+
+    // The target number of samples of qsub is a power of two that is
+    // close to sqrt(D*log2(D)*log2(D)). The runtime of the fast eigenvalue
+    // root finder is thus O(D*log2(D)*log2(D)) -- this is the complexity
+    // that the algorithm for computing the continuous spectrum needs
+    // anyway (if M==D).
+    Dsub = POW(2.0, CEIL( \
+        0.5 * LOG2(D * LOG2(D) * LOG2(D)) ));
+    if (Dsub <= 2)
+        Dsub = 2;
+    if (D <= Dsub)
+        return 1;
+    return D / Dsub;
+}
+
+UINT misc_downsample_len(const UINT D)
+{
+    // Every subsampling_factor-th sample is kept, starting with the first
+    // one. For powers of two, this results in the target number of
+    // samples. Otherwise, D does not have to be a multiple of the target.
+    return (D - 1)/downsample_factor(D) + 1;
+}
+
 INT misc_downsample(COMPLEX const * const q, const UINT D,
     COMPLEX ** qsub_ptr, UINT * const Dsub_ptr,
     UINT * const subsampling_factor_ptr)
 {
-    UINT i, Dsub, subsampling_factor;
-    COMPLEX * qsub;
+    const samples_t samples = { samples_format_COMPLEX, q, NULL, 1.0 };
 
     if (q == NULL)
         return E_INVALID_ARGUMENT(q);
+    return misc_downsample_samples(&samples, D, qsub_ptr, Dsub_ptr,
+        subsampling_factor_ptr);
+}
+
+INT misc_downsample_samples(samples_t const * const q, const UINT D,
+    COMPLEX ** qsub_ptr, UINT * const Dsub_ptr,
+    UINT * const subsampling_factor_ptr)
+{
+    UINT i, Dsub, subsampling_factor;
+    COMPLEX * qsub;
+    INT ret_code;
+
+    ret_code = misc_samples_check(q);
+    if (ret_code != SUCCESS)
+        return ret_code;
     if (D <= 2)
         return E_INVALID_ARGUMENT(D);
     if (qsub_ptr == NULL)
@@ -272,24 +557,16 @@ INT misc_downsample(COMPLEX const * const q, const UINT D,
     if (subsampling_factor_ptr == NULL)
         return E_INVALID_ARGUMENT(subsampling_factor_ptr);
 
-    // Dsub is the number of samples of qsub. It is is chosen to be a
-    // power of two that is close to sqrt(D*log2(D)*log2(D)). The
-    // runtime of the fast eigenvalue root finder is thus
-    // O(D*log2(D)*log2(D)) -- this is the complexity that the
-    // algorithm for computing the continuous spectrum needs anyway
-    // (if M==D).
-    Dsub = POW(2.0, CEIL( \
-        0.5 * LOG2(D * LOG2(D) * LOG2(D)) ));
-    if (Dsub <= 2)
-        Dsub = 2;
-    subsampling_factor = D / Dsub;
+    subsampling_factor = downsample_factor(D);
+    Dsub = (D - 1)/subsampling_factor + 1;
             
-    // Create the subsampled version of q, qsub
+    // Create the subsampled version of q, qsub. Only the samples that are
+    // kept are converted.
     qsub = malloc(Dsub * sizeof(COMPLEX));
     if (qsub == NULL)
         return E_NOMEM;
     for (i=0; i<Dsub; i++)
-        qsub[i] = q[i * subsampling_factor];
+        qsub[i] = misc_sample(q, i * subsampling_factor);
 
     *qsub_ptr = qsub;
     *Dsub_ptr = Dsub;
@@ -298,6 +575,45 @@ INT misc_downsample(COMPLEX const * const q, const UINT D,
     return SUCCESS;
 }
 
+INT misc_samples_check(samples_t const * const q)
+{
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (q->data == NULL)
+        return E_INVALID_ARGUMENT(q->data);
+    switch (q->format) {
+    case samples_format_COMPLEX:
+    case samples_format_INT16_INTERLEAVED:
+    case samples_format_FLOAT32_INTERLEAVED:
+        break;
+    case samples_format_INT16_SPLIT:
+    case samples_format_FLOAT32_SPLIT:
+        if (q->imag == NULL)
+            return E_INVALID_ARGUMENT(q->imag);
+        break;
+    default:
+        return E_INVALID_ARGUMENT(q->format);
+    }
+    return SUCCESS;
+}
+
+INT misc_samples_to_complex(const UINT D, samples_t const * const q,
+    COMPLEX * const result)
+{
+    UINT i;
+    INT ret_code;
+
+    ret_code = misc_samples_check(q);
+    if (ret_code != SUCCESS)
+        return ret_code;
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+
+    for (i=0; i<D; i++)
+        result[i] = misc_sample(q, i);
+    return SUCCESS;
+}
+
 // Computes sinc(x):= 1 if x=0 and sin(x)/x otherwise. If x is close to 0, the
 // calculation is approximated with sinc(x) = cos(x/sqrt(3)) + O(x^4)
 COMPLEX misc_CSINC(COMPLEX x)
@@ -26,6 +26,7 @@
 #include "fnft__nse_fscatter.h"
 #include "fnft__nse_scatter.h"
 #include "fnft__nse_discretization.h"
+#include "fnft__misc.h"
 
 /**
  * Returns the length (in number of elements) for "result" in nse_fscatter
@@ -46,19 +47,32 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
     COMPLEX * const result, UINT * const deg_ptr,
     INT * const W_ptr, nse_discretization_t discretization)
 {
-    INT i, ret_code;
+    const samples_t samples = { samples_format_COMPLEX, q, NULL, 1.0 };
+
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    return nse_fscatter_samples(D, &samples, eps_t, kappa, result, deg_ptr,
+        W_ptr, discretization);
+}
+
+/**
+ * result needs to be pre-allocated with size 4*(deg+1)*D*sizeof(COMPLEX)
+ */
+INT nse_fscatter_samples(const UINT D, samples_t const * const q,
+    const REAL eps_t, const INT kappa,
+    COMPLEX * const result, UINT * const deg_ptr,
+    INT * const W_ptr, nse_discretization_t discretization)
+{
+    INT ret_code;
     UINT len;
-    COMPLEX *p, *p11, *p12, *p21, *p22;
-    REAL scl;
-    REAL Q_abs;
-    COMPLEX q_arg;
-    COMPLEX qt, rt, B11, B12, B21, B22;
+    COMPLEX *p;
     
     // Check inputs
     if (D == 0)
         return E_INVALID_ARGUMENT(D);
-    if (q == NULL)
-        return E_INVALID_ARGUMENT(q);
+    ret_code = misc_samples_check(q);
+    if (ret_code != SUCCESS)
+        return ret_code;
     if (eps_t <= 0.0)
         return E_INVALID_ARGUMENT(eps_t);
     if (abs(kappa) != 1)
@@ -77,6 +91,123 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
     // degree 1 polynomials
     if (p == NULL)
         return E_NOMEM;
+
+    // Set the individual scattering matrices up
+    ret_code = nse_fscatter_leaves_samples(D, q, eps_t, kappa, p,
+        discretization);
+    CHECK_RETCODE(ret_code, release_mem);
+    
+    // Multiply the individual scattering matrices
+    *deg_ptr = nse_discretization_degree(discretization);
+    if (*deg_ptr == 0) {
+        ret_code = E_INVALID_ARGUMENT(discretization);
+        goto release_mem;
+    }
+    ret_code = poly_fmult2x2_fd(deg_ptr, D, p, result, W_ptr);
+    if (ret_code != SUCCESS)
+        ret_code = E_SUBROUTINE(ret_code);
+    
+    release_mem:
+        free(p);
+        return ret_code;
+}
+
+/**
+ * q has length nsig*D, result needs to be pre-allocated with size
+ * nsig*4*(deg+1)*D*sizeof(COMPLEX)
+ */
+INT nse_fscatter_multi(const UINT nsig, const UINT D,
+    COMPLEX const * const q, const REAL eps_t, const INT kappa,
+    COMPLEX * const result, UINT * const deg_ptr, INT * const W,
+    nse_discretization_t discretization)
+{
+    INT ret_code = SUCCESS;
+    UINT len, t;
+    COMPLEX *p;
+
+    // Check inputs
+    if (nsig == 0)
+        return E_INVALID_ARGUMENT(nsig);
+    if (D == 0)
+        return E_INVALID_ARGUMENT(D);
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (eps_t <= 0.0)
+        return E_INVALID_ARGUMENT(eps_t);
+    if (abs(kappa) != 1)
+        return E_INVALID_ARGUMENT(kappa);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+    if (deg_ptr == NULL)
+        return E_INVALID_ARGUMENT(deg_ptr);
+
+    // Allocate buffers
+    len = nse_fscatter_numel(D, discretization);
+    if (len == 0) // size D>0, this means unknown discretization
+        return E_INVALID_ARGUMENT(discretization);
+    p = malloc(nsig*len*sizeof(COMPLEX));
+    if (p == NULL)
+        return E_NOMEM;
+
+    // Set the individual scattering matrices of all signals up. (The
+    // matrix functions of the samples do not vectorize, so this is done
+    // signal by signal.)
+    for (t=0; t<nsig; t++) {
+        ret_code = nse_fscatter_leaves(D, q + t*D, eps_t, kappa, p + t*len,
+            discretization);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+
+    // Multiply the individual scattering matrices of all signals in
+    // lockstep
+    *deg_ptr = nse_discretization_degree(discretization);
+    ret_code = poly_fmult2x2_multi(deg_ptr, D, nsig, p, result, W);
+    if (ret_code != SUCCESS)
+        ret_code = E_SUBROUTINE(ret_code);
+
+release_mem:
+    free(p);
+    return ret_code;
+}
+
+/**
+ * p needs to be pre-allocated with size 4*(deg+1)*D*sizeof(COMPLEX)
+ */
+INT nse_fscatter_leaves(const UINT D, COMPLEX const * const q,
+    const REAL eps_t, const INT kappa, COMPLEX * const p,
+    nse_discretization_t discretization)
+{
+    const samples_t samples = { samples_format_COMPLEX, q, NULL, 1.0 };
+
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    return nse_fscatter_leaves_samples(D, &samples, eps_t, kappa, p,
+        discretization);
+}
+
+/**
+ * p needs to be pre-allocated with size 4*(deg+1)*D*sizeof(COMPLEX). The
+ * samples are converted while the matrices are set up.
+ */
+INT nse_fscatter_leaves_samples(const UINT D, samples_t const * const q,
+    const REAL eps_t, const INT kappa, COMPLEX * const p,
+    nse_discretization_t discretization)
+{
+    INT i, ret_code;
+    COMPLEX *p11, *p12, *p21, *p22;
+    REAL scl;
+    REAL Q_abs;
+    COMPLEX q_arg;
+    COMPLEX qt, rt, B11, B12, B21, B22;
+
+    // Check inputs
+    if (D == 0)
+        return E_INVALID_ARGUMENT(D);
+    ret_code = misc_samples_check(q);
+    if (ret_code != SUCCESS)
+        return ret_code;
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
     
     switch (discretization) {
         
@@ -88,12 +219,11 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
             p22 = p21 + 2*D;
             for (i=D-1; i>=0; i--) {
                 // compute the scaling factor scl = 1/sqrt(1+kappa*|eps_t*q[i]|^2)
-                scl = eps_t*CABS(q[i]);
+                qt = misc_sample(q, i);
+                scl = eps_t*CABS(qt);
                 if (kappa == -1) {
-                    if (scl >= 1.0) {
-                        ret_code = E_OTHER("kappa == -1 but eps_t*|q[i]|>=1 ... decrease step size");
-                        goto release_mem;
-                    }
+                    if (scl >= 1.0)
+                        return E_OTHER("kappa == -1 but eps_t*|q[i]|>=1 ... decrease step size");
                     scl = 1.0 / ( SQRT(1.0 + scl) * SQRT(1.0 - scl) );
                 } else
                     scl = 1.0 / HYPOT(1.0, scl);
@@ -101,10 +231,10 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
                 // construct the scattering matrix for the i-th sample
                 p11[0] = 0.0;
                 p11[1] = scl;
-                p12[0] = scl*eps_t*q[i];
+                p12[0] = scl*eps_t*qt;
                 p12[1] = 0.0;
                 p21[0] = 0.0;
-                p21[1] = -kappa*scl*eps_t*CONJ(q[i]);
+                p21[1] = -kappa*scl*eps_t*CONJ(qt);
                 p22[0] = scl;
                 p22[1] = 0.0;
                 p11 += 2;
@@ -126,16 +256,16 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
             
             for (i = D-1; i >= 0; i--) {
                 // compute few values
-                qt = q[i];
-                rt = -kappa*CONJ(q[i]);
-                if (qt == 0){
-                    B11 = 1; B12 = 0; B21 = 0; B22 = 1;
-                }else{
-                    B11 = CCOSH(0.25*eps_t*CSQRT(qt)*CSQRT(rt));
-                    B12 = (CSINH(0.25*eps_t*CSQRT(rt*qt))*CSQRT(rt*qt))/rt;
-                    B21 = -kappa * CONJ(B12);
-                    B22 = B11;
-                }
+                qt = misc_sample(q, i);
+                rt = -kappa*CONJ(qt);
+                // B11 = cosh(a*w) and B12 = sinh(a*w)*w/rt
+                // = a*qt*sinh(a*w)/(a*w) with a = 0.25*eps_t and w^2 = qt*rt.
+                // No division by rt is needed, also not for qt = 0.
+                misc_cosh_sinhc(0.25*0.25*eps_t*eps_t*qt*rt, &B11, &B12, NULL,
+                    NULL);
+                B12 *= 0.25*eps_t*qt;
+                B21 = -kappa * CONJ(B12);
+                B22 = B11;
                 // construct the scattering matrix for the i-th sample
                 p11[0] = B11*B11*B11*B11 + (2*B12*B21*B11*B11)/3 - (B12*B12*B21*B21)/3;
                 p11[1] = (8*B12*B21*B11*B11)/3 + (8*B12*B21*B22*B11)/3;
@@ -166,16 +296,16 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
             p22 = p21 + 5*D;
             for (i = D-1; i >= 0; i--) {
                 // compute few values
-                qt = q[i];
-                rt = -kappa*CONJ(q[i]);
-                if (qt == 0){
-                    B11 = 1; B12 = 0; B21 = 0; B22 = 1;
-                }else{
-                    B11 = CCOSH(0.5*eps_t*CSQRT(qt)*CSQRT(rt));
-                    B12 = (CSINH(0.5*eps_t*CSQRT(rt*qt))*CSQRT(rt*qt))/rt;
-                    B21 = -kappa * CONJ(B12);
-                    B22 = B11;
-                }
+                qt = misc_sample(q, i);
+                rt = -kappa*CONJ(qt);
+                // B11 = cosh(a*w) and B12 = sinh(a*w)*w/rt
+                // = a*qt*sinh(a*w)/(a*w) with a = 0.5*eps_t and w^2 = qt*rt.
+                // No division by rt is needed, also not for qt = 0.
+                misc_cosh_sinhc(0.5*0.5*eps_t*eps_t*qt*rt, &B11, &B12, NULL,
+                    NULL);
+                B12 *= 0.5*eps_t*qt;
+                B21 = -kappa * CONJ(B12);
+                B22 = B11;
                 
                 // construct the scattering matrix for the i-th sample
                 p11[0] = B11*B11-(B12*B21)/3;
@@ -220,8 +350,9 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
                 for (i=D-1; i>=0; i--) {
                     
                     // pre-compute a few values
-                    Q_abs = eps_t * CABS(q[i]);
-                    q_arg = CEXP( I * CARG(q[i]) );
+                    qt = misc_sample(q, i);
+                    Q_abs = eps_t * CABS(qt);
+                    q_arg = CEXP( I * CARG(qt) );
                     
                     // construct the scattering matrix for the i-th sample
                     p11[0] = 0.0;
@@ -245,8 +376,9 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
                 for (i=D-1; i>=0; i--) {
                     
                     // pre-compute a few values
-                    Q_abs = eps_t * CABS(q[i]);
-                    q_arg = CEXP( I * CARG(q[i]) );
+                    qt = misc_sample(q, i);
+                    Q_abs = eps_t * CABS(qt);
+                    q_arg = CEXP( I * CARG(qt) );
                     
                     // construct the scattering matrix for the i-th sample
                     p11[0] = 0.0;
@@ -270,21 +402,147 @@ INT nse_fscatter(const UINT D, COMPLEX const * const q,
             
         default: // Unknown discretization
             
-            ret_code = E_INVALID_ARGUMENT(discretization);
-            goto release_mem;
+            return E_INVALID_ARGUMENT(discretization);
     }
-    
-    // Multiply the individual scattering matrices
-    *deg_ptr = nse_discretization_degree(discretization);
-    if (*deg_ptr == 0) {
-        ret_code = E_INVALID_ARGUMENT(discretization);
-        goto release_mem;
+
+    return SUCCESS;
+}
+
+/**
+ * dp_dq and dp_dqc need to be pre-allocated with size 4*(deg+1)*
+ * sizeof(COMPLEX) each.
+ */
+INT nse_fscatter_leaf_derivs(const COMPLEX q, const REAL eps_t,
+    const INT kappa, COMPLEX * const dp_dq, COMPLEX * const dp_dqc,
+    nse_discretization_t discretization)
+{
+    // All schemes are written in terms of r = -kappa*conj(q), which is
+    // treated as a variable independent of q, and x = a^2*q*r for a
+    // scheme-dependent constant a. The coefficients of the entries 11 and
+    // 22 are functions h(x), and those of the entries 12 and 21 are
+    // a*q*h(x) and a*r*h(x), respectively. The tables h and dh contain the
+    // functions h and their derivatives w.r.t. x.
+    COMPLEX h[20], dh[20];
+    COMPLEX r, x, c, dc, s, ds, u, du, g, dg, K, dK_dq, dK_dr, d_dq, d_dr;
+    REAL a;
+    UINT deg, j, l;
+
+    // Check inputs
+    if (dp_dq == NULL)
+        return E_INVALID_ARGUMENT(dp_dq);
+    if (dp_dqc == NULL)
+        return E_INVALID_ARGUMENT(dp_dqc);
+    deg = nse_discretization_degree(discretization);
+    if (deg == 0 || deg > 4)
+        return E_INVALID_ARGUMENT(discretization);
+    for (l=0; l<4*(deg + 1); l++) {
+        h[l] = 0.0;
+        dh[l] = 0.0;
     }
-    ret_code = poly_fmult2x2(deg_ptr, D, p, result, W_ptr);
-    if (ret_code != SUCCESS)
-        ret_code = E_SUBROUTINE(ret_code);
-    
-    release_mem:
-        free(p);
-        return ret_code;
+    r = -kappa*CONJ(q);
+
+    switch (discretization) {
+
+        case nse_discretization_2SPLIT2_MODAL:
+            // h = 1/sqrt(1-x) with a = eps_t
+            a = eps_t;
+            x = a*a*CREAL(q*r); // q*r is real
+            if (CREAL(x) >= 1.0)
+                return E_OTHER("kappa == -1 but eps_t*|q|>=1 ... decrease step size");
+            c = 1.0 / SQRT(1.0 - CREAL(x));
+            dc = 0.5*c*c*c;
+            h[1] = h[2] = h[5] = h[6] = c;
+            dh[1] = dh[2] = dh[5] = dh[6] = dc;
+            break;
+
+        case nse_discretization_2SPLIT2A:
+            // B11 = cosh(a*w) and B12 = a*q*sinh(a*w)/(a*w) with a = eps_t
+            // and w^2 = q*r, see nse_fscatter_leaves
+            a = eps_t;
+            x = a*a*CREAL(q*r);
+            misc_cosh_sinhc(x, &c, &s, &ds, NULL);
+            h[1] = h[6] = c;
+            dh[1] = dh[6] = 0.5*s; // d/dx cosh(sqrt(x)) = s/2
+            h[2] = h[5] = s;
+            dh[2] = dh[5] = ds;
+            break;
+
+        case nse_discretization_2SPLIT4A:
+            // With c = B11 = B22 and u = B12*B21 = x*s^2, the entries are
+            // [c^2-u/3, 0, 4u/3, 0, 0] for 11, 4/3*c*B12*[0, 1, -1/2, 1, 0]
+            // for 12 and the mirrored ones for 22 and 21
+            a = 0.5*eps_t;
+            x = a*a*CREAL(q*r);
+            misc_cosh_sinhc(x, &c, &s, &ds, NULL);
+            dc = 0.5*s;
+            u = x*s*s;
+            du = s*s + 2.0*x*s*ds;
+            h[0] = h[19] = c*c - u/3;
+            dh[0] = dh[19] = 2.0*c*dc - du/3;
+            h[2] = h[17] = 4.0*u/3;
+            dh[2] = dh[17] = 4.0*du/3;
+            g = 4.0*c*s/3;
+            dg = 4.0*(dc*s + c*ds)/3;
+            h[6] = h[8] = h[11] = h[13] = g;
+            dh[6] = dh[8] = dh[11] = dh[13] = dg;
+            h[7] = h[12] = -0.5*g;
+            dh[7] = dh[12] = -0.5*dg;
+            break;
+
+        case nse_discretization_2SPLIT4B:
+            // With c = B11 = B22 and u = B12*B21 = x*s^2, the entries are
+            // [c^4+2/3*u*c^2-u^2/3, 16/3*u*c^2, 4/3*u^2] for 11 and
+            // 2/3*c*(c^2+u)*B12*[1, 4, 1] for 12, and the mirrored ones for
+            // 22 and 21
+            a = 0.25*eps_t;
+            x = a*a*CREAL(q*r);
+            misc_cosh_sinhc(x, &c, &s, &ds, NULL);
+            dc = 0.5*s;
+            u = x*s*s;
+            du = s*s + 2.0*x*s*ds;
+            h[0] = h[11] = c*c*c*c + 2.0*u*c*c/3 - u*u/3;
+            dh[0] = dh[11] = 4.0*c*c*c*dc + 2.0*(du*c*c + 2.0*u*c*dc)/3
+                - 2.0*u*du/3;
+            h[1] = h[10] = 16.0*u*c*c/3;
+            dh[1] = dh[10] = 16.0*(du*c*c + 2.0*u*c*dc)/3;
+            h[2] = h[9] = 4.0*u*u/3;
+            dh[2] = dh[9] = 8.0*u*du/3;
+            g = 2.0*s*c*(c*c + u)/3;
+            dg = 2.0*(ds*c*(c*c + u) + s*dc*(c*c + u)
+                + s*c*(2.0*c*dc + du))/3;
+            h[3] = h[5] = h[6] = h[8] = g;
+            dh[3] = dh[5] = dh[6] = dh[8] = dg;
+            h[4] = h[7] = 4.0*g;
+            dh[4] = dh[7] = 4.0*dg;
+            break;
+
+        default: // Unknown discretization
+
+            return E_INVALID_ARGUMENT(discretization);
+    }
+
+    // Chain rule. Since r = -kappa*conj(q), the derivative w.r.t. conj(q)
+    // is -kappa times the one w.r.t. r.
+    for (j=0; j<4; j++) {
+        K = 1.0;
+        dK_dq = 0.0;
+        dK_dr = 0.0;
+        if (j == 1) {
+            K = a*q;
+            dK_dq = a;
+        } else if (j == 2) {
+            K = a*r;
+            dK_dr = a;
+        }
+        for (l=0; l<=deg; l++) {
+            d_dq = dK_dq*h[j*(deg + 1) + l]
+                + K*dh[j*(deg + 1) + l]*a*a*r;
+            d_dr = dK_dr*h[j*(deg + 1) + l]
+                + K*dh[j*(deg + 1) + l]*a*a*q;
+            dp_dq[j*(deg + 1) + l] = d_dq;
+            dp_dqc[j*(deg + 1) + l] = -kappa*d_dr;
+        }
+    }
+
+    return SUCCESS;
 }
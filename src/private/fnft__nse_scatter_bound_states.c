@@ -21,6 +21,7 @@
 
 #include "fnft__errwarn.h"
 #include "fnft__nse_scatter.h"
+#include "fnft__misc.h"
 #include <stdio.h>
 
 /**
@@ -38,7 +39,7 @@ INT nse_scatter_bound_states(const UINT D, COMPLEX const *const q,
     REAL norm_left, norm_right;
     UINT i0, i1, neig;
     UINT n, c1, c2, c3;
-    COMPLEX l, qn, qnc, ks, k, sum=0, TM[4][4],ch,chi,sh,u1,ud1,ud2;
+    COMPLEX l, qn, qnc, ks, sum=0, TM[4][4],ch,sh,g,u1,ud1,ud2;
     
     // Check inputs
     if (D == 0)
@@ -100,23 +101,22 @@ INT nse_scatter_bound_states(const UINT D, COMPLEX const *const q,
                 for (n = D-1; n >= i0; n--){
                     qn = q[n];
                     qnc = CONJ(qn);
-                    ks = (-(CABS(qn)*CABS(qn))-(l*l));
-                    k = CSQRT(ks);
-                    ch = CCOSH(k*eps_t);
-                    chi = ch/ks;
-                    sh = CSINH(k*eps_t)/k;
+                    ks = -(CREAL(qn)*CREAL(qn) + CIMAG(qn)*CIMAG(qn)) - l*l;
+                    misc_cosh_sinhc(ks*eps_t*eps_t, &ch, &sh, &g, NULL);
+                    sh *= eps_t;
+                    g *= eps_t*eps_t*eps_t;
                     u1 = l*sh*I;
-                    ud1 = eps_t*l*l*chi*I;
-                    ud2 = l*(eps_t*ch-sh)/ks;
+                    ud1 = 2.0*l*l*g*I;
+                    ud2 = 2.0*l*g;
                     
                     U[0][0] = ch-u1;
                     U[0][1] = qn*sh;
                     U[1][0] = -qnc*sh;
                     U[1][1] = ch + u1;
-                    U[2][0] = ud1-(l*eps_t+I+(l*l*I)/ks)*sh;
+                    U[2][0] = ud1-(l*eps_t+I)*sh;
                     U[2][1] = -qn*ud2;
                     U[3][0] = qnc*ud2;
-                    U[3][1] = -ud1-(l*eps_t-I-(l*l*I)/ks)*sh;
+                    U[3][1] = -ud1-(l*eps_t-I)*sh;
                     U[2][2] = ch-u1;
                     U[2][3] = qn*sh;
                     U[3][2] = -qnc*sh;
@@ -144,22 +144,21 @@ INT nse_scatter_bound_states(const UINT D, COMPLEX const *const q,
                         n--;
                         qn = q[n];
                         qnc = CONJ(qn);
-                        ks = (-(CABS(qn)*CABS(qn))-(l*l));
-                        k = CSQRT(ks);
-                        ch = CCOSH(k*eps_t);
-                        chi = ch/ks;
-                        sh = CSINH(k*eps_t)/k;
+                        ks = -(CREAL(qn)*CREAL(qn) + CIMAG(qn)*CIMAG(qn)) - l*l;
+                        misc_cosh_sinhc(ks*eps_t*eps_t, &ch, &sh, &g, NULL);
+                        sh *= eps_t;
+                        g *= eps_t*eps_t*eps_t;
                         u1 = l*sh*I;
-                        ud1 = eps_t*l*l*chi*I;
-                        ud2 = l*(eps_t*ch-sh)/ks;
+                        ud1 = 2.0*l*l*g*I;
+                        ud2 = 2.0*l*g;
                         U[0][0] = ch-u1;
                         U[0][1] = qn*sh;
                         U[1][0] = -qnc*sh;
                         U[1][1] = ch+u1;
-                        U[2][0] = ud1-(l*eps_t+I+(l*l*I)/ks)*sh;
+                        U[2][0] = ud1-(l*eps_t+I)*sh;
                         U[2][1] = -qn*ud2;
                         U[3][0] = qnc*ud2;
-                        U[3][1] = -ud1-(l*eps_t-I-(l*l*I)/ks)*sh;
+                        U[3][1] = -ud1-(l*eps_t-I)*sh;
                         U[2][2] = ch-u1;
                         U[2][3] = qn*sh;
                         U[3][2] = -qnc*sh;
@@ -0,0 +1,348 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdlib.h>
+#include "fnft_config.h"
+#include "fnft__errwarn.h"
+#include "fnft__nse_scatter.h"
+#include "fnft__misc.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Number of values of lambda that are propagated together through the
+// signal by jost_block
+#define JOST_BLOCK 8
+
+typedef struct {
+    UINT D;
+    COMPLEX const *q;
+    REAL const *T;
+    INT kappa;
+    COMPLEX const *lambda;
+    INT right_flag;
+    COMPLEX *result;
+    UINT first; // index of the first value of lambda of the job
+    UINT last; // index after the last value of lambda of the job
+} jost_job_t;
+
+// The BO scheme assumes that q is constant on the intervals
+// [t_n-eps_t/2, t_n+eps_t/2]. The step matrix of each interval is
+// split into two half steps of length h such that the solution is
+// available at the sample times t_n. For constant q, the half step is
+// expm(h*[-j*l, q; -kappa*conj(q), j*l]) = ch*I + sh*[-j*l, q;
+// -kappa*conj(q), j*l], where ch=cosh(k*h), sh=sinh(k*h)/k and
+// k=sqrt(-kappa*|q|^2-l^2). Its inverse is obtained by flipping the
+// sign of sh.
+
+// Auxiliary function: Propagates lambda[k] through the signal.
+static void jost_single(jost_job_t const * const job, const UINT k)
+{
+    const UINT D = job->D;
+    const REAL h = (job->T[1] - job->T[0])/(D - 1)/2;
+    const COMPLEX l = job->lambda[k];
+    COMPLEX * const result = job->result + 2*D*k;
+    UINT n, n0;
+    REAL qn2;
+    COMPLEX qn, qnc, ks, ch, sh, il_sh, x1, x2, v1, v2;
+
+    // Boundary conditions: [exp(-j*l*t); 0] for t -> -infinity (left)
+    // or [0; exp(j*l*t)] for t -> +infinity (right)
+    if (job->right_flag) {
+        x1 = 0.0;
+        x2 = CEXP(I*l*(job->T[1] + h));
+    } else {
+        x1 = CEXP(-I*l*(job->T[0] - h));
+        x2 = 0.0;
+    }
+
+    for (n0 = 0; n0 < D; n0++) {
+        n = job->right_flag ? D - 1 - n0 : n0;
+        qn = job->q[n];
+        qnc = CONJ(qn);
+        qn2 = CREAL(qn)*CREAL(qn) + CIMAG(qn)*CIMAG(qn);
+
+        ks = -job->kappa*qn2 - l*l;
+        misc_cosh_sinhc(ks*h*h, &ch, &sh, NULL, NULL);
+        sh *= h;
+        if (job->right_flag)
+            sh = -sh;
+        il_sh = I*l*sh;
+
+        // Half step to t_n ...
+        v1 = (ch - il_sh)*x1 + qn*sh*x2;
+        v2 = -job->kappa*qnc*sh*x1 + (ch + il_sh)*x2;
+        result[n] = v1;
+        result[D + n] = v2;
+
+        // ... and to the other end of the interval
+        x1 = (ch - il_sh)*v1 + qn*sh*v2;
+        x2 = -job->kappa*qnc*sh*v1 + (ch + il_sh)*v2;
+    }
+}
+
+// Auxiliary function: Propagates lambda[k], ..., lambda[k+JOST_BLOCK-1]
+// together through the signal. The real and imaginary parts are kept in
+// separate arrays and the loops over the block have a fixed length, such
+// that the compiler can vectorize them. The Taylor series of
+// misc_cosh_sinhc is evaluated for the whole block, and the few entries
+// outside of its range are recomputed with misc_cosh_sinhc afterwards.
+static void jost_block(jost_job_t const * const job, const UINT k)
+{
+    // 1/(2m)! and 1/(2m+1)!, see misc_cosh_sinhc
+    static const REAL a_c[10] = { 1.0, 1.0/2, 1.0/24, 1.0/720,
+        1.0/40320, 1.0/3628800, 1.0/479001600, 1.0/87178291200.0,
+        1.0/20922789888000.0, 1.0/6402373705728000.0 };
+    static const REAL a_s[10] = { 1.0, 1.0/6, 1.0/120, 1.0/5040,
+        1.0/362880, 1.0/39916800, 1.0/6227020800.0,
+        1.0/1307674368000.0, 1.0/355687428096000.0,
+        1.0/121645100408832000.0 };
+    const UINT D = job->D;
+    const REAL h = (job->T[1] - job->T[0])/(D - 1)/2;
+    const REAL sgn_h = job->right_flag ? -h : h;
+    const REAL kappa = job->kappa;
+    COMPLEX * const result = job->result + 2*D*k;
+    REAL lr[JOST_BLOCK], li[JOST_BLOCK], l2r[JOST_BLOCK], l2i[JOST_BLOCK];
+    REAL x1r[JOST_BLOCK], x1i[JOST_BLOCK], x2r[JOST_BLOCK], x2i[JOST_BLOCK];
+    REAL v1r[JOST_BLOCK], v1i[JOST_BLOCK], v2r[JOST_BLOCK], v2i[JOST_BLOCK];
+    REAL zr[JOST_BLOCK], zi[JOST_BLOCK], chr[JOST_BLOCK], chi[JOST_BLOCK];
+    REAL shr[JOST_BLOCK], shi[JOST_BLOCK];
+    REAL qr, qi, qn2, t, ar, ai, br, bi, cr, ci, dr, di, ilr, ili;
+    COMPLEX l, x, ch, sh;
+    UINT j, m, n, n0;
+    INT taylor_ok;
+
+    for (j = 0; j < JOST_BLOCK; j++) {
+        l = job->lambda[k + j];
+        lr[j] = CREAL(l);
+        li[j] = CIMAG(l);
+        l2r[j] = lr[j]*lr[j] - li[j]*li[j];
+        l2i[j] = 2*lr[j]*li[j];
+
+        // Boundary conditions, see jost_single
+        if (job->right_flag) {
+            x = CEXP(I*l*(job->T[1] + h));
+            x1r[j] = 0.0;
+            x1i[j] = 0.0;
+            x2r[j] = CREAL(x);
+            x2i[j] = CIMAG(x);
+        } else {
+            x = CEXP(-I*l*(job->T[0] - h));
+            x1r[j] = CREAL(x);
+            x1i[j] = CIMAG(x);
+            x2r[j] = 0.0;
+            x2i[j] = 0.0;
+        }
+    }
+
+    for (n0 = 0; n0 < D; n0++) {
+        n = job->right_flag ? D - 1 - n0 : n0;
+        qr = CREAL(job->q[n]);
+        qi = CIMAG(job->q[n]);
+        qn2 = qr*qr + qi*qi;
+
+        // z = (-kappa*|q|^2-l^2)*h^2 and the Taylor series of cosh(sqrt(z))
+        // and sinh(sqrt(z))/sqrt(z)
+        taylor_ok = 1;
+        for (j = 0; j < JOST_BLOCK; j++) {
+            zr[j] = (-kappa*qn2 - l2r[j])*h*h;
+            zi[j] = -l2i[j]*h*h;
+            taylor_ok &= zr[j]*zr[j] + zi[j]*zi[j] <= 1.0;
+            chr[j] = a_c[9];
+            chi[j] = 0.0;
+            shr[j] = a_s[9];
+            shi[j] = 0.0;
+        }
+        for (m = 9; m-- > 0; ) {
+            for (j = 0; j < JOST_BLOCK; j++) {
+                t = chr[j]*zr[j] - chi[j]*zi[j] + a_c[m];
+                chi[j] = chr[j]*zi[j] + chi[j]*zr[j];
+                chr[j] = t;
+                t = shr[j]*zr[j] - shi[j]*zi[j] + a_s[m];
+                shi[j] = shr[j]*zi[j] + shi[j]*zr[j];
+                shr[j] = t;
+            }
+        }
+        if (!taylor_ok) {
+            for (j = 0; j < JOST_BLOCK; j++) {
+                if (zr[j]*zr[j] + zi[j]*zi[j] <= 1.0)
+                    continue;
+                misc_cosh_sinhc(zr[j] + I*zi[j], &ch, &sh, NULL, NULL);
+                chr[j] = CREAL(ch);
+                chi[j] = CIMAG(ch);
+                shr[j] = CREAL(sh);
+                shi[j] = CIMAG(sh);
+            }
+        }
+
+        for (j = 0; j < JOST_BLOCK; j++) {
+            shr[j] *= sgn_h;
+            shi[j] *= sgn_h;
+
+            // Entries a=ch-j*l*sh, b=q*sh, c=-kappa*conj(q)*sh and
+            // d=ch+j*l*sh of the half step matrix
+            ilr = -(lr[j]*shi[j] + li[j]*shr[j]);
+            ili = lr[j]*shr[j] - li[j]*shi[j];
+            ar = chr[j] - ilr;
+            ai = chi[j] - ili;
+            dr = chr[j] + ilr;
+            di = chi[j] + ili;
+            br = qr*shr[j] - qi*shi[j];
+            bi = qr*shi[j] + qi*shr[j];
+            cr = -kappa*(qr*shr[j] + qi*shi[j]);
+            ci = -kappa*(qr*shi[j] - qi*shr[j]);
+
+            // Half step to t_n ...
+            v1r[j] = ar*x1r[j] - ai*x1i[j] + br*x2r[j] - bi*x2i[j];
+            v1i[j] = ar*x1i[j] + ai*x1r[j] + br*x2i[j] + bi*x2r[j];
+            v2r[j] = cr*x1r[j] - ci*x1i[j] + dr*x2r[j] - di*x2i[j];
+            v2i[j] = cr*x1i[j] + ci*x1r[j] + dr*x2i[j] + di*x2r[j];
+
+            // ... and to the other end of the interval
+            x1r[j] = ar*v1r[j] - ai*v1i[j] + br*v2r[j] - bi*v2i[j];
+            x1i[j] = ar*v1i[j] + ai*v1r[j] + br*v2i[j] + bi*v2r[j];
+            x2r[j] = cr*v1r[j] - ci*v1i[j] + dr*v2r[j] - di*v2i[j];
+            x2i[j] = cr*v1i[j] + ci*v1r[j] + dr*v2i[j] + di*v2r[j];
+        }
+
+        for (j = 0; j < JOST_BLOCK; j++) {
+            result[2*D*j + n] = v1r[j] + I*v1i[j];
+            result[2*D*j + D + n] = v2r[j] + I*v2i[j];
+        }
+    }
+}
+
+// Auxiliary function: Propagates the values of lambda of a job through the
+// signal, in blocks of JOST_BLOCK values as far as possible.
+static void * jost_worker(void * arg)
+{
+    jost_job_t const * const job = arg;
+    UINT k = job->first;
+
+    for (; k + JOST_BLOCK <= job->last; k += JOST_BLOCK)
+        jost_block(job, k);
+    for (; k < job->last; k++)
+        jost_single(job, k);
+    return NULL;
+}
+
+/**
+ * Returns the left or right Jost solutions at the sample times.
+ */
+INT nse_scatter_jost(const UINT D, COMPLEX const * const q,
+    REAL const * const T, const INT kappa, const UINT K,
+    COMPLEX const * const lambda, const INT right_flag,
+    COMPLEX * const result, nse_discretization_t discretization,
+    const INT nthreads)
+{
+    jost_job_t *jobs = NULL;
+    UINT n, t, nblocks;
+    INT ret_code = SUCCESS;
+#ifdef HAVE_PTHREAD
+    pthread_t *threads = NULL;
+    INT *started = NULL;
+    long ncpus;
+#endif
+
+    // Check inputs
+    if (D < 2)
+        return E_INVALID_ARGUMENT(D);
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (T == NULL || T[0] >= T[1])
+        return E_INVALID_ARGUMENT(T);
+    if (abs(kappa) != 1)
+        return E_INVALID_ARGUMENT(kappa);
+    if (K == 0)
+        return SUCCESS;
+    if (lambda == NULL)
+        return E_INVALID_ARGUMENT(lambda);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+    if (discretization != nse_discretization_BO)
+        return E_INVALID_ARGUMENT(discretization);
+
+    // Determine the number of threads. The values of lambda are split into
+    // chunks of whole blocks, so there is no point in more threads than
+    // blocks.
+    nblocks = (K + JOST_BLOCK - 1)/JOST_BLOCK;
+#ifdef HAVE_PTHREAD
+    if (nthreads < 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = ncpus > 0 ? (UINT)ncpus : 1;
+    } else {
+        n = nthreads > 0 ? (UINT)nthreads : 1;
+    }
+    if (n > nblocks)
+        n = nblocks;
+#else
+    (void)nthreads;
+    n = 1;
+#endif
+
+    jobs = malloc(n * sizeof(jost_job_t));
+    if (jobs == NULL)
+        return E_NOMEM;
+    for (t=0; t<n; t++) {
+        jobs[t].D = D;
+        jobs[t].q = q;
+        jobs[t].T = T;
+        jobs[t].kappa = kappa;
+        jobs[t].lambda = lambda;
+        jobs[t].right_flag = right_flag;
+        jobs[t].result = result;
+        jobs[t].first = (t*nblocks/n)*JOST_BLOCK;
+        jobs[t].last = t + 1 < n ? ((t + 1)*nblocks/n)*JOST_BLOCK : K;
+    }
+
+#ifdef HAVE_PTHREAD
+    // The first job is carried out by the calling thread. Jobs for which no
+    // thread can be started are carried out by the calling thread as well.
+    if (n > 1) {
+        threads = malloc(n * sizeof(pthread_t));
+        started = calloc(n, sizeof(INT));
+        if (threads == NULL || started == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        for (t=1; t<n; t++)
+            started[t] = pthread_create(&threads[t], NULL, jost_worker,
+                &jobs[t]) == 0;
+    }
+    jost_worker(&jobs[0]);
+    for (t=1; t<n; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            jost_worker(&jobs[t]);
+    }
+#else
+    jost_worker(&jobs[0]);
+#endif
+
+#ifdef HAVE_PTHREAD
+release_mem:
+    free(threads);
+    free(started);
+#endif
+    free(jobs);
+    return ret_code;
+}
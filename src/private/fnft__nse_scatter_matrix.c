@@ -21,8 +21,19 @@
 
 #include "fnft__errwarn.h"
 #include "fnft__nse_scatter.h"
+#include "fnft__misc.h"
 #include <stdio.h>
 
+// Auxiliary function: C = A*B for 2x2 matrices stored row-wise.
+static inline void mult2x2(COMPLEX const * const A, COMPLEX const * const B,
+    COMPLEX * const C)
+{
+    C[0] = A[0]*B[0] + A[1]*B[2];
+    C[1] = A[0]*B[1] + A[1]*B[3];
+    C[2] = A[2]*B[0] + A[3]*B[2];
+    C[3] = A[2]*B[1] + A[3]*B[3];
+}
+
 /**
  * Returns [S11 S12 S21 S22 S11' S12' S21' S22'] in result 
  * where S = [S11, S12; S21, S22] is the scattering matrix.
@@ -37,10 +48,10 @@ INT nse_scatter_matrix(const UINT D, COMPLEX const * const q,
 {
      
     INT ret_code = SUCCESS;
-    UINT  neig;
-    INT n, c1, c2, c3;
-    COMPLEX l, qn, qnc, ks, k, sum=0, TM[4][4], ch,
-                         chi, sh, u1, ud1, ud2;
+    UINT  neig, j;
+    INT n;
+    COMPLEX l, qn, qnc, ks, ch, sh, g, u1, ud1, ud2;
+    COMPLEX S[4], dS[4], U0[4], U1[4], P[4];
     
     // Check inputs
     if (D == 0)
@@ -62,60 +73,63 @@ INT nse_scatter_matrix(const UINT D, COMPLEX const * const q,
         
         case nse_discretization_BO: // Bofetta-Osborne scheme
             
+            // The 4x4 transfer matrices T = [S, 0; S', S] and step matrices
+            // U = [U0, 0; U1, U0] are block lower triangular. Only the
+            // blocks S and S' are propagated, using T*U = [S*U0, 0;
+            // S'*U0 + S*U1, S*U0]. The nonzero terms are summed in the same
+            // order as in the full 4x4 product.
             for (neig = 0; neig < K; neig++) { // iterate over lambda
                 l = lambda[neig];
                 
-                COMPLEX T[4][4] =
-                    { {1,0,0,0}, {0,1,0,0},{0,0,1,0},{0,0,0,1} };
-                COMPLEX U[4][4] = {{ 0 }};
+                S[0] = 1; S[1] = 0; S[2] = 0; S[3] = 1;
+                for (j = 0; j < 4; j++)
+                    dS[j] = 0;
                
                 for (n = D-1; n >= 0; n--){
                     qn = q[n];
                     qnc = CONJ(qn);
-                    ks = (-kappa * (CABS(qn)*CABS(qn))-(l*l));
-                    k = CSQRT(ks);
-                    ch = CCOSH(k*eps_t);
-                    chi = ch/ks;
-                    sh = CSINH(k*eps_t)/k;
+                    ks = -kappa*(CREAL(qn)*CREAL(qn) + CIMAG(qn)*CIMAG(qn))
+                        - l*l;
+                    // ch = cosh(k*eps_t), sh = sinh(k*eps_t)/k and
+                    // g = d(sh)/d(ks) = (eps_t*ch - sh)/(2*ks) with k^2 = ks
+                    misc_cosh_sinhc(ks*eps_t*eps_t, &ch, &sh, &g, NULL);
+                    sh *= eps_t;
+                    g *= eps_t*eps_t*eps_t;
                     u1 = l*sh*I;
-                    ud1 = eps_t*l*l*chi*I;
-                    ud2 = l*(eps_t*ch-sh)/ks;
+                    ud1 = 2.0*l*l*g*I;
+                    ud2 = 2.0*l*g;
                     
-                    U[0][0] = ch-u1;
-                    U[0][1] = qn*sh;
-                    U[1][0] = -kappa * qnc*sh;
-                    U[1][1] = ch + u1;
-                    U[2][0] = ud1-(l*eps_t+I+(l*l*I)/ks)*sh;
-                    U[2][1] = -qn*ud2;
-                    U[3][0] = kappa * qnc*ud2;
-                    U[3][1] = -ud1-(l*eps_t-I-(l*l*I)/ks)*sh;
-                    U[2][2] = ch-u1;
-                    U[2][3] = qn*sh;
-                    U[3][2] = -kappa * qnc*sh;
-                    U[3][3] = ch+u1;
-                    for (c1 = 0; c1 < 4; c1++) {
-                        for (c2 = 0; c2 < 4; c2++) {
-                            for (c3 = 0; c3 < 4; c3++) {
-                                sum = sum + T[c1][c3]*U[c3][c2];
-                            }
-                            TM[c1][c2] = sum;
-                            sum = 0;
-                        }
-                    }
-                    for (c1 = 0; c1 < 4; c1++) {
-                        for (c2 = 0; c2 < 4; c2++)
-                            T[c1][c2] = TM[c1][c2];
-                    }
+                    U0[0] = ch-u1;
+                    U0[1] = qn*sh;
+                    U0[2] = -kappa * qnc*sh;
+                    U0[3] = ch + u1;
+                    U1[0] = ud1-(l*eps_t+I)*sh;
+                    U1[1] = -qn*ud2;
+                    U1[2] = kappa * qnc*ud2;
+                    U1[3] = -ud1-(l*eps_t-I)*sh;
+
+                    // S' <- S'*U0 + S*U1
+                    P[0] = dS[0]*U0[0] + dS[1]*U0[2] + S[0]*U1[0] + S[1]*U1[2];
+                    P[1] = dS[0]*U0[1] + dS[1]*U0[3] + S[0]*U1[1] + S[1]*U1[3];
+                    P[2] = dS[2]*U0[0] + dS[3]*U0[2] + S[2]*U1[0] + S[3]*U1[2];
+                    P[3] = dS[2]*U0[1] + dS[3]*U0[3] + S[2]*U1[1] + S[3]*U1[3];
+                    for (j = 0; j < 4; j++)
+                        dS[j] = P[j];
+
+                    // S <- S*U0
+                    mult2x2(S, U0, P);
+                    for (j = 0; j < 4; j++)
+                        S[j] = P[j];
                 }
                
-		        result[neig*8] = T[0][0];
-		        result[neig*8 + 1] = T[0][1];
-		        result[neig*8 + 2] = T[1][0];
-		        result[neig*8 + 3] = T[1][1];
-		        result[neig*8 + 4] = T[2][0];
-		        result[neig*8 + 5] = T[2][1];
-		        result[neig*8 + 6] = T[3][0];
-		        result[neig*8 + 7] = T[3][1];
+		        result[neig*8] = S[0];
+		        result[neig*8 + 1] = S[1];
+		        result[neig*8 + 2] = S[2];
+		        result[neig*8 + 3] = S[3];
+		        result[neig*8 + 4] = dS[0];
+		        result[neig*8 + 5] = dS[1];
+		        result[neig*8 + 6] = dS[2];
+		        result[neig*8 + 7] = dS[3];
             }
             break;
             
@@ -125,3 +139,130 @@ INT nse_scatter_matrix(const UINT D, COMPLEX const * const q,
     }
     return ret_code;
 }
+
+// Auxiliary function: Computes c = cosh(k*eps_t) and s = sinh(k*eps_t)/k,
+// where k = sqrt(ks), as well as the derivatives g = ds/dks and
+// h = d^2s/dks^2. The series used by misc_cosh_sinhc for small
+// |ks|*eps_t^2 avoid the cancellation in the closed-form expressions (and
+// s is well-defined for ks=0).
+static inline void bo_kernels(const COMPLEX ks, const REAL eps_t,
+    COMPLEX * const c, COMPLEX * const s, COMPLEX * const g,
+    COMPLEX * const h)
+{
+    const REAL eps_t3 = eps_t*eps_t*eps_t;
+
+    misc_cosh_sinhc(ks*eps_t*eps_t, c, s, g, h);
+    *s *= eps_t;
+    *g *= eps_t3;
+    *h *= eps_t3*eps_t*eps_t;
+}
+
+/**
+ * Returns [S11 S12 S21 S22 S11' S12' S21' S22' S11'' S12'' S21'' S22''] in
+ * result. The step matrices of the BO scheme are U=c*I+s*A with
+ * A=[-j*lam, q; -kappa*conj(q), j*lam], c=cosh(k*eps_t) and
+ * s=sinh(k*eps_t)/k, where k^2=-kappa*|q|^2-lam^2. Their derivatives follow
+ * from the chain rule. The products and their derivatives are propagated
+ * as 2x2 matrices, which needs fewer operations than the 4x4 block
+ * matrices in nse_scatter_matrix.
+ */
+INT nse_scatter_matrix_d2(const UINT D, COMPLEX const * const q,
+    const REAL eps_t, const INT kappa, const UINT K,
+    COMPLEX const * const lambda,
+    COMPLEX * const result, nse_discretization_t discretization)
+{
+    UINT i, n, j;
+    COMPLEX l, qn, ks, dks, c, s, g, h, dc, ds, d2c, d2s;
+    COMPLEX U[4], dU[4], d2U[4], S[4], dS[4], d2S[4], P1[4], P2[4], P3[4];
+
+    // Check inputs
+    if (D == 0)
+        return E_INVALID_ARGUMENT(D);
+    if (q == NULL)
+        return E_INVALID_ARGUMENT(q);
+    if (!(eps_t > 0))
+        return E_INVALID_ARGUMENT(eps_t);
+    if (abs(kappa) != 1)
+        return E_INVALID_ARGUMENT(kappa);
+    if (K == 0)
+        return E_INVALID_ARGUMENT(K);
+    if (lambda == NULL)
+        return E_INVALID_ARGUMENT(lambda);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+    if (discretization != nse_discretization_BO)
+        return E_INVALID_ARGUMENT(discretization);
+
+    for (i = 0; i < K; i++) { // iterate over lambda
+        l = lambda[i];
+        dks = -2.0*l; // d(ks)/dlam, the second derivative is -2
+
+        S[0] = 1.0; S[1] = 0.0; S[2] = 0.0; S[3] = 1.0;
+        for (j = 0; j < 4; j++) {
+            dS[j] = 0.0;
+            d2S[j] = 0.0;
+        }
+
+        for (n = D; n-- > 0; ) {
+            qn = q[n];
+            ks = -kappa*(CREAL(qn)*CREAL(qn) + CIMAG(qn)*CIMAG(qn)) - l*l;
+            bo_kernels(ks, eps_t, &c, &s, &g, &h);
+            dc = 0.5*eps_t*s*dks;
+            ds = g*dks;
+            d2c = 0.5*eps_t*(g*dks*dks - 2.0*s);
+            d2s = h*dks*dks - 2.0*g;
+
+            U[0] = c - I*l*s;
+            U[1] = qn*s;
+            U[2] = -kappa*CONJ(qn)*s;
+            U[3] = c + I*l*s;
+            dU[0] = dc - I*(l*ds + s);
+            dU[1] = qn*ds;
+            dU[2] = -kappa*CONJ(qn)*ds;
+            dU[3] = dc + I*(l*ds + s);
+            d2U[0] = d2c - I*(l*d2s + 2.0*ds);
+            d2U[1] = qn*d2s;
+            d2U[2] = -kappa*CONJ(qn)*d2s;
+            d2U[3] = d2c + I*(l*d2s + 2.0*ds);
+
+            // S'' <- S''*U + 2*S'*U' + S*U''
+            mult2x2(d2S, U, P1);
+            mult2x2(dS, dU, P2);
+            mult2x2(S, d2U, P3);
+            for (j = 0; j < 4; j++)
+                d2S[j] = P1[j] + 2.0*P2[j] + P3[j];
+
+            // S' <- S'*U + S*U'
+            mult2x2(dS, U, P1);
+            mult2x2(S, dU, P2);
+            for (j = 0; j < 4; j++)
+                dS[j] = P1[j] + P2[j];
+
+            // S <- S*U
+            mult2x2(S, U, P1);
+            for (j = 0; j < 4; j++)
+                S[j] = P1[j];
+        }
+
+        for (j = 0; j < 4; j++) {
+            result[12*i + j] = S[j];
+            result[12*i + 4 + j] = dS[j];
+            result[12*i + 8 + j] = d2S[j];
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Returns max(100*EPSILON*(1+|lam|), 1e-3*err), where
+ * err = eps_t^2*(|lam|^2+qmax^2)*(|lam|+qmax)/12 is a heuristic for the
+ * O(eps_t^2) error of the BO scheme.
+ */
+REAL nse_scatter_refine_tol(const REAL eps_t, const REAL qmax,
+    const COMPLEX lam)
+{
+    const REAL l = CABS(lam);
+    const REAL err = eps_t*eps_t*(l*l + qmax*qmax)*(l + qmax)/12.0;
+    const REAL tol = 100*EPSILON*(1.0 + l);
+    return (1e-3*err > tol) ? 1e-3*err : tol;
+}
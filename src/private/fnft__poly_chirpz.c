@@ -34,16 +34,33 @@
 INT poly_chirpz(const UINT deg, COMPLEX const * const p, \
     const COMPLEX A, const COMPLEX W, const UINT M, \
     COMPLEX * const result)
+{
+    return poly_chirpz_multi(deg, p, 1, &A, W, M, result);
+}
+
+/*
+ * result should be of length R*M
+ * for r=1:R, Z = A(r) * W.^-(0:(M-1)); result(r,:) = polyval(p, 1./Z); end
+ * The FFT plans and the FFT of the chirp, which only depend on W, are
+ * shared between the R transforms.
+ */
+INT poly_chirpz_multi(const UINT deg, COMPLEX const * const p, \
+    const UINT R, COMPLEX const * const A, const COMPLEX W, const UINT M, \
+    COMPLEX * const result)
 {
     COMPLEX Z;
     kiss_fft_cpx *Y, *V, *buf;
-    kiss_fft_cfg cfg;
+    kiss_fft_cfg cfg = NULL, cfg_inv = NULL;
     INT ret_code = SUCCESS;
-    UINT n;
+    UINT n, r;
 
     // Check inputs
     if (p == NULL)
         return E_INVALID_ARGUMENT(p);
+    if (R == 0)
+        return E_INVALID_ARGUMENT(R);
+    if (A == NULL)
+        return E_INVALID_ARGUMENT(A);
     if (M == 0)
         return E_INVALID_ARGUMENT(M);
     if (result == NULL)
@@ -53,25 +70,111 @@ INT poly_chirpz(const UINT deg, COMPLEX const * const p, \
     const UINT N = deg + 1;
     const UINT L = kiss_fft_next_fast_size(N + M - 1);
     cfg = kiss_fft_alloc((int)L, 0, NULL, NULL);
+    cfg_inv = kiss_fft_alloc((int)L, 1, NULL, NULL);
     Y = malloc(L * sizeof(kiss_fft_cpx));
     V = malloc(L * sizeof(kiss_fft_cpx));
     buf = malloc(L * sizeof(kiss_fft_cpx));
-    if (cfg == NULL || Y == NULL || V == NULL || buf == NULL) {
+    if (cfg == NULL || cfg_inv == NULL || Y == NULL || V == NULL
+    || buf == NULL) {
         ret_code = E_NOMEM;
         goto release_mem;
     }
 
-    // Setup yn and compute Yr = fft(yn)
-    for (n=0; n<=N-1; n++) {
-        Z = p[deg - n] * CPOW(A, -1.0*n) * CPOW(W, 0.5*n*n);
+    // Setup vn and compute Vr = fft(vn)
+    for (n=0; n<=M-1; n++) {
+        Z = CPOW(W, -0.5*n*n);
         buf[n].r = CREAL(Z);
         buf[n].i = CIMAG(Z);
     }
-    for (n=N; n<L; n++) {
+    for (n=M; n<=L-N; n++) {
         buf[n].r = 0;
         buf[n].i = 0;
     }
-    kiss_fft(cfg, buf, Y);
+    for (n=L-N+1; n<L; n++) {
+         Z = CPOW(W, -0.5*(L - n)*(L - n));
+         buf[n].r = CREAL(Z);
+         buf[n].i = CIMAG(Z);
+    }
+    kiss_fft(cfg, buf, V);
+
+    for (r=0; r<R; r++) {
+
+        // Setup yn and compute Yr = fft(yn)
+        for (n=0; n<=N-1; n++) {
+            Z = p[deg - n] * CPOW(A[r], -1.0*n) * CPOW(W, 0.5*n*n);
+            buf[n].r = CREAL(Z);
+            buf[n].i = CIMAG(Z);
+        }
+        for (n=N; n<L; n++) {
+            buf[n].r = 0;
+            buf[n].i = 0;
+        }
+        kiss_fft(cfg, buf, Y);
+
+        // Multiply V and Y
+        for (n=0; n<L; n++)
+            C_MUL(buf[n], V[n], Y[n]);
+
+        // Compute inverse FFT of the product and store it in Y
+        kiss_fft(cfg_inv, buf, Y);
+
+        // Form the final result
+        for (n=0; n<M; n++)
+            result[r*M + n] = CPOW(W, 0.5*n*n) * (Y[n].r + I*Y[n].i) / L;
+    }
+
+    // Release memory and return
+release_mem:
+    free(cfg);
+    free(cfg_inv);
+    free(Y);
+    free(V);
+    free(buf);
+    return ret_code;
+}
+
+/*
+* result should be of length R*M
+* for r=1:R, Z = A * W.^-(0:(M-1)); result(r,:) = polyval(p(r,:), 1./Z); end
+* The FFT plans, the FFT of the chirp and the chirp factors are shared
+* between the R transforms.
+*/
+INT poly_chirpz_batch(const UINT deg, const UINT R, COMPLEX const * const p,
+    const UINT stride, const COMPLEX A, const COMPLEX W, const UINT M,
+    COMPLEX * const result)
+{
+    COMPLEX Z, *pre = NULL, *post = NULL;
+    COMPLEX const *pr;
+    kiss_fft_cpx *Y = NULL, *V = NULL, *buf = NULL;
+    kiss_fft_cfg cfg = NULL, cfg_inv = NULL;
+    INT ret_code = SUCCESS;
+    UINT n, r;
+
+    // Check inputs
+    if (R == 0)
+        return E_INVALID_ARGUMENT(R);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (M == 0)
+        return E_INVALID_ARGUMENT(M);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+
+    // Allocate memory
+    const UINT N = deg + 1;
+    const UINT L = kiss_fft_next_fast_size(N + M - 1);
+    cfg = kiss_fft_alloc((int)L, 0, NULL, NULL);
+    cfg_inv = kiss_fft_alloc((int)L, 1, NULL, NULL);
+    Y = malloc(L * sizeof(kiss_fft_cpx));
+    V = malloc(L * sizeof(kiss_fft_cpx));
+    buf = malloc(L * sizeof(kiss_fft_cpx));
+    pre = malloc(N * sizeof(COMPLEX));
+    post = malloc(M * sizeof(COMPLEX));
+    if (cfg == NULL || cfg_inv == NULL || Y == NULL || V == NULL
+    || buf == NULL || pre == NULL || post == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
 
     // Setup vn and compute Vr = fft(vn)
     for (n=0; n<=M-1; n++) {
@@ -90,28 +193,47 @@ INT poly_chirpz(const UINT deg, COMPLEX const * const p, \
     }
     kiss_fft(cfg, buf, V);
 
-    // Multiply V and Y
-    for (n=0; n<L; n++)
-        C_MUL(buf[n], V[n], Y[n]);
-    
-    // Compute inverse FFT of the product and store it in V
-    free(cfg);   
-    cfg = kiss_fft_alloc((int)L, 1, NULL, NULL);
-    if (cfg == NULL) {
-        ret_code = E_NOMEM;
-        goto release_mem;
-    }
-    kiss_fft(cfg, buf, V);
-
-    // Form the final result
+    // Chirp factors of yn and of the result
+    for (n=0; n<=N-1; n++)
+        pre[n] = CPOW(A, -1.0*n) * CPOW(W, 0.5*n*n);
     for (n=0; n<M; n++)
-        result[n] = CPOW(W, 0.5*n*n) * (V[n].r + I*V[n].i) / L;
+        post[n] = CPOW(W, 0.5*n*n) / L;
+
+    for (r=0; r<R; r++) {
+        pr = p + r*stride;
+
+        // Setup yn and compute Yr = fft(yn)
+        for (n=0; n<=N-1; n++) {
+            Z = pr[deg - n] * pre[n];
+            buf[n].r = CREAL(Z);
+            buf[n].i = CIMAG(Z);
+        }
+        for (n=N; n<L; n++) {
+            buf[n].r = 0;
+            buf[n].i = 0;
+        }
+        kiss_fft(cfg, buf, Y);
+
+        // Multiply V and Y
+        for (n=0; n<L; n++)
+            C_MUL(buf[n], V[n], Y[n]);
+
+        // Compute inverse FFT of the product and store it in Y
+        kiss_fft(cfg_inv, buf, Y);
+
+        // Form the final result
+        for (n=0; n<M; n++)
+            result[r*M + n] = post[n] * (Y[n].r + I*Y[n].i);
+    }
 
     // Release memory and return
 release_mem:
     free(cfg);
+    free(cfg_inv);
     free(Y);
     free(V);
     free(buf);
+    free(pre);
+    free(post);
     return ret_code;
 }
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fnft__poly_fmult.h"
 #include "kiss_fft.h"
 #include "_kiss_fft_guts.h"
@@ -88,28 +89,38 @@ static INT poly_fmult2(const UINT deg, COMPLEX *p1, \
     return SUCCESS;
 }
 
+// Maximum of max_sq and the squared absolute values of the coefficients
+// of p, which has degree d
+static inline REAL poly_max_sq(const UINT d, COMPLEX const * const p,
+    REAL max_sq)
+{
+    REAL cur_sq;
+    UINT i;
+
+    for (i=0; i<=d; i++) {
+        cur_sq = CREAL(p[i])*CREAL(p[i]) + CIMAG(p[i])*CIMAG(p[i]);
+        max_sq = cur_sq > max_sq ? cur_sq : max_sq;
+    }
+    return max_sq;
+}
+
 static INT poly_rescale(const UINT d, COMPLEX * const p)
 {
     UINT i;
     INT a;
     REAL scl;
-    REAL cur_abs;
-    REAL max_abs = 0.0;
+    REAL max_sq;
 
-    // Find max of absolute values of coefficients
-    max_abs = 0.0;
-    for (i=0; i<=d; i++) {
-        cur_abs = CABS( p[i] );
-        if (cur_abs > max_abs)
-            max_abs = cur_abs;
-    }
+    // Find max of squared absolute values of coefficients (avoids the
+    // square roots in CABS)
+    max_sq = poly_max_sq(d, p, 0.0);
 
     // Return if polynomial is identical to zero
-    if (max_abs == 0.0)
+    if (max_sq == 0.0)
         return 0;
 
     // Otherwise, rescale
-    a = FLOOR( LOG2(max_abs) );
+    a = FLOOR( 0.5*LOG2(max_sq) );
     scl = POW( 2.0, -a );
     for (i=0; i<=d; i++)
         p[i] *= scl;
@@ -117,25 +128,81 @@ static INT poly_rescale(const UINT d, COMPLEX * const p)
     return a;
 }
 
+// Degree of the factors on the highest level of a product tree with n
+// factors of degree deg, i.e., deg*2^(ceil(log2(n))-1). It bounds the
+// degrees of all pairs that are multiplied with poly_fmult2.
+static UINT poly_fmult_top_deg(const UINT deg, const UINT n)
+{
+    UINT m = 1;
+
+    while (2*m < n)
+        m *= 2;
+    return deg*m;
+}
+
+// The products below are computed level by level. On every level, all
+// polynomials have the same degree deg, except possibly the last one whose
+// degree deg_last<=deg is lower. Neighboring polynomials are multiplied
+// pairwise. If the number of polynomials n is odd, the last one is carried
+// over to the next level. The degrees of the polynomials on the next level
+// are thus 2*deg, and either deg+deg_last (n even) or deg_last (n odd) for
+// the last one. The degree of the final product is exact, i.e., n*deg for
+// n factors of degree deg. For powers of two, the tree is balanced.
+
+// Multiplies the polynomial p1 of degree deg with the polynomial p2 of
+// degree deg2<=deg. If deg2<deg, p2 is padded with leading zeros, which
+// does not change it as a polynomial, and the leading zeros of the product
+// are removed. buf then has to provide space for 3*deg+2 elements. The
+// product has deg+deg2+1 coefficients.
+static INT poly_fmult2_uneven(const UINT deg, COMPLEX *p1, const UINT deg2,
+    COMPLEX *p2, COMPLEX *result, COMPLEX * const buf, void *mem,
+    kiss_fft_cfg cfg_fft, kiss_fft_cfg cfg_ifft, INT add_flag)
+{
+    COMPLEX * const p2_pad = buf;
+    COMPLEX * const r_pad = buf + (deg + 1);
+    UINT i;
+    INT ret_code;
+
+    if (deg2 == deg)
+        return poly_fmult2(deg, p1, p2, result, mem, cfg_fft, cfg_ifft,
+            add_flag);
+
+    for (i = 0; i < deg - deg2; i++)
+        p2_pad[i] = 0.0;
+    memcpy(p2_pad + (deg - deg2), p2, (deg2 + 1)*sizeof(COMPLEX));
+    ret_code = poly_fmult2(deg, p1, p2_pad, r_pad, mem, cfg_fft, cfg_ifft, 0);
+    if (ret_code != SUCCESS)
+        return ret_code;
+    if (!add_flag) {
+        memcpy(result, r_pad + (deg - deg2), (deg + deg2 + 1)*sizeof(COMPLEX));
+    } else {
+        for (i = 0; i <= deg + deg2; i++)
+            result[i] += r_pad[deg - deg2 + i];
+    }
+    return SUCCESS;
+}
+
 INT fnft__poly_fmult(UINT * const d, UINT n, COMPLEX * const p, 
     INT * const W_ptr)
 {
-    UINT i, deg, lenmem, len, memneeded, memneeded_buf;
+    UINT i, deg, deg_last, deg2, top_deg, len, memneeded, memneeded_buf;
     void *mem, *mem_fft, *mem_ifft;
-    COMPLEX *p1, *p2, *result;
+    COMPLEX *p1, *p2, *result, *buf;
     kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
     INT W = 0;
-    INT ret_code;
+    INT ret_code = SUCCESS;
 
     // Allocate memory for for calls to poly_fmult2
     deg = *d;
-    lenmem = poly_fmult2_lenmen(deg * n);
-    mem = malloc(lenmem); // contains the memory for the actual data
+    deg_last = deg;
+    top_deg = poly_fmult_top_deg(deg, n);
+    mem = malloc(poly_fmult2_lenmen(top_deg)); // contains the actual data
     // The line below find max number of bytes needed for an (I)FFT config
-    kiss_fft_alloc(poly_fmult2_len(*d * n/2), 0, NULL, &memneeded);
+    kiss_fft_alloc(poly_fmult2_len(top_deg), 0, NULL, &memneeded);
     mem_fft = malloc(memneeded); // memory for FFT configs
     mem_ifft = malloc(memneeded); // memory for IFFT configs
-    if (mem == NULL || mem_fft == NULL || mem_ifft == NULL) {
+    buf = malloc((3*top_deg + 2) * sizeof(COMPLEX)); // for uneven pairs
+    if (mem == NULL || mem_fft == NULL || mem_ifft == NULL || buf == NULL) {
         ret_code = E_NOMEM;
         goto release_mem;
     }
@@ -160,39 +227,45 @@ INT fnft__poly_fmult(UINT * const d, UINT n, COMPLEX * const p,
         result = p;
         
         // Multiply all pairs of polynomials, normalize if desired
-        for (i=0; i<n; i+=2) {
-            ret_code = poly_fmult2(deg, p1, p2, result, mem, cfg_fft,
-                cfg_ifft, 0);
+        for (i=0; i+1<n; i+=2) {
+            deg2 = (i+2 == n) ? deg_last : deg;
+            ret_code = poly_fmult2_uneven(deg, p1, deg2, p2, result, buf,
+                mem, cfg_fft, cfg_ifft, 0);
             CHECK_RETCODE(ret_code, release_mem);
 
             if (W_ptr != NULL)
-                W += poly_rescale(2*deg, result);
+                W += poly_rescale(deg + deg2, result);
 
             p1 += 2*deg + 2;
             p2 += 2*deg + 2;
             result += 2*deg + 1;
         }
 
-        // REAL degrees and half the number of polynomials
+        // Carry the last polynomial over if n is odd, otherwise update the
+        // degree of the last product
+        if (n%2 != 0)
+            memmove(result, p1, (deg_last + 1)*sizeof(COMPLEX));
+        else
+            deg_last += deg;
+
+        // Double degrees and halve the number of polynomials
         deg *= 2;
-        if (n%2 != 0) { // n was no power of two
-            ret_code = E_INVALID_ARGUMENT(n);
-            goto release_mem;
-        }
-        n /= 2;
+        n = (n + 1)/2;
     }
     
     // Set degree of final result, free memory and return w/o error
-    *d = deg;
+    *d = deg_last;
     if (W_ptr != NULL)
         *W_ptr = W;
 release_mem:  
     free(mem);
     free(mem_fft);
     free(mem_ifft);
+    free(buf);
     return ret_code;
 }
 
+
 static INT poly_rescale2x2(const UINT d,
     COMPLEX * const p11,
     COMPLEX * const p12,
@@ -202,32 +275,21 @@ static INT poly_rescale2x2(const UINT d,
     UINT i;
     INT a;
     REAL scl;
-    REAL cur_abs;
-    REAL max_abs = 0.0;
+    REAL max_sq = 0.0;
 
-    // Find max of absolute values of coefficients
-    max_abs = 0.0;
-    for (i=0; i<=d; i++) {
-        cur_abs = CABS( p11[i] );
-        if (cur_abs > max_abs)
-            max_abs = cur_abs;
-        cur_abs = CABS( p12[i] );
-        if (cur_abs > max_abs)
-            max_abs = cur_abs;
-        cur_abs = CABS( p21[i] );
-        if (cur_abs > max_abs)
-            max_abs = cur_abs;
-        cur_abs = CABS( p22[i] );
-        if (cur_abs > max_abs)
-            max_abs = cur_abs;
-    }
+    // Find max of squared absolute values of coefficients (avoids the
+    // square roots in CABS)
+    max_sq = poly_max_sq(d, p11, max_sq);
+    max_sq = poly_max_sq(d, p12, max_sq);
+    max_sq = poly_max_sq(d, p21, max_sq);
+    max_sq = poly_max_sq(d, p22, max_sq);
 
     // Return if polynomials are all identical to zero
-    if (max_abs == 0.0)
+    if (max_sq == 0.0)
         return 0;
 
     // Otherwise, rescale
-    a = FLOOR( LOG2(max_abs) );
+    a = FLOOR( 0.5*LOG2(max_sq) );
     scl = POW( 2.0, -a );
     for (i=0; i<=d; i++) {
         p11[i] *= scl;
@@ -239,38 +301,76 @@ static INT poly_rescale2x2(const UINT d,
     return a;
 }
 
+// Number of coefficients per entry on a level with n 2x2 matrix-valued
+// polynomials of degree deg, the last one of degree deg_last
+static inline UINT poly_fmult2x2_stride(const UINT n, const UINT deg,
+    const UINT deg_last)
+{
+    return (n - 1)*(deg + 1) + deg_last + 1;
+}
+
+// Multiplies the 2x2 matrix-valued polynomial whose entries (0=upper left,
+// 1=upper right, 2=lower left, 3=lower right) are given by l[0],...,l[3]
+// and have degree deg with the one given by r[0],...,r[3] of degree
+// deg2<=deg. The product is stored in out[0],...,out[3]. See
+// poly_fmult2_uneven for buf.
+static INT poly_fmult2x2_node(const UINT deg, COMPLEX * const * const l,
+    const UINT deg2, COMPLEX * const * const r, COMPLEX * const * const out,
+    COMPLEX * const buf, void *mem, kiss_fft_cfg cfg_fft,
+    kiss_fft_cfg cfg_ifft)
+{
+    UINT i, j;
+    INT ret_code;
+
+    for (i = 0; i < 2; i++) { // row of the result
+        for (j = 0; j < 2; j++) { // column of the result
+            ret_code = poly_fmult2_uneven(deg, l[2*i], deg2, r[j],
+                out[2*i+j], buf, mem, cfg_fft, cfg_ifft, 0);
+            if (ret_code != SUCCESS)
+                return ret_code;
+            ret_code = poly_fmult2_uneven(deg, l[2*i+1], deg2, r[2+j],
+                out[2*i+j], buf, mem, cfg_fft, cfg_ifft, 1);
+            if (ret_code != SUCCESS)
+                return ret_code;
+        }
+    }
+    return SUCCESS;
+}
+
 /*
 * length of p = m*m*n*(deg+1)
-* length of result = m*m*(n/2)*(2*deg+1)
+* length of result = m*m*(n*deg + (n+1)/2)
 * WARNING: p is overwritten
 */
 INT fnft__poly_fmult2x2(UINT * const d, UINT n, COMPLEX * const p,
     COMPLEX * const result, INT * const W_ptr)
 {
-    UINT i, deg, lenmem, len, memneeded, memneeded_buf;
+    UINT i, j, deg, deg_last, deg2, top_deg, len, memneeded, memneeded_buf;
+    UINT n_next, deg_next_last, stride, stride_next;
     void *mem, *mem_fft, *mem_ifft;
-    UINT o1, o2, or; // pointer offsets
-    COMPLEX *p11, *p12, *p21, *p22;
-    COMPLEX *r11, *r12, *r21, *r22;
+    COMPLEX *l[4], *r[4], *o[4], *buf;
     kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
     INT W = 0;
-    INT ret_code;
+    INT ret_code = SUCCESS;
 
-    // Setup pointers to the individual polynomials in p
     deg = *d;
-    p11 = p;
-    p12 = p11 + n*(deg+1);
-    p21 = p12 + n*(deg+1);
-    p22 = p21 + n*(deg+1);
-   
+    deg_last = deg;
+    if (n == 1) { // nothing to multiply
+        memcpy(result, p, 4*(deg + 1)*sizeof(COMPLEX));
+        if (W_ptr != NULL)
+            *W_ptr = 0;
+        return SUCCESS;
+    }
+
     // Allocate memory for for calls to poly_fmult2
-    lenmem = poly_fmult2_lenmen(deg * n);
-    mem = malloc(lenmem); // memory for actual data
+    top_deg = poly_fmult_top_deg(deg, n);
+    mem = malloc(poly_fmult2_lenmen(top_deg)); // memory for actual data
     // Find max number of bytes needed for an (I)FFT configuration
-    kiss_fft_alloc(poly_fmult2_len(*d * n/2), 0, NULL, &memneeded);
+    kiss_fft_alloc(poly_fmult2_len(top_deg), 0, NULL, &memneeded);
     mem_fft = malloc(memneeded); // memory for the FFT configs
     mem_ifft = malloc(memneeded); // memory for the IFFT configs
-    if (mem == NULL || mem_fft == NULL || mem_ifft == NULL) {
+    buf = malloc((3*top_deg + 2) * sizeof(COMPLEX)); // for uneven pairs
+    if (mem == NULL || mem_fft == NULL || mem_ifft == NULL || buf == NULL) {
         ret_code = E_NOMEM;
         goto release_mem;
     }
@@ -289,88 +389,1274 @@ INT fnft__poly_fmult2x2(UINT * const d, UINT n, COMPLEX * const p,
             goto release_mem;
         }   
 
-        // Offsets for the current pair of polynomials and their product
-        o1 = 0;
-        o2 = deg + 1;
-        or = 0;
-
-        // Setup pointers to the individual polynomials in result
-        r11 = result;
-        r12 = r11 + (n/2)*(2*deg+1);
-        r21 = r12 + (n/2)*(2*deg+1);
-        r22 = r21 + (n/2)*(2*deg+1);
+        // Layout of the current and of the next level
+        n_next = (n + 1)/2;
+        deg_next_last = (n%2 == 0) ? deg + deg_last : deg_last;
+        stride = poly_fmult2x2_stride(n, deg, deg_last);
+        stride_next = poly_fmult2x2_stride(n_next, 2*deg, deg_next_last);
 
         // Multiply all pairs of polynomials, normalize if desired
-        for (i=0; i<n; i+=2) {
-
-            // Multiply current pair of 2x2 matrix-valued polynomials
-            ret_code = poly_fmult2(deg, p11+o1, p11+o2, r11+or, mem,
-                cfg_fft, cfg_ifft, 0);
+        for (i=0; i+1<n; i+=2) {
+            for (j=0; j<4; j++) {
+                l[j] = p + j*stride + i*(deg + 1);
+                r[j] = l[j] + (deg + 1);
+                o[j] = result + j*stride_next + (i/2)*(2*deg + 1);
+            }
+            deg2 = (i+2 == n) ? deg_last : deg;
+            ret_code = poly_fmult2x2_node(deg, l, deg2, r, o, buf, mem,
+                cfg_fft, cfg_ifft);
             CHECK_RETCODE(ret_code, release_mem);
 
-            ret_code = poly_fmult2(deg, p12+o1, p21+o2, r11+or, mem,
-                cfg_fft, cfg_ifft, 1);
-            CHECK_RETCODE(ret_code, release_mem);
+            // Normalize if desired
+            if (W_ptr != NULL)
+                W += poly_rescale2x2(deg + deg2, o[0], o[1], o[2], o[3]);
+        }
 
-            ret_code = poly_fmult2(deg, p11+o1, p12+o2, r12+or, mem,
-                cfg_fft, cfg_ifft, 0);
-            CHECK_RETCODE(ret_code, release_mem);
+        // Carry the last polynomial over if n is odd
+        if (n%2 != 0) {
+            for (j=0; j<4; j++)
+                memcpy(result + j*stride_next + (n_next - 1)*(2*deg + 1),
+                    p + j*stride + (n - 1)*(deg + 1),
+                    (deg_last + 1)*sizeof(COMPLEX));
+        }
 
-            ret_code = poly_fmult2(deg, p12+o1, p22+o2, r12+or, mem, 
-                cfg_fft, cfg_ifft, 1);
-            CHECK_RETCODE(ret_code, release_mem);
+        // Update degrees and number of polynomials
+        deg *= 2;
+        deg_last = deg_next_last;
+        n = n_next;
 
-            ret_code = poly_fmult2(deg, p21+o1, p11+o2, r21+or, mem,
-                cfg_fft, cfg_ifft, 0);
-            CHECK_RETCODE(ret_code, release_mem);
+        // Prepare for the next iteration
+        if (n>1)
+            memcpy(p, result, 4*stride_next*sizeof(COMPLEX));
+    }
+    
+    // Set degree of final result, free memory and return w/o error
+    *d = deg_last;
+    if (W_ptr != NULL)
+        *W_ptr = W;
+release_mem:
+    free(mem);
+    free(mem_fft);
+    free(mem_ifft);
+    free(buf);
+    return ret_code;
+}
 
-            ret_code = poly_fmult2(deg, p22+o1, p21+o2, r21+or, mem,
-                cfg_fft, cfg_ifft, 1);
-            CHECK_RETCODE(ret_code, release_mem);
 
-            ret_code = poly_fmult2(deg, p21+o1, p12+o2, r22+or, mem,
-                cfg_fft, cfg_ifft, 0);
-            CHECK_RETCODE(ret_code, release_mem);
+// The nodes of the product tree in poly_fmult2x2_fd are represented by their
+// values on a grid of L roots of unity, where L is larger than the degree.
+// The polynomial with the coefficients c_0,...,c_deg (highest power first)
+// is identified with the polynomial c_0+c_1*z+...+c_deg*z^deg, which is
+// compatible with the multiplication of polynomials with different degrees.
+// Before two nodes are multiplied, their values are extended to the grid of
+// 2L roots of unity. The even samples on the finer grid are the samples on
+// the old grid. The odd samples are obtained from the coefficients, which
+// are computed with an IFFT of length L, by an FFT of length L after a
+// multiplication with the twiddle factors tw. (tw[k] also contains the
+// normalization factor 1/L of the IFFT.) Compared to converting the
+// products back to coefficients and transforming them again on every
+// level, this saves about an IFFT/FFT pair per level.
+static void poly_fd_double(const UINT L, kiss_fft_cpx const * const vals,
+    kiss_fft_cpx * const out, kiss_fft_cpx const * const tw,
+    kiss_fft_cpx * const buf0, kiss_fft_cpx * const buf1,
+    kiss_fft_cfg cfg_fft, kiss_fft_cfg cfg_ifft)
+{
+    UINT k;
 
-            ret_code = poly_fmult2(deg, p22+o1, p22+o2, r22+or, mem,
-                cfg_fft, cfg_ifft, 1);
-            CHECK_RETCODE(ret_code, release_mem);
+    kiss_fft(cfg_ifft, vals, buf1);
+    for (k = 0; k < L; k++)
+        C_MUL(buf0[k], buf1[k], tw[k]);
+    kiss_fft(cfg_fft, buf0, buf1);
+    for (k = 0; k < L; k++) {
+        out[2*k] = vals[k];
+        out[2*k + 1] = buf1[k];
+    }
+}
+
+// Values of the polynomial with the coefficients p[0],...,p[deg] on a grid
+// of length len>deg
+static void poly_fd_values(const UINT deg, COMPLEX const * const p,
+    const UINT len, kiss_fft_cpx * const out, kiss_fft_cpx * const buf,
+    kiss_fft_cfg cfg_fft)
+{
+    UINT k;
+
+    for (k = 0; k <= deg; k++) {
+        buf[k].r = CREAL(p[k]);
+        buf[k].i = CIMAG(p[k]);
+    }
+    for (k = deg + 1; k < len; k++) {
+        buf[k].r = 0.0;
+        buf[k].i = 0.0;
+    }
+    kiss_fft(cfg_fft, buf, out);
+}
+
+// Same as poly_rescale2x2 for values in the frequency domain. The entries
+// are stored with the given stride. By Parseval's theorem, the Euclidean
+// norm of the coefficients of an entry is the root mean square of its
+// values. The largest of these norms is normalized, which bounds the
+// coefficients in the same way as in poly_rescale2x2.
+static INT poly_fd_rescale2x2(const UINT len, kiss_fft_cpx * const p,
+    const UINT stride)
+{
+    UINT i, j;
+    INT a;
+    REAL scl, sum, max_sum = 0.0;
+
+    for (j = 0; j < 4; j++) {
+        sum = 0.0;
+        for (i = 0; i < len; i++) {
+            sum += p[j*stride + i].r*p[j*stride + i].r
+                + p[j*stride + i].i*p[j*stride + i].i;
+        }
+        if (sum > max_sum)
+            max_sum = sum;
+    }
+    if (max_sum == 0.0)
+        return 0;
+    a = FLOOR( 0.5*LOG2(max_sum/len) );
+    scl = POW( 2.0, -a );
+    for (j = 0; j < 4; j++) {
+        for (i = 0; i < len; i++)
+            C_MULBYSCALAR(p[j*stride + i], scl);
+    }
+    return a;
+}
+
+/*
+* length of p = 4*n*(deg+1)
+* length of result = 4*(n*deg+1)
+*/
+INT fnft__poly_fmult2x2_fd(UINT * const d, const UINT n,
+    COMPLEX const * const p, COMPLEX * const result, INT * const W_ptr)
+{
+    UINT i, j, k, m, m_next, deg, deg_last, L, L0, memneeded;
+    UINT memneeded_buf, numel, numel_max;
+    void *mem_fft = NULL, *mem_ifft = NULL;
+    kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
+    kiss_fft_cpx *buf0 = NULL, *buf1 = NULL, *tw = NULL, *ext = NULL;
+    kiss_fft_cpx *vals = NULL, *vals_next = NULL, *tmp;
+    kiss_fft_cpx *l[4], *r[4], *o, t1, t2;
+    INT W = 0;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (d == NULL)
+        return E_INVALID_ARGUMENT(d);
+    if (n == 0)
+        return E_INVALID_ARGUMENT(n);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+
+    deg = *d;
+    if (n == 1) { // nothing to multiply
+        memcpy(result, p, 4*(deg + 1)*sizeof(COMPLEX));
+        if (W_ptr != NULL)
+            *W_ptr = 0;
+        return SUCCESS;
+    }
+
+    // The values of the nodes on the level with m nodes are stored on a grid
+    // of length L. Find the maximum number of values per entry on the levels
+    // l>0 and the length L of the grid of the root.
+    L0 = kiss_fft_next_fast_size(deg + 1);
+    numel_max = 0;
+    L = L0;
+    for (m = n; m > 1; m = (m + 1)/2) {
+        L *= 2;
+        numel = ((m + 1)/2)*L;
+        if (numel > numel_max)
+            numel_max = numel;
+    }
+
+    // Allocate memory
+    kiss_fft_alloc(L, 0, NULL, &memneeded);
+    mem_fft = malloc(memneeded);
+    mem_ifft = malloc(memneeded);
+    buf0 = malloc(L * sizeof(kiss_fft_cpx));
+    buf1 = malloc(L * sizeof(kiss_fft_cpx));
+    tw = malloc(L/2 * sizeof(kiss_fft_cpx));
+    ext = malloc(8*L * sizeof(kiss_fft_cpx)); // children on the finer grid
+    vals = malloc(4*numel_max * sizeof(kiss_fft_cpx));
+    vals_next = malloc(4*numel_max * sizeof(kiss_fft_cpx));
+    if (mem_fft == NULL || mem_ifft == NULL || buf0 == NULL || buf1 == NULL
+        || tw == NULL || ext == NULL || vals == NULL || vals_next == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    // Main loop, m is the current number of nodes, deg is their degree
+    // (except for the last one, which has degree deg_last) and L is the
+    // length of the grid of their values. On the first level, the values on
+    // the finer grid are computed directly from the coefficients.
+    m = n;
+    L = L0;
+    deg_last = deg;
+    while (m >= 2) {
+
+        // Create FFT and IFFT config (computes twiddle factors, so reuse)
+        memneeded_buf = memneeded;
+        cfg_fft = kiss_fft_alloc(m == n ? 2*L : L, 0, mem_fft,
+            &memneeded_buf);
+        memneeded_buf = memneeded;
+        cfg_ifft = kiss_fft_alloc(L, 1, mem_ifft, &memneeded_buf);
+        if (cfg_fft == NULL || cfg_ifft == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        for (k = 0; k < L && m != n; k++) {
+            tw[k].r = COS(PI*k/L) / L;
+            tw[k].i = -SIN(PI*k/L) / L;
+        }
+
+        // Multiply all pairs of nodes, carry the last one over if m is odd
+        m_next = (m + 1)/2;
+        for (i = 0; i < m; i += 2) {
+            for (j = 0; j < 4; j++) {
+                o = vals_next + (j*m_next + i/2)*2*L;
+                l[j] = (i + 1 < m) ? ext + j*2*L : o;
+                r[j] = ext + (4 + j)*2*L;
+                if (m == n) { // values from the coefficients
+                    poly_fd_values(deg, p + (j*n + i)*(deg + 1), 2*L, l[j],
+                        buf0, cfg_fft);
+                    if (i + 1 < m)
+                        poly_fd_values(deg, p + (j*n + i + 1)*(deg + 1),
+                            2*L, r[j], buf0, cfg_fft);
+                } else { // values on the finer grid by doubling
+                    poly_fd_double(L, vals + (j*m + i)*L, l[j], tw, buf0,
+                        buf1, cfg_fft, cfg_ifft);
+                    if (i + 1 < m)
+                        poly_fd_double(L, vals + (j*m + i + 1)*L, r[j], tw,
+                            buf0, buf1, cfg_fft, cfg_ifft);
+                }
+            }
+            if (i + 1 == m) // carried over
+                continue;
+
+            // The values of the product are the products of the values
+            for (j = 0; j < 4; j++) {
+                o = vals_next + (j*m_next + i/2)*2*L;
+                for (k = 0; k < 2*L; k++) {
+                    C_MUL(t1, l[j & 2][k], r[j & 1][k]);
+                    C_MUL(t2, l[(j & 2) + 1][k], r[2 + (j & 1)][k]);
+                    C_ADD(o[k], t1, t2);
+                }
+            }
 
             // Normalize if desired
             if (W_ptr != NULL)
-                W += poly_rescale2x2(2*deg, r11+or, r12+or, r21+or, r22+or);
+                W += poly_fd_rescale2x2(2*L, vals_next + (i/2)*2*L,
+                    m_next*2*L);
+        }
 
-            // Move pointers to next pair
-            o1 += 2*deg + 2;
-            o2 += 2*deg + 2;
-            or += 2*deg + 1;
+        // Update degrees, number of nodes and grid length
+        if (m%2 == 0)
+            deg_last += deg;
+        deg *= 2;
+        m = m_next;
+        L *= 2;
+        tmp = vals;
+        vals = vals_next;
+        vals_next = tmp;
+    }
+
+    // Compute the coefficients of the root with IFFTs
+    memneeded_buf = memneeded;
+    cfg_ifft = kiss_fft_alloc(L, 1, mem_ifft, &memneeded_buf);
+    if (cfg_ifft == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    for (j = 0; j < 4; j++) {
+        kiss_fft(cfg_ifft, vals + j*L, buf1);
+        for (k = 0; k <= deg_last; k++)
+            result[j*(deg_last + 1) + k] = (buf1[k].r + I*buf1[k].i)/L;
+    }
+
+    // Set degree of final result, free memory and return w/o error
+    *d = deg_last;
+    if (W_ptr != NULL)
+        *W_ptr = W;
+release_mem:
+    free(mem_fft);
+    free(mem_ifft);
+    free(buf0);
+    free(buf1);
+    free(tw);
+    free(ext);
+    free(vals);
+    free(vals_next);
+    return ret_code;
+}
+
+// Values or coefficients with separate arrays for the real and imaginary
+// parts (re[k] and im[k] instead of interleaved complex numbers)
+typedef struct {
+    REAL *re;
+    REAL *im;
+} poly_fd_vals_t;
+
+// The products in poly_fmult2x2_multi are computed for several sets of
+// factors (e.g., the scattering matrices of several signals) in lockstep.
+// On the lower levels of the trees, where the degrees are small and FFTs
+// do not pay off, the coefficients of all sets are interleaved, i.e., the
+// coefficient c of set t is stored at c*nsets + t with separate arrays for
+// the real and imaginary parts. The products are then computed directly
+// with loops over the sets as the innermost loops, which the compiler
+// vectorizes. On the higher levels, the sets are multiplied one after the
+// other with FFTs whose configurations are shared by all sets.
+#define POLY_FMULT2X2_MULTI_DIRECT_DEG 16
+
+// Computes the next level of the interleaved product trees, see above. The
+// level has m nodes of degree deg (the last one of degree deg_last) and
+// consists of 4*stride coefficients per set, as in poly_fmult2x2. If W is
+// not NULL, the products of the sets t are normalized and W[t] is updated.
+// buf has to provide space for 3*nsets elements.
+static void poly_fmult2x2_multi_direct(const UINT m, const UINT deg,
+    const UINT deg_last, const UINT nsets, const poly_fd_vals_t p,
+    const poly_fd_vals_t result, INT * const W, REAL * const buf)
+{
+    const UINT m_next = (m + 1)/2;
+    const UINT stride = poly_fmult2x2_stride(m, deg, deg_last);
+    const UINT stride_next = poly_fmult2x2_stride(m_next, 2*deg,
+        (m%2 == 0) ? deg + deg_last : deg_last);
+    REAL * const max_sq = buf;
+    REAL * const scl = buf + nsets;
+    REAL * const sq = buf + 2*nsets;
+    UINT i, j, a, b, k, t, deg2;
+    INT e;
+
+    for (i = 0; i < m; i += 2) {
+
+        // Carry the last node over if m is odd
+        if (i + 1 == m) {
+            for (j = 0; j < 4; j++) {
+                memcpy(result.re + (j*stride_next + (i/2)*(2*deg + 1))*nsets,
+                    p.re + (j*stride + i*(deg + 1))*nsets,
+                    (deg_last + 1)*nsets*sizeof(REAL));
+                memcpy(result.im + (j*stride_next + (i/2)*(2*deg + 1))*nsets,
+                    p.im + (j*stride + i*(deg + 1))*nsets,
+                    (deg_last + 1)*nsets*sizeof(REAL));
+            }
+            break;
         }
+        deg2 = (i + 2 == m) ? deg_last : deg;
 
-        // Update degrees and number of polynomials
+        // Entry j of the product is l[2*(j/2)]*r[j%2] + l[2*(j/2)+1]*r[2+j%2]
+        for (j = 0; j < 4; j++) {
+            REAL * const o_re = result.re
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            REAL * const o_im = result.im
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            memset(o_re, 0, (deg + deg2 + 1)*nsets*sizeof(REAL));
+            memset(o_im, 0, (deg + deg2 + 1)*nsets*sizeof(REAL));
+            for (k = 0; k < 2; k++) {
+                REAL const * const l_re = p.re
+                    + (((j & 2) + k)*stride + i*(deg + 1))*nsets;
+                REAL const * const l_im = p.im
+                    + (((j & 2) + k)*stride + i*(deg + 1))*nsets;
+                REAL const * const r_re = p.re
+                    + ((2*k + (j & 1))*stride + (i + 1)*(deg + 1))*nsets;
+                REAL const * const r_im = p.im
+                    + ((2*k + (j & 1))*stride + (i + 1)*(deg + 1))*nsets;
+                for (a = 0; a <= deg; a++) {
+                    for (b = 0; b <= deg2; b++) {
+                        REAL * const restrict y_re = o_re + (a + b)*nsets;
+                        REAL * const restrict y_im = o_im + (a + b)*nsets;
+                        REAL const * const restrict x1_re = l_re + a*nsets;
+                        REAL const * const restrict x1_im = l_im + a*nsets;
+                        REAL const * const restrict x2_re = r_re + b*nsets;
+                        REAL const * const restrict x2_im = r_im + b*nsets;
+                        for (t = 0; t < nsets; t++) {
+                            y_re[t] += x1_re[t]*x2_re[t] - x1_im[t]*x2_im[t];
+                            y_im[t] += x1_re[t]*x2_im[t] + x1_im[t]*x2_re[t];
+                        }
+                    }
+                }
+            }
+        }
+
+        // Normalize if desired, see poly_rescale2x2
+        if (W == NULL)
+            continue;
+        for (t = 0; t < nsets; t++)
+            max_sq[t] = 0.0;
+        for (j = 0; j < 4; j++) {
+            REAL const * const o_re = result.re
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            REAL const * const o_im = result.im
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            for (k = 0; k < (deg + deg2 + 1)*nsets; k += nsets) {
+                for (t = 0; t < nsets; t++) {
+                    sq[t] = o_re[k + t]*o_re[k + t] + o_im[k + t]*o_im[k + t];
+                    max_sq[t] = sq[t] > max_sq[t] ? sq[t] : max_sq[t];
+                }
+            }
+        }
+        for (t = 0; t < nsets; t++) {
+            scl[t] = 1.0;
+            if (max_sq[t] > 0.0) {
+                e = FLOOR( 0.5*LOG2(max_sq[t]) );
+                scl[t] = POW( 2.0, -e );
+                W[t] += e;
+            }
+        }
+        for (j = 0; j < 4; j++) {
+            REAL * const o_re = result.re
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            REAL * const o_im = result.im
+                + (j*stride_next + (i/2)*(2*deg + 1))*nsets;
+            for (k = 0; k < (deg + deg2 + 1)*nsets; k += nsets) {
+                for (t = 0; t < nsets; t++) {
+                    o_re[k + t] *= scl[t];
+                    o_im[k + t] *= scl[t];
+                }
+            }
+        }
+    }
+}
+
+// Multiplies the 2x2 matrix-valued polynomials l of degree deg and r of
+// degree deg2<=deg with FFTs of length len>deg+deg2, where the entries e of
+// l, r and the product o are stored at l + e*stride etc. (The coefficients
+// are stored with the highest power first, so that the coefficients of the
+// product are the linear convolutions of those of the factors, also for
+// deg2<deg.) buf has to provide space for 10*len elements.
+static void poly_fmult2x2_multi_fft(const UINT deg, COMPLEX const * const l,
+    const UINT deg2, COMPLEX const * const r, const UINT stride,
+    COMPLEX * const o, const UINT stride_next, const UINT len,
+    kiss_fft_cfg cfg_fft, kiss_fft_cfg cfg_ifft, kiss_fft_cpx * const buf)
+{
+    kiss_fft_cpx * const in = buf;
+    kiss_fft_cpx * const out = buf + len;
+    kiss_fft_cpx * const vals = buf + 2*len; // 4 entries of l, then r
+    kiss_fft_cpx x, y;
+    UINT j, k;
+
+    for (j = 0; j < 8; j++) {
+        COMPLEX const * const c = (j < 4) ? l + j*stride : r + (j - 4)*stride;
+        const UINT d = (j < 4) ? deg : deg2;
+        for (k = 0; k <= d; k++) {
+            in[k].r = CREAL(c[k]);
+            in[k].i = CIMAG(c[k]);
+        }
+        for (k = d + 1; k < len; k++) {
+            in[k].r = 0;
+            in[k].i = 0;
+        }
+        kiss_fft(cfg_fft, in, vals + j*len);
+    }
+    for (j = 0; j < 4; j++) {
+        kiss_fft_cpx const * const l1 = vals + (j & 2)*len;
+        kiss_fft_cpx const * const l2 = vals + ((j & 2) + 1)*len;
+        kiss_fft_cpx const * const r1 = vals + (4 + (j & 1))*len;
+        kiss_fft_cpx const * const r2 = vals + (6 + (j & 1))*len;
+        for (k = 0; k < len; k++) {
+            C_MUL(x, l1[k], r1[k]);
+            C_MUL(y, l2[k], r2[k]);
+            C_ADD(in[k], x, y);
+        }
+        kiss_fft(cfg_ifft, in, out);
+        for (k = 0; k <= deg + deg2; k++)
+            o[j*stride_next + k] = (out[k].r + I*out[k].i)/len;
+    }
+}
+
+/*
+* length of p = nsets*4*n*(deg+1)
+* length of result = nsets*4*(n*deg+1)
+*/
+INT fnft__poly_fmult2x2_multi(UINT * const d, const UINT n,
+    const UINT nsets, COMPLEX const * const p, COMPLEX * const result,
+    INT * const W)
+{
+    UINT i, j, k, t, m, m_next, deg, deg2, deg_last, deg_next_last;
+    UINT deg_direct, deg_direct_last, m_direct, stride, stride_next;
+    UINT numel, len, len_max, nlevels = 0, lev;
+    kiss_fft_cfg *cfgs = NULL;
+    kiss_fft_cpx *fft_buf = NULL;
+    COMPLEX *buf = NULL, *cur, *next, *o;
+    REAL *mem = NULL;
+    poly_fd_vals_t vals, vals_next, tmp;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (d == NULL)
+        return E_INVALID_ARGUMENT(d);
+    if (n == 0)
+        return E_INVALID_ARGUMENT(n);
+    if (nsets == 0)
+        return E_INVALID_ARGUMENT(nsets);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+
+    // Allocate memory for the interleaved levels
+    deg = *d;
+    numel = 4*n*(deg + 1); // coefficients per set on the first level
+    mem = malloc((4*numel + 3)*nsets * sizeof(REAL));
+    if (mem == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    vals.re = mem;
+    vals.im = vals.re + numel*nsets;
+    vals_next.re = vals.im + numel*nsets;
+    vals_next.im = vals_next.re + numel*nsets;
+
+    // Interleave the coefficients of the sets
+    for (t = 0; t < nsets; t++) {
+        for (k = 0; k < numel; k++) {
+            vals.re[k*nsets + t] = CREAL(p[t*numel + k]);
+            vals.im[k*nsets + t] = CIMAG(p[t*numel + k]);
+        }
+    }
+    if (W != NULL) {
+        for (t = 0; t < nsets; t++)
+            W[t] = 0;
+    }
+
+    // Compute the lower levels directly. m is the current number of nodes,
+    // deg is their degree (except for the last one, which has degree
+    // deg_last).
+    m = n;
+    deg_last = deg;
+    while (m >= 2 && deg < POLY_FMULT2X2_MULTI_DIRECT_DEG) {
+        poly_fmult2x2_multi_direct(m, deg, deg_last, nsets, vals, vals_next,
+            W, mem + 4*numel*nsets);
+        if (m%2 == 0)
+            deg_last += deg;
         deg *= 2;
-        if (n%2 != 0) {
-            ret_code = E_INVALID_ARGUMENT(n); // n was no power of two
+        m = (m + 1)/2;
+        tmp = vals;
+        vals = vals_next;
+        vals_next = tmp;
+    }
+    m_direct = m;
+    deg_direct = deg;
+    deg_direct_last = deg_last;
+
+    // Create the FFT and IFFT configurations for the higher levels, which
+    // are shared by all sets
+    len_max = 0;
+    for (m = m_direct, deg = deg_direct; m >= 2; m = (m + 1)/2, deg *= 2) {
+        nlevels++;
+        len_max = poly_fmult2_len(deg);
+    }
+    if (nlevels > 0) {
+        cfgs = calloc(2*nlevels, sizeof(kiss_fft_cfg));
+        fft_buf = malloc(10*len_max * sizeof(kiss_fft_cpx));
+        buf = malloc(2*numel * sizeof(COMPLEX));
+        if (cfgs == NULL || fft_buf == NULL || buf == NULL) {
+            ret_code = E_NOMEM;
             goto release_mem;
         }
-        n /= 2;
+        lev = 0;
+        for (m = m_direct, deg = deg_direct; m >= 2; m = (m + 1)/2,
+            deg *= 2) {
+            len = poly_fmult2_len(deg);
+            cfgs[2*lev] = kiss_fft_alloc(len, 0, NULL, NULL);
+            cfgs[2*lev + 1] = kiss_fft_alloc(len, 1, NULL, NULL);
+            if (cfgs[2*lev] == NULL || cfgs[2*lev + 1] == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+            lev++;
+        }
+    }
 
-        // Prepare for the next iteration
-        if (n>1) {
-            memcpy(p11, r11, n*(deg+1)*sizeof(COMPLEX));
-            memcpy(p12, r12, n*(deg+1)*sizeof(COMPLEX));
-            memcpy(p21, r21, n*(deg+1)*sizeof(COMPLEX));
-            memcpy(p22, r22, n*(deg+1)*sizeof(COMPLEX));
+    // Compute the higher levels of the sets one after the other
+    for (t = 0; t < nsets; t++) {
+        m = m_direct;
+        deg = deg_direct;
+        deg_last = deg_direct_last;
+        stride = poly_fmult2x2_stride(m, deg, deg_last);
+        if (m == 1) { // nothing left to multiply
+            for (k = 0; k < 4*stride; k++) {
+                result[t*4*stride + k] = vals.re[k*nsets + t]
+                    + I*vals.im[k*nsets + t];
+            }
+            continue;
+        }
+        cur = buf;
+        for (k = 0; k < 4*stride; k++)
+            cur[k] = vals.re[k*nsets + t] + I*vals.im[k*nsets + t];
+
+        for (lev = 0; m >= 2; lev++) {
+            m_next = (m + 1)/2;
+            deg_next_last = (m%2 == 0) ? deg + deg_last : deg_last;
+            stride_next = poly_fmult2x2_stride(m_next, 2*deg, deg_next_last);
+            len = poly_fmult2_len(deg);
+
+            // The root is stored in the result
+            next = (m_next == 1) ? result + t*4*stride_next
+                : (cur == buf ? buf + numel : buf);
+
+            // Multiply all pairs of nodes, normalize if desired
+            for (i = 0; i + 1 < m; i += 2) {
+                deg2 = (i + 2 == m) ? deg_last : deg;
+                o = next + (i/2)*(2*deg + 1);
+                poly_fmult2x2_multi_fft(deg, cur + i*(deg + 1), deg2,
+                    cur + (i + 1)*(deg + 1), stride, o, stride_next, len,
+                    cfgs[2*lev], cfgs[2*lev + 1], fft_buf);
+                if (W != NULL)
+                    W[t] += poly_rescale2x2(deg + deg2, o, o + stride_next,
+                        o + 2*stride_next, o + 3*stride_next);
+            }
+
+            // Carry the last node over if m is odd
+            if (m%2 != 0) {
+                for (j = 0; j < 4; j++)
+                    memcpy(next + j*stride_next + (m_next - 1)*(2*deg + 1),
+                        cur + j*stride + (m - 1)*(deg + 1),
+                        (deg_last + 1)*sizeof(COMPLEX));
+            }
+
+            // Update degrees and number of nodes
+            deg *= 2;
+            deg_last = deg_next_last;
+            m = m_next;
+            stride = stride_next;
+            cur = next;
         }
     }
-    
+
     // Set degree of final result, free memory and return w/o error
-    *d = deg;
+    *d = n*(*d);
+release_mem:
+    if (cfgs != NULL) {
+        for (lev = 0; lev < 2*nlevels; lev++)
+            free(cfgs[lev]);
+    }
+    free(cfgs);
+    free(fft_buf);
+    free(buf);
+    free(mem);
+    return ret_code;
+}
+
+/*
+* length of p1 = 4*(deg1+1), length of p2 = 4*(deg2+1)
+* length of result = 4*(deg1+deg2+1)
+*/
+INT fnft__poly_fmult2x2_pair(const UINT deg1, COMPLEX const * const p1,
+    const UINT deg2, COMPLEX const * const p2, COMPLEX * const result,
+    INT * const W_ptr)
+{
+    UINT i, j, deg, len, offset, memneeded;
+    void *mem = NULL, *mem_fft = NULL, *mem_ifft = NULL;
+    COMPLEX *buf = NULL, *q1, *q2, *r;
+    kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (p1 == NULL)
+        return E_INVALID_ARGUMENT(p1);
+    if (p2 == NULL)
+        return E_INVALID_ARGUMENT(p2);
+    if (result == NULL)
+        return E_INVALID_ARGUMENT(result);
+
+    // Both factors are padded to the same degree by prepending zeros to
+    // their coefficients, which does not change them as polynomials. The
+    // product then starts with deg-deg1 + deg-deg2 zero coefficients that
+    // are removed at the end.
+    deg = deg1 > deg2 ? deg1 : deg2;
+    offset = 2*deg - (deg1 + deg2);
+    buf = malloc((8*(deg+1) + 4*(2*deg+1)) * sizeof(COMPLEX));
+    len = poly_fmult2_len(deg);
+    mem = malloc(poly_fmult2_lenmen(deg));
+    kiss_fft_alloc(len, 0, NULL, &memneeded);
+    mem_fft = malloc(memneeded);
+    mem_ifft = malloc(memneeded);
+    if (buf == NULL || mem == NULL || mem_fft == NULL || mem_ifft == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    cfg_fft = kiss_fft_alloc(len, 0, mem_fft, &memneeded);
+    cfg_ifft = kiss_fft_alloc(len, 1, mem_ifft, &memneeded);
+    if (cfg_fft == NULL || cfg_ifft == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    // Pad the factors
+    q1 = buf;
+    q2 = q1 + 4*(deg+1);
+    r = q2 + 4*(deg+1);
+    for (j=0; j<4; j++) {
+        for (i=0; i<deg-deg1; i++)
+            q1[j*(deg+1) + i] = 0.0;
+        memcpy(q1 + j*(deg+1) + (deg-deg1), p1 + j*(deg1+1),
+            (deg1+1)*sizeof(COMPLEX));
+        for (i=0; i<deg-deg2; i++)
+            q2[j*(deg+1) + i] = 0.0;
+        memcpy(q2 + j*(deg+1) + (deg-deg2), p2 + j*(deg2+1),
+            (deg2+1)*sizeof(COMPLEX));
+    }
+
+    // Multiply the two 2x2 matrix-valued polynomials
+    for (i=0; i<2; i++) { // row of the result
+        for (j=0; j<2; j++) { // column of the result
+            ret_code = poly_fmult2(deg, q1 + (2*i)*(deg+1),
+                q2 + j*(deg+1), r + (2*i+j)*(2*deg+1), mem, cfg_fft,
+                cfg_ifft, 0);
+            CHECK_RETCODE(ret_code, release_mem);
+            ret_code = poly_fmult2(deg, q1 + (2*i+1)*(deg+1),
+                q2 + (2+j)*(deg+1), r + (2*i+j)*(2*deg+1), mem, cfg_fft,
+                cfg_ifft, 1);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+    }
+
+    // Remove the leading zeros and normalize if desired
+    for (j=0; j<4; j++)
+        memcpy(result + j*(deg1+deg2+1), r + j*(2*deg+1) + offset,
+            (deg1+deg2+1)*sizeof(COMPLEX));
     if (W_ptr != NULL)
-        *W_ptr = W;
+        *W_ptr = poly_rescale2x2(deg1+deg2, result,
+            result + (deg1+deg2+1), result + 2*(deg1+deg2+1),
+            result + 3*(deg1+deg2+1));
+
 release_mem:
+    free(buf);
     free(mem);
     free(mem_fft);
     free(mem_ifft);
     return ret_code;
 }
 
+/*
+* result[i] = sum_j g[i+j]*conj(p[j]), where the length of g is 2*deg+1 and
+* the lengths of p and result are deg+1. This is the adjoint of the
+* multiplication with p that is performed in poly_fmult2.
+*/
+static INT poly_fcorr2(const UINT deg, COMPLEX *g, COMPLEX *p,
+    COMPLEX *result, void *mem, kiss_fft_cfg cfg_fft, kiss_fft_cfg cfg_ifft,
+    INT add_flag)
+{
+    UINT i, len;
+    kiss_fft_cpx *buf0, *buf1, *buf2;
+
+    // Prepare buffers
+    len = poly_fmult2_len(deg);
+    buf0 = (kiss_fft_cpx *)mem;
+    buf1 = buf0 + len;
+    buf2 = buf1 + len;
+
+    // FFT of g
+    for (i = 0; i < 2*deg + 1; i++) {
+        buf0[i].r = creal(g[i]);
+        buf0[i].i = cimag(g[i]);
+    }
+    for (i = 2*deg + 1; i < len; i++) {
+        buf0[i].r = 0;
+        buf0[i].i = 0;
+    }
+    kiss_fft(cfg_fft, buf0, buf1);
+
+    // FFT of the reversed and conjugated coefficients of p
+    for (i = 0; i <= deg; i++) {
+        buf0[i].r = creal(p[deg - i]);
+        buf0[i].i = -cimag(p[deg - i]);
+    }
+    for (i = deg + 1; i < len; i++) {
+        buf0[i].r = 0;
+        buf0[i].i = 0;
+    }
+    kiss_fft(cfg_fft, buf0, buf2);
+
+    // Inverse FFT of product. Since len >= 2*deg+1, the entries deg,...,2*deg
+    // of the circular convolution are not affected by aliasing.
+    for (i = 0; i < len; i++)
+        C_MUL(buf0[i], buf1[i], buf2[i]);
+    kiss_fft(cfg_ifft, buf0, buf1);
+
+    // Extract result
+    if (!add_flag) {
+        for (i = 0; i <= deg; i++)
+            result[i] = buf1[deg + i].r/len + I*buf1[deg + i].i/len;
+    } else {
+        for (i = 0; i <= deg; i++)
+            result[i] += buf1[deg + i].r/len + I*buf1[deg + i].i/len;
+    }
+
+    return SUCCESS;
+}
+
+/*
+* Level l of the tree contains m[l] nodes. The nodes on level 0 are the
+* factors. The i-th node on level l>0 is the product of the nodes 2*i (left
+* factor) and 2*i+1 (right factor) on level l-1, or a copy of the node 2*i
+* if it is the last node on level l-1 (odd-carry, see poly_fmult2x2). All
+* nodes on level l have degree deg[l], except the last one whose degree is
+* deg_last[l]. Each level is stored as the input p of poly_fmult2x2, with
+* stride[l] coefficients per entry. W[l][i] is the exponent of the
+* normalization factor of the i-th node on level l, which includes the
+* normalization factors of its children.
+*/
+struct fnft__poly_fmult2x2_tree_s {
+    UINT n;
+    UINT nlevels;
+    UINT *m;
+    UINT *deg;
+    UINT *deg_last;
+    UINT *stride;
+    COMPLEX **levels;
+    INT **W;
+    INT normalization_flag;
+};
+
+// Pointer to the coefficients of the entry e (0=upper left, 1=upper right,
+// 2=lower left, 3=lower right) of the i-th node on level l
+static inline COMPLEX * tree_node(fnft__poly_fmult2x2_tree_t * const tree,
+    const UINT l, const UINT i, const UINT e)
+{
+    return tree->levels[l] + e*tree->stride[l] + i*(tree->deg[l] + 1);
+}
+
+// Degree of the i-th node on level l
+static inline UINT tree_node_deg(fnft__poly_fmult2x2_tree_t const * const tree,
+    const UINT l, const UINT i)
+{
+    return (i + 1 == tree->m[l]) ? tree->deg_last[l] : tree->deg[l];
+}
+
+// Recomputes the nodes of the tree. If dirty != NULL, only the nodes on the
+// paths from the factors i with dirty[i] != 0 to the root are recomputed.
+// The array dirty is overwritten.
+static INT tree_compute(fnft__poly_fmult2x2_tree_t * const tree,
+    char * const dirty)
+{
+    UINT i, j, l, d, d2, len, memneeded, memneeded_buf;
+    void *mem = NULL, *mem_fft = NULL, *mem_ifft = NULL;
+    kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
+    COMPLEX *lp[4], *rp[4], *op[4], *buf = NULL;
+    INT W;
+    INT ret_code = SUCCESS;
+
+    if (tree->nlevels < 2)
+        return SUCCESS;
+
+    // Allocate memory for the calls to poly_fmult2
+    d = tree->deg[tree->nlevels - 2];
+    mem = malloc(poly_fmult2_lenmen(d));
+    kiss_fft_alloc(poly_fmult2_len(d), 0, NULL, &memneeded);
+    mem_fft = malloc(memneeded);
+    mem_ifft = malloc(memneeded);
+    buf = malloc((3*d + 2) * sizeof(COMPLEX));
+    if (mem == NULL || mem_fft == NULL || mem_ifft == NULL || buf == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    for (l = 1; l < tree->nlevels; l++) {
+
+        // Create FFT and IFFT config for the degree of the children
+        d = tree->deg[l - 1];
+        len = poly_fmult2_len(d);
+        memneeded_buf = memneeded;
+        cfg_fft = kiss_fft_alloc(len, 0, mem_fft, &memneeded_buf);
+        memneeded_buf = memneeded;
+        cfg_ifft = kiss_fft_alloc(len, 1, mem_ifft, &memneeded_buf);
+        if (cfg_fft == NULL || cfg_ifft == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+
+        for (i = 0; i < tree->m[l]; i++) {
+
+            // Skip nodes whose children did not change. (Note that dirty[i]
+            // has already been used when dirty[i/2] is overwritten.)
+            if (dirty != NULL) {
+                dirty[i] = dirty[2*i]
+                    || (2*i + 1 < tree->m[l-1] && dirty[2*i + 1]);
+                if (!dirty[i])
+                    continue;
+            }
+
+            // Copy the last child if it has no partner
+            if (2*i + 1 == tree->m[l-1]) {
+                for (j = 0; j < 4; j++)
+                    memcpy(tree_node(tree, l, i, j),
+                        tree_node(tree, l-1, 2*i, j),
+                        (tree->deg_last[l-1] + 1)*sizeof(COMPLEX));
+                tree->W[l][i] = tree->W[l-1][2*i];
+                continue;
+            }
+
+            // Multiply the children
+            for (j = 0; j < 4; j++) {
+                lp[j] = tree_node(tree, l-1, 2*i, j);
+                rp[j] = tree_node(tree, l-1, 2*i+1, j);
+                op[j] = tree_node(tree, l, i, j);
+            }
+            d2 = tree_node_deg(tree, l-1, 2*i+1);
+            ret_code = poly_fmult2x2_node(d, lp, d2, rp, op, buf, mem,
+                cfg_fft, cfg_ifft);
+            CHECK_RETCODE(ret_code, release_mem);
+
+            // Normalize if desired
+            W = tree->W[l-1][2*i] + tree->W[l-1][2*i + 1];
+            if (tree->normalization_flag)
+                W += poly_rescale2x2(d + d2, op[0], op[1], op[2], op[3]);
+            tree->W[l][i] = W;
+        }
+    }
+
+release_mem:
+    free(mem);
+    free(mem_fft);
+    free(mem_ifft);
+    free(buf);
+    return ret_code;
+}
+
+/*
+* length of p = 4*n*(deg+1)
+*/
+INT fnft__poly_fmult2x2_tree_create(const UINT deg, const UINT n,
+    COMPLEX const * const p, const INT normalization_flag,
+    fnft__poly_fmult2x2_tree_t ** const tree_ptr)
+{
+    fnft__poly_fmult2x2_tree_t *tree = NULL;
+    UINT l, m;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (n == 0)
+        return E_INVALID_ARGUMENT(n);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (tree_ptr == NULL)
+        return E_INVALID_ARGUMENT(tree_ptr);
+
+    // Allocate memory
+    tree = calloc(1, sizeof(fnft__poly_fmult2x2_tree_t));
+    if (tree == NULL)
+        return E_NOMEM;
+    tree->n = n;
+    tree->normalization_flag = normalization_flag;
+    tree->nlevels = 1;
+    for (m = n; m > 1; m = (m + 1)/2)
+        tree->nlevels++;
+    tree->m = malloc(tree->nlevels * sizeof(UINT));
+    tree->deg = malloc(tree->nlevels * sizeof(UINT));
+    tree->deg_last = malloc(tree->nlevels * sizeof(UINT));
+    tree->stride = malloc(tree->nlevels * sizeof(UINT));
+    tree->levels = calloc(tree->nlevels, sizeof(COMPLEX *));
+    tree->W = calloc(tree->nlevels, sizeof(INT *));
+    if (tree->m == NULL || tree->deg == NULL || tree->deg_last == NULL
+        || tree->stride == NULL || tree->levels == NULL || tree->W == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    for (l = 0; l < tree->nlevels; l++) {
+        if (l == 0) {
+            tree->m[l] = n;
+            tree->deg[l] = deg;
+            tree->deg_last[l] = deg;
+        } else {
+            m = tree->m[l-1];
+            tree->m[l] = (m + 1)/2;
+            tree->deg[l] = 2*tree->deg[l-1];
+            tree->deg_last[l] = (m%2 == 0) ?
+                tree->deg[l-1] + tree->deg_last[l-1] : tree->deg_last[l-1];
+        }
+        tree->stride[l] = poly_fmult2x2_stride(tree->m[l], tree->deg[l],
+            tree->deg_last[l]);
+        tree->levels[l] = malloc(4*tree->stride[l] * sizeof(COMPLEX));
+        tree->W[l] = calloc(tree->m[l], sizeof(INT));
+        if (tree->levels[l] == NULL || tree->W[l] == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+    }
+
+    // Compute the products
+    memcpy(tree->levels[0], p, 4*n*(deg + 1) * sizeof(COMPLEX));
+    ret_code = tree_compute(tree, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    *tree_ptr = tree;
+    return SUCCESS;
+
+release_mem:
+    fnft__poly_fmult2x2_tree_free(tree);
+    return ret_code;
+}
+
+
+/*
+* length of p = 4*m*(deg+1)
+*/
+INT fnft__poly_fmult2x2_tree_update(fnft__poly_fmult2x2_tree_t * const tree,
+    const UINT m, UINT const * const idx, COMPLEX const * const p)
+{
+    char *dirty = NULL;
+    UINT j, k, deg;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tree == NULL)
+        return E_INVALID_ARGUMENT(tree);
+    if (m == 0)
+        return SUCCESS;
+    if (idx == NULL)
+        return E_INVALID_ARGUMENT(idx);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    for (k = 0; k < m; k++) {
+        if (idx[k] >= tree->n)
+            return E_INVALID_ARGUMENT(idx);
+    }
+
+    dirty = calloc(tree->n, sizeof(char));
+    if (dirty == NULL)
+        return E_NOMEM;
+
+    // Replace the factors
+    deg = tree->deg[0];
+    for (k = 0; k < m; k++) {
+        for (j = 0; j < 4; j++)
+            memcpy(tree_node(tree, 0, idx[k], j), p + (j*m + k)*(deg + 1),
+                (deg + 1)*sizeof(COMPLEX));
+        dirty[idx[k]] = 1;
+    }
+
+    // Recompute the paths from the new factors to the root
+    ret_code = tree_compute(tree, dirty);
+
+    free(dirty);
+    return ret_code;
+}
+
+INT fnft__poly_fmult2x2_tree_root(fnft__poly_fmult2x2_tree_t * const tree,
+    UINT * const deg_ptr, COMPLEX * const result, INT * const W_ptr)
+{
+    UINT j, L;
+
+    // Check inputs
+    if (tree == NULL)
+        return E_INVALID_ARGUMENT(tree);
+
+    L = tree->nlevels - 1;
+    if (deg_ptr != NULL)
+        *deg_ptr = tree->deg_last[L];
+    if (result != NULL) {
+        for (j = 0; j < 4; j++)
+            memcpy(result + j*(tree->deg_last[L] + 1),
+                tree_node(tree, L, 0, j),
+                (tree->deg_last[L] + 1)*sizeof(COMPLEX));
+    }
+    if (W_ptr != NULL)
+        *W_ptr = tree->W[L][0];
+    return SUCCESS;
+}
+
+/*
+* length of G = 4*(deg*n+1), length of G_leaves = 4*n*(deg+1)
+*/
+INT fnft__poly_fmult2x2_tree_adjoint(fnft__poly_fmult2x2_tree_t * const tree,
+    COMPLEX const * const G, COMPLEX * const G_leaves)
+{
+    COMPLEX *buf[2] = { NULL, NULL }, *G_par, *G_chl, *G_l, *G_r;
+    COMPLEX *scratch = NULL, *g[4], *R[4], *G_r_pad;
+    INT *E[2] = { NULL, NULL }, *E_par, *E_chl, r;
+    UINT i, j, k, l, d, d2, len, memneeded = 0, memneeded_buf;
+    void *mem = NULL, *mem_fft = NULL, *mem_ifft = NULL;
+    kiss_fft_cfg cfg_fft = NULL, cfg_ifft = NULL;
+    REAL scl;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (tree == NULL)
+        return E_INVALID_ARGUMENT(tree);
+    if (G == NULL)
+        return E_INVALID_ARGUMENT(G);
+    if (G_leaves == NULL)
+        return E_INVALID_ARGUMENT(G_leaves);
+
+    // The adjoints of the nodes on a level are stored in the same format as
+    // the nodes themselves, with an exponent E of a normalization factor per
+    // node in order to avoid overflows
+    l = tree->nlevels - 1;
+    buf[0] = malloc(4*tree->stride[0] * sizeof(COMPLEX));
+    buf[1] = malloc(4*tree->stride[0] * sizeof(COMPLEX));
+    E[0] = malloc(tree->n * sizeof(INT));
+    E[1] = malloc(tree->n * sizeof(INT));
+    if (buf[0] == NULL || buf[1] == NULL || E[0] == NULL || E[1] == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    d = tree->deg_last[l];
+    memcpy(buf[l%2], G, 4*(d + 1) * sizeof(COMPLEX));
+    E[l%2][0] = poly_rescale2x2(d, buf[l%2], buf[l%2] + (d + 1),
+        buf[l%2] + 2*(d + 1), buf[l%2] + 3*(d + 1));
+
+    // Allocate memory for the calls to poly_fcorr2. The scratch space is
+    // used to pad the adjoints of products with a right factor of lower
+    // degree, the right factor and the adjoint of the right factor.
+    if (tree->nlevels > 1) {
+        d = tree->deg[tree->nlevels - 2];
+        mem = malloc(poly_fmult2_lenmen(d));
+        kiss_fft_alloc(poly_fmult2_len(d), 0, NULL, &memneeded);
+        mem_fft = malloc(memneeded);
+        mem_ifft = malloc(memneeded);
+        scratch = malloc((4*(2*d + 1) + 5*(d + 1)) * sizeof(COMPLEX));
+        if (mem == NULL || mem_fft == NULL || mem_ifft == NULL
+            || scratch == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+    }
+
+    // Propagate the adjoints from the root to the factors
+    for (; l > 0; l--) {
+
+        // Create FFT and IFFT config for the degree of the children
+        d = tree->deg[l - 1];
+        len = poly_fmult2_len(d);
+        memneeded_buf = memneeded;
+        cfg_fft = kiss_fft_alloc(len, 0, mem_fft, &memneeded_buf);
+        memneeded_buf = memneeded;
+        cfg_ifft = kiss_fft_alloc(len, 1, mem_ifft, &memneeded_buf);
+        if (cfg_fft == NULL || cfg_ifft == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+
+        G_par = buf[l%2];
+        G_chl = buf[(l - 1)%2];
+        E_par = E[l%2];
+        E_chl = E[(l - 1)%2];
+
+        for (i = 0; i < tree->m[l]; i++) {
+
+            // The adjoint of a copied node is passed on unchanged
+            if (2*i + 1 == tree->m[l-1]) {
+                for (j = 0; j < 4; j++)
+                    memcpy(G_chl + j*tree->stride[l-1] + 2*i*(d + 1),
+                        G_par + j*tree->stride[l] + i*(2*d + 1),
+                        (tree->deg_last[l-1] + 1)*sizeof(COMPLEX));
+                E_chl[2*i] = E_par[i];
+                continue;
+            }
+
+            // If the right factor R has a lower degree d2<d, it is padded
+            // with leading zeros. The adjoint of the product is padded
+            // accordingly, and the adjoint of R consists of the last d2+1
+            // coefficients of the adjoint of the padded R.
+            d2 = tree_node_deg(tree, l-1, 2*i+1);
+            G_r_pad = scratch + 4*(2*d + 1) + 4*(d + 1);
+            for (j = 0; j < 4; j++) {
+                g[j] = G_par + j*tree->stride[l] + i*(2*d + 1);
+                R[j] = tree_node(tree, l-1, 2*i+1, j);
+                if (d2 < d) {
+                    for (k = 0; k < d - d2; k++) {
+                        scratch[j*(2*d + 1) + k] = 0.0;
+                        scratch[4*(2*d + 1) + j*(d + 1) + k] = 0.0;
+                    }
+                    memcpy(scratch + j*(2*d + 1) + (d - d2), g[j],
+                        (d + d2 + 1)*sizeof(COMPLEX));
+                    memcpy(scratch + 4*(2*d + 1) + j*(d + 1) + (d - d2),
+                        R[j], (d2 + 1)*sizeof(COMPLEX));
+                    g[j] = scratch + j*(2*d + 1);
+                    R[j] = scratch + 4*(2*d + 1) + j*(d + 1);
+                }
+            }
+
+            // If N=L*R, then the adjoint of L is the sum of the correlations
+            // of the entries of the adjoint of N in row r with the entries
+            // of R in row c. Similarly, the adjoint of R is the sum of
+            // correlations of the entries of the adjoint of N in column c
+            // with the entries of L in column r.
+            for (j = 0; j < 4; j++) {
+                G_l = G_chl + j*tree->stride[l-1] + 2*i*(d + 1);
+                G_r = G_chl + j*tree->stride[l-1] + (2*i + 1)*(d + 1);
+
+                // Entry j=(a,b) of L contributes to the entries (a,0) and
+                // (a,1) of N together with the entries (b,0) and (b,1) of R
+                ret_code = poly_fcorr2(d, g[(j/2)*2], R[(j%2)*2], G_l, mem,
+                    cfg_fft, cfg_ifft, 0);
+                CHECK_RETCODE(ret_code, release_mem);
+                ret_code = poly_fcorr2(d, g[(j/2)*2 + 1], R[(j%2)*2 + 1],
+                    G_l, mem, cfg_fft, cfg_ifft, 1);
+                CHECK_RETCODE(ret_code, release_mem);
+
+                // Entry j=(a,b) of R contributes to the entries (0,b) and
+                // (1,b) of N together with the entries (0,a) and (1,a) of L
+                ret_code = poly_fcorr2(d, g[j%2],
+                    tree_node(tree, l-1, 2*i, j/2),
+                    d2 < d ? G_r_pad : G_r, mem, cfg_fft, cfg_ifft, 0);
+                CHECK_RETCODE(ret_code, release_mem);
+                ret_code = poly_fcorr2(d, g[2 + j%2],
+                    tree_node(tree, l-1, 2*i, 2 + j/2),
+                    d2 < d ? G_r_pad : G_r, mem, cfg_fft, cfg_ifft, 1);
+                CHECK_RETCODE(ret_code, release_mem);
+                if (d2 < d)
+                    memcpy(G_r, G_r_pad + (d - d2),
+                        (d2 + 1)*sizeof(COMPLEX));
+            }
+
+            // The node has been normalized by 2^-r after multiplication
+            r = tree->W[l][i] - tree->W[l-1][2*i] - tree->W[l-1][2*i+1];
+            for (j = 0; j < 2; j++) {
+                G_l = G_chl + (2*i + j)*(d + 1);
+                k = tree->stride[l-1];
+                E_chl[2*i + j] = E_par[i] - r + poly_rescale2x2(
+                    tree_node_deg(tree, l-1, 2*i + j), G_l, G_l + k,
+                    G_l + 2*k, G_l + 3*k);
+            }
+        }
+    }
+
+    // Remove the normalization factors
+    d = tree->deg[0];
+    for (i = 0; i < tree->n; i++) {
+        scl = POW(2.0, E[0][i]);
+        for (j = 0; j < 4; j++) {
+            for (k = 0; k <= d; k++)
+                G_leaves[(j*tree->n + i)*(d + 1) + k] =
+                    scl * buf[0][(j*tree->n + i)*(d + 1) + k];
+        }
+    }
+
+release_mem:
+    free(buf[0]);
+    free(buf[1]);
+    free(E[0]);
+    free(E[1]);
+    free(scratch);
+    free(mem);
+    free(mem_fft);
+    free(mem_ifft);
+    return ret_code;
+}
+
+void fnft__poly_fmult2x2_tree_free(fnft__poly_fmult2x2_tree_t * const tree)
+{
+    UINT l;
+
+    if (tree == NULL)
+        return;
+    if (tree->levels != NULL) {
+        for (l = 0; l < tree->nlevels; l++)
+            free(tree->levels[l]);
+    }
+    if (tree->W != NULL) {
+        for (l = 0; l < tree->nlevels; l++)
+            free(tree->W[l]);
+    }
+    free(tree->levels);
+    free(tree->W);
+    free(tree->m);
+    free(tree->deg);
+    free(tree->deg_last);
+    free(tree->stride);
+    free(tree);
+}
@@ -18,21 +18,71 @@
 */
 #define FNFT_ENABLE_SHORT_NAMES
 
+#include <stdlib.h>
+#include <float.h>
+#include "fnft_config.h"
 #include "fnft__errwarn.h"
 #include "fnft__poly_roots_fasteigen.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 
-// Interface to the EISCOR root finding routine
+// Interface to the EISCOR root finding routines
 extern INT z_poly_roots_modified_(INT *N, double complex const * const coeffs,
     double complex * const roots, double *threshold, INT *info);
+extern INT z_poly_roots_modified_ws_(INT *N,
+    double complex const * const coeffs, double complex * const roots,
+    double *threshold, INT *info, INT *P, INT *ITS, double *rwork,
+    double complex *zwork);
+
+// Interfaces to the EISCOR routines that the multishift QR algorithm below
+// is composed of. (Fortran LOGICALs are passed as INT.)
+extern void z_compmat_compress_(INT *N, INT *P, double complex *coeffs,
+    double *Q, double *D, double *C, double *B);
+extern void z_upr1utri_decompress_(INT *diag, INT *N, double *D, double *C,
+    double *B, double complex *T);
+extern void z_upr1fact_buildbulge_(INT *P, double *Q, double *D, double *C,
+    double *B, double complex *shift, double *G);
+extern void z_rot3_fusion_(INT *flag, double *G1, double *G2);
+extern void z_upr1utri_rot3swap_(INT *dir, double *D, double *C, double *B,
+    double *G);
+extern void z_upr1utri_unimodscale_(INT *row, double *D, double *C,
+    double *B, double complex *scl);
+extern void z_upr1fact_chasedown_(INT *vec, INT *P, double *Q, double *D,
+    double *C, double *B, INT *M, double complex *V, double *misfit);
+extern void z_upr1fact_endchase_(INT *vec, INT *N, INT *P, double *Q,
+    double *D, double *C, double *B, INT *M, double complex *V, double *G,
+    INT *flag);
+extern void z_upr1fact_deflationcheck_(INT *vec, INT *N, INT *P, double *Q,
+    double *D, double *C, double *B, INT *M, double complex *V, INT *zero);
+extern void z_upr1fact_singlestep_(INT *vec, INT (*fun)(INT *, INT *),
+    INT *N, INT *P, double *Q, double *D, double *C, double *B, INT *M,
+    double complex *V, INT *itcnt);
+extern INT l_upr1fact_hess_(INT *N, INT *P);
+
+// Work arrays of z_poly_roots_modified_ws. (The Fortran LOGICAL array P is
+// stored as INT, which has the same size.)
+struct fnft__poly_roots_fasteigen_ws_s {
+    UINT deg;
+    INT *P;
+    INT *ITS;
+    double *rwork;
+    double complex *zwork;
+};
+
+// Threshold used to decide whether QR or QZ is used. This threshold was
+// used in the original routine. Set to INFINITY to enforce QR. Set to 0 to
+// enforce QZ.
+static const double threshold = 1e8;
 
 // Fast computation of polynomial roots. See the header file for details.
 INT poly_roots_fasteigen(const UINT deg,
     COMPLEX const * const p, COMPLEX * const roots)
 {
     INT int_deg, info;
-    double threshold = 1e8;
-    // This threshold was used in the original routine. Set to INFINITY to
-    // enforce QR. Set to 0 to enforce QZ.
+    double thres = threshold;
 
 	// Check inputs
 	if (p == NULL)
@@ -42,10 +92,898 @@ INT poly_roots_fasteigen(const UINT deg,
 
     // Call Fortran root finding routine
     int_deg = (int)deg;
-    z_poly_roots_modified_(&int_deg, p, roots, &threshold, &info);
+    z_poly_roots_modified_(&int_deg, p, roots, &thres, &info);
     
     if (info == 0)
         return SUCCESS;
     else
         return E_SUBROUTINE(FNFT_EC_OTHER);
 }
+
+// Creates a workspace. See the header file for details.
+INT poly_roots_fasteigen_ws_create(const UINT deg,
+    poly_roots_fasteigen_ws_t ** const ws_ptr)
+{
+    poly_roots_fasteigen_ws_t *ws;
+
+    // Check inputs
+    if (deg < 2)
+        return E_INVALID_ARGUMENT(deg);
+    if (ws_ptr == NULL)
+        return E_INVALID_ARGUMENT(ws_ptr);
+
+    // Allocate memory (sizes as in z_poly_roots_modified)
+    ws = calloc(1, sizeof(poly_roots_fasteigen_ws_t));
+    if (ws == NULL)
+        return E_NOMEM;
+    ws->deg = deg;
+    ws->P = malloc(deg * sizeof(INT));
+    ws->ITS = malloc((deg - 1) * sizeof(INT));
+    ws->rwork = malloc((19*deg + 1) * sizeof(double));
+    ws->zwork = malloc(2*deg * sizeof(double complex));
+    if (ws->P == NULL || ws->ITS == NULL || ws->rwork == NULL
+        || ws->zwork == NULL) {
+        poly_roots_fasteigen_ws_free(ws);
+        return E_NOMEM;
+    }
+
+    *ws_ptr = ws;
+    return SUCCESS;
+}
+
+// Auxiliary function: Calls the Fortran root finding routine with the work
+// arrays in ws. Returns the INFO flag of the routine.
+static inline INT solve(poly_roots_fasteigen_ws_t * const ws,
+    COMPLEX const * const p, COMPLEX * const roots)
+{
+    INT int_deg = (INT)ws->deg, info = 0;
+    double thres = threshold;
+
+    z_poly_roots_modified_ws_(&int_deg, p, roots, &thres, &info, ws->P,
+        ws->ITS, ws->rwork, ws->zwork);
+    return info;
+}
+
+// Fast computation of polynomial roots with a given workspace. See the
+// header file for details.
+INT poly_roots_fasteigen_ws(poly_roots_fasteigen_ws_t * const ws,
+    COMPLEX const * const p, COMPLEX * const roots)
+{
+    // Check inputs
+    if (ws == NULL)
+        return E_INVALID_ARGUMENT(ws);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (roots == NULL)
+        return E_INVALID_ARGUMENT(roots);
+
+    if (solve(ws, p, roots) == 0)
+        return SUCCESS;
+    else
+        return E_SUBROUTINE(FNFT_EC_OTHER);
+}
+
+// Releases a workspace. See the header file for details.
+void poly_roots_fasteigen_ws_free(poly_roots_fasteigen_ws_t * const ws)
+{
+    if (ws == NULL)
+        return;
+    free(ws->P);
+    free(ws->ITS);
+    free(ws->rwork);
+    free(ws->zwork);
+    free(ws);
+}
+
+// Polynomials that are solved by one thread: first, first+step, ...
+typedef struct {
+    poly_roots_fasteigen_ws_t *ws;
+    UINT first;
+    UINT step;
+    UINT npoly;
+    COMPLEX const *p;
+    COMPLEX *roots;
+    INT *status;
+} batch_job_t;
+
+// Auxiliary function: Solves the polynomials of a job. Failures are only
+// recorded in the status array, since the error messages of several threads
+// would be interleaved otherwise.
+static void * batch_worker(void * arg)
+{
+    batch_job_t * const job = arg;
+    const UINT deg = job->ws->deg;
+    UINT i;
+
+    for (i=job->first; i<job->npoly; i+=job->step) {
+        if (solve(job->ws, job->p + i*(deg + 1), job->roots + i*deg) == 0)
+            job->status[i] = SUCCESS;
+        else
+            job->status[i] = FNFT_EC_OTHER;
+    }
+    return NULL;
+}
+
+// Fast computation of the roots of many polynomials of the same degree. See
+// the header file for details.
+INT poly_roots_fasteigen_batch(const UINT deg, const UINT npoly,
+    COMPLEX const * const p, COMPLEX * const roots, INT * const status,
+    const UINT nthreads)
+{
+    batch_job_t *jobs = NULL;
+    UINT n, t;
+    INT ret_code = SUCCESS;
+#ifdef HAVE_PTHREAD
+    pthread_t *threads = NULL;
+    INT *started = NULL;
+    long ncpus;
+#endif
+
+    // Check inputs
+    if (deg < 2)
+        return E_INVALID_ARGUMENT(deg);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (roots == NULL)
+        return E_INVALID_ARGUMENT(roots);
+    if (status == NULL)
+        return E_INVALID_ARGUMENT(status);
+    if (npoly == 0)
+        return SUCCESS;
+
+    // Determine the number of threads
+#ifdef HAVE_PTHREAD
+    n = nthreads;
+    if (n == 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = ncpus > 0 ? (UINT)ncpus : 1;
+    }
+    if (n > npoly)
+        n = npoly;
+#else
+    (void)nthreads;
+    n = 1;
+#endif
+
+    // Allocate one workspace per thread
+    jobs = calloc(n, sizeof(batch_job_t));
+    if (jobs == NULL)
+        return E_NOMEM;
+    for (t=0; t<n; t++) {
+        ret_code = poly_roots_fasteigen_ws_create(deg, &jobs[t].ws);
+        CHECK_RETCODE(ret_code, release_mem);
+        jobs[t].first = t;
+        jobs[t].step = n;
+        jobs[t].npoly = npoly;
+        jobs[t].p = p;
+        jobs[t].roots = roots;
+        jobs[t].status = status;
+    }
+
+#ifdef HAVE_PTHREAD
+    // The first job is carried out by the calling thread. Jobs for which no
+    // thread can be started are carried out by the calling thread as well.
+    if (n > 1) {
+        threads = malloc(n * sizeof(pthread_t));
+        started = calloc(n, sizeof(INT));
+        if (threads == NULL || started == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        for (t=1; t<n; t++)
+            started[t] = pthread_create(&threads[t], NULL, batch_worker,
+                &jobs[t]) == 0;
+    }
+    batch_worker(&jobs[0]);
+    for (t=1; t<n; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            batch_worker(&jobs[t]);
+    }
+#else
+    batch_worker(&jobs[0]);
+#endif
+
+release_mem:
+#ifdef HAVE_PTHREAD
+    free(threads);
+    free(started);
+#endif
+    for (t=0; t<n; t++)
+        poly_roots_fasteigen_ws_free(jobs[t].ws);
+    free(jobs);
+    return ret_code;
+}
+
+// The multishift QR algorithm below works on the compressed upper Hessenberg
+// matrix H=Q*R that z_compmat_compress computes for the companion matrix.
+// Q is the product of n-1 cores in descending order (P=.FALSE.), which are
+// stored as three reals each, and R is upper triangular and stored in D, C
+// and B. Rows and cores are numbered from one as in EISCOR. An active block
+// of H is described by pointers to its first core and row.
+typedef struct {
+    INT n; // number of rows
+    INT *P;
+    double *Q;
+    double *D;
+    double *C;
+    double *B;
+} ms_block_t;
+
+// Auxiliary function: Returns the block of the rows str, ..., stp+1.
+static inline ms_block_t ms_block(const INT str, const INT stp,
+    INT * const P, double * const Q, double * const D, double * const C,
+    double * const B)
+{
+    ms_block_t blk;
+
+    blk.n = stp - str + 2;
+    blk.P = P + (str - 1);
+    blk.Q = Q + 3*(str - 1);
+    blk.D = D + 2*(str - 1);
+    blk.C = C + 3*(str - 1);
+    blk.B = B + 3*(str - 1);
+    return blk;
+}
+
+// Auxiliary function: Carries out operation op of the bulge with the given
+// shift. Operation 0 introduces the bulge (as z_upr1fact_startchase, but
+// with the given shift), the operations 1, ..., n-3 move the misfit G down
+// by one row (z_upr1fact_chasedown) and operation n-2 fuses it with the last
+// core (z_upr1fact_endchase). Operation op only touches the cores op and
+// op+1 and the rows op+1 and op+2 of R. A bulge can therefore carry out
+// operation op as soon as the bulge in front of it has carried out
+// operation op+1, and the result is the same as if the bulges had been
+// chased one after another.
+static void bulge_op(ms_block_t const * const blk, const INT op,
+    const COMPLEX shift, double * const G)
+{
+    INT no = 0, one = 1, n = blk->n;
+    double Ginv[3];
+    double complex shft = shift, scl, V[1];
+
+    if (op == 0) {
+        z_upr1fact_buildbulge_(blk->P, blk->Q, blk->D, blk->C, blk->B,
+            &shft, G);
+        Ginv[0] = G[0];
+        Ginv[1] = -G[1];
+        Ginv[2] = -G[2];
+
+        // Fuse Ginv and the first core, pass G through R and move the
+        // diagonal rotation Ginv into R
+        z_rot3_fusion_(&no, Ginv, blk->Q);
+        z_upr1utri_rot3swap_(&no, blk->D, blk->C, blk->B, G);
+        scl = Ginv[0] + I*Ginv[1];
+        z_upr1utri_unimodscale_(&no, blk->D, blk->C, blk->B, &scl);
+        scl = Ginv[0] - I*Ginv[1];
+        z_upr1utri_unimodscale_(&no, blk->D + 2, blk->C + 3, blk->B + 3,
+            &scl);
+    } else if (op <= n - 3) {
+        z_upr1fact_chasedown_(&no, blk->P + (op - 1), blk->Q + 3*(op - 1),
+            blk->D + 2*op, blk->C + 3*op, blk->B + 3*op, &one, V, G);
+    } else {
+        z_upr1fact_endchase_(&no, &n, blk->P, blk->Q, blk->D, blk->C,
+            blk->B, &one, V, G, &no);
+    }
+}
+
+// Auxiliary function: Stores the trailing m x m submatrix of H=Q*R of a
+// block with n>m rows in T (column-major). T must have room for (m+1)^2
+// values.
+static void trailing_window(ms_block_t const * const blk, const INT m,
+    COMPLEX * const T)
+{
+    INT no = 0, w = m + 1, s = blk->n - m;
+    INT j, k, r;
+    double const *q;
+    COMPLEX a, b, c;
+
+    // Rows and columns s, ..., n of R
+    z_upr1utri_decompress_(&no, &w, blk->D + 2*(s - 1), blk->C + 3*(s - 1),
+        blk->B + 3*(s - 1), T);
+
+    // Apply the cores n-1, ..., s from the left
+    for (j=blk->n-1; j>=s; j--) {
+        q = blk->Q + 3*(j - 1);
+        c = q[0] + I*q[1];
+        r = j - s;
+        for (k=0; k<w; k++) {
+            a = T[r + k*w];
+            b = T[r + 1 + k*w];
+            T[r + k*w] = c*a - q[2]*b;
+            T[r + 1 + k*w] = q[2]*a + CONJ(c)*b;
+        }
+    }
+
+    // Remove the first row and column
+    for (k=0; k<m; k++) {
+        for (j=0; j<m; j++)
+            T[j + k*m] = T[j + 1 + (k + 1)*w];
+    }
+}
+
+// Auxiliary function: Computes the eigenvalues of the upper Hessenberg
+// matrix H (m x m, column-major, overwritten) with the shifted QR algorithm.
+// Returns SUCCESS or FNFT_EC_OTHER if it did not converge.
+static INT hess_eig(const INT m, COMPLEX * const H, COMPLEX * const ev)
+{
+    INT lo, hi, k, j, its = 0;
+    REAL r;
+    COMPLEX a, b, c, d, tr, disc, mu, x, y, cs, sn;
+
+#define H_(i,j) H[(i) + (j)*m]
+    hi = m - 1;
+    while (hi > 0) {
+
+        // Find the active window lo, ..., hi
+        for (lo=hi; lo>0; lo--) {
+            if (CABS(H_(lo,lo-1)) <= DBL_EPSILON*(CABS(H_(lo-1,lo-1))
+                + CABS(H_(lo,lo)))) {
+                H_(lo,lo-1) = 0.0;
+                break;
+            }
+        }
+        if (lo == hi) {
+            ev[hi] = H_(hi,hi);
+            hi--;
+            its = 0;
+            continue;
+        }
+        if (its >= 30*m)
+            return FNFT_EC_OTHER;
+
+        // Wilkinson shift (exceptional shift every tenth iteration)
+        a = H_(hi-1,hi-1);
+        b = H_(hi-1,hi);
+        c = H_(hi,hi-1);
+        d = H_(hi,hi);
+        tr = 0.5*(a + d);
+        disc = CSQRT(0.25*(a - d)*(a - d) + b*c);
+        mu = CABS(tr + disc - d) < CABS(tr - disc - d) ? tr + disc
+            : tr - disc;
+        if (its % 10 == 9)
+            mu = d + 0.75*CABS(c);
+        its++;
+
+        // Explicit QR step H-mu*I=QR, H=RQ+mu*I on the active window. The
+        // Givens rotations are stored in the (now zero) subdiagonal and in
+        // ev[lo], ..., ev[hi-1].
+        for (k=lo; k<=hi; k++)
+            H_(k,k) -= mu;
+        for (k=lo; k<hi; k++) {
+            x = H_(k,k);
+            y = H_(k+1,k);
+            r = SQRT(CABS(x)*CABS(x) + CABS(y)*CABS(y));
+            if (r == 0.0) {
+                cs = 1.0;
+                sn = 0.0;
+            } else {
+                cs = x/r;
+                sn = y/r;
+            }
+            for (j=k; j<=hi; j++) {
+                x = H_(k,j);
+                y = H_(k+1,j);
+                H_(k,j) = CONJ(cs)*x + CONJ(sn)*y;
+                H_(k+1,j) = -sn*x + cs*y;
+            }
+            ev[k] = cs;
+            H_(k+1,k) = sn;
+        }
+        for (k=lo; k<hi; k++) {
+            cs = ev[k];
+            sn = H_(k+1,k);
+            H_(k+1,k) = 0.0;
+            for (j=lo; j<=k+1; j++) {
+                x = H_(j,k);
+                y = H_(j,k+1);
+                H_(j,k) = cs*x + sn*y;
+                H_(j,k+1) = -CONJ(sn)*x + CONJ(cs)*y;
+            }
+        }
+        for (k=lo; k<=hi; k++)
+            H_(k,k) += mu;
+    }
+    ev[0] = H_(0,0);
+#undef H_
+    return SUCCESS;
+}
+
+// Several threads can chase the bulges of a sweep if POSIX threads and
+// atomic builtins are available.
+#if defined(HAVE_PTHREAD) && defined(HAVE___ATOMIC)
+#define MS_THREADS
+#define LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#endif
+
+// Number of operations by which a bulge is moved before the next bulge of
+// the same group is moved
+#define MS_CHUNK 32
+
+// Additional number of operations between the last bulge of a group and the
+// first one of the next group, so that the threads do not write to the same
+// cache lines
+#define MS_GAP 8
+
+// Minimum number of rows of a block per thread
+#define MS_ROWS_PER_THREAD 512
+
+// Number of operations that the last bulge of a group has carried out,
+// padded to a cache line
+typedef struct {
+    INT ops;
+    char pad[64 - sizeof(INT)];
+} ms_progress_t;
+
+// Consecutive bulges of a sweep that are chased by one thread. They move
+// down in a tight bundle. The first bulge follows the last one of the
+// previous group.
+typedef struct {
+    ms_block_t blk;
+    INT nbulges;
+    COMPLEX const *shifts;
+    INT *pos;
+    double *G;
+    ms_progress_t *prev;
+    ms_progress_t *own;
+} ms_group_t;
+
+// Auxiliary function: Chases the bulges of a group through the block.
+static void * ms_group_chase(void * arg)
+{
+    ms_group_t * const grp = arg;
+    const INT nops = grp->blk.n - 1;
+    INT b, limit, stop, moved;
+
+    while (grp->pos[grp->nbulges - 1] < nops) {
+        moved = 0;
+        for (b=0; b<grp->nbulges; b++) {
+
+            // Operations up to limit-1 are allowed
+            if (b > 0) {
+                limit = grp->pos[b-1] < nops ? grp->pos[b-1] - 1 : nops;
+            } else if (grp->prev != NULL) {
+#ifdef MS_THREADS
+                limit = LOAD(&grp->prev->ops);
+#else
+                limit = grp->prev->ops;
+#endif
+                limit = limit < nops ? limit - 1 - MS_GAP : nops;
+            } else {
+                limit = nops;
+            }
+
+            stop = grp->pos[b] + MS_CHUNK;
+            if (stop > limit)
+                stop = limit;
+            for (; grp->pos[b]<stop; grp->pos[b]++) {
+                bulge_op(&grp->blk, grp->pos[b], grp->shifts[b],
+                    grp->G + 3*b);
+                moved = 1;
+            }
+        }
+
+        if (grp->own != NULL) {
+#ifdef MS_THREADS
+            STORE(&grp->own->ops, grp->pos[grp->nbulges - 1]);
+#else
+            grp->own->ops = grp->pos[grp->nbulges - 1];
+#endif
+        }
+#ifdef MS_THREADS
+        if (!moved)
+            sched_yield();
+#endif
+    }
+    return NULL;
+}
+
+// Work arrays of the multishift QR algorithm for at most m shifts and
+// nthreads threads. The threads 1, ..., nthreads-1 are started once and
+// wait for the sweeps (signalled by incrementing sweep) until quit is set.
+typedef struct {
+    INT m;
+    INT nthreads;
+    COMPLEX *shifts;
+    COMPLEX *T;
+    COMPLEX *ev;
+    INT *pos;
+    double *G;
+    ms_group_t *groups;
+    ms_progress_t *progress;
+#ifdef MS_THREADS
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_sweep;
+    pthread_cond_t cond_done;
+    INT sweep;
+    INT nactive;
+    INT ndone;
+    INT quit;
+#endif
+} ms_ws_t;
+
+#ifdef MS_THREADS
+// Argument of ms_worker
+typedef struct {
+    ms_ws_t *ws;
+    INT t;
+} ms_worker_arg_t;
+
+// Auxiliary function: Thread t of the multishift QR algorithm. It chases
+// group t in every sweep in which at least t+1 threads are used.
+static void * ms_worker(void * arg)
+{
+    ms_ws_t * const ws = ((ms_worker_arg_t *)arg)->ws;
+    const INT t = ((ms_worker_arg_t *)arg)->t;
+    INT sweep = 0, active;
+
+    for (;;) {
+        pthread_mutex_lock(&ws->mutex);
+        while (ws->sweep == sweep && !ws->quit)
+            pthread_cond_wait(&ws->cond_sweep, &ws->mutex);
+        if (ws->quit) {
+            pthread_mutex_unlock(&ws->mutex);
+            return NULL;
+        }
+        sweep = ws->sweep;
+        active = t < ws->nactive;
+        pthread_mutex_unlock(&ws->mutex);
+
+        if (active)
+            ms_group_chase(&ws->groups[t]);
+
+        pthread_mutex_lock(&ws->mutex);
+        ws->ndone++;
+        if (ws->ndone == ws->nthreads - 1)
+            pthread_cond_signal(&ws->cond_done);
+        pthread_mutex_unlock(&ws->mutex);
+    }
+}
+#endif
+
+// Auxiliary function: Chases m bulges with the given shifts through a block
+// in one sweep. The bulges are divided into groups of consecutive bulges,
+// which are chased by different threads.
+static void ms_sweep(ms_block_t const * const blk, const INT m,
+    ms_ws_t * const ws)
+{
+    INT t, nthreads, first;
+
+    // Determine the number of threads (at least two bulges per thread)
+    nthreads = ws->nthreads;
+    if (nthreads > m/2)
+        nthreads = m/2;
+    if (nthreads > blk->n/MS_ROWS_PER_THREAD)
+        nthreads = blk->n/MS_ROWS_PER_THREAD;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    // Set up the groups
+    first = 0;
+    for (t=0; t<nthreads; t++) {
+        ws->groups[t].blk = *blk;
+        ws->groups[t].nbulges = (m - first)/(nthreads - t);
+        ws->groups[t].shifts = ws->shifts + first;
+        ws->groups[t].pos = ws->pos + first;
+        ws->groups[t].G = ws->G + 3*first;
+        ws->groups[t].prev = t > 0 ? &ws->progress[t-1] : NULL;
+        ws->groups[t].own = t < nthreads - 1 ? &ws->progress[t] : NULL;
+        ws->progress[t].ops = 0;
+        first += ws->groups[t].nbulges;
+    }
+    for (t=0; t<m; t++)
+        ws->pos[t] = 0;
+
+#ifdef MS_THREADS
+    // The first group is chased by the calling thread, the others by the
+    // waiting threads
+    if (nthreads > 1) {
+        pthread_mutex_lock(&ws->mutex);
+        ws->nactive = nthreads;
+        ws->ndone = 0;
+        ws->sweep++;
+        pthread_cond_broadcast(&ws->cond_sweep);
+        pthread_mutex_unlock(&ws->mutex);
+    }
+    ms_group_chase(&ws->groups[0]);
+    if (nthreads > 1) {
+        pthread_mutex_lock(&ws->mutex);
+        while (ws->ndone < ws->nthreads - 1)
+            pthread_cond_wait(&ws->cond_done, &ws->mutex);
+        pthread_mutex_unlock(&ws->mutex);
+    }
+#else
+    ms_group_chase(&ws->groups[0]);
+#endif
+}
+
+// Auxiliary function: Returns the number of shifts that are used for a
+// block with n rows, or zero if single shift iterations should be used. By
+// default, every thread that can be used for the block gets two bulges.
+// More shifts per sweep would need more sweeps in total without early
+// deflation. If only one thread can be used, the default are single shift
+// iterations, which are about as fast then.
+static inline INT ms_num_shifts(const INT n, const UINT nshifts,
+    const INT nthreads)
+{
+    INT m;
+
+    if (nshifts > 0) {
+        m = (INT)nshifts;
+    } else {
+        m = nthreads < n/MS_ROWS_PER_THREAD ? nthreads : n/MS_ROWS_PER_THREAD;
+        if (m < 2)
+            return 0;
+        m *= 2;
+        if (m < 4)
+            m = 4;
+        if (m > 64)
+            m = 64;
+    }
+    if (n < 64 || n < 4*m)
+        return 0;
+    return m;
+}
+
+// Auxiliary function: Pseudo-random number in [0,1) (xorshift)
+static inline REAL ms_rand(uint64_t * const state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (*state >> 11) * (1.0/9007199254740992.0);
+}
+
+// Auxiliary function: Multishift QR algorithm for the compressed Hessenberg
+// matrix of size N. It follows z_upr1fact_qr, but chases m bulges per sweep
+// whose shifts are the eigenvalues of the trailing m x m submatrix of the
+// active block. A sweep costs about as much as m single shift iterations.
+// Small blocks are treated with single shift iterations. Upon return, the
+// eigenvalues are the diagonal of R. Returns SUCCESS, FNFT_EC_OTHER if the
+// algorithm did not converge, or FNFT_EC_NOMEM.
+static INT ms_qr(const INT N, INT * const P, double * const Q,
+    double * const D, double * const C, double * const B,
+    const UINT nshifts, const UINT nthreads)
+{
+    ms_ws_t ws = { 0 };
+    ms_block_t blk;
+    INT no = 0, one = 1;
+    INT str = 1, stp = N - 1, zero = 0, itcnt = 0, nsweeps = 0;
+    INT kk = 0, itmax = 20*N, m, k, n, w;
+    uint64_t state = 88172645463325252ULL;
+    double complex V[1];
+    INT ret_code = SUCCESS;
+#ifdef MS_THREADS
+    ms_worker_arg_t *args = NULL;
+    INT nstarted = 0, sync_init = 0;
+    long ncpus;
+#endif
+
+    // Allocate the work arrays for the largest number of shifts
+    ws.nthreads = 1;
+#ifdef MS_THREADS
+    ws.nthreads = (INT)nthreads;
+    if (nthreads == 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        ws.nthreads = ncpus > 0 ? (INT)ncpus : 1;
+    }
+#else
+    (void)nthreads;
+#endif
+    ws.m = ms_num_shifts(N, nshifts, ws.nthreads);
+    if (ws.m > 0) {
+        ws.shifts = malloc(ws.m * sizeof(COMPLEX));
+        w = ws.m + ws.m/2;
+        ws.T = malloc((w + 1)*(w + 1) * sizeof(COMPLEX));
+        ws.ev = malloc(w * sizeof(COMPLEX));
+        ws.pos = malloc(ws.m * sizeof(INT));
+        ws.G = malloc(3*ws.m * sizeof(double));
+        ws.groups = malloc(ws.nthreads * sizeof(ms_group_t));
+        ws.progress = malloc(ws.nthreads * sizeof(ms_progress_t));
+        if (ws.shifts == NULL || ws.T == NULL || ws.ev == NULL
+            || ws.pos == NULL
+            || ws.G == NULL || ws.groups == NULL || ws.progress == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+#ifdef MS_THREADS
+        // Start the threads that chase the groups 1, 2, ... If not all
+        // threads can be started, fewer groups are used.
+        if (ws.nthreads > 1) {
+            ws.threads = malloc(ws.nthreads * sizeof(pthread_t));
+            args = malloc(ws.nthreads * sizeof(ms_worker_arg_t));
+            if (ws.threads == NULL || args == NULL) {
+                ret_code = E_NOMEM;
+                goto release_mem;
+            }
+            if (pthread_mutex_init(&ws.mutex, NULL) != 0) {
+                ws.nthreads = 1;
+            } else if (pthread_cond_init(&ws.cond_sweep, NULL) != 0) {
+                pthread_mutex_destroy(&ws.mutex);
+                ws.nthreads = 1;
+            } else if (pthread_cond_init(&ws.cond_done, NULL) != 0) {
+                pthread_cond_destroy(&ws.cond_sweep);
+                pthread_mutex_destroy(&ws.mutex);
+                ws.nthreads = 1;
+            } else {
+                sync_init = 1;
+            }
+            if (sync_init) {
+                for (k=1; k<ws.nthreads; k++) {
+                    args[k].ws = &ws;
+                    args[k].t = k;
+                    if (pthread_create(&ws.threads[k], NULL, ms_worker,
+                        &args[k]) != 0)
+                        break;
+                    nstarted++;
+                }
+                pthread_mutex_lock(&ws.mutex);
+                ws.nthreads = 1 + nstarted;
+                pthread_mutex_unlock(&ws.mutex);
+            }
+        }
+#endif
+    }
+
+    // Iteration loop
+    while (stp > 0) {
+        if (kk >= itmax) {
+            ret_code = FNFT_EC_OTHER;
+            goto release_mem;
+        }
+
+        // Check for deflation
+        blk = ms_block(str, stp, P, Q, D, C, B);
+        z_upr1fact_deflationcheck_(&no, &blk.n, blk.P, blk.Q, blk.D, blk.C,
+            blk.B, &one, V, &zero);
+
+        // If 1x1 block remove and check again
+        if (stp == str + zero - 1) {
+            stp--;
+            zero = 0;
+            str = 1;
+            itcnt = 0;
+            nsweeps = 0;
+            kk++;
+            continue;
+        }
+        if (zero > 0) {
+            str += zero;
+            zero = 0;
+            itcnt = 0;
+            nsweeps = 0;
+            blk = ms_block(str, stp, P, Q, D, C, B);
+        }
+
+        n = blk.n;
+        m = ms_num_shifts(n, nshifts, ws.nthreads);
+        if (m > ws.m)
+            m = ws.m;
+        if (m == 0) {
+
+            // Single shift iteration
+            z_upr1fact_singlestep_(&no, l_upr1fact_hess_, &n, blk.P, blk.Q,
+                blk.D, blk.C, blk.B, &one, V, &itcnt);
+            itcnt++;
+            kk++;
+
+        } else {
+
+            // The shifts are the m eigenvalues that the QR algorithm finds
+            // first for the trailing (3m/2) x (3m/2) submatrix. (This
+            // converges slightly faster than using all eigenvalues of the
+            // trailing m x m submatrix.) Random shifts are used if no
+            // deflation occured in the last ten sweeps, or if the
+            // eigenvalues of the submatrix cannot be computed.
+            w = m + m/2;
+            trailing_window(&blk, w, ws.T);
+            if (nsweeps % 10 == 9 || hess_eig(w, ws.T, ws.ev) != SUCCESS) {
+                for (k=0; k<m; k++)
+                    ws.shifts[k] = ms_rand(&state) + I*ms_rand(&state);
+            } else {
+                for (k=0; k<m; k++)
+                    ws.shifts[k] = ws.ev[w - m + k];
+            }
+
+            ms_sweep(&blk, m, &ws);
+            itcnt += m;
+            kk += m;
+            nsweeps++;
+        }
+    }
+
+release_mem:
+#ifdef MS_THREADS
+    if (nstarted > 0) {
+        pthread_mutex_lock(&ws.mutex);
+        ws.quit = 1;
+        pthread_cond_broadcast(&ws.cond_sweep);
+        pthread_mutex_unlock(&ws.mutex);
+        for (k=1; k<=nstarted; k++)
+            pthread_join(ws.threads[k], NULL);
+    }
+    if (sync_init) {
+        pthread_cond_destroy(&ws.cond_done);
+        pthread_cond_destroy(&ws.cond_sweep);
+        pthread_mutex_destroy(&ws.mutex);
+    }
+    free(ws.threads);
+    free(args);
+#endif
+    free(ws.shifts);
+    free(ws.T);
+    free(ws.ev);
+    free(ws.pos);
+    free(ws.G);
+    free(ws.groups);
+    free(ws.progress);
+    return ret_code;
+}
+
+// Fast computation of polynomial roots with the multishift QR algorithm.
+// See the header file for details.
+INT poly_roots_fasteigen_multishift(const UINT deg,
+    COMPLEX const * const p, COMPLEX * const roots, const UINT nshifts,
+    const UINT nthreads)
+{
+    poly_roots_fasteigen_ws_t *ws = NULL;
+    INT N, yes = 1, i;
+    double *Q, *D, *C, *B;
+    double complex *V;
+    REAL normc;
+    INT ret_code = SUCCESS;
+
+    // Check inputs
+    if (deg < 2)
+        return E_INVALID_ARGUMENT(deg);
+    if (p == NULL)
+        return E_INVALID_ARGUMENT(p);
+    if (roots == NULL)
+        return E_INVALID_ARGUMENT(roots);
+
+    ret_code = poly_roots_fasteigen_ws_create(deg, &ws);
+    CHECK_RETCODE(ret_code, release_mem);
+    N = (INT)deg;
+
+    // The multishift algorithm is only available for QR. Polynomials for
+    // which z_poly_roots_modified uses QZ are passed on.
+    normc = 0.0;
+    for (i=1; i<=N; i++)
+        normc += CABS(p[i]/p[0])*CABS(p[i]/p[0]);
+    normc = SQRT(normc);
+    if (!(normc < threshold)) {
+        ret_code = poly_roots_fasteigen_ws(ws, p, roots);
+        CHECK_RETCODE(ret_code, release_mem);
+        goto release_mem;
+    }
+
+    // Factor the companion matrix (as in z_poly_roots_modified)
+    Q = ws->rwork;
+    D = Q + 3*(N - 1);
+    C = D + 2*(N + 1);
+    B = C + 3*N;
+    V = ws->zwork;
+    V[N-1] = (N % 2 == 0 ? 1.0 : -1.0)*p[N]/p[0];
+    for (i=1; i<N; i++)
+        V[i-1] = -p[N-i]/p[0];
+    for (i=0; i<N-2; i++)
+        ws->P[i] = 0;
+    z_compmat_compress_(&N, ws->P, V, Q, D, C, B);
+
+    ret_code = ms_qr(N, ws->P, Q, D, C, B, nshifts, nthreads);
+    if (ret_code == FNFT_EC_OTHER) {
+        ret_code = E_SUBROUTINE(FNFT_EC_OTHER);
+        goto release_mem;
+    }
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Extract the roots
+    z_upr1utri_decompress_(&yes, &N, D, C, B, roots);
+
+release_mem:
+    poly_roots_fasteigen_ws_free(ws);
+    return ret_code;
+}
@@ -0,0 +1,114 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define NANGLES 24
+
+// Reference values in long double precision. cosh(x) and sinh(x)/x are
+// computed with the complex functions of the C library. The derivatives of
+// sinh(x)/x with respect to x2 are computed from the closed-form expressions
+// for |x2|>1 and from 40 terms of their Taylor series otherwise.
+static void cosh_sinhc_ref(const long double complex x2,
+    long double complex * const c, long double complex * const s,
+    long double complex * const ds, long double complex * const d2s)
+{
+    long double complex x, xn;
+    long double f;
+    UINT n;
+
+    if (x2 == 0) {
+        *c = 1;
+        *s = 1;
+    } else {
+        x = csqrtl(x2);
+        *c = ccoshl(x);
+        *s = csinhl(x)/x;
+    }
+    if (cabsl(x2) > 1) {
+        *ds = (*c - *s)/(2*x2);
+        *d2s = (0.5L*(*s) - 3*(*ds))/(2*x2);
+    } else {
+        *ds = 0;
+        *d2s = 0;
+        xn = 1;
+        f = 1.0L/6; // = 1/(2n+3)!
+        for (n=0; n<40; n++) {
+            *ds += (n + 1)*f*xn;
+            *d2s += (n + 1)*(n + 2)*f*xn/((2*n + 4)*(2*n + 5));
+            f /= (2*n + 4)*(2*n + 5);
+            xn *= x2;
+        }
+    }
+}
+
+static REAL rel_err(const COMPLEX val, const long double complex ref)
+{
+    return (REAL)(cabsl(val - ref)/cabsl(ref));
+}
+
+INT main()
+{
+    const REAL radii[] = { 0.0, 1e-14, 1e-6, 1e-3, 0.1, 0.5, 0.9, 1.0,
+        1.0 + 1e-12, 1.5, 4.0, 30.0 };
+    long double complex c_ref, s_ref, ds_ref, d2s_ref;
+    COMPLEX x2, c, s, ds, d2s;
+    REAL err, max_err = 0.0;
+    UINT i, j;
+
+    for (i=0; i<sizeof(radii)/sizeof(radii[0]); i++) {
+        for (j=0; j<NANGLES; j++) {
+            // Includes the real and imaginary axes
+            x2 = radii[i]*CEXP(2*I*PI*j/NANGLES);
+            misc_cosh_sinhc(x2, &c, &s, &ds, &d2s);
+            cosh_sinhc_ref(x2, &c_ref, &s_ref, &ds_ref, &d2s_ref);
+
+            err = rel_err(c, c_ref);
+            if (rel_err(s, s_ref) > err)
+                err = rel_err(s, s_ref);
+            // The closed-form expressions for the derivatives suffer from
+            // some cancellation for |x2| slightly above one
+            if (radii[i] <= 1.0) {
+                if (rel_err(ds, ds_ref) > err)
+                    err = rel_err(ds, ds_ref);
+                if (rel_err(d2s, d2s_ref) > err)
+                    err = rel_err(d2s, d2s_ref);
+            } else if (rel_err(ds, ds_ref) > 1e3*EPSILON
+                || rel_err(d2s, d2s_ref) > 1e3*EPSILON)
+                return EXIT_FAILURE;
+            if (!(err <= max_err))
+                max_err = err;
+
+            // The optional outputs can be omitted
+            misc_cosh_sinhc(x2, &ds, &d2s, NULL, NULL);
+            if (ds != c || d2s != s)
+                return EXIT_FAILURE;
+        }
+    }
+#ifdef DEBUG
+    printf("misc_cosh_sinhc_test: max_err = %g\n", max_err);
+#endif
+    if (!(max_err <= 20*EPSILON))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define N 1500
+
+// Reference implementation that compares all pairs
+static REAL hausdorff_dist_ref(const UINT lenA, COMPLEX const * const vecA,
+    const UINT lenB, COMPLEX const * const vecB)
+{
+    UINT i, j;
+    REAL tmp, dist, max_dist = -1.0;
+
+    for (i=0; i<lenA; i++) {
+        dist = INFINITY;
+        for (j=0; j<lenB; j++) {
+            tmp = CABS(vecA[i] - vecB[j]);
+            if (tmp < dist)
+                dist = tmp;
+        }
+        if (dist > max_dist)
+            max_dist = dist;
+    }
+    for (j=0; j<lenB; j++) {
+        dist = INFINITY;
+        for (i=0; i<lenA; i++) {
+            tmp = CABS(vecA[i] - vecB[j]);
+            if (tmp < dist)
+                dist = tmp;
+        }
+        if (dist > max_dist)
+            max_dist = dist;
+    }
+    return max_dist;
+}
+
+// Deterministic pseudo-random number in [0,1)
+static REAL rnd(UINT * const state)
+{
+    *state = *state * 1103515245 + 12345;
+    return (REAL)((*state >> 8) & 0xffffff) / 16777216.0;
+}
+
+// The distances have to agree exactly with the reference implementation
+static INT misc_hausdorff_dist_test(const UINT lenA,
+    COMPLEX const * const vecA, const UINT lenB,
+    COMPLEX const * const vecB)
+{
+    REAL dist, dist_ref;
+
+    dist = misc_hausdorff_dist(lenA, vecA, lenB, vecB);
+    dist_ref = hausdorff_dist_ref(lenA, vecA, lenB, vecB);
+    if (!(dist == dist_ref))
+        return E_TEST_FAILED;
+    return SUCCESS;
+}
+
+INT main()
+{
+    COMPLEX vecA[N], vecB[N];
+    UINT i, state = 1;
+    INT ret_code;
+
+    // Perturbed copies of random points in a square
+    for (i=0; i<N; i++) {
+        vecA[i] = rnd(&state) + I*rnd(&state);
+        vecB[i] = vecA[i] + 1e-3*(rnd(&state) - 0.5);
+    }
+    ret_code = misc_hausdorff_dist_test(N, vecA, N - 7, vecB);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = misc_hausdorff_dist_test(N/3, vecB, N, vecA);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Points on the imaginary axis (bound states of real pulses) and on
+    // the real axis, with duplicates
+    for (i=0; i<N; i++) {
+        vecA[i] = I*(i % 101)*0.01;
+        vecB[i] = (i % 2) ? I*rnd(&state) : rnd(&state) - 0.5;
+    }
+    ret_code = misc_hausdorff_dist_test(N, vecA, N, vecB);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Values that are not finite and empty vectors
+    vecA[0] = NAN;
+    ret_code = misc_hausdorff_dist_test(N, vecA, N, vecB);
+    CHECK_RETCODE(ret_code, leave_fun);
+    vecB[0] = INFINITY;
+    ret_code = misc_hausdorff_dist_test(1, vecB, 5, vecA + 1);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = misc_hausdorff_dist_test(0, vecA, 5, vecB);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = misc_hausdorff_dist_test(0, vecA, 0, vecB);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
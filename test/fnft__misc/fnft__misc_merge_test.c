@@ -0,0 +1,115 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <string.h>
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define N 2000
+
+// Reference implementation that compares every value with all values that
+// have been kept before
+static UINT merge_ref(const UINT n, COMPLEX * const vals, const REAL tol)
+{
+    UINT i, j, n_kept = 0;
+
+    for (i=0; i<n; i++) {
+        for (j=0; j<n_kept; j++) {
+            if (CABS(vals[j] - vals[i]) < tol)
+                break;
+        }
+        if (j == n_kept)
+            vals[n_kept++] = vals[i];
+    }
+    return n_kept;
+}
+
+// Deterministic pseudo-random number in [0,1)
+static REAL rnd(UINT * const state)
+{
+    *state = *state * 1103515245 + 12345;
+    return (REAL)((*state >> 8) & 0xffffff) / 16777216.0;
+}
+
+static INT misc_merge_test(COMPLEX * const vals, const UINT n,
+    const REAL tol)
+{
+    COMPLEX ref[N];
+    UINT n_ref, n_merged = n;
+    INT ret_code;
+
+    memcpy(ref, vals, n * sizeof(COMPLEX));
+    n_ref = merge_ref(n, ref, tol);
+    ret_code = misc_merge(&n_merged, vals, tol);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (n_merged != n_ref || memcmp(vals, ref, n_ref * sizeof(COMPLEX)) != 0)
+        return E_TEST_FAILED;
+    return SUCCESS;
+}
+
+INT main()
+{
+    COMPLEX vals[N];
+    UINT i, state = 1;
+    INT ret_code;
+
+    // Clusters of nearby values in a small region, so that many values are
+    // merged and chains of values closer than tol occur
+    for (i=0; i<N; i++)
+        vals[i] = rnd(&state) + I*rnd(&state);
+    ret_code = misc_merge_test(vals, N, 0.02);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Values on the imaginary axis and values on the boundaries of cells,
+    // including negative ones
+    for (i=0; i<N; i++) {
+        if (i % 2)
+            vals[i] = I*0.001*(i % 97);
+        else
+            vals[i] = -0.001*(i % 53) + I*0.001*(i % 7);
+    }
+    ret_code = misc_merge_test(vals, N, 0.001);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Values that are not finite are kept
+    vals[0] = 1.0;
+    vals[1] = NAN;
+    vals[2] = INFINITY;
+    vals[3] = 1.0 + 1e-9*I;
+    vals[4] = INFINITY;
+    vals[5] = 1e300;
+    vals[6] = 1e300 - 1e-5*I;
+    ret_code = misc_merge_test(vals, 7, 1e-4);
+    CHECK_RETCODE(ret_code, leave_fun);
+    i = 7;
+    ret_code = misc_merge(&i, vals, 1e-4);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (i != 5) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__nse_fscatter.h"
+#include "fnft__nse_discretization.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+// Compares the analytic derivatives of the scattering matrix of a single
+// sample with finite differences of fourth order in the directions of the
+// real and of the imaginary part of the sample.
+static INT nse_fscatter_test_leaf_derivs(const COMPLEX q, const INT kappa,
+    nse_discretization_t discretization)
+{
+    const REAL eps_t = 0.1, h = 1e-3;
+    const REAL stencil[4] = { 1.0/12, -2.0/3, 2.0/3, -1.0/12 };
+    COMPLEX dp_dq[20], dp_dqc[20], p[20], fd[20], dir, q_pert;
+    REAL err, max_abs;
+    UINT deg, i, j, k;
+    INT ret_code;
+
+    deg = nse_discretization_degree(discretization);
+    ret_code = nse_fscatter_leaf_derivs(q, eps_t, kappa, dp_dq, dp_dqc,
+        discretization);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    for (j=0; j<2; j++) {
+        dir = j == 0 ? 1.0 : I;
+        for (i=0; i<4*(deg + 1); i++)
+            fd[i] = 0.0;
+        for (k=0; k<4; k++) {
+            q_pert = q + (k < 2 ? k - 2.0 : k - 1.0)*h*dir;
+            ret_code = nse_fscatter_leaves(1, &q_pert, eps_t, kappa, p,
+                discretization);
+            CHECK_RETCODE(ret_code, leave_fun);
+            for (i=0; i<4*(deg + 1); i++)
+                fd[i] += stencil[k]*p[i]/h;
+        }
+
+        // The directional derivative is dp_dq*dir + dp_dqc*conj(dir)
+        err = 0.0;
+        max_abs = 0.0;
+        for (i=0; i<4*(deg + 1); i++) {
+            if (CABS(fd[i]) > max_abs)
+                max_abs = CABS(fd[i]);
+            if (CABS(fd[i] - dp_dq[i]*dir - dp_dqc[i]*CONJ(dir)) > err)
+                err = CABS(fd[i] - dp_dq[i]*dir - dp_dqc[i]*CONJ(dir));
+        }
+        err /= max_abs;
+#ifdef DEBUG
+        printf("nse_fscatter_test_leaf_derivs: discretization %i, kappa %i, "
+            "direction %i: err = %2.1e\n", (int)discretization, (int)kappa,
+            (int)j, err);
+#endif
+        if (!(err <= 1e-10))
+            return E_TEST_FAILED;
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    nse_discretization_t discretizations[4] = {
+        nse_discretization_2SPLIT2_MODAL, nse_discretization_2SPLIT2A,
+        nse_discretization_2SPLIT4A, nse_discretization_2SPLIT4B };
+    COMPLEX q[3] = { 1.3 + 0.4*I, -0.2 + 2.5*I, 0.0 };
+    COMPLEX dp_dq[8], dp_dqc[8];
+    UINT i, j;
+    INT kappa;
+
+    for (i=0; i<4; i++) {
+        for (j=0; j<3; j++) {
+            for (kappa=-1; kappa<=1; kappa+=2) {
+                if (nse_fscatter_test_leaf_derivs(q[j], kappa,
+                    discretizations[i]) != SUCCESS)
+                    return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // The BO scheme has no polynomial scattering matrices
+    if (nse_fscatter_leaf_derivs(q[0], 0.1, 1, dp_dq, dp_dqc,
+        nse_discretization_BO) != FNFT_EC_INVALID_ARGUMENT)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
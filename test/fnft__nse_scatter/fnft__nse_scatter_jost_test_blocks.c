@@ -0,0 +1,94 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__nse_scatter.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h> // for printf
+#endif
+
+// Values of lambda are propagated through the signal in blocks, the
+// remaining ones one by one. Compares the Jost solutions for many values of
+// lambda, computed with several threads, with the ones obtained from one
+// call per value of lambda. Some values of lambda are large enough that the
+// Taylor series of cosh and sinh cannot be used within a block.
+static INT nse_scatter_jost_test_blocks(const INT kappa, const INT right_flag,
+    const INT nthreads)
+{
+    UINT i, k, D = 50;
+    const UINT K = 21; // two blocks and five remaining values
+    INT ret_code;
+    REAL T[2] = {-2.0, 3.0}, err = 0.0, max_abs = 0.0;
+    COMPLEX q[50], lam[21], jost[2*50*21], jost_k[2*50];
+
+    for (i=0; i<D; i++)
+        q[i] = 0.8*cos(i+1) + 0.6*I*sin(0.3*(i+1));
+    for (k=0; k<K; k++)
+        lam[k] = -3.0 + 0.3*k + 0.1*(k % 3)*I;
+    lam[3] = 45.0 + 0.2*I;
+    lam[12] = -60.0;
+    lam[19] = 50.0 - 0.1*I;
+
+    ret_code = nse_scatter_jost(D, q, T, kappa, K, lam, right_flag, jost,
+        nse_discretization_BO, nthreads);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+
+    for (k=0; k<K; k++) {
+        ret_code = nse_scatter_jost(D, q, T, kappa, 1, lam + k, right_flag,
+            jost_k, nse_discretization_BO, 0);
+        if (ret_code != SUCCESS)
+            return E_SUBROUTINE(ret_code);
+        for (i=0; i<2*D; i++) {
+            if (CABS(jost_k[i]) > max_abs)
+                max_abs = CABS(jost_k[i]);
+            if (CABS(jost[2*D*k + i] - jost_k[i]) > err)
+                err = CABS(jost[2*D*k + i] - jost_k[i]);
+        }
+    }
+    err /= max_abs;
+
+#ifdef DEBUG
+    printf("nse_scatter_jost_test_blocks: kappa=%i, right_flag=%i, "
+        "nthreads=%i: err = %2.1e\n", (int)kappa, (int)right_flag,
+        (int)nthreads, err);
+#endif
+    if (!(err <= 100*EPSILON))
+        return E_TEST_FAILED;
+    return SUCCESS;
+}
+
+INT main()
+{
+    const INT nthreads[3] = { 0, 3, -1 };
+    INT kappa, right_flag, i;
+
+    for (kappa=-1; kappa<=1; kappa+=2) {
+        for (right_flag=0; right_flag<=1; right_flag++) {
+            for (i=0; i<3; i++) {
+                if (nse_scatter_jost_test_blocks(kappa, right_flag,
+                    nthreads[i]) != SUCCESS)
+                    return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__nse_scatter.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h> // for printf
+#endif
+
+// The Wronskian phi1*psi2-phi2*psi1 of the left and right Jost solutions
+// is constant and equal to a(lambda) in the BO scheme. The values of a are
+// computed independently with nse_scatter_matrix.
+INT nse_scatter_jost_test_wronskian(const INT kappa)
+{
+    UINT i, k, D = 64;
+    const UINT K = 11; // more than one block
+    INT ret_code;
+    REAL eps_t, T[2] = {-2.0, 3.0}, err, max_err = 0.0;
+    COMPLEX q[64], lam[11], phi[2*64*11], psi[2*64*11], S[8*11], a, W;
+
+    eps_t = (T[1] - T[0])/(D - 1);
+    for (i=0; i<D; i++)
+        q[i] = 0.4*cos(i+1) + 0.5*I*sin(0.3*(i+1));
+    for (k=0; k<K; k++)
+        lam[k] = -2.0 + 0.4*k + 0.1*(k % 3)*I;
+
+    ret_code = nse_scatter_jost(D, q, T, kappa, K, lam, 0, phi,
+        nse_discretization_BO, 0);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    ret_code = nse_scatter_jost(D, q, T, kappa, K, lam, 1, psi,
+        nse_discretization_BO, 0);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    ret_code = nse_scatter_matrix(D, q, eps_t, kappa, K, lam, S,
+        nse_discretization_BO);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+
+    for (k=0; k<K; k++) {
+        a = S[8*k]*CEXP(I*lam[k]*(T[1] - T[0] + eps_t));
+        for (i=0; i<D; i++) {
+            W = phi[2*D*k + i]*psi[2*D*k + D + i]
+                - phi[2*D*k + D + i]*psi[2*D*k + i];
+            err = CABS(W - a)/CABS(a);
+            if (err > max_err)
+                max_err = err;
+        }
+    }
+#ifdef DEBUG
+    printf("nse_scatter_jost_test_wronskian(kappa=%i): err = %2.1e\n",
+        (int)kappa, max_err);
+#endif
+    if (!(max_err <= 1000*EPSILON))
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
+// At bound states, the left Jost solution is a multiple of the right one.
+// The factor is the norming constant. The bound states of the signal are
+// first refined w.r.t. the BO scheme with a few Newton steps. Any remaining
+// error in a(lambda) is amplified exponentially in the tails, which is why
+// the solutions are only compared in the center.
+INT nse_scatter_jost_test_bound_states()
+{
+    UINT i, k, iter, D = 256;
+    INT ret_code;
+    REAL eps_t, T[2] = {-16,16}, t, err, max_err = 0.0, nrm;
+    COMPLEX q[256], phi[2*256*3], psi[2*256*3];
+    COMPLEX a_vals[3], aprime_vals[3], b_vals[3];
+    COMPLEX bound_states[3] = {0.5*I, 1.5*I, 2.5*I};
+    UINT trunc_index = D;
+
+    eps_t = (T[1] - T[0])/(D - 1);
+    for (i=0; i<D; i++)
+        q[i] = 3.0*misc_sech(T[0] + i*eps_t);
+    for (iter=0; iter<5; iter++) {
+        ret_code = nse_scatter_bound_states(D, q, T, &trunc_index, 3,
+            bound_states, a_vals, aprime_vals, b_vals, nse_discretization_BO);
+        if (ret_code != SUCCESS)
+            return E_SUBROUTINE(ret_code);
+        for (k=0; k<3; k++)
+            bound_states[k] -= a_vals[k]/aprime_vals[k];
+    }
+    ret_code = nse_scatter_bound_states(D, q, T, &trunc_index, 3,
+        bound_states, a_vals, aprime_vals, b_vals, nse_discretization_BO);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    ret_code = nse_scatter_jost(D, q, T, +1, 3, bound_states, 0, phi,
+        nse_discretization_BO, 0);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    ret_code = nse_scatter_jost(D, q, T, +1, 3, bound_states, 1, psi,
+        nse_discretization_BO, 0);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+
+    for (k=0; k<3; k++) {
+        nrm = 0.0;
+        for (i=0; i<2*D; i++) {
+            if (CABS(phi[2*D*k + i]) > nrm)
+                nrm = CABS(phi[2*D*k + i]);
+        }
+        for (i=0; i<2*D; i++) {
+            t = T[0] + (i % D)*eps_t;
+            if (FABS(t) > 4.0)
+                continue;
+            err = CABS(phi[2*D*k + i] - b_vals[k]*psi[2*D*k + i])/nrm;
+            if (err > max_err)
+                max_err = err;
+        }
+    }
+#ifdef DEBUG
+    printf("nse_scatter_jost_test_bound_states: err = %2.1e\n", max_err);
+#endif
+    if (!(max_err <= 1e-6))
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
+INT main()
+{
+    if (nse_scatter_jost_test_wronskian(+1) != SUCCESS)
+        return EXIT_FAILURE;
+    if (nse_scatter_jost_test_wronskian(-1) != SUCCESS)
+        return EXIT_FAILURE;
+    if (nse_scatter_jost_test_bound_states() != SUCCESS)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__nse_scatter.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+// Compares the values and first derivatives with nse_scatter_matrix and the
+// second derivatives with central differences of the first ones. The values
+// of lambda are chosen such that both the series and the closed-form
+// expressions for the step matrices are used.
+INT nse_scatter_matrix_d2_test_bo(const INT kappa)
+{
+    UINT i, j, D = 8;
+    INT ret_code;
+    const REAL eps_t = 0.13, h = 1e-4;
+    COMPLEX q[8];
+    COMPLEX lam[3] = {2, 1+0.5*I, 10-0.3*I}, lam_pm[2];
+    COMPLEX result[12*3], result_ref[8], result_pm[2*8];
+    COMPLEX first[8*3], first_ref[8*3], second[4*3], second_ref[4*3];
+
+    for (i=0; i<D; i++)
+        q[i] = 0.4*cos(i+1) + 0.5*I*sin(0.3*(i+1));
+
+    ret_code = nse_scatter_matrix_d2(D, q, eps_t, kappa, 3, lam, result,
+        nse_discretization_BO);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+
+    for (i=0; i<3; i++) {
+        ret_code = nse_scatter_matrix(D, q, eps_t, kappa, 1, &lam[i],
+            result_ref, nse_discretization_BO);
+        if (ret_code != SUCCESS)
+            return E_SUBROUTINE(ret_code);
+        lam_pm[0] = lam[i] + h;
+        lam_pm[1] = lam[i] - h;
+        ret_code = nse_scatter_matrix(D, q, eps_t, kappa, 2, lam_pm,
+            result_pm, nse_discretization_BO);
+        if (ret_code != SUCCESS)
+            return E_SUBROUTINE(ret_code);
+        for (j=0; j<8; j++) {
+            first[8*i + j] = result[12*i + j];
+            first_ref[8*i + j] = result_ref[j];
+        }
+        for (j=0; j<4; j++) {
+            second[4*i + j] = result[12*i + 8 + j];
+            second_ref[4*i + j] = (result_pm[4 + j] - result_pm[12 + j])
+                / (2*h);
+        }
+    }
+
+    if (misc_rel_err(8*3, first, first_ref) > 100*EPSILON)
+        return E_TEST_FAILED;
+    if (misc_rel_err(4*3, second, second_ref) > 1e-7)
+        return E_TEST_FAILED;
+
+    // Only the BO scheme is supported
+    if (nse_scatter_matrix_d2(D, q, eps_t, kappa, 1, lam, result,
+        nse_discretization_2SPLIT2A) != FNFT_EC_INVALID_ARGUMENT)
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
+INT main()
+{
+    if (nse_scatter_matrix_d2_test_bo(+1) != SUCCESS)
+        return EXIT_FAILURE;
+    if (nse_scatter_matrix_d2_test_bo(-1) != SUCCESS)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -70,10 +70,78 @@ INT poly_chirpz_test()
     return SUCCESS;
 }
 
+// Evaluates a polynomial on several spirals at once and compares the
+// results with those obtained by Horner's scheme.
+INT poly_chirpz_multi_test()
+{
+    const UINT deg = 3, R = 3, M = 6;
+    COMPLEX p[4] = {1+2*I, -3-0.5*I, 0.3, -0.4*I};
+    COMPLEX A[3] = {0.95, 1.0, 1.1*CEXP(0.2*I)};
+    COMPLEX result[18], result_exact[18], W, z;
+    UINT r, m, n;
+    INT ret_code;
+
+    W = CEXP(0.3*I);
+    for (r=0; r<R; r++) {
+        for (m=0; m<M; m++) {
+            z = 1.0/(A[r]*CPOW(W, -1.0*m));
+            result_exact[r*M + m] = p[0];
+            for (n=1; n<=deg; n++)
+                result_exact[r*M + m] = result_exact[r*M + m]*z + p[n];
+        }
+    }
+
+    ret_code = poly_chirpz_multi(deg, p, R, A, W, M, result);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (misc_rel_err(R*M, result, result_exact) > 100*EPSILON)
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
+// Evaluates several polynomials on the same spiral at once and compares
+// the results with those obtained by Horner's scheme.
+INT poly_chirpz_batch_test()
+{
+    const UINT deg = 3, R = 3, M = 6, stride = 5;
+    COMPLEX p[15] = {1+2*I, -3-0.5*I, 0.3, -0.4*I, 99.0,
+        0.5, 2.0*I, -1.0, 1.5-I, 99.0,
+        -I, 0.2, 0.0, 3.0+0.1*I, 99.0};
+    COMPLEX A, W, z, result[18], result_exact[18];
+    UINT r, m, n;
+    INT ret_code;
+
+    A = 0.95;
+    W = CEXP(0.3*I);
+    for (r=0; r<R; r++) {
+        for (m=0; m<M; m++) {
+            z = 1.0/(A*CPOW(W, -1.0*m));
+            result_exact[r*M + m] = p[r*stride];
+            for (n=1; n<=deg; n++) {
+                result_exact[r*M + m] = result_exact[r*M + m]*z
+                    + p[r*stride + n];
+            }
+        }
+    }
+
+    ret_code = poly_chirpz_batch(deg, R, p, stride, A, W, M, result);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (misc_rel_err(R*M, result, result_exact) > 100*EPSILON)
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
 INT main()
 {
     if (poly_chirpz_test() != SUCCESS)
         return EXIT_FAILURE;
+    if (poly_chirpz_multi_test() != SUCCESS)
+        return EXIT_FAILURE;
+    if (poly_chirpz_batch_test() != SUCCESS)
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 }
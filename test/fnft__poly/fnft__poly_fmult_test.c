@@ -19,6 +19,7 @@
 
 #define FNFT_ENABLE_SHORT_NAMES
 
+#include <string.h>
 #include "fnft__poly_fmult.h"
 #include "fnft__misc.h"
 #include "fnft__errwarn.h"
@@ -178,6 +179,430 @@ static INT poly_fmult2x2_test(INT normalize_flag)
     return SUCCESS;
 }
 
+// Multiplies the same four 2x2 matrix-valued polynomials as
+// poly_fmult2x2_test, but as P0*(P1*(P2*P3)) with factors of different
+// degrees.
+static INT poly_fmult2x2_pair_test(INT normalize_flag)
+{
+    UINT i, j, k;
+    INT W, W_total = 0, *W_ptr = NULL;
+    REAL scl;
+    INT ret_code;
+    COMPLEX p[32], P[4][8], r2[12], r3[16], r4[20];
+    COMPLEX result_exact[20] = { \
+        60.6824426714241 + I*64.8661118935554, \
+        192.332936227757 - I*1.10233198818688, \
+        162.110387625956 - I*111.127467380607, \
+       -89.7931323551994 - I*80.292426677456, \
+        10.9405573209266 + I*121.130913146948, \
+        60.232171606396 + I*70.7074200214283, \
+        188.004055601206 + I*7.96812436286603, \
+        156.207023899884 - I*102.153018093302, \
+       -100.627468409158 - I*80.5748163736639, \
+        14.8569933196036 + I*113.838094358267, \
+        46.5859268828598 + I*75.6288485779254, \
+        171.341929283725 - I*10.2410011372218, \
+        155.475099221666 - I*110.340545813463, \
+       -117.458524441818 - I*87.5204294848652, \
+        31.9873641358437 + I*114.857725853133, \
+          44.9841424843245 + I*81.2642643937605, \
+          166.826592700681 - I*5.16720885749995, \
+          155.130568557566 - I*102.464890587643, \
+          -127.981613283912 - I*83.7735775388555, \
+          34.4728506991058 + I*107.132856593172};
+
+    for (i=0; i<8; i++) {
+        p[i] = SQRT(i+1.0)*(COS(i) + I*SIN(-2.0*i));
+        p[i+8] = SQRT(i+1.0)*(COS(i+0.1) + I*SIN(-2.0*i+0.1));
+        p[i+16] = SQRT(i+1.0)*(COS(i+0.2) + I*SIN(-2.0*i+0.2));
+        p[i+24] = SQRT(i+1.0)*(COS(i+0.3) + I*SIN(-2.0*i+0.3));
+    }
+
+    // Extract the individual 2x2 matrix-valued polynomials of degree one
+    for (k=0; k<4; k++) {
+        for (j=0; j<4; j++) {
+            P[k][2*j] = p[8*j + 2*k];
+            P[k][2*j+1] = p[8*j + 2*k + 1];
+        }
+    }
+
+    if (normalize_flag)
+        W_ptr = &W;
+    ret_code = poly_fmult2x2_pair(1, P[2], 1, P[3], r2, W_ptr);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (normalize_flag)
+        W_total += W;
+    ret_code = poly_fmult2x2_pair(1, P[1], 2, r2, r3, W_ptr);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (normalize_flag)
+        W_total += W;
+    ret_code = poly_fmult2x2_pair(1, P[0], 3, r3, r4, W_ptr);
+    if (ret_code != SUCCESS)
+        return E_SUBROUTINE(ret_code);
+    if (normalize_flag) {
+        W_total += W;
+        if (W_total == 0)
+            return E_TEST_FAILED;
+        scl = POW(2.0, W_total);
+        for (i=0; i<20; i++)
+            r4[i] *= scl;
+    }
+    if (misc_rel_err(20, r4, result_exact) > 100*EPSILON)
+        return E_TEST_FAILED;
+
+    return SUCCESS;
+}
+
+// Multiplies the same four 2x2 matrix-valued polynomials as
+// poly_fmult2x2_test using a product tree, checks the adjoint of the product
+// tree and updates one of the factors.
+static INT poly_fmult2x2_tree_test(INT normalize_flag)
+{
+    UINT i, j, idx = 2;
+    INT W0, W;
+    REAL scl, lhs, rhs;
+    INT ret_code = SUCCESS;
+    COMPLEX p[32], result[20], G[20], G_leaves[32], delta[8];
+    COMPLEX c = 0.5 + 0.25*I;
+    poly_fmult2x2_tree_t *tree = NULL;
+    COMPLEX result_exact[20] = { \
+        60.6824426714241 + I*64.8661118935554, \
+        192.332936227757 - I*1.10233198818688, \
+        162.110387625956 - I*111.127467380607, \
+       -89.7931323551994 - I*80.292426677456, \
+        10.9405573209266 + I*121.130913146948, \
+        60.232171606396 + I*70.7074200214283, \
+        188.004055601206 + I*7.96812436286603, \
+        156.207023899884 - I*102.153018093302, \
+       -100.627468409158 - I*80.5748163736639, \
+        14.8569933196036 + I*113.838094358267, \
+        46.5859268828598 + I*75.6288485779254, \
+        171.341929283725 - I*10.2410011372218, \
+        155.475099221666 - I*110.340545813463, \
+       -117.458524441818 - I*87.5204294848652, \
+        31.9873641358437 + I*114.857725853133, \
+          44.9841424843245 + I*81.2642643937605, \
+          166.826592700681 - I*5.16720885749995, \
+          155.130568557566 - I*102.464890587643, \
+          -127.981613283912 - I*83.7735775388555, \
+          34.4728506991058 + I*107.132856593172};
+
+    for (i=0; i<8; i++) {
+        p[i] = SQRT(i+1.0)*(COS(i) + I*SIN(-2.0*i));
+        p[i+8] = SQRT(i+1.0)*(COS(i+0.1) + I*SIN(-2.0*i+0.1));
+        p[i+16] = SQRT(i+1.0)*(COS(i+0.2) + I*SIN(-2.0*i+0.2));
+        p[i+24] = SQRT(i+1.0)*(COS(i+0.3) + I*SIN(-2.0*i+0.3));
+    }
+
+    ret_code = poly_fmult2x2_tree_create(1, 4, p, normalize_flag, &tree);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_root(tree, &i, result, &W0);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (i != 4 || (normalize_flag && W0 == 0) || (!normalize_flag && W0 != 0)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    scl = POW(2.0, W0);
+    for (i=0; i<20; i++)
+        result[i] *= scl;
+    if (misc_rel_err(20, result, result_exact) > 100*EPSILON) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // The product is linear in each factor. The adjoint G_leaves of the
+    // factors therefore has to satisfy Re(<G, P(delta)>) = Re(<G_leaves,
+    // delta>), where P(delta) is the normalized product after one of the
+    // factors has been replaced by delta.
+    for (i=0; i<20; i++)
+        G[i] = COS(0.3*i) + I*SIN(0.7*i + 1.0);
+    ret_code = poly_fmult2x2_tree_adjoint(tree, G, G_leaves);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<8; i++)
+        delta[i] = COS(1.1*i + 0.5) - I*SIN(0.2*i);
+    ret_code = poly_fmult2x2_tree_update(tree, 1, &idx, delta);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_root(tree, NULL, result, &W);
+    CHECK_RETCODE(ret_code, release_mem);
+    scl = POW(2.0, W - W0);
+    lhs = 0.0;
+    for (i=0; i<20; i++)
+        lhs += CREAL(CONJ(G[i]) * scl * result[i]);
+    rhs = 0.0;
+    for (j=0; j<4; j++) {
+        for (i=0; i<2; i++)
+            rhs += CREAL(CONJ(G_leaves[8*j + 2*idx + i]) * delta[2*j + i]);
+    }
+    if (FABS(lhs - rhs) > 100*EPSILON*FABS(rhs)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // Replace the factor by c times the original factor
+    for (j=0; j<4; j++) {
+        for (i=0; i<2; i++)
+            delta[2*j + i] = c * p[8*j + 2*idx + i];
+    }
+    ret_code = poly_fmult2x2_tree_update(tree, 1, &idx, delta);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = poly_fmult2x2_tree_root(tree, NULL, result, &W);
+    CHECK_RETCODE(ret_code, release_mem);
+    scl = POW(2.0, W);
+    for (i=0; i<20; i++)
+        result[i] *= scl / c;
+    if (misc_rel_err(20, result, result_exact) > 100*EPSILON) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+release_mem:
+    poly_fmult2x2_tree_free(tree);
+    return ret_code;
+}
+
+// Multiplies n=3,5,6,7 polynomials and 2x2 matrix-valued polynomials of
+// degree two, i.e., numbers of factors that are not powers of two. The
+// results are compared with products that are computed one factor at a
+// time. The adjoint of the product tree is checked as in
+// poly_fmult2x2_tree_test, for the first and the last factor.
+static INT poly_fmult_odd_test(INT normalize_flag)
+{
+    const UINT deg = 2, ns[4] = { 3, 5, 6, 7 };
+    UINT i, j, k, l, n, d, idx[2];
+    INT W, W0, W1, *W_ptr = NULL;
+    REAL scl, lhs, rhs;
+    INT ret_code = SUCCESS;
+    COMPLEX p[4*7*3], q[4*7*3], r[4*(7*2+1)], ref[4*(7*2+1)];
+    COMPLEX result[4*(7*2+4)], G[4*(7*2+1)], G_leaves[4*7*3], delta[12];
+    poly_fmult2x2_tree_t *tree = NULL;
+
+    if (normalize_flag)
+        W_ptr = &W;
+    for (k=0; k<4; k++) {
+        n = ns[k];
+        for (i=0; i<4*n*(deg+1); i++)
+            p[i] = SQRT(i+1.0)*(COS(i) + I*SIN(-2.0*i + 0.1*(i%4)));
+
+        // Reference: ref = p_0*p_1*...*p_{n-1}, one factor at a time
+        memcpy(ref, p, (deg+1)*sizeof(COMPLEX));
+        for (j=1; j<4; j++)
+            memcpy(ref + j*(deg+1), p + j*n*(deg+1),
+                (deg+1)*sizeof(COMPLEX));
+        W0 = 0;
+        for (i=1; i<n; i++) {
+            for (j=0; j<4; j++)
+                memcpy(q + j*(deg+1), p + (j*n + i)*(deg+1),
+                    (deg+1)*sizeof(COMPLEX));
+            ret_code = poly_fmult2x2_pair(i*deg, ref, deg, q, r, &W1);
+            CHECK_RETCODE(ret_code, release_mem);
+            W0 += W1;
+            memcpy(ref, r, 4*((i+1)*deg+1)*sizeof(COMPLEX));
+        }
+        scl = POW(2.0, W0);
+        for (i=0; i<4*(n*deg+1); i++)
+            ref[i] *= scl;
+
+        // Scalar product of the upper left entries
+        memcpy(q, p, n*(deg+1)*sizeof(COMPLEX));
+        d = deg;
+        ret_code = poly_fmult(&d, n, q, W_ptr);
+        CHECK_RETCODE(ret_code, release_mem);
+        scl = normalize_flag ? POW(2.0, W) : 1.0;
+        for (i=0; i<=d; i++)
+            q[i] *= scl;
+        if (d != n*deg) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+        // The reference has to be recomputed for the 1x1 case
+        memcpy(r, p, (deg+1)*sizeof(COMPLEX));
+        for (i=1; i<n; i++) {
+            for (j=0; j<=(i+1)*deg; j++) {
+                G[j] = 0.0;
+                for (l=0; l<=deg && l<=j; l++) {
+                    if (j - l <= i*deg)
+                        G[j] += r[j - l]*p[i*(deg+1) + l];
+                }
+            }
+            memcpy(r, G, ((i+1)*deg+1)*sizeof(COMPLEX));
+        }
+        if (misc_rel_err(d+1, q, r) > 1000*EPSILON) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+
+        // 2x2 product
+        memcpy(q, p, 4*n*(deg+1)*sizeof(COMPLEX));
+        d = deg;
+        ret_code = poly_fmult2x2(&d, n, q, result, W_ptr);
+        CHECK_RETCODE(ret_code, release_mem);
+        scl = normalize_flag ? POW(2.0, W) : 1.0;
+        for (i=0; i<4*(d+1); i++)
+            result[i] *= scl;
+        if (d != n*deg
+            || misc_rel_err(4*(d+1), result, ref) > 1000*EPSILON) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+
+        // Product tree
+        ret_code = poly_fmult2x2_tree_create(deg, n, p, normalize_flag,
+            &tree);
+        CHECK_RETCODE(ret_code, release_mem);
+        ret_code = poly_fmult2x2_tree_root(tree, &d, result, &W0);
+        CHECK_RETCODE(ret_code, release_mem);
+        scl = POW(2.0, W0);
+        for (i=0; i<4*(d+1); i++)
+            result[i] *= scl;
+        if (d != n*deg
+            || misc_rel_err(4*(d+1), result, ref) > 1000*EPSILON) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+        for (i=0; i<4*(d+1); i++)
+            G[i] = COS(0.3*i) + I*SIN(0.7*i + 1.0);
+        ret_code = poly_fmult2x2_tree_adjoint(tree, G, G_leaves);
+        CHECK_RETCODE(ret_code, release_mem);
+        idx[0] = 0;
+        idx[1] = n - 1;
+        for (l=0; l<2; l++) {
+            for (i=0; i<4*(deg+1); i++)
+                delta[i] = COS(1.1*i + 0.5*l) - I*SIN(0.2*i);
+            ret_code = poly_fmult2x2_tree_update(tree, 1, idx + l, delta);
+            CHECK_RETCODE(ret_code, release_mem);
+            ret_code = poly_fmult2x2_tree_root(tree, NULL, result, &W);
+            CHECK_RETCODE(ret_code, release_mem);
+            scl = POW(2.0, W - W0);
+            lhs = 0.0;
+            for (i=0; i<4*(d+1); i++)
+                lhs += CREAL(CONJ(G[i]) * scl * result[i]);
+            rhs = 0.0;
+            for (j=0; j<4; j++) {
+                for (i=0; i<=deg; i++)
+                    rhs += CREAL(CONJ(G_leaves[(j*n + idx[l])*(deg+1) + i])
+                        * delta[j*(deg+1) + i]);
+            }
+            if (FABS(lhs - rhs) > 1000*EPSILON*FABS(rhs)) {
+                ret_code = E_TEST_FAILED;
+                goto release_mem;
+            }
+
+            // Restore the factor
+            for (j=0; j<4; j++)
+                memcpy(delta + j*(deg+1), p + (j*n + idx[l])*(deg+1),
+                    (deg+1)*sizeof(COMPLEX));
+            ret_code = poly_fmult2x2_tree_update(tree, 1, idx + l, delta);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+        poly_fmult2x2_tree_free(tree);
+        tree = NULL;
+    }
+
+release_mem:
+    poly_fmult2x2_tree_free(tree);
+    return ret_code;
+}
+
+// Compares poly_fmult2x2_fd with poly_fmult2x2 for various degrees and
+// numbers of factors.
+static INT poly_fmult2x2_fd_test(INT normalize_flag)
+{
+    UINT i, n, deg, d1, d2;
+    INT W1 = 0, W2 = 0, *W1_ptr = NULL, *W2_ptr = NULL;
+    REAL scl;
+    COMPLEX p[4*9*4], q[4*9*4], r1[4*(9*3+5)], r2[4*(9*3+1)];
+    INT ret_code = SUCCESS;
+
+    if (normalize_flag) {
+        W1_ptr = &W1;
+        W2_ptr = &W2;
+    }
+    for (deg=1; deg<=3; deg++) {
+        for (n=1; n<=9; n++) {
+            for (i=0; i<4*n*(deg+1); i++) {
+                p[i] = SQRT(i+1.0)*(COS(i) + I*SIN(-2.0*i + 0.1*(i%4)));
+                q[i] = p[i];
+            }
+            d1 = deg;
+            ret_code = poly_fmult2x2(&d1, n, q, r1, W1_ptr);
+            CHECK_RETCODE(ret_code, leave_fun);
+            d2 = deg;
+            ret_code = poly_fmult2x2_fd(&d2, n, p, r2, W2_ptr);
+            CHECK_RETCODE(ret_code, leave_fun);
+            scl = POW(2.0, W2 - W1);
+            for (i=0; i<4*(d2+1); i++)
+                r2[i] *= scl;
+            if (d1 != n*deg || d2 != d1
+                || misc_rel_err(4*(d1+1), r2, r1) > 1000*EPSILON) {
+                ret_code = E_TEST_FAILED;
+                goto leave_fun;
+            }
+        }
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+// Compares poly_fmult2x2_multi with separate calls of poly_fmult2x2 for
+// various degrees and numbers of factors. For n>=16, both the direct and
+// the FFT-based levels are used.
+static INT poly_fmult2x2_multi_test(INT normalize_flag)
+{
+    const UINT nsets = 3, n_max = 40, deg_max = 3;
+    UINT i, t, n, deg, d1, d2;
+    INT W1 = 0, *W1_ptr = NULL, W2[3] = { 0 }, *W2_ptr = NULL;
+    REAL scl;
+    COMPLEX *p = NULL, *q = NULL, *r1 = NULL, *r2 = NULL;
+    INT ret_code = SUCCESS;
+
+    p = malloc(nsets*4*n_max*(deg_max+1) * sizeof(COMPLEX));
+    q = malloc(4*n_max*(deg_max+1) * sizeof(COMPLEX));
+    r1 = malloc(4*(n_max*deg_max + (n_max+1)/2) * sizeof(COMPLEX));
+    r2 = malloc(nsets*4*(n_max*deg_max+1) * sizeof(COMPLEX));
+    if (p == NULL || q == NULL || r1 == NULL || r2 == NULL) {
+        ret_code = E_NOMEM;
+        goto leave_fun;
+    }
+    if (normalize_flag) {
+        W1_ptr = &W1;
+        W2_ptr = W2;
+    }
+    for (deg=1; deg<=deg_max; deg++) {
+        for (n=1; n<=n_max; n+=(n<9 ? 1 : 7)) {
+            for (i=0; i<nsets*4*n*(deg+1); i++)
+                p[i] = SQRT(i+1.0)*(COS(i) + I*SIN(-2.0*i + 0.1*(i%4)));
+            d2 = deg;
+            ret_code = poly_fmult2x2_multi(&d2, n, nsets, p, r2, W2_ptr);
+            CHECK_RETCODE(ret_code, leave_fun);
+            for (t=0; t<nsets; t++) {
+                memcpy(q, p + t*4*n*(deg+1), 4*n*(deg+1)*sizeof(COMPLEX));
+                d1 = deg;
+                ret_code = poly_fmult2x2(&d1, n, q, r1, W1_ptr);
+                CHECK_RETCODE(ret_code, leave_fun);
+                scl = POW(2.0, W2[t] - W1);
+                for (i=0; i<4*(d2+1); i++)
+                    r2[t*4*(d2+1) + i] *= scl;
+                if (d1 != n*deg || d2 != d1
+                    || misc_rel_err(4*(d1+1), r2 + t*4*(d2+1), r1)
+                    > 1000*EPSILON) {
+                    ret_code = E_TEST_FAILED;
+                    goto leave_fun;
+                }
+            }
+        }
+    }
+
+leave_fun:
+    free(p);
+    free(q);
+    free(r1);
+    free(r2);
+    return ret_code;
+}
+
 INT main(void)
 {
     INT ret_code;
@@ -208,5 +633,65 @@ INT main(void)
         return EXIT_FAILURE;
     }
 
+    ret_code = poly_fmult2x2_pair_test(0); // different degrees
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_pair_test(1); // ... with normalization
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_tree_test(0); // product tree
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_tree_test(1); // ... with normalization
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult_odd_test(0); // n is not a power of two
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult_odd_test(1); // ... with normalization
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_fd_test(0); // in the frequency domain
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_fd_test(1); // ... with normalization
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_multi_test(0); // several sets in lockstep
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
+    ret_code = poly_fmult2x2_multi_test(1); // ... with normalization
+    if (ret_code != SUCCESS) {
+        E_SUBROUTINE(ret_code);
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,120 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft__poly_roots_fasteigen.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define DEG 24
+#define NPOLY 7
+
+// Computes the coefficients of the polynomial with the given roots in
+// descending order.
+static void poly_from_roots(const UINT deg, COMPLEX const * const r,
+    COMPLEX * const p)
+{
+    UINT i, j;
+
+    p[0] = 1.0;
+    for (i=0; i<deg; i++) {
+        p[i+1] = 0.0;
+        for (j=i+1; j>=1; j--)
+            p[j] -= r[i]*p[j-1];
+    }
+}
+
+// Solves NPOLY polynomials with known roots with poly_roots_fasteigen_batch
+// and compares the results with those of poly_roots_fasteigen_ws and the
+// exact roots. (The eigenvalue solver uses random shifts, which is why the
+// results of different calls only agree up to rounding errors.)
+static INT poly_roots_fasteigen_test_batch(const UINT nthreads)
+{
+    COMPLEX r[NPOLY*DEG], p[NPOLY*(DEG+1)], roots[NPOLY*DEG], roots1[DEG];
+    INT status[NPOLY];
+    poly_roots_fasteigen_ws_t *ws = NULL;
+    UINT i, k;
+    INT ret_code = SUCCESS;
+
+    // Roots on circles with different radii. The last polynomial has a
+    // large constant term, so that the QZ variant of the solver is used.
+    for (i=0; i<NPOLY; i++) {
+        for (k=0; k<DEG; k++) {
+            r[i*DEG + k] = (0.6 + 0.1*i + 0.01*k)
+                * CEXP(I*(2*PI*k/DEG + 0.3*i));
+            if (i == NPOLY-1)
+                r[i*DEG + k] *= 3.0;
+        }
+        poly_from_roots(DEG, r + i*DEG, p + i*(DEG+1));
+        status[i] = -1;
+    }
+
+    ret_code = poly_roots_fasteigen_batch(DEG, NPOLY, p, roots, status,
+        nthreads);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = poly_roots_fasteigen_ws_create(DEG, &ws);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    for (i=0; i<NPOLY; i++) {
+        if (status[i] != SUCCESS) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+        ret_code = poly_roots_fasteigen_ws(ws, p + i*(DEG+1), roots1);
+        CHECK_RETCODE(ret_code, leave_fun);
+        if (!(misc_hausdorff_dist(DEG, roots + i*DEG, DEG, roots1) <= 1e-10)
+            || !(misc_hausdorff_dist(DEG, roots + i*DEG, DEG, r + i*DEG)
+            <= 1e-8)) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+
+leave_fun:
+    poly_roots_fasteigen_ws_free(ws);
+    return ret_code;
+}
+
+INT main()
+{
+    COMPLEX p[3] = { 1.0, 0.0, -1.0 }, roots[2];
+    INT status[1];
+    poly_roots_fasteigen_ws_t *ws = NULL;
+
+    // In the calling thread, one thread per polynomial, and fewer threads
+    // than polynomials
+    if (poly_roots_fasteigen_test_batch(1) != SUCCESS
+        || poly_roots_fasteigen_test_batch(0) != SUCCESS
+        || poly_roots_fasteigen_test_batch(NPOLY) != SUCCESS
+        || poly_roots_fasteigen_test_batch(3) != SUCCESS)
+        return EXIT_FAILURE;
+
+    // Empty batches are fine, invalid arguments must be rejected
+    if (poly_roots_fasteigen_batch(2, 0, p, roots, status, 0) != SUCCESS
+        || poly_roots_fasteigen_batch(1, 1, p, roots, status, 0)
+        != FNFT_EC_INVALID_ARGUMENT
+        || poly_roots_fasteigen_batch(2, 1, p, roots, NULL, 0)
+        != FNFT_EC_INVALID_ARGUMENT
+        || poly_roots_fasteigen_ws_create(1, &ws) != FNFT_EC_INVALID_ARGUMENT
+        || poly_roots_fasteigen_ws(NULL, p, roots)
+        != FNFT_EC_INVALID_ARGUMENT)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
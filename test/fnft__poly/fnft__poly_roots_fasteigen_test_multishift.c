@@ -0,0 +1,119 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft__poly_roots_fasteigen.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define DEG 1200
+
+// Computes the roots of a polynomial with pseudo-random coefficients with
+// poly_roots_fasteigen_multishift for different numbers of shifts and
+// threads and compares them with the roots found by poly_roots_fasteigen.
+// (The single shift solver uses random shifts, which is why the results
+// only agree up to rounding errors.) The roots must not depend on the
+// number of threads.
+static INT poly_roots_fasteigen_test_multishift(const REAL scl)
+{
+    COMPLEX *p = NULL, *roots = NULL, *roots1 = NULL, *roots2 = NULL;
+    UINT i, state = 12345;
+    REAL re, im, dist;
+    INT ret_code = SUCCESS;
+
+    p = malloc((DEG+1) * sizeof(COMPLEX));
+    roots = malloc(DEG * sizeof(COMPLEX));
+    roots1 = malloc(DEG * sizeof(COMPLEX));
+    roots2 = malloc(DEG * sizeof(COMPLEX));
+    if (p == NULL || roots == NULL || roots1 == NULL || roots2 == NULL) {
+        ret_code = E_NOMEM;
+        goto leave_fun;
+    }
+    for (i=0; i<=DEG; i++) {
+        state = 1103515245*state + 12345;
+        re = (REAL)(state % 65536) / 32768.0 - 1.0;
+        state = 1103515245*state + 12345;
+        im = (REAL)(state % 65536) / 32768.0 - 1.0;
+        p[i] = re + I*im;
+    }
+    // If scl is large, the constant term dominates and the multishift
+    // solver falls back to the QZ algorithm
+    p[DEG] *= scl;
+
+    ret_code = poly_roots_fasteigen(DEG, p, roots);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    ret_code = poly_roots_fasteigen_multishift(DEG, p, roots1, 8, 1);
+    CHECK_RETCODE(ret_code, leave_fun);
+    dist = misc_hausdorff_dist(DEG, roots, DEG, roots1);
+#ifdef DEBUG
+    printf("poly_roots_fasteigen_test_multishift: dist = %g\n", dist);
+#endif
+    if (!(dist <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    ret_code = poly_roots_fasteigen_multishift(DEG, p, roots2, 8, 3);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (memcmp(roots1, roots2, DEG * sizeof(COMPLEX)) != 0) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // Default number of shifts and threads
+    ret_code = poly_roots_fasteigen_multishift(DEG, p, roots2, 0, 0);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (!(misc_hausdorff_dist(DEG, roots, DEG, roots2) <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    free(p);
+    free(roots);
+    free(roots1);
+    free(roots2);
+    return ret_code;
+}
+
+INT main()
+{
+    COMPLEX p[3] = { 1.0, 0.0, -1.0 }, roots[2], exact[2] = { 1.0, -1.0 };
+
+    // Multishift QR and QZ fallback
+    if (poly_roots_fasteigen_test_multishift(1.0) != SUCCESS
+        || poly_roots_fasteigen_test_multishift(1e10) != SUCCESS)
+        return EXIT_FAILURE;
+
+    // Small degrees are fine, invalid arguments must be rejected
+    if (poly_roots_fasteigen_multishift(2, p, roots, 0, 0) != SUCCESS
+        || !(misc_hausdorff_dist(2, roots, 2, exact) <= 1e-14)
+        || poly_roots_fasteigen_multishift(1, p, roots, 0, 0)
+        != FNFT_EC_INVALID_ARGUMENT
+        || poly_roots_fasteigen_multishift(2, NULL, roots, 0, 0)
+        != FNFT_EC_INVALID_ARGUMENT
+        || poly_roots_fasteigen_multishift(2, p, NULL, 0, 0)
+        != FNFT_EC_INVALID_ARGUMENT)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "fnft_nsev.h"
+#include "fnft_errwarn.h"
+#include "fnft__errwarn.h"
+
+static UINT nprinted = 0;
+
+// Counts instead of printing
+static INT counting_printf(const char *format, ...)
+{
+    (void)format;
+    nprinted++;
+    return 0;
+}
+
+// Calls fnft_nsev with an invalid argument, which yields two errors (one
+// in the subroutine that checks the argument and one in fnft_nsev)
+static INT trigger_error()
+{
+    REAL T[2] = { -1.0, 1.0 }, XI[2] = { -1.0, 1.0 };
+    COMPLEX q[2] = { 0.0, 0.0 };
+    UINT K = 0;
+
+    return fnft_nsev(2, q, T, 0, NULL, XI, &K, NULL, NULL, 2, NULL);
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    fnft_errwarn_event_t events[8];
+    fnft_errwarn_summary_t summary;
+    UINT i, n;
+
+    fnft_errwarn_setprintf(counting_printf);
+
+    ret_code = fnft_errwarn_setdiag(4);
+    if (ret_code == FNFT_EC_NOT_YET_IMPLEMENTED) {
+        // Not supported on this platform, nothing to test
+        ret_code = SUCCESS;
+        goto leave_fun;
+    }
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Errors are recorded instead of printed. The last two do not fit into
+    // the buffer and are only counted.
+    for (i=0; i<3; i++) {
+        if (trigger_error() != -FNFT_EC_INVALID_ARGUMENT) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+    summary = fnft_errwarn_summary();
+    if (nprinted != 0 || summary.errors != 6 || summary.warnings != 0
+        || summary.dropped != 2 || summary.pending != 4
+        || summary.buffers != 1) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    n = fnft_errwarn_drain(events, 8);
+    if (n != 4 || fnft_errwarn_drain(events + n, 8 - n) != 0
+        || fnft_errwarn_summary().pending != 0) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    for (i=0; i<n; i++) {
+        if (events[i].ec != (i%2 ? -1 : 1)*FNFT_EC_INVALID_ARGUMENT
+            || events[i].msg == NULL
+            || events[i].func == NULL || events[i].thread != 0) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+    fnft_errwarn_print_event(&events[0]);
+    if (nprinted != 1) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // Disabling the diagnostics mode restores printing. Enabling it again
+    // reuses the buffer.
+    ret_code = fnft_errwarn_setdiag(0);
+    CHECK_RETCODE(ret_code, leave_fun);
+    trigger_error();
+    ret_code = fnft_errwarn_setdiag(1);
+    CHECK_RETCODE(ret_code, leave_fun);
+    trigger_error();
+    summary = fnft_errwarn_summary();
+    if (nprinted != 3 || summary.buffers != 1 || summary.errors != 8
+        || summary.pending != 2) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    ret_code = fnft_errwarn_setdiag(0);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    fnft_errwarn_setprintf(NULL);
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
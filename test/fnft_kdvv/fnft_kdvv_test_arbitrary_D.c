@@ -0,0 +1,91 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include "fnft_kdvv.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D_PAD 1024
+#define M 64
+
+// Transforms a signal with D samples, where D is not a power of two, and
+// compares the continuous spectrum with that for the same signal after
+// zero-padding it to D_PAD samples. The zeros do not change the reflection
+// coefficient. The schemes do not propagate zero samples exactly, but the
+// differences are below the tolerance for the high order schemes that are
+// used here.
+static INT kdvv_arbitrary_D_test(const UINT D, kdvv_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, T_pad[2], XI[2] = { -3.0, 2.0 };
+    REAL eps_t, t, err;
+    COMPLEX q[D_PAD], contspec[M], contspec_pad[M];
+    UINT i;
+
+    // A sech^2 potential
+    eps_t = (T[1] - T[0])/(D - 1);
+    for (i=0; i<D_PAD; i++) {
+        t = T[0] + i*eps_t;
+        q[i] = i < D ? 1.3*misc_sech(t)*misc_sech(t) : 0.0;
+    }
+    T_pad[0] = T[0];
+    T_pad[1] = T[0] + (D_PAD - 1)*eps_t;
+
+    ret_code = fnft_kdvv(D, q, T, M, contspec, XI, NULL, NULL, NULL, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = fnft_kdvv(D_PAD, q, T_pad, M, contspec_pad, XI, NULL, NULL,
+        NULL, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    err = misc_rel_err(M, contspec, contspec_pad);
+#ifdef DEBUG
+    printf("kdvv_arbitrary_D_test: D=%u, err=%g\n", (unsigned)D, err);
+#endif
+    if (!(err <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    kdvv_opts_t opts;
+
+    opts = fnft_kdvv_default_opts();
+    ret_code = kdvv_arbitrary_D_test(1000, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = kdvv_arbitrary_D_test(777, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = kdv_discretization_2SPLIT8A;
+    ret_code = kdvv_arbitrary_D_test(777, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
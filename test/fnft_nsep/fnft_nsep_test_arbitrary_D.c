@@ -0,0 +1,151 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsep.h"
+#include "fnft__nsep_testcases.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define MAX_K 4000
+
+// Largest distance of a value in x to the nearest value in y
+static REAL max_dist(const UINT nx, COMPLEX const * const x, const UINT ny,
+    COMPLEX const * const y)
+{
+    REAL d, dmin, dmax = 0.0;
+    UINT i, j;
+
+    for (i=0; i<nx; i++) {
+        dmin = INFINITY;
+        for (j=0; j<ny; j++) {
+            d = CABS(x[i] - y[j]);
+            if (d < dmin)
+                dmin = d;
+        }
+        if (dmin > dmax)
+            dmax = dmin;
+    }
+    return dmax;
+}
+
+// Transforms a periodic signal with D samples per period, where D is odd,
+// and compares the results with those for two periods of the same signal
+// (2*D samples with the same step size). With M the monodromy matrix of one
+// period, the monodromy matrix of two periods is M^2, whose trace is
+// trace(M)^2-2 and whose upper right element is M12*trace(M). The main and
+// auxiliary spectra of one period are therefore contained in those of two
+// periods.
+static INT nsep_arbitrary_D_test(const UINT D, const REAL tol,
+    fnft_nsep_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { 0.0, 4.0 }, T2[2], eps_t, t;
+    COMPLEX *q = NULL, *main_spec = NULL, *aux_spec = NULL;
+    COMPLEX *main_spec2 = NULL, *aux_spec2 = NULL;
+    UINT K = MAX_K, M = MAX_K, K2 = MAX_K, M2 = MAX_K, i;
+    REAL dist_main, dist_aux;
+
+    q = malloc(2*D * sizeof(COMPLEX));
+    main_spec = malloc(4 * MAX_K * sizeof(COMPLEX));
+    if (q == NULL || main_spec == NULL) {
+        ret_code = E_NOMEM;
+        goto leave_fun;
+    }
+    aux_spec = main_spec + MAX_K;
+    main_spec2 = aux_spec + MAX_K;
+    aux_spec2 = main_spec2 + MAX_K;
+
+    eps_t = (T[1] - T[0])/D;
+    for (i=0; i<2*D; i++) {
+        t = T[0] + (i % D)*eps_t;
+        q[i] = 1.2 + 0.6*CEXP(I*2*PI*t/(T[1] - T[0]));
+    }
+    T2[0] = T[0];
+    T2[1] = T[0] + 2*D*eps_t;
+
+    ret_code = fnft_nsep(D, q, T, &K, main_spec, &M, aux_spec, NULL, +1,
+        opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = fnft_nsep(2*D, q, T2, &K2, main_spec2, &M2, aux_spec2, NULL,
+        +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    dist_main = max_dist(K, main_spec, K2, main_spec2);
+    dist_aux = max_dist(M, aux_spec, M2, aux_spec2);
+#ifdef DEBUG
+    printf("nsep_arbitrary_D_test: D=%u, K=%u, K2=%u, M=%u, M2=%u, dist_main=%g, dist_aux=%g\n",
+        (unsigned)D, (unsigned)K, (unsigned)K2, (unsigned)M, (unsigned)M2,
+        dist_main, dist_aux);
+#endif
+    if (K == 0 || M == 0 || !(dist_main <= tol) || !(dist_aux <= tol)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    free(q);
+    free(main_spec);
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    fnft_nsep_opts_t opts;
+    REAL error_bounds[3] = { 3.5e-4, 2.9e-4, 0.0 };
+
+    opts = fnft_nsep_default_opts();
+    opts.filtering = fnft_nsep_filt_MANUAL;
+    opts.bounding_box[0] = -5;
+    opts.bounding_box[1] = 5;
+    opts.bounding_box[2] = -5;
+    opts.bounding_box[3] = 5;
+
+    // The refinement stops once the steps are far below the discretization
+    // error, and the grid search on the real line is less accurate
+    opts.localization = fnft_nsep_loc_SUBSAMPLE_AND_REFINE;
+    ret_code = nsep_arbitrary_D_test(777, 1e-4, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    opts.localization = fnft_nsep_loc_MIXED;
+    ret_code = nsep_arbitrary_D_test(777, 1e-3, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    opts.localization = fnft_nsep_loc_GRIDSEARCH;
+    ret_code = nsep_arbitrary_D_test(777, 1e-3, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Exact spectra for an odd number of samples
+    opts = fnft_nsep_default_opts();
+    opts.filtering = fnft_nsep_filt_MANUAL;
+    opts.bounding_box[0] = -10;
+    opts.bounding_box[1] = 10;
+    opts.bounding_box[2] = -10;
+    opts.bounding_box[3] = 10;
+    ret_code = nsep_testcases_test_fnft(nsep_testcases_PLANE_WAVE_FOCUSING,
+        1025, error_bounds, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
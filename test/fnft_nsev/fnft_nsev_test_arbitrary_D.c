@@ -0,0 +1,95 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D_PAD 1024
+#define M 64
+#define MAX_K 8
+
+// Transforms a signal with D samples, where D is not a power of two, and
+// compares the results with those for the same signal after zero-padding
+// it to D_PAD samples. The zeros do not change the reflection coefficient
+// and the bound states, which is why both have to agree up to rounding
+// errors. (The polynomial root finder uses random shifts, which is why the
+// bound states are compared with a tolerance.)
+static INT nsev_arbitrary_D_test(const UINT D, fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, T_pad[2], XI[2] = { -3.0, 2.0 };
+    REAL eps_t, t;
+    COMPLEX q[D_PAD], contspec[M], contspec_pad[M];
+    COMPLEX bound_states[MAX_K], bound_states_pad[MAX_K];
+    UINT K = MAX_K, K_pad = MAX_K, i;
+
+    // A sech pulse with a chirp
+    eps_t = (T[1] - T[0])/(D - 1);
+    for (i=0; i<D_PAD; i++) {
+        t = T[0] + i*eps_t;
+        q[i] = i < D ? 2.2*misc_sech(t)*CEXP(I*0.3*t) : 0.0;
+    }
+    T_pad[0] = T[0];
+    T_pad[1] = T[0] + (D_PAD - 1)*eps_t;
+
+    ret_code = fnft_nsev(D, q, T, M, contspec, XI, &K, bound_states, NULL,
+        +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = fnft_nsev(D_PAD, q, T_pad, M, contspec_pad, XI, &K_pad,
+        bound_states_pad, NULL, +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    if (K != 2 || K_pad != K
+        || !(misc_rel_err(M, contspec, contspec_pad) <= 1e-10)
+        || !(misc_hausdorff_dist(K, bound_states, K_pad, bound_states_pad)
+        <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    fnft_nsev_opts_t opts;
+
+    opts = fnft_nsev_default_opts();
+    ret_code = nsev_arbitrary_D_test(1000, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = nsev_arbitrary_D_test(777, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2A;
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = nsev_arbitrary_D_test(777, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
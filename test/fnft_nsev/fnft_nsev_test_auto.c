@@ -0,0 +1,184 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h> // for printf
+#endif
+
+#define D 8193
+#define M 16
+#define MAX_K 8
+
+// Reflection coefficient and bound states of 3.2*sech(t), see
+// nsev_testcases_SECH_FOCUSING
+static const REAL T[2] = { -25.0, 25.0 };
+static const REAL XI[2] = { -7.0/5.0, 8.0/5.0 };
+static COMPLEX contspec_exact[M];
+static COMPLEX bound_states_exact[3];
+
+static void setup_exact()
+{
+    contspec_exact[0] = 0.01418788668709013595992021025473684215882
+        - 0.002780494135403430187512334448840356894033*I;
+    contspec_exact[1] = 0.02241182921176242546967787829962193792932
+        - 0.01523064097337719809817988712025498134135*I;
+    contspec_exact[2] = 0.02465858976907935401910832019686315816969
+        - 0.04438144029159159323809699075974745310038*I;
+    contspec_exact[3] = -0.003769955008351912170484991343204667254443
+        - 0.09495492126539469847498823350667910603724*I;
+    contspec_exact[4] = -0.1125183095807641031140695325799053429154
+        - 0.1368780622436166383108546963189442789103*I;
+    contspec_exact[5] = -0.3233468273512117378446470596682895379774
+        - 0.03729229993634457693343890962907380139133*I;
+    contspec_exact[6] = -0.4116152074717953525393539594551519006178
+        + 0.3788164254609808107108977070302734836415*I;
+    contspec_exact[7] = 0.7265425280053608858954667574806187496161*I;
+    contspec_exact[8] = 0.4116152074717953525393539594551519006178
+        + 0.3788164254609808107108977070302734836415*I;
+    contspec_exact[9] = 0.3233468273512117378446470596682895379774
+        - 0.03729229993634457693343890962907380139133*I;
+    contspec_exact[10] = 0.1125183095807641031140695325799053429154
+        - 0.1368780622436166383108546963189442789103*I;
+    contspec_exact[11] = 0.003769955008351912170484991343204667254443
+        - 0.09495492126539469847498823350667910603724*I;
+    contspec_exact[12] = -0.02465858976907935401910832019686315816969
+        - 0.04438144029159159323809699075974745310038*I;
+    contspec_exact[13] = -0.02241182921176242546967787829962193792932
+        - 0.01523064097337719809817988712025498134135*I;
+    contspec_exact[14] = -0.01418788668709013595992021025473684215882
+        - 0.002780494135403430187512334448840356894033*I;
+    contspec_exact[15] = -0.007616495541673034905010512686300960103961
+        + 0.001218250087174144753540506062403435472519*I;
+    bound_states_exact[0] = 0.7*I;
+    bound_states_exact[1] = 1.7*I;
+    bound_states_exact[2] = 2.7*I;
+}
+
+// Returns the actual error of the results
+static REAL actual_err(COMPLEX const * const contspec, const UINT K,
+    COMPLEX const * const bound_states)
+{
+    REAL err = 0.0, tmp;
+    UINT i;
+
+    for (i=0; contspec != NULL && i<M; i++) {
+        tmp = CABS(contspec[i] - contspec_exact[i]);
+        if (!(tmp <= err))
+            err = tmp;
+    }
+    tmp = misc_hausdorff_dist(K, bound_states, 3, bound_states_exact);
+    if (!(tmp <= err))
+        err = tmp;
+    return err;
+}
+
+// Checks that the results returned by fnft_nsev_auto meet the target
+// accuracy, and that the number of samples is not much larger than needed:
+// with about half of the samples, the target accuracy is missed.
+static INT nsev_auto_test(COMPLEX * const q, const REAL tol,
+    const INT with_contspec, fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    COMPLEX contspec[M], bound_states[MAX_K], qsub[D];
+    COMPLEX * const cs = with_contspec ? contspec : NULL;
+    UINT K = MAX_K, D_used, Dsub, r, i;
+    REAL err_est, Tsub[2];
+
+    ret_code = fnft_nsev_auto(D, q, T, M, cs, XI, &K, bound_states, NULL,
+        +1, opts, tol, &D_used, &err_est);
+    CHECK_RETCODE(ret_code, leave_fun);
+#ifdef DEBUG
+    printf("tol=%g: D_used=%zu, estimated error=%g, actual error=%g\n",
+        tol, (size_t)D_used, err_est, actual_err(cs, K, bound_states));
+#endif
+    if (!(err_est <= tol) || D_used >= D
+        || !(actual_err(cs, K, bound_states) <= 2*tol)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    r = 2*(D - 1)/(D_used - 1);
+    Dsub = (D - 1)/r + 1;
+    for (i=0; i<Dsub; i++)
+        qsub[i] = q[i*r];
+    Tsub[0] = T[0];
+    Tsub[1] = T[0] + (Dsub - 1)*r*(T[1] - T[0])/(D - 1);
+    K = MAX_K;
+    ret_code = fnft_nsev(Dsub, qsub, Tsub, M, cs, XI, &K, bound_states,
+        NULL, +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (!(actual_err(cs, K, bound_states) > tol))
+        ret_code = E_TEST_FAILED;
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    COMPLEX q[D], contspec[M], bound_states[MAX_K];
+    UINT i, K, D_used;
+    REAL err_est;
+    fnft_nsev_opts_t opts;
+
+    setup_exact();
+    for (i=0; i<D; i++)
+        q[i] = I * 3.2 * misc_sech(T[0] + i*(T[1] - T[0])/(D - 1));
+    opts = fnft_nsev_default_opts();
+
+    ret_code = nsev_auto_test(q, 1e-4, 1, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = nsev_auto_test(q, 1e-3, 0, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    opts.discretization = nse_discretization_2SPLIT2A;
+    ret_code = nsev_auto_test(q, 1e-3, 1, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // A target accuracy that cannot be reached with the given samples
+    // results in a warning, and all samples are used
+    opts = fnft_nsev_default_opts();
+    K = MAX_K;
+    ret_code = fnft_nsev_auto(D, q, T, M, contspec, XI, &K, bound_states,
+        NULL, +1, &opts, 1e-10, &D_used, &err_est);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (D_used != D || !(err_est > 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // Invalid arguments must be rejected
+    if (fnft_nsev_auto(D, q, T, M, contspec, XI, &K, bound_states, NULL, +1,
+        NULL, 0.0, &D_used, &err_est) != FNFT_EC_INVALID_ARGUMENT
+        || fnft_nsev_auto(D, q, T, 0, NULL, XI, &K, NULL, NULL, +1, NULL,
+        1e-3, &D_used, &err_est) != FNFT_EC_INVALID_ARGUMENT) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
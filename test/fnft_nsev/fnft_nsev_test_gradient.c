@@ -0,0 +1,232 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+#define D 256
+#define M 32
+
+static REAL T[2] = { -8.0, 8.0 }, XI[2] = { -2.0, 2.0 };
+
+// Auxiliary function: Computes the loss
+// L = sum_i Re(conj(w_i)*c_i) + sum_k Re(conj(v_k)*lam_k + conj(u_k)*b_k),
+// where c is the continuous spectrum of type BOTH and the lam_k and b_k are
+// the bound states and norming constants computed from the polynomial
+// approximation of the transfer matrix. The bound states are sorted like
+// the reference bound states bs_ref.
+static INT loss(fnft_nsev_tm_t * const tm, const UINT K,
+    COMPLEX const * const bs_ref, REAL * const L_ptr)
+{
+    fnft_nsev_tm_t *tm_imported = NULL;
+    fnft_nsev_opts_t opts;
+    COMPLEX contspec[3*M], bound_states[8], normconsts[8];
+    UINT i, j, K2, len;
+    void *buf = NULL;
+    REAL L = 0.0;
+    INT ret_code = SUCCESS;
+
+    opts = fnft_nsev_default_opts();
+    opts.contspec_type = nsev_cstype_BOTH;
+    ret_code = fnft_nsev_tm_contspec(tm, M, contspec, XI, &opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<3*M; i++)
+        L += CREAL(CONJ(COS(0.1*i) + I*SIN(0.3*i + 0.5)) * contspec[i]);
+
+    // Objects without signal compute the norming constants from the
+    // polynomials in the transfer matrix
+    ret_code = fnft_nsev_tm_export(tm, &len, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    buf = malloc(len);
+    if (buf == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    ret_code = fnft_nsev_tm_export(tm, &len, buf);
+    CHECK_RETCODE(ret_code, release_mem);
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = fnft_nsev_tm_import(len, buf, &opts, &tm_imported);
+    CHECK_RETCODE(ret_code, release_mem);
+    K2 = 8;
+    ret_code = fnft_nsev_tm_discspec(tm_imported, &K2, bound_states,
+        normconsts, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K2 != K) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    for (i=0; i<K; i++) {
+        for (j=0; j<K; j++) {
+            if (CABS(bound_states[j] - bs_ref[i]) < 1e-3)
+                break;
+        }
+        if (j == K) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+        L += CREAL(CONJ(1.0 - 2.0*I) * bound_states[j]);
+        L += CREAL(CONJ(0.5 + 1.5*I) * normconsts[j]);
+    }
+    *L_ptr = L;
+
+release_mem:
+    fnft_nsev_tm_free(tm_imported);
+    free(buf);
+    return ret_code;
+}
+
+// Checks that updating samples of a transfer matrix object gives the same
+// results as creating a new object, and compares the gradient of a loss
+// function computed with fnft_nsev_tm_gradient with finite differences.
+static INT nsev_gradient_test(fnft_nsev_opts_t * const opts)
+{
+    UINT i, j, k, K, idx[3] = { 17, 128, 129 };
+    INT ret_code = SUCCESS;
+    REAL t, L = 0.0, err, h = 1e-2, max_grad;
+    const REAL stencil[4] = { 1.0/12, -2.0/3, 2.0/3, -1.0/12 };
+    COMPLEX q[D], q_grad[D], q_new[3], contspec1[3*M], contspec2[3*M];
+    COMPLEX contspec_grad[3*M], bound_states[8], bs_grad[8], nc_grad[8];
+    COMPLEX fd_grad;
+    fnft_nsev_tm_t *tm1 = NULL, *tm2 = NULL;
+    fnft_nsev_opts_t query_opts;
+
+    for (i=0; i<D; i++) {
+        t = T[0] + i*(T[1] - T[0])/(D - 1);
+        q[i] = 1.2*misc_sech(t)*CEXP(0.2*I*t);
+    }
+    ret_code = fnft_nsev_tm_create(D, q, T, +1, opts, &tm1);
+    CHECK_RETCODE(ret_code, release_mem);
+    query_opts = *opts;
+    query_opts.contspec_type = nsev_cstype_BOTH;
+    query_opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+
+    // Update a few samples twice (the first update builds the product tree,
+    // the second one updates it)
+    for (j=0; j<2; j++) {
+        for (i=0; i<3; i++) {
+            q_new[i] = q[idx[i]] + 0.1*(j + 1)*(1.0 - 0.5*I*i);
+            q[idx[i]] = q_new[i];
+        }
+        ret_code = fnft_nsev_tm_update(tm1, 3, idx, q_new);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+    ret_code = fnft_nsev_tm_create(D, q, T, +1, opts, &tm2);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = fnft_nsev_tm_contspec(tm1, M, contspec1, XI, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = fnft_nsev_tm_contspec(tm2, M, contspec2, XI, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    err = misc_rel_err(3*M, contspec1, contspec2);
+#ifdef DEBUG
+    printf("nsev_gradient_test: contspec after update: err = %2.1e\n", err);
+#endif
+    // (The transfer matrix of tm1 is the root of the product tree, while
+    // that of tm2 is computed in the frequency domain with
+    // poly_fmult2x2_fd. Both thus agree only up to rounding errors.)
+    if (!(err <= 1000*EPSILON)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // Gradient
+    K = 8;
+    ret_code = fnft_nsev_tm_discspec(tm1, &K, bound_states, NULL,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K != 1) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    for (i=0; i<3*M; i++)
+        contspec_grad[i] = COS(0.1*i) + I*SIN(0.3*i + 0.5);
+    for (i=0; i<K; i++) {
+        bs_grad[i] = 1.0 - 2.0*I;
+        nc_grad[i] = 0.5 + 1.5*I;
+    }
+    ret_code = fnft_nsev_tm_gradient(tm1, M, XI, contspec_grad, K,
+        bound_states, bs_grad, nc_grad, q_grad, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    max_grad = 0.0;
+    for (i=0; i<D; i++) {
+        if (CABS(q_grad[i]) > max_grad)
+            max_grad = CABS(q_grad[i]);
+    }
+
+    // Finite differences of fourth order for a few samples. The
+    // perturbations are applied to tm2, which also stores the product tree
+    // afterwards. (The step size is fairly large since the rounding errors
+    // of the roots in the loss limit the accuracy of the finite differences
+    // to about 1e-10 otherwise.)
+    for (i=0; i<D; i+=51) {
+        fd_grad = 0.0;
+        for (j=0; j<2; j++) {
+            for (k=0; k<4; k++) {
+                q_new[0] = q[i] + (k < 2 ? k - 2.0 : k - 1.0)
+                    * (j == 0 ? h : I*h);
+                ret_code = fnft_nsev_tm_update(tm2, 1, &i, q_new);
+                CHECK_RETCODE(ret_code, release_mem);
+                ret_code = loss(tm2, K, bound_states, &L);
+                CHECK_RETCODE(ret_code, release_mem);
+                fd_grad += (j == 0 ? 1.0 : I) * stencil[k]*L/h;
+            }
+        }
+        ret_code = fnft_nsev_tm_update(tm2, 1, &i, q + i);
+        CHECK_RETCODE(ret_code, release_mem);
+        err = CABS(fd_grad - q_grad[i]) / max_grad;
+#ifdef DEBUG
+        printf("nsev_gradient_test: gradient at sample %i: err = %2.1e\n",
+            (int)i, err);
+#endif
+        if (!(err <= 2e-9)) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+    }
+
+release_mem:
+    fnft_nsev_tm_free(tm1);
+    fnft_nsev_tm_free(tm2);
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code;
+    fnft_nsev_opts_t opts;
+
+    opts = fnft_nsev_default_opts();
+    ret_code = nsev_gradient_test(&opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2A;
+    opts.normalization_flag = 0;
+    ret_code = nsev_gradient_test(&opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define NSIG 5
+#define D_MAX 300
+#define M 48
+#define MAX_K 8
+
+// Transforms NSIG signals with fnft_nsev_multi and compares the results
+// with those of separate calls of fnft_nsev. The transfer matrices are
+// computed with different algorithms, which is why the results only agree
+// up to rounding errors. (The polynomial root finder uses random shifts,
+// which is why the order of the bound states may differ.)
+static INT nsev_multi_test(const UINT D, COMPLEX * const q,
+    fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, XI[2] = { -3.0, 2.0 };
+    COMPLEX contspec[NSIG*3*M], contspec1[3*M];
+    COMPLEX bound_states[NSIG*MAX_K], bound_states1[MAX_K];
+    COMPLEX ncr[NSIG*2*MAX_K], ncr1[2*MAX_K];
+    UINT K[NSIG], K1, t, i, j, nearest;
+
+    ret_code = fnft_nsev_multi(NSIG, D, q, T, M, contspec, XI, MAX_K, K,
+        bound_states, ncr, +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    for (t=0; t<NSIG; t++) {
+        K1 = MAX_K;
+        ret_code = fnft_nsev(D, q + t*D, T, M, contspec1, XI, &K1,
+            bound_states1, ncr1, +1, opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+        if (!(misc_rel_err(3*M, contspec + t*3*M, contspec1) <= 1e-10)
+            || K[t] != K1 || !(misc_hausdorff_dist(K1, bound_states1, K[t],
+            bound_states + t*MAX_K) <= 1e-10)) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+        for (i=0; i<K1; i++) {
+            nearest = 0;
+            for (j=1; j<K1; j++) {
+                if (CABS(bound_states[t*MAX_K + i] - bound_states1[j])
+                    < CABS(bound_states[t*MAX_K + i]
+                    - bound_states1[nearest]))
+                    nearest = j;
+            }
+            if (!(CABS(ncr[t*2*MAX_K + i] - ncr1[nearest])
+                <= 1e-8*CABS(ncr1[nearest]))
+                || !(CABS(ncr[t*2*MAX_K + K1 + i] - ncr1[K1 + nearest])
+                <= 1e-8*CABS(ncr1[K1 + nearest]))) {
+                ret_code = E_TEST_FAILED;
+                goto leave_fun;
+            }
+        }
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    UINT i, t, D;
+    REAL eps_t, tt;
+    COMPLEX q[NSIG*D_MAX];
+    fnft_nsev_opts_t opts;
+
+    opts = fnft_nsev_default_opts();
+    opts.contspec_type = nsev_cstype_BOTH;
+    opts.discspec_type = nsev_dstype_BOTH;
+
+    // Sech pulses with chirps and different amplitudes. The number of
+    // samples is not a power of two, so that the product trees carry
+    // factors over to the next levels.
+    for (D=64; D<=D_MAX; D+=236) {
+        eps_t = 32.0/(D - 1);
+        for (t=0; t<NSIG; t++) {
+            for (i=0; i<D; i++) {
+                tt = -16.0 + i*eps_t;
+                q[t*D + i] = (1.2 + 0.3*t)*misc_sech(tt)*CEXP(I*0.2*t*tt);
+            }
+        }
+
+        opts.discretization = nse_discretization_2SPLIT4B;
+        opts.bound_state_localization = nsev_bsloc_SUBSAMPLE_AND_REFINE;
+        ret_code = nsev_multi_test(D, q, &opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+
+        opts.discretization = nse_discretization_2SPLIT2A;
+        opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+        ret_code = nsev_multi_test(D, q, &opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+    }
+
+    // Invalid arguments must be rejected
+    if (fnft_nsev_multi(0, 64, q, NULL, 0, NULL, NULL, 0, NULL, NULL, NULL,
+        +1, NULL) != FNFT_EC_INVALID_ARGUMENT) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D 256
+#define MAX_K 8
+
+// Computes the bound states of a sech pulse with the fast eigenvalue method
+// for zero-initialized options, for the default options and with explicitly
+// requested threads (which selects the multishift root finder). All runs
+// have to find the same bound states up to rounding errors.
+INT main()
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, t;
+    COMPLEX q[D], bs_ref[MAX_K], bs[MAX_K];
+    INT nthreads[3] = { 0, 3, -1 };
+    UINT K_ref = MAX_K, K, i;
+    fnft_nsev_opts_t opts;
+
+    for (i=0; i<D; i++) {
+        t = T[0] + i*(T[1] - T[0])/(D - 1);
+        q[i] = 2.2*misc_sech(t);
+    }
+    opts = fnft_nsev_default_opts();
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    opts.bound_state_filtering = nsev_bsfilt_FULL;
+    if (opts.nthreads != 0) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    ret_code = fnft_nsev(D, q, T, 0, NULL, NULL, &K_ref, bs_ref, NULL, +1,
+        &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (K_ref != 2) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    for (i=0; i<3; i++) {
+        if (i == 0) {
+            memset(&opts, 0, sizeof(opts));
+            opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+            opts.bound_state_filtering = nsev_bsfilt_FULL;
+            opts.niter = 10;
+            opts.discretization = nse_discretization_2SPLIT4B;
+            opts.normalization_flag = 1;
+        }
+        opts.nthreads = nthreads[i];
+        K = MAX_K;
+        ret_code = fnft_nsev(D, q, T, 0, NULL, NULL, &K, bs, NULL, +1,
+            &opts);
+        CHECK_RETCODE(ret_code, leave_fun);
+        if (K != K_ref || !(misc_hausdorff_dist(K, bs, K_ref, bs_ref)
+            <= 1e-8)) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D 2048
+#define M 64
+#define MAX_K 16
+#define MAX_STAGES 4
+
+// Copies of the results that have been delivered
+typedef struct {
+    UINT nstages;
+    UINT stop_after;
+    fnft_nsev_stage_t stages[MAX_STAGES];
+    UINT D_used[MAX_STAGES];
+    UINT K[MAX_STAGES];
+    COMPLEX contspec[MAX_STAGES][M];
+    COMPLEX bound_states[MAX_STAGES][MAX_K];
+    COMPLEX normconsts[MAX_K];
+    INT contspec_null[MAX_STAGES];
+    INT bound_states_null[MAX_STAGES];
+    INT normconsts_null[MAX_STAGES];
+} record_t;
+
+static INT deliver(void *ctx, fnft_nsev_stage_t stage, UINT D_used,
+    UINT M_, COMPLEX const *contspec, UINT K, COMPLEX const *bound_states,
+    COMPLEX const *normconsts_or_residues)
+{
+    record_t * const rec = ctx;
+    const UINT i = rec->nstages;
+
+    if (i >= MAX_STAGES || M_ != M || K > MAX_K)
+        return E_TEST_FAILED;
+    rec->stages[i] = stage;
+    rec->D_used[i] = D_used;
+    rec->K[i] = K;
+    rec->contspec_null[i] = (contspec == NULL);
+    rec->bound_states_null[i] = (bound_states == NULL);
+    rec->normconsts_null[i] = (normconsts_or_residues == NULL);
+    if (contspec != NULL)
+        memcpy(rec->contspec[i], contspec, M * sizeof(COMPLEX));
+    if (bound_states != NULL)
+        memcpy(rec->bound_states[i], bound_states, K * sizeof(COMPLEX));
+    if (normconsts_or_residues != NULL)
+        memcpy(rec->normconsts, normconsts_or_residues, K * sizeof(COMPLEX));
+    rec->nstages++;
+    return rec->nstages == rec->stop_after ? 1 : SUCCESS;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    const REAL T[2] = { -25.0, 25.0 }, XI[2] = { -2.0, 2.0 };
+    COMPLEX q[D], contspec[M], bound_states[MAX_K], normconsts[MAX_K];
+    static record_t rec;
+    fnft_nsev_progress_t progress = { &rec, deliver, 1, 1 };
+    fnft_nsev_opts_t opts;
+    UINT i, j, K;
+
+    for (i=0; i<D; i++)
+        q[i] = 3.2 * misc_sech(T[0] + i*(T[1] - T[0])/(D - 1));
+    opts = fnft_nsev_default_opts();
+    K = MAX_K;
+    ret_code = fnft_nsev(D, q, T, M, contspec, XI, &K, bound_states,
+        normconsts, +1, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // All stages are delivered in order. The final results agree with
+    // those of fnft_nsev.
+    memset(&rec, 0, sizeof(rec));
+    ret_code = fnft_nsev_progressive(D, q, T, M, XI, +1, &opts, &progress);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (rec.nstages != 4 || rec.stages[0] != nsev_stage_COARSE_CONTSPEC
+        || rec.stages[1] != nsev_stage_COARSE_BOUND_STATES
+        || rec.stages[2] != nsev_stage_CONTSPEC
+        || rec.stages[3] != nsev_stage_REFINED
+        || !(rec.D_used[0] < D) || rec.D_used[1] != rec.D_used[0]
+        || rec.D_used[2] != D || rec.D_used[3] != D
+        || !rec.bound_states_null[0] || rec.bound_states_null[1]
+        || !rec.normconsts_null[2] || rec.normconsts_null[3]) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    if (!(misc_rel_err(M, rec.contspec[3], contspec) <= 1e-14)
+        || rec.K[3] != K
+        || !(misc_hausdorff_dist(K, bound_states, rec.K[3],
+        rec.bound_states[3]) <= 1e-12)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    for (i=0; i<K; i++) {
+        for (j=0; j<K; j++) {
+            if (CABS(rec.bound_states[3][i] - bound_states[j]) <= 1e-12
+                && !(CABS(rec.normconsts[i] - normconsts[j]) <= 1e-10)) {
+                ret_code = E_TEST_FAILED;
+                goto leave_fun;
+            }
+        }
+    }
+
+    // The coarse results are close to the final ones (the coarse
+    // continuous spectrum for small |xi| only)
+    if (!(misc_rel_err(M/2, rec.contspec[0] + M/4, contspec + M/4) <= 1e-2)
+        || rec.K[1] != K
+        || !(misc_hausdorff_dist(K, bound_states, rec.K[1],
+        rec.bound_states[1]) <= 1e-2)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // The consumer can stop after any stage
+    for (i=1; i<=4; i++) {
+        memset(&rec, 0, sizeof(rec));
+        rec.stop_after = i;
+        ret_code = fnft_nsev_progressive(D, q, T, M, XI, +1, &opts,
+            &progress);
+        if (ret_code != (i < 4 ? FNFT_EC_STOPPED : SUCCESS)
+            || rec.nstages != i) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+
+    // Without bound states, only the stages of the continuous spectrum and
+    // the final stage are delivered
+    memset(&rec, 0, sizeof(rec));
+    ret_code = fnft_nsev_progressive(D, q, T, M, XI, -1, &opts, &progress);
+    CHECK_RETCODE(ret_code, leave_fun);
+    if (rec.nstages != 3 || rec.stages[1] != nsev_stage_CONTSPEC
+        || !rec.bound_states_null[2] || rec.K[2] != 0) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // Invalid arguments must be rejected
+    if (fnft_nsev_progressive(D, q, T, M, XI, +1, NULL, NULL)
+        != FNFT_EC_INVALID_ARGUMENT) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
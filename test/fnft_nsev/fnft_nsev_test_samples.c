@@ -0,0 +1,132 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D 1024
+#define M 64
+#define MAX_K 8
+
+// Transforms a signal that is stored in the given format with
+// fnft_nsev_samples and compares the results with those of fnft_nsev for
+// the converted signal. Since both routines convert the samples in the same
+// way, the continuous spectra have to agree exactly. (The polynomial root
+// finder uses random shifts, which is why the discrete spectra may differ
+// slightly even for repeated calls of fnft_nsev.)
+static INT nsev_samples_test(samples_t const * const samples,
+    fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, XI[2] = { -3.0, 2.0 };
+    COMPLEX q[D], contspec1[3*M], contspec2[3*M];
+    COMPLEX bound_states1[MAX_K], bound_states2[MAX_K];
+    COMPLEX ncr1[2*MAX_K], ncr2[2*MAX_K];
+    COMPLEX *ncr1_ptr = ncr1, *ncr2_ptr = ncr2;
+    UINT K1 = MAX_K, K2 = MAX_K;
+
+    // Without norming constants, the fast eigenvalue method does not need
+    // a converted copy of the signal
+    if (opts->bound_state_localization == nsev_bsloc_FAST_EIGENVALUE) {
+        ncr1_ptr = NULL;
+        ncr2_ptr = NULL;
+    }
+
+    ret_code = misc_samples_to_complex(D, samples, q);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = fnft_nsev(D, q, T, M, contspec1, XI, &K1, bound_states1,
+        ncr1_ptr, +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    ret_code = fnft_nsev_samples(D, samples, T, M, contspec2, XI, &K2,
+        bound_states2, ncr2_ptr, +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    if (K1 != 2 || K2 != K1
+        || memcmp(contspec1, contspec2, sizeof(contspec1)) != 0
+        || !(misc_hausdorff_dist(K1, bound_states1, K2, bound_states2)
+        <= 1e-12)
+        || (ncr1_ptr != NULL && !(misc_rel_err(2*K1, ncr2, ncr1) <= 1e-12))) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    UINT i;
+    REAL eps_t, t, scale = 2.2/32767;
+    int16_t iq16[2*D];
+    float re32[D], im32[D];
+    samples_t samples;
+    fnft_nsev_opts_t opts;
+
+    // A sech pulse with a chirp, quantized as an ADC would do it
+    eps_t = 32.0/(D - 1);
+    for (i=0; i<D; i++) {
+        t = -16.0 + i*eps_t;
+        iq16[2*i] = (int16_t)(32767*CREAL(misc_sech(t)*CEXP(I*0.3*t)));
+        iq16[2*i + 1] = (int16_t)(32767*CIMAG(misc_sech(t)*CEXP(I*0.3*t)));
+        re32[i] = iq16[2*i];
+        im32[i] = iq16[2*i + 1];
+    }
+
+    opts = fnft_nsev_default_opts();
+    opts.contspec_type = nsev_cstype_BOTH;
+    opts.discspec_type = nsev_dstype_BOTH;
+
+    samples.format = samples_format_INT16_INTERLEAVED;
+    samples.data = iq16;
+    samples.imag = NULL;
+    samples.scale = scale;
+    ret_code = nsev_samples_test(&samples, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    samples.format = samples_format_FLOAT32_SPLIT;
+    samples.data = re32;
+    samples.imag = im32;
+    opts.discretization = nse_discretization_2SPLIT2A;
+    ret_code = nsev_samples_test(&samples, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = nsev_samples_test(&samples, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Invalid descriptions must be rejected
+    samples.imag = NULL;
+    if (fnft_nsev_samples(D, &samples, NULL, 0, NULL, NULL, NULL, NULL,
+        NULL, +1, NULL) != FNFT_EC_INVALID_ARGUMENT) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
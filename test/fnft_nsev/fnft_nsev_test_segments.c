@@ -0,0 +1,292 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h> // for memcpy
+#include <stdint.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+// Imports copies of an exported transfer matrix with corrupted headers,
+// which must be rejected. The offsets are those of T[0], kappa and of the
+// number of samples D in the header. For degrees that are powers of two,
+// the huge value of D is chosen such that the product of the degree and D
+// overflows to the stored polynomial degree.
+static INT nsev_import_corrupted_test(const UINT len, void const * const buf,
+    fnft_nsev_opts_t * const opts)
+{
+    const REAL nan_val = NAN;
+    const int32_t kappa = 2;
+    uint64_t D, deg, degree, D_huge;
+    unsigned char *copy = NULL;
+    fnft_nsev_tm_t *tm = NULL;
+    UINT i;
+    INT ret_code = SUCCESS;
+
+    memcpy(&D, (unsigned char const *)buf + 16, 8);
+    memcpy(&deg, (unsigned char const *)buf + 24, 8);
+    degree = deg/D;
+    D_huge = degree > 1 ? D + (UINT64_MAX/degree + 1) : UINT64_MAX;
+
+    copy = malloc(len);
+    if (copy == NULL)
+        return E_NOMEM;
+    for (i=0; i<3; i++) {
+        memcpy(copy, buf, len);
+        if (i == 0)
+            memcpy(copy + 48, &nan_val, sizeof(REAL));
+        else if (i == 1)
+            memcpy(copy + 36, &kappa, 4);
+        else
+            memcpy(copy + 16, &D_huge, 8);
+        if (fnft_nsev_tm_import(len, copy, opts, &tm) == SUCCESS
+            || tm != NULL) {
+            ret_code = E_TEST_FAILED;
+            break;
+        }
+    }
+
+    fnft_nsev_tm_free(tm);
+    free(copy);
+    return ret_code;
+}
+
+// Splits a signal into segments, computes their transfer matrices
+// separately, exports and imports them, merges them and compares the
+// resulting spectra with those computed for the whole signal.
+static INT nsev_segments_test(fnft_nsev_opts_t * const opts,
+    const REAL error_bound_normconsts)
+{
+    const UINT D = 1024, M = 64;
+    const UINT nseg = 3, Dseg[3] = { 256, 512, 256 };
+    const char *filename = "fnft_nsev_test_segments.tmp";
+    UINT i, j, K1, K2, len;
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, Tseg[2], XI[2] = { -3.0, 2.0 }, eps_t;
+    REAL err, err2;
+    COMPLEX *q = NULL, contspec1[3*64], contspec2[3*64];
+    COMPLEX bound_states1[8], bound_states2[8], ncr1[16], ncr2[16];
+    void *buf = NULL;
+    fnft_nsev_tm_t *tm_full = NULL, *tm_merged = NULL;
+    fnft_nsev_tm_t *tm_segs[3] = { NULL }, *tm_imported[3] = { NULL };
+    fnft_nsev_opts_t query_opts;
+
+    q = malloc(D * sizeof(COMPLEX));
+    if (q == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+    eps_t = (T[1] - T[0])/(D - 1);
+    for (i=0; i<D; i++)
+        q[i] = 2.2*misc_sech(T[0] + i*eps_t);
+
+    ret_code = fnft_nsev_tm_create(D, q, T, +1, opts, &tm_full);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Transfer matrices of the segments
+    for (i=0, j=0; i<nseg; j+=Dseg[i], i++) {
+        Tseg[0] = T[0] + j*eps_t;
+        Tseg[1] = T[0] + (j + Dseg[i] - 1)*eps_t;
+        ret_code = fnft_nsev_tm_create(Dseg[i], q + j, Tseg, +1, opts,
+            &tm_segs[i]);
+        CHECK_RETCODE(ret_code, release_mem);
+    }
+
+    // Transport them, the middle one via a file
+    for (i=0; i<nseg; i++) {
+        if (i == 1) {
+            ret_code = fnft_nsev_tm_save(tm_segs[i], filename);
+            CHECK_RETCODE(ret_code, release_mem);
+            ret_code = fnft_nsev_tm_load(filename, opts, &tm_imported[i]);
+            remove(filename);
+            CHECK_RETCODE(ret_code, release_mem);
+            continue;
+        }
+        ret_code = fnft_nsev_tm_export(tm_segs[i], &len, NULL);
+        CHECK_RETCODE(ret_code, release_mem);
+        buf = malloc(len);
+        if (buf == NULL) {
+            ret_code = E_NOMEM;
+            goto release_mem;
+        }
+        ret_code = fnft_nsev_tm_export(tm_segs[i], &len, buf);
+        CHECK_RETCODE(ret_code, release_mem);
+        if (i == 0) {
+            ret_code = nsev_import_corrupted_test(len, buf, opts);
+            CHECK_RETCODE(ret_code, release_mem);
+        }
+        ret_code = fnft_nsev_tm_import(len, buf, opts, &tm_imported[i]);
+        CHECK_RETCODE(ret_code, release_mem);
+        free(buf);
+        buf = NULL;
+    }
+
+    // Queries of the segments must not affect the merged result
+    ret_code = fnft_nsev_tm_contspec(tm_imported[0], M, contspec1, XI, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    K1 = 1;
+    ret_code = fnft_nsev_tm_discspec(tm_imported[2], &K1, bound_states1, NULL,
+        NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Segments in the wrong order must be rejected
+    tm_merged = tm_imported[0];
+    tm_imported[0] = tm_imported[1];
+    tm_imported[1] = tm_merged;
+    ret_code = fnft_nsev_tm_merge(nseg, tm_imported, &tm_merged);
+    if (ret_code == SUCCESS || tm_merged != NULL) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    tm_merged = tm_imported[0];
+    tm_imported[0] = tm_imported[1];
+    tm_imported[1] = tm_merged;
+
+    ret_code = fnft_nsev_tm_merge(nseg, tm_imported, &tm_merged);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // Compare continuous spectra
+    query_opts = *opts;
+    query_opts.contspec_type = nsev_cstype_BOTH;
+    ret_code = fnft_nsev_tm_contspec(tm_full, M, contspec1, XI, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = fnft_nsev_tm_contspec(tm_merged, M, contspec2, XI,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    err = misc_rel_err(3*M, contspec2, contspec1);
+#ifdef DEBUG
+    printf("nsev_segments_test: contspec: err = %2.1e\n", err);
+#endif
+    if (!(err <= 1e-12)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // Compare discrete spectra. The merged object does not store the signal,
+    // which is why only the fast eigenvalue method is available.
+    query_opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    query_opts.discspec_type = nsev_dstype_BOTH;
+    K1 = 8;
+    ret_code = fnft_nsev_tm_discspec(tm_full, &K1, bound_states1, ncr1,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    K2 = 8;
+    ret_code = fnft_nsev_tm_discspec(tm_merged, &K2, bound_states2, ncr2,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K1 != 2 || K2 != K1) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    err = misc_hausdorff_dist(K1, bound_states1, K2, bound_states2);
+#ifdef DEBUG
+    printf("nsev_segments_test: bound states: err = %2.1e\n", err);
+#endif
+    if (!(err <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    // The norming constants and residues of the merged object are computed
+    // from the polynomials in the transfer matrix, which is ill-conditioned
+    // for bound states far away from the real axis. Only the bound state
+    // close to the real axis is therefore compared with the results for the
+    // full object. (The latter are computed from the signal itself using
+    // a different discretization, which is why the error bound depends
+    // on the discretization of the transfer matrix.)
+    for (i=0; i<K2; i++) {
+        if (CIMAG(bound_states2[i]) > 1.0)
+            continue;
+        for (j=0; j<K1; j++) {
+            if (CABS(bound_states1[j] - bound_states2[i]) > 1e-6)
+                continue;
+            err = misc_rel_err(1, ncr2 + i, ncr1 + j);
+            err2 = misc_rel_err(1, ncr2 + K2 + i, ncr1 + K1 + j);
+            if (err2 > err)
+                err = err2;
+#ifdef DEBUG
+            printf("nsev_segments_test: norming constant and residue: err = %2.1e\n", err);
+#endif
+            if (!(err <= error_bound_normconsts)) {
+                ret_code = E_TEST_FAILED;
+                goto release_mem;
+            }
+            break;
+        }
+        if (j == K1) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+    }
+
+    // If the segments store their signals, so does the merged object. Then,
+    // all localization methods are available.
+    fnft_nsev_tm_free(tm_merged);
+    ret_code = fnft_nsev_tm_merge(nseg, tm_segs, &tm_merged);
+    CHECK_RETCODE(ret_code, release_mem);
+    K1 = 8;
+    ret_code = fnft_nsev_tm_discspec(tm_full, &K1, bound_states1, ncr1,
+        NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    K2 = 8;
+    ret_code = fnft_nsev_tm_discspec(tm_merged, &K2, bound_states2, ncr2,
+        NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K2 != K1) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    err = misc_hausdorff_dist(K1, bound_states1, K2, bound_states2);
+    if (!(err <= 1e-10)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+release_mem:
+    for (i=0; i<nseg; i++) {
+        fnft_nsev_tm_free(tm_segs[i]);
+        fnft_nsev_tm_free(tm_imported[i]);
+    }
+    fnft_nsev_tm_free(tm_full);
+    fnft_nsev_tm_free(tm_merged);
+    free(buf);
+    free(q);
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code;
+    fnft_nsev_opts_t opts;
+
+    opts = fnft_nsev_default_opts();
+    ret_code = nsev_segments_test(&opts, 1e-6);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2_MODAL;
+    ret_code = nsev_segments_test(&opts, 5e-2);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
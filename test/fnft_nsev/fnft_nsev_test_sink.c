@@ -0,0 +1,195 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D 1024
+#define M 64
+#define MAX_K 8
+#define BLOCK_LEN 7
+
+// Collects the blocks that are passed to the callbacks
+typedef struct {
+    UINT nvals;
+    UINT next;
+    UINT K;
+    UINT nblocks;
+    INT abort;
+    COMPLEX contspec[3*M];
+    COMPLEX bound_states[MAX_K];
+    COMPLEX ncr[2*MAX_K];
+} collector_t;
+
+static INT collect_contspec(void *ctx, UINT first, UINT n,
+    COMPLEX const *vals)
+{
+    collector_t * const c = ctx;
+    UINT i, j;
+
+    // The blocks have to arrive in order
+    if (first != c->next || n == 0 || n > BLOCK_LEN || first + n > M)
+        return E_TEST_FAILED;
+    for (j=0; j<c->nvals; j++) {
+        for (i=0; i<n; i++)
+            c->contspec[j*M + first + i] = vals[j*n + i];
+    }
+    c->next += n;
+    c->nblocks++;
+    return c->abort ? FNFT_EC_OTHER : SUCCESS;
+}
+
+static INT collect_discspec(void *ctx, UINT n, COMPLEX const *bound_states,
+    COMPLEX const *ncr)
+{
+    collector_t * const c = ctx;
+    UINT i;
+
+    if (n == 0 || n > BLOCK_LEN || c->K + n > MAX_K)
+        return E_TEST_FAILED;
+    for (i=0; i<n; i++) {
+        c->bound_states[c->K + i] = bound_states[i];
+        if (ncr != NULL) {
+            c->ncr[c->K + i] = ncr[i];
+            c->ncr[MAX_K + c->K + i] = ncr[n + i];
+        }
+    }
+    c->K += n;
+    return SUCCESS;
+}
+
+// Transforms a signal with fnft_nsev_sink and compares the results with
+// those of fnft_nsev. The blocks of the continuous spectrum are computed
+// with chirp transforms that start at different points, which is why the
+// results agree only up to rounding errors. (The polynomial root finder
+// uses random shifts, which is why the order of the bound states may
+// differ.)
+static INT nsev_sink_test(COMPLEX * const q, fnft_nsev_opts_t * const opts)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, XI[2] = { -3.0, 2.0 };
+    COMPLEX contspec[3*M], bound_states[MAX_K], ncr[2*MAX_K];
+    collector_t c;
+    fnft_nsev_sink_t sink;
+    UINT K = MAX_K, i, j, nearest;
+
+    ret_code = fnft_nsev(D, q, T, M, contspec, XI, &K, bound_states, ncr,
+        +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    memset(&c, 0, sizeof(c));
+    c.nvals = 3;
+    sink.ctx = &c;
+    sink.contspec = collect_contspec;
+    sink.discspec = collect_discspec;
+    sink.block_len = BLOCK_LEN;
+    sink.normconsts_flag = 1;
+    ret_code = fnft_nsev_sink(D, q, T, M, XI, +1, opts, &sink);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    if (c.next != M || c.nblocks != (M + BLOCK_LEN - 1)/BLOCK_LEN
+        || !(misc_rel_err(3*M, c.contspec, contspec) <= 1e-10)
+        || K != 2 || c.K != K
+        || !(misc_hausdorff_dist(K, bound_states, c.K, c.bound_states)
+        <= 1e-12)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    for (i=0; i<K; i++) {
+        nearest = 0;
+        for (j=1; j<K; j++) {
+            if (CABS(c.bound_states[i] - bound_states[j])
+                < CABS(c.bound_states[i] - bound_states[nearest]))
+                nearest = j;
+        }
+        if (!(CABS(c.ncr[i] - ncr[nearest]) <= 1e-10*CABS(ncr[nearest]))
+            || !(CABS(c.ncr[MAX_K + i] - ncr[K + nearest])
+            <= 1e-10*CABS(ncr[K + nearest]))) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    UINT i;
+    REAL T[2] = { -16.0, 16.0 }, XI[2] = { -3.0, 2.0 };
+    REAL eps_t, t;
+    COMPLEX q[D];
+    collector_t c;
+    fnft_nsev_sink_t sink;
+    fnft_nsev_opts_t opts;
+
+    // A sech pulse with a chirp
+    eps_t = 32.0/(D - 1);
+    for (i=0; i<D; i++) {
+        t = -16.0 + i*eps_t;
+        q[i] = 2.2*misc_sech(t)*CEXP(I*0.3*t);
+    }
+
+    opts = fnft_nsev_default_opts();
+    opts.contspec_type = nsev_cstype_BOTH;
+    opts.discspec_type = nsev_dstype_BOTH;
+    ret_code = nsev_sink_test(q, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2A;
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = nsev_sink_test(q, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // A callback can stop the computation
+    memset(&c, 0, sizeof(c));
+    c.nvals = 3;
+    c.abort = 1;
+    sink.ctx = &c;
+    sink.contspec = collect_contspec;
+    sink.discspec = collect_discspec;
+    sink.block_len = BLOCK_LEN;
+    sink.normconsts_flag = 0;
+    if (fnft_nsev_sink(D, q, T, M, XI, +1, &opts, &sink)
+        != FNFT_EC_STOPPED || c.nblocks != 1 || c.K != 0) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+    // Newton's method needs initial guesses and cannot be used
+    opts.bound_state_localization = nsev_bsloc_NEWTON;
+    sink.contspec = NULL;
+    if (fnft_nsev_sink(D, q, T, M, XI, +1, &opts, &sink)
+        != FNFT_EC_INVALID_ARGUMENT) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/*
+* This file is part of FNFT.  
+*                                                                  
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*                                                                      
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include <stdio.h>
+#include <string.h>
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+
+#define D 1024
+#define M 63
+#define MAX_K 16
+
+// Transforms q with and without exploiting the symmetries of real signals
+// and compares the results. The mirrored values agree with the computed
+// ones only up to rounding errors. (The polynomial root finder uses random
+// shifts, which is why the discrete spectra may differ slightly even for
+// repeated calls with the same options.)
+static INT nsev_symmetry_test(COMPLEX * const q, fnft_nsev_opts_t * const opts,
+    const UINT K_exact)
+{
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, XI[2] = { -3.0, 3.0 };
+    COMPLEX contspec1[3*M], contspec2[3*M];
+    COMPLEX bound_states1[MAX_K], bound_states2[MAX_K];
+    COMPLEX ncr1[2*MAX_K], ncr2[2*MAX_K];
+    UINT K1 = MAX_K, K2 = MAX_K, i, j, nearest;
+
+    opts->symmetry = nsev_symmetry_NONE;
+    ret_code = fnft_nsev(D, q, T, M, contspec1, XI, &K1, bound_states1, ncr1,
+        +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+    opts->symmetry = nsev_symmetry_DETECT;
+    ret_code = fnft_nsev(D, q, T, M, contspec2, XI, &K2, bound_states2, ncr2,
+        +1, opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    if (K1 != K_exact || K2 != K1
+        || !(misc_rel_err(3*M, contspec2, contspec1) <= 1e-10)
+        || !(misc_hausdorff_dist(K1, bound_states1, K2, bound_states2)
+        <= 1e-8)) {
+        ret_code = E_TEST_FAILED;
+        goto leave_fun;
+    }
+    for (i=0; i<K2; i++) {
+        nearest = 0;
+        for (j=1; j<K1; j++) {
+            if (CABS(bound_states2[i] - bound_states1[j])
+                < CABS(bound_states2[i] - bound_states1[nearest]))
+                nearest = j;
+        }
+        if (!(CABS(ncr2[i] - ncr1[nearest]) <= 1e-6*CABS(ncr1[nearest]))
+            || !(CABS(ncr2[K2 + i] - ncr1[K1 + nearest])
+            <= 1e-6*CABS(ncr1[K1 + nearest]))) {
+            ret_code = E_TEST_FAILED;
+            goto leave_fun;
+        }
+    }
+
+leave_fun:
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code = SUCCESS;
+    UINT i;
+    REAL eps_t, t;
+    COMPLEX q[D];
+    fnft_nsev_opts_t opts;
+
+    // A real signal with a pair of bound states off the imaginary axis and
+    // one on the axis
+    eps_t = 32.0/(D - 1);
+    for (i=0; i<D; i++) {
+        t = -16.0 + i*eps_t;
+        q[i] = 3.0*misc_sech(2.0*(t - 4.0))*COS(4.0*(t - 4.0))
+            + 1.2*misc_sech(t + 3.0);
+    }
+
+    opts = fnft_nsev_default_opts();
+    opts.contspec_type = nsev_cstype_BOTH;
+    opts.discspec_type = nsev_dstype_BOTH;
+    ret_code = nsev_symmetry_test(q, &opts, 3);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2A;
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = nsev_symmetry_test(q, &opts, 3);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    // Complex signals are detected as such
+    for (i=0; i<D; i++)
+        q[i] *= CEXP(0.1*I*i*eps_t);
+    ret_code = nsev_symmetry_test(q, &opts, 3);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+#define FNFT_ENABLE_SHORT_NAMES
+
+#include "fnft_nsev.h"
+#include "fnft__misc.h"
+#include "fnft__errwarn.h"
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+// Checks that queries on a transfer matrix object give the same results as
+// the corresponding calls of fnft_nsev.
+static INT nsev_tm_test(const UINT D, fnft_nsev_opts_t * const opts)
+{
+    UINT i, K1, K2, M1 = 64, M2;
+    INT ret_code = SUCCESS;
+    REAL T[2] = { -16.0, 16.0 }, XI1[2] = { -3.0, 2.0 }, XI2[2] = { -7, 7 };
+    REAL ETA[2] = { -0.5, 2.0 }, err, err2;
+    COMPLEX *q = NULL, *contspec1 = NULL, *contspec2 = NULL, *xi = NULL;
+    COMPLEX *ab = NULL, *bound_states1 = NULL, *bound_states2 = NULL;
+    COMPLEX *normconsts1 = NULL, *normconsts2 = NULL;
+    fnft_nsev_tm_t *tm = NULL;
+    fnft_nsev_opts_t query_opts;
+
+    // More points than the degree of the transfer matrix
+    M2 = 3*D + 1;
+
+    q = malloc(D * sizeof(COMPLEX));
+    contspec1 = malloc(2*M2 * sizeof(COMPLEX));
+    contspec2 = malloc(2*M2 * sizeof(COMPLEX));
+    xi = malloc(M2 * sizeof(COMPLEX));
+    ab = malloc(2*M2 * sizeof(COMPLEX));
+    K1 = fnft_nsev_max_K(D, opts);
+    bound_states1 = malloc(K1 * sizeof(COMPLEX));
+    bound_states2 = malloc(K1 * sizeof(COMPLEX));
+    normconsts1 = malloc(K1 * sizeof(COMPLEX));
+    normconsts2 = malloc(K1 * sizeof(COMPLEX));
+    if (q == NULL || contspec1 == NULL || contspec2 == NULL || xi == NULL
+    || ab == NULL || bound_states1 == NULL || bound_states2 == NULL
+    || normconsts1 == NULL || normconsts2 == NULL) {
+        ret_code = E_NOMEM;
+        goto release_mem;
+    }
+
+    for (i=0; i<D; i++)
+        q[i] = 2.2*misc_sech(T[0] + i*(T[1] - T[0])/(D - 1));
+
+    ret_code = fnft_nsev_tm_create(D, q, T, +1, opts, &tm);
+    CHECK_RETCODE(ret_code, release_mem);
+
+    // The object works on a copy of the signal
+    for (i=0; i<D; i++)
+        q[i] *= 2.0;
+
+    // Bound states using the localization method given in opts
+    K2 = K1;
+    ret_code = fnft_nsev_tm_discspec(tm, &K2, bound_states2, normconsts2,
+        NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<D; i++)
+        q[i] *= 0.5;
+    ret_code = fnft_nsev(D, q, T, 0, NULL, NULL, &K1, bound_states1,
+        normconsts1, +1, opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K1 != 2 || K2 != K1) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    err = misc_hausdorff_dist(K1, bound_states1, K2, bound_states2);
+#ifdef DEBUG
+    printf("nsev_tm_test: bound states: err = %2.1e\n", err);
+#endif
+    if (!(err <= 100*EPSILON)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    err = misc_rel_err(K1, normconsts2, normconsts1);
+#ifdef DEBUG
+    printf("nsev_tm_test: norming constants: err = %2.1e\n", err);
+#endif
+    if (!(err <= 100*EPSILON)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // Continuous spectrum on a first grid ...
+    query_opts = *opts;
+    query_opts.contspec_type = nsev_cstype_BOTH;
+    ret_code = fnft_nsev(D, q, T, M1, contspec1, XI1, NULL, NULL, NULL, +1,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    ret_code = fnft_nsev_tm_contspec(tm, M1, contspec2, XI1, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    err = misc_rel_err(3*M1, contspec2, contspec1);
+#ifdef DEBUG
+    printf("nsev_tm_test: contspec on first grid: err = %2.1e\n", err);
+#endif
+    if (!(err <= 100*EPSILON)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // ... and on a second, finer grid. The values of a and b are compared
+    // with those obtained by direct evaluation.
+    query_opts.contspec_type = nsev_cstype_AB;
+    ret_code = fnft_nsev_tm_contspec(tm, M2, contspec2, XI2, &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<M2; i++)
+        xi[i] = XI2[0] + i*(XI2[1] - XI2[0])/(M2 - 1);
+    ret_code = fnft_nsev_tm_ab(tm, M2, xi, ab, ab + M2);
+    CHECK_RETCODE(ret_code, release_mem);
+    err = misc_rel_err(2*M2, ab, contspec2);
+#ifdef DEBUG
+    printf("nsev_tm_test: a and b on second grid: err = %2.1e\n", err);
+#endif
+    if (!(err <= 1e-8)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // Values of a and b on a rectangular grid that extends into both half
+    // planes are compared with those obtained by direct evaluation. The
+    // errors are measured row-wise since the magnitudes differ strongly.
+    ret_code = fnft_nsev_tm_ab_grid(tm, 21, XI1, 11, ETA, contspec1,
+        contspec1 + 21*11);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<21*11; i++)
+        xi[i] = XI1[0] + (i % 21)*(XI1[1] - XI1[0])/20
+            + I*(ETA[0] + (i / 21)*(ETA[1] - ETA[0])/10);
+    ret_code = fnft_nsev_tm_ab(tm, 21*11, xi, ab, ab + 21*11);
+    CHECK_RETCODE(ret_code, release_mem);
+    err = 0.0;
+    for (i=0; i<2*11; i++) {
+        err2 = misc_rel_err(21, contspec1 + 21*i, ab + 21*i);
+        if (err2 > err)
+            err = err2;
+    }
+#ifdef DEBUG
+    printf("nsev_tm_test: a and b on rectangular grid: err = %2.1e\n", err);
+#endif
+    if (!(err <= 1e-8)) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+
+    // The roots of the polynomial approximation of a(lambda) that are found
+    // with the fast eigenvalue method must be roots of the values returned
+    // by fnft_nsev_tm_ab in the upper half plane as well.
+    query_opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    K2 = fnft_nsev_max_K(D, opts);
+    ret_code = fnft_nsev_tm_discspec(tm, &K2, bound_states2, NULL,
+        &query_opts);
+    CHECK_RETCODE(ret_code, release_mem);
+    if (K2 != 2) {
+        ret_code = E_TEST_FAILED;
+        goto release_mem;
+    }
+    ret_code = fnft_nsev_tm_ab(tm, K2, bound_states2, ab, NULL);
+    CHECK_RETCODE(ret_code, release_mem);
+    for (i=0; i<K2; i++) {
+#ifdef DEBUG
+        printf("nsev_tm_test: |a(bound_states[%i])| = %2.1e\n", (int)i,
+            CABS(ab[i]));
+#endif
+        if (!(CABS(ab[i]) <= 1e-9)) {
+            ret_code = E_TEST_FAILED;
+            goto release_mem;
+        }
+    }
+
+release_mem:
+    fnft_nsev_tm_free(tm);
+    free(q);
+    free(contspec1);
+    free(contspec2);
+    free(xi);
+    free(ab);
+    free(bound_states1);
+    free(bound_states2);
+    free(normconsts1);
+    free(normconsts2);
+    return ret_code;
+}
+
+INT main()
+{
+    INT ret_code;
+    fnft_nsev_opts_t opts;
+
+    opts = fnft_nsev_default_opts();
+    ret_code = nsev_tm_test(1024, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+    opts.discretization = nse_discretization_2SPLIT2A;
+    opts.bound_state_localization = nsev_bsloc_FAST_EIGENVALUE;
+    ret_code = nsev_tm_test(512, &opts);
+    CHECK_RETCODE(ret_code, leave_fun);
+
+leave_fun:
+    if (ret_code != SUCCESS)
+        return EXIT_FAILURE;
+    else
+        return EXIT_SUCCESS;
+}
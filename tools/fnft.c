@@ -0,0 +1,789 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Command line tool that applies fnft_nsev, fnft_nsep or fnft_kdvv to all
+// records in a binary file. Run "fnft --help" for usage information.
+//
+// Input files contain fixed-length records of complex samples, stored as
+// interleaved doubles in native byte order. They either start with the
+// 64-byte header described by signal_header_t below, or are raw (option
+// --raw), in which case the number of samples per record and the time
+// interval have to be given on the command line.
+//
+// The results are written into an archive (see fnft_archive.h) in the
+// order of the input. The records are processed in parallel and appended
+// to the archive in batches by the main thread.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fnft_nsev.h"
+#include "fnft_nsep.h"
+#include "fnft_kdvv.h"
+#include "fnft_archive.h"
+
+#define SIGNAL_MAGIC "FNFTSIG1"
+
+// Number of results that can be pending per worker thread before they are
+// appended to the archive
+#define RESULTS_PER_THREAD 4
+
+// Header of signal files
+typedef struct {
+    char magic[8];
+    uint64_t D;          // number of samples per record
+    uint64_t nrecords;   // number of records
+    double T[2];         // see fnft_nsev, fnft_nsep and fnft_kdvv
+    uint8_t reserved[24];
+} signal_header_t;
+
+typedef enum {
+    TRANSFORM_NSEV,
+    TRANSFORM_NSEP,
+    TRANSFORM_KDVV
+} transform_t;
+
+typedef struct {
+    transform_t transform;
+    const char *input;
+    const char *output;
+    int raw_flag;
+    FNFT_UINT D;
+    FNFT_REAL T[2];
+    int have_T;
+    FNFT_UINT M;
+    FNFT_REAL XI[2];
+    int contspec_flag;
+    int discspec_flag;
+    FNFT_INT kappa;
+    FNFT_UINT max_K;
+    FNFT_UINT nthreads;
+    fnft_nsev_opts_t nsev_opts;
+    fnft_nsep_opts_t nsep_opts;
+    fnft_kdvv_opts_t kdvv_opts;
+} cli_opts_t;
+
+// Result of a record that has not been appended to the archive yet. The
+// arrays in rec point into buf.
+typedef struct {
+    fnft_archive_record_t rec;
+    FNFT_COMPLEX *buf;
+    int ready;
+} pending_t;
+
+// State shared by the worker threads and the main thread. Record i is
+// processed only after the records before i-window have been appended. Its
+// result is stored in pending[i % window].
+typedef struct {
+    cli_opts_t const *opts;
+    FNFT_COMPLEX const *signals;
+    FNFT_UINT nrecords;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    FNFT_UINT next_record;
+    FNFT_UINT next_append;
+    FNFT_UINT window;
+    pending_t *pending;
+    int error;
+} job_t;
+
+static const char * const nse_discretization_names[] = {
+    "2split2_modal", "2split2a", "2split4a", "2split4b", "bo", NULL };
+static const char * const kdv_discretization_names[] = {
+    "2split1a", "2split1b", "2split2a", "2split2b", "2split3a", "2split3b",
+    "2split4a", "2split4b", "2split5a", "2split5b", "2split6a", "2split6b",
+    "2split7a", "2split7b", "2split8a", "2split8b", NULL };
+static const char * const nsev_bsfilt_names[] = {
+    "none", "basic", "full", NULL };
+static const char * const nsev_bsloc_names[] = {
+    "fast_eigenvalue", "newton", "subsample_and_refine", NULL };
+static const char * const nsev_dstype_names[] = {
+    "norming_constants", "residues", "both", NULL };
+static const char * const nsev_cstype_names[] = {
+    "reflection_coefficient", "ab", "both", NULL };
+static const char * const nsev_symmetry_names[] = {
+    "none", "real", "detect", NULL };
+static const char * const nsep_loc_names[] = {
+    "subsample_and_refine", "gridsearch", "mixed", NULL };
+static const char * const nsep_filt_names[] = {
+    "none", "manual", "auto", NULL };
+
+static void print_usage(FILE *f)
+{
+    fprintf(f,
+"Usage: fnft nsev|nsep|kdvv [options] input output\n"
+"       fnft gen [options] output\n"
+"       fnft info archive\n"
+"\n"
+"Applies fnft_nsev, fnft_nsep or fnft_kdvv to every record in the input\n"
+"file and writes the results into an archive. \"gen\" writes a file with\n"
+"random sech pulses, \"info\" summarizes an archive.\n"
+"\n"
+"General options:\n"
+"  --raw                     input has no header (requires --D and --T)\n"
+"  --D <n>                   number of samples per record\n"
+"  --T <t0> <t1>             time interval (see the fnft_* routines)\n"
+"  --records <n>             number of records (gen only)\n"
+"  --seed <n>                seed of the random generator (gen only)\n"
+"  --threads <n>             number of worker threads\n"
+"  --kappa <+1|-1>           focusing or defocusing (nsev, nsep)\n"
+"  --M <n>                   number of points in the continuous spectrum\n"
+"  --XI <xi0> <xi1>          range of the continuous spectrum\n"
+"  --no-contspec             do not compute the continuous spectrum\n"
+"  --no-discspec             do not compute the discrete spectrum\n"
+"  --max-K <n>               max. number of points in discrete spectra\n"
+"\n"
+"Options that correspond to fields of fnft_nsev_opts_t,\n"
+"fnft_nsep_opts_t and fnft_kdvv_opts_t:\n"
+"  --discretization <name>   e.g. 2split4b, bo (nse) or 2split3a (kdv)\n"
+"  --normalization-flag <0|1>\n"
+"  --bound-state-filtering <none|basic|full>\n"
+"  --bound-state-localization <fast_eigenvalue|newton|subsample_and_refine>\n"
+"  --niter <n>\n"
+"  --discspec-type <norming_constants|residues|both>\n"
+"  --contspec-type <reflection_coefficient|ab|both>\n"
+"  --symmetry <none|real|detect>\n"
+"  --localization <subsample_and_refine|gridsearch|mixed>\n"
+"  --filtering <none|manual|auto>\n"
+"  --bounding-box <re0> <re1> <im0> <im1>\n"
+"  --max-evals <n>\n"
+"fnft_nsev_opts_t::nthreads is always one, since the records are already\n"
+"transformed in parallel (see --threads).\n"
+"\n"
+"Input files contain records of D complex samples (interleaved doubles in\n"
+"native byte order). Unless --raw is given, they start with a 64-byte\n"
+"header: \"FNFTSIG1\", D and the number of records (uint64), T[0] and\n"
+"T[1] (double) and 24 reserved bytes.\n"
+"The results are stored in an indexed archive, which consists of the\n"
+"output file and a heap file with the additional suffix \".heap\". The\n"
+"transform is stored as 0=nsev, 1=nsep or 2=kdvv. Every record contains\n"
+"the return code, the continuous spectrum, the discrete spectra (bound\n"
+"states and norming constants and/or residues for nsev, main and\n"
+"auxiliary spectrum for nsep) and the run time of the transform. See\n"
+"tools/fnft_archive.h for the format and the functions to read it.\n");
+}
+
+// Returns the index of name in the NULL-terminated list names, or -1.
+static int parse_name(const char *name, const char * const names[])
+{
+    int i;
+    for (i=0; names[i] != NULL; i++) {
+        if (strcmp(name, names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+// Parses the command line. Returns 0 on success.
+static int parse_args(int argc, char *argv[], cli_opts_t *opts,
+    FNFT_UINT *nrecords_ptr, unsigned long *seed_ptr)
+{
+    int i, n, val, nfiles = 0;
+    const char *files[2] = { NULL, NULL };
+
+#define NEED(k) do { if (i + (k) >= argc) { \
+    fprintf(stderr, "fnft: %s needs %d argument(s)\n", argv[i], k); \
+    return -1; } } while (0)
+#define NAME_ARG(names, field, type) do { NEED(1); \
+    val = parse_name(argv[++i], names); \
+    if (val < 0) { \
+        fprintf(stderr, "fnft: unknown value %s\n", argv[i]); \
+        return -1; } \
+    field = (type)val; } while (0)
+
+    for (i=2; i<argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--raw") == 0) {
+            opts->raw_flag = 1;
+        } else if (strcmp(a, "--D") == 0) {
+            NEED(1); opts->D = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--T") == 0) {
+            NEED(2);
+            opts->T[0] = strtod(argv[++i], NULL);
+            opts->T[1] = strtod(argv[++i], NULL);
+            opts->have_T = 1;
+        } else if (strcmp(a, "--records") == 0) {
+            NEED(1); *nrecords_ptr = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--seed") == 0) {
+            NEED(1); *seed_ptr = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--threads") == 0) {
+            NEED(1); opts->nthreads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--kappa") == 0) {
+            NEED(1); opts->kappa = atoi(argv[++i]);
+        } else if (strcmp(a, "--M") == 0) {
+            NEED(1); opts->M = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--XI") == 0) {
+            NEED(2);
+            opts->XI[0] = strtod(argv[++i], NULL);
+            opts->XI[1] = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--no-contspec") == 0) {
+            opts->contspec_flag = 0;
+        } else if (strcmp(a, "--no-discspec") == 0) {
+            opts->discspec_flag = 0;
+        } else if (strcmp(a, "--max-K") == 0) {
+            NEED(1); opts->max_K = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--discretization") == 0) {
+            if (opts->transform == TRANSFORM_KDVV) {
+                NAME_ARG(kdv_discretization_names,
+                    opts->kdvv_opts.discretization,
+                    fnft_kdv_discretization_t);
+            } else {
+                NAME_ARG(nse_discretization_names,
+                    opts->nsev_opts.discretization,
+                    fnft_nse_discretization_t);
+                opts->nsep_opts.discretization =
+                    opts->nsev_opts.discretization;
+            }
+        } else if (strcmp(a, "--normalization-flag") == 0) {
+            NEED(1);
+            opts->nsev_opts.normalization_flag = atoi(argv[++i]);
+            opts->nsep_opts.normalization_flag =
+                opts->nsev_opts.normalization_flag;
+        } else if (strcmp(a, "--bound-state-filtering") == 0) {
+            NAME_ARG(nsev_bsfilt_names, opts->nsev_opts.bound_state_filtering,
+                fnft_nsev_bsfilt_t);
+        } else if (strcmp(a, "--bound-state-localization") == 0) {
+            NAME_ARG(nsev_bsloc_names,
+                opts->nsev_opts.bound_state_localization, fnft_nsev_bsloc_t);
+        } else if (strcmp(a, "--niter") == 0) {
+            NEED(1); opts->nsev_opts.niter = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--discspec-type") == 0) {
+            NAME_ARG(nsev_dstype_names, opts->nsev_opts.discspec_type,
+                fnft_nsev_dstype_t);
+        } else if (strcmp(a, "--contspec-type") == 0) {
+            NAME_ARG(nsev_cstype_names, opts->nsev_opts.contspec_type,
+                fnft_nsev_cstype_t);
+        } else if (strcmp(a, "--symmetry") == 0) {
+            NAME_ARG(nsev_symmetry_names, opts->nsev_opts.symmetry,
+                fnft_nsev_symmetry_t);
+        } else if (strcmp(a, "--localization") == 0) {
+            NAME_ARG(nsep_loc_names, opts->nsep_opts.localization,
+                fnft_nsep_loc_t);
+        } else if (strcmp(a, "--filtering") == 0) {
+            NAME_ARG(nsep_filt_names, opts->nsep_opts.filtering,
+                fnft_nsep_filt_t);
+        } else if (strcmp(a, "--bounding-box") == 0) {
+            NEED(4);
+            for (n=0; n<4; n++)
+                opts->nsep_opts.bounding_box[n] = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--max-evals") == 0) {
+            NEED(1);
+            opts->nsep_opts.max_evals = strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(a, "--", 2) == 0) {
+            fprintf(stderr, "fnft: unknown option %s\n", a);
+            return -1;
+        } else {
+            if (nfiles == 2) {
+                fprintf(stderr, "fnft: too many file names\n");
+                return -1;
+            }
+            files[nfiles++] = a;
+        }
+    }
+#undef NEED
+#undef NAME_ARG
+
+    if (nfiles == 2) {
+        opts->input = files[0];
+        opts->output = files[1];
+    } else if (nfiles == 1) {
+        opts->output = files[0];
+    } else {
+        fprintf(stderr, "fnft: no file name given\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Number of complex values in the continuous spectrum per record
+static FNFT_UINT contspec_len(cli_opts_t const * const opts)
+{
+    if (!opts->contspec_flag || opts->transform == TRANSFORM_NSEP)
+        return 0;
+    if (opts->transform == TRANSFORM_NSEV) {
+        switch (opts->nsev_opts.contspec_type) {
+        case fnft_nsev_cstype_AB:
+            return 2*opts->M;
+        case fnft_nsev_cstype_BOTH:
+            return 3*opts->M;
+        default:
+            return opts->M;
+        }
+    }
+    return opts->M;
+}
+
+// Worker thread: Processes records until none are left. Every worker has
+// its own copies of the options, which are reused for all records it
+// processes. The results are computed directly into the pending slots.
+static void *worker(void *arg)
+{
+    job_t * const job = arg;
+    cli_opts_t const * const opts = job->opts;
+    const FNFT_UINT D = opts->D, ncs = contspec_len(opts);
+    const FNFT_UINT max_K = opts->max_K;
+    fnft_nsev_opts_t nsev_opts = opts->nsev_opts;
+    fnft_nsep_opts_t nsep_opts = opts->nsep_opts;
+    fnft_kdvv_opts_t kdvv_opts = opts->kdvv_opts;
+    FNFT_COMPLEX *q = NULL, *contspec, *spec1, *spec2;
+    fnft_archive_record_t *rec;
+    FNFT_UINT i, K1, K2;
+    FNFT_INT ret_code;
+    double t_start;
+
+    // The records are already transformed in parallel
+    nsev_opts.nthreads = 1;
+
+    q = malloc(D * sizeof(FNFT_COMPLEX));
+    if (q == NULL) {
+        pthread_mutex_lock(&job->mutex);
+        job->error = 1;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->mutex);
+        return NULL;
+    }
+
+    while (1) {
+        pthread_mutex_lock(&job->mutex);
+        while (!job->error && job->next_record < job->nrecords
+            && job->next_record >= job->next_append + job->window)
+            pthread_cond_wait(&job->cond, &job->mutex);
+        i = job->next_record;
+        if (job->error || i >= job->nrecords) {
+            pthread_mutex_unlock(&job->mutex);
+            break;
+        }
+        job->next_record++;
+        pthread_mutex_unlock(&job->mutex);
+
+        rec = &job->pending[i % job->window].rec;
+        contspec = job->pending[i % job->window].buf;
+        spec1 = contspec + ncs;
+        spec2 = spec1 + max_K;
+
+        // The input is mapped read-only, and the routines might modify q
+        memcpy(q, job->signals + (size_t)i*D, D * sizeof(FNFT_COMPLEX));
+        K1 = max_K;
+        K2 = max_K;
+        t_start = wall_time();
+        switch (opts->transform) {
+        case TRANSFORM_NSEV:
+            ret_code = fnft_nsev(D, q, opts->T, ncs > 0 ? opts->M : 0,
+                ncs > 0 ? contspec : NULL, opts->XI,
+                opts->discspec_flag ? &K1 : NULL,
+                opts->discspec_flag ? spec1 : NULL,
+                opts->discspec_flag ? spec2 : NULL, opts->kappa, &nsev_opts);
+            if (!opts->discspec_flag)
+                K1 = 0;
+            K2 = (nsev_opts.discspec_type == fnft_nsev_dstype_BOTH) ? 2*K1
+                : K1;
+            break;
+        case TRANSFORM_NSEP:
+            ret_code = fnft_nsep(D, q, opts->T, &K1, spec1, &K2, spec2, NULL,
+                opts->kappa, &nsep_opts);
+            break;
+        default:
+            ret_code = fnft_kdvv(D, q, opts->T, opts->M, contspec, opts->XI,
+                NULL, NULL, NULL, &kdvv_opts);
+            K1 = 0;
+            K2 = 0;
+        }
+        memset(rec, 0, sizeof(fnft_archive_record_t));
+        rec->stats[0] = wall_time() - t_start;
+        rec->ret_code = ret_code;
+        if (ret_code == FNFT_SUCCESS) {
+            rec->K1 = K1;
+            rec->K2 = K2;
+            rec->contspec = contspec;
+            rec->spec1 = spec1;
+            rec->spec2 = spec2;
+        }
+
+        pthread_mutex_lock(&job->mutex);
+        job->pending[i % job->window].ready = 1;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->mutex);
+    }
+
+    free(q);
+    return NULL;
+}
+
+// Applies the transform to all records of the input file
+static int run_transform(cli_opts_t *opts)
+{
+    int in_fd = -1, ret = EXIT_FAILURE;
+    struct stat st;
+    void *map = MAP_FAILED;
+    size_t map_len = 0, data_offset = 0;
+    signal_header_t sig_hdr;
+    fnft_archive_t *ar = NULL;
+    fnft_archive_info_t info;
+    fnft_archive_record_t *recs = NULL;
+    job_t job;
+    pthread_t *threads = NULL;
+    FNFT_UINT i, n, nds2, nthreads_started = 0, nfailed = 0;
+    FNFT_INT ret_code;
+    double t_start, t_elapsed;
+
+    memset(&job, 0, sizeof(job));
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    // Map the input file
+    in_fd = open(opts->input, O_RDONLY);
+    if (in_fd < 0 || fstat(in_fd, &st) != 0) {
+        fprintf(stderr, "fnft: cannot open %s: %s\n", opts->input,
+            strerror(errno));
+        goto release_mem;
+    }
+    map_len = (size_t)st.st_size;
+    if (map_len > 0)
+        map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "fnft: cannot map %s\n", opts->input);
+        goto release_mem;
+    }
+    if (!opts->raw_flag) {
+        if (map_len < sizeof(sig_hdr)) {
+            fprintf(stderr, "fnft: %s is too short\n", opts->input);
+            goto release_mem;
+        }
+        memcpy(&sig_hdr, map, sizeof(sig_hdr));
+        if (memcmp(sig_hdr.magic, SIGNAL_MAGIC, 8) != 0) {
+            fprintf(stderr, "fnft: %s has no valid header (use --raw?)\n",
+                opts->input);
+            goto release_mem;
+        }
+        opts->D = (FNFT_UINT)sig_hdr.D;
+        if (!opts->have_T) {
+            opts->T[0] = sig_hdr.T[0];
+            opts->T[1] = sig_hdr.T[1];
+        }
+        data_offset = sizeof(sig_hdr);
+        job.nrecords = (FNFT_UINT)sig_hdr.nrecords;
+        if (job.nrecords > (map_len - data_offset)
+            / (opts->D * sizeof(FNFT_COMPLEX))) {
+            fprintf(stderr, "fnft: %s is truncated\n", opts->input);
+            goto release_mem;
+        }
+    } else {
+        if (opts->D == 0 || !opts->have_T) {
+            fprintf(stderr, "fnft: --raw requires --D and --T\n");
+            goto release_mem;
+        }
+        job.nrecords = (FNFT_UINT)(map_len / (opts->D*sizeof(FNFT_COMPLEX)));
+    }
+    if (opts->D == 0) {
+        fprintf(stderr, "fnft: D must be positive\n");
+        goto release_mem;
+    }
+    job.signals = (FNFT_COMPLEX const *)((char const *)map + data_offset);
+    if (opts->max_K == 0) {
+        if (opts->transform == TRANSFORM_NSEV)
+            opts->max_K = fnft_nsev_max_K(opts->D, &opts->nsev_opts);
+        else
+            opts->max_K = opts->D;
+    }
+    job.opts = opts;
+
+    // Create the archive
+    memset(&info, 0, sizeof(info));
+    info.transform = opts->transform;
+    info.D = opts->D;
+    info.T[0] = opts->T[0];
+    info.T[1] = opts->T[1];
+    info.M = contspec_len(opts) > 0 ? opts->M : 0;
+    info.XI[0] = opts->XI[0];
+    info.XI[1] = opts->XI[1];
+    info.ncontspec = contspec_len(opts);
+    ret_code = fnft_archive_create(opts->output, &info, &ar);
+    if (ret_code != FNFT_SUCCESS) {
+        fprintf(stderr, "fnft: cannot create %s (error code %d)\n",
+            opts->output, (int)ret_code);
+        goto release_mem;
+    }
+
+    // Buffers for the pending results: the continuous spectrum and both
+    // discrete spectra
+    nds2 = (opts->transform == TRANSFORM_NSEV
+        && opts->nsev_opts.discspec_type == fnft_nsev_dstype_BOTH)
+        ? 2*opts->max_K : opts->max_K;
+    job.window = RESULTS_PER_THREAD * opts->nthreads;
+    job.pending = calloc(job.window, sizeof(pending_t));
+    recs = malloc(job.window * sizeof(fnft_archive_record_t));
+    threads = malloc(opts->nthreads * sizeof(pthread_t));
+    if (job.pending == NULL || recs == NULL || threads == NULL) {
+        fprintf(stderr, "fnft: out of memory\n");
+        goto release_mem;
+    }
+    for (i=0; i<job.window; i++) {
+        job.pending[i].buf = malloc((info.ncontspec + opts->max_K + nds2)
+            * sizeof(FNFT_COMPLEX));
+        if (job.pending[i].buf == NULL) {
+            fprintf(stderr, "fnft: out of memory\n");
+            goto release_mem;
+        }
+    }
+
+    // Run the workers. The main thread appends the results in the order of
+    // the input as soon as they are available.
+    t_start = wall_time();
+    for (i=0; i<opts->nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, worker, &job) != 0)
+            break;
+        nthreads_started++;
+    }
+    if (nthreads_started == 0)
+        job.error = 1;
+    while (job.next_append < job.nrecords) {
+        pthread_mutex_lock(&job.mutex);
+        while (!job.error && !job.pending[job.next_append % job.window].ready)
+            pthread_cond_wait(&job.cond, &job.mutex);
+        if (job.error) {
+            pthread_mutex_unlock(&job.mutex);
+            break;
+        }
+        for (n=0; job.next_append + n < job.nrecords && n < job.window
+            && job.pending[(job.next_append + n) % job.window].ready; n++)
+            recs[n] = job.pending[(job.next_append + n) % job.window].rec;
+        pthread_mutex_unlock(&job.mutex);
+
+        ret_code = fnft_archive_append(ar, n, recs);
+        for (i=0; i<n; i++) {
+            if (recs[i].ret_code != FNFT_SUCCESS) {
+                if (nfailed < 10)
+                    fprintf(stderr, "fnft: record %lu failed with code %d\n",
+                        (unsigned long)(job.next_append + i),
+                        (int)recs[i].ret_code);
+                nfailed++;
+            }
+        }
+
+        pthread_mutex_lock(&job.mutex);
+        for (i=0; i<n; i++)
+            job.pending[(job.next_append + i) % job.window].ready = 0;
+        job.next_append += n;
+        if (ret_code != FNFT_SUCCESS)
+            job.error = 1;
+        pthread_cond_broadcast(&job.cond);
+        pthread_mutex_unlock(&job.mutex);
+    }
+    for (i=0; i<nthreads_started; i++)
+        pthread_join(threads[i], NULL);
+    t_elapsed = wall_time() - t_start;
+    if (job.error) {
+        fprintf(stderr, "fnft: processing failed\n");
+        goto release_mem;
+    }
+
+    // Throughput summary
+    fprintf(stderr, "fnft: %lu records (%lu failed), %lu threads, %.3f s, "
+        "%.1f records/s, %.2f Msamples/s\n", (unsigned long)job.nrecords,
+        (unsigned long)nfailed, (unsigned long)nthreads_started, t_elapsed,
+        job.nrecords/t_elapsed, 1e-6*job.nrecords*opts->D/t_elapsed);
+    ret = nfailed > 0 ? 2 : EXIT_SUCCESS;
+
+release_mem:
+    if (fnft_archive_close(ar) != FNFT_SUCCESS) {
+        fprintf(stderr, "fnft: cannot write %s\n", opts->output);
+        ret = EXIT_FAILURE;
+    }
+    if (map != MAP_FAILED)
+        munmap(map, map_len);
+    if (in_fd >= 0)
+        close(in_fd);
+    if (job.pending != NULL) {
+        for (i=0; i<job.window; i++)
+            free(job.pending[i].buf);
+    }
+    free(job.pending);
+    free(recs);
+    free(threads);
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.mutex);
+    return ret;
+}
+
+// Writes a signal file with random sech pulses
+static int run_gen(cli_opts_t const * const opts, const FNFT_UINT nrecords,
+    unsigned long seed)
+{
+    FILE *f;
+    signal_header_t hdr;
+    FNFT_COMPLEX *q;
+    FNFT_REAL t, A, c;
+    FNFT_UINT i, n;
+    int ret = EXIT_SUCCESS;
+
+    q = malloc(opts->D * sizeof(FNFT_COMPLEX));
+    f = fopen(opts->output, "wb");
+    if (q == NULL || f == NULL) {
+        fprintf(stderr, "fnft: cannot create %s\n", opts->output);
+        free(q);
+        if (f != NULL)
+            fclose(f);
+        return EXIT_FAILURE;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SIGNAL_MAGIC, 8);
+    hdr.D = opts->D;
+    hdr.nrecords = nrecords;
+    hdr.T[0] = opts->T[0];
+    hdr.T[1] = opts->T[1];
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+        ret = EXIT_FAILURE;
+    for (i=0; i<nrecords && ret == EXIT_SUCCESS; i++) {
+        // Amplitude in [1,3) and chirp in [-1,1) from a linear
+        // congruential generator
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        A = 1.0 + 2.0*((seed >> 11) & 0xFFFFF)/1048576.0;
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        c = -1.0 + 2.0*((seed >> 11) & 0xFFFFF)/1048576.0;
+        for (n=0; n<opts->D; n++) {
+            t = opts->T[0] + n*(opts->T[1] - opts->T[0])/(opts->D - 1);
+            q[n] = A/FNFT_COSH(t) * FNFT_CEXP(I*c*t);
+        }
+        if (fwrite(q, sizeof(FNFT_COMPLEX), opts->D, f) != opts->D)
+            ret = EXIT_FAILURE;
+    }
+    if (fclose(f) != 0)
+        ret = EXIT_FAILURE;
+    free(q);
+    return ret;
+}
+
+// Prints a summary of an archive
+static int run_info(const char *filename)
+{
+    fnft_archive_t *ar;
+    fnft_archive_info_t info;
+    fnft_archive_record_t rec;
+    uint64_t i, nrecords, nfailed = 0, K1 = 0;
+    double t_total = 0.0;
+    static const char * const transform_names[] = { "nsev", "nsep", "kdvv" };
+    FNFT_INT ret_code;
+    int ret = EXIT_SUCCESS;
+
+    ret_code = fnft_archive_open(filename, 0, &ar);
+    if (ret_code != FNFT_SUCCESS) {
+        fprintf(stderr, "fnft: %s is not a valid archive (error code %d)\n",
+            filename, (int)ret_code);
+        return EXIT_FAILURE;
+    }
+    info = fnft_archive_info(ar);
+    nrecords = fnft_archive_nrecords(ar);
+    for (i=0; i<nrecords; i++) {
+        ret_code = fnft_archive_get(ar, i, &rec);
+        if (ret_code != FNFT_SUCCESS) {
+            fprintf(stderr, "fnft: record %lu of %s is corrupt\n",
+                (unsigned long)i, filename);
+            ret = EXIT_FAILURE;
+            break;
+        }
+        if (rec.ret_code != FNFT_SUCCESS)
+            nfailed++;
+        K1 += rec.K1;
+        t_total += rec.stats[0];
+    }
+    printf("transform: %s\nrecords: %lu\nfailed: %lu\nD: %lu\nM: %lu\n"
+        "discrete spectrum points: %lu\ntransform time: %.3f s\n",
+        info.transform <= 2 ? transform_names[info.transform] : "unknown",
+        (unsigned long)nrecords, (unsigned long)nfailed,
+        (unsigned long)info.D, (unsigned long)info.M, (unsigned long)K1,
+        t_total);
+    fnft_archive_close(ar);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    cli_opts_t opts;
+    FNFT_UINT nrecords = 16;
+    unsigned long seed = 1;
+    long ncpus;
+
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        print_usage(argc < 2 ? stderr : stdout);
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    memset(&opts, 0, sizeof(opts));
+    if (strcmp(argv[1], "nsev") == 0 || strcmp(argv[1], "gen") == 0
+        || strcmp(argv[1], "info") == 0) {
+        opts.transform = TRANSFORM_NSEV;
+    } else if (strcmp(argv[1], "nsep") == 0) {
+        opts.transform = TRANSFORM_NSEP;
+    } else if (strcmp(argv[1], "kdvv") == 0) {
+        opts.transform = TRANSFORM_KDVV;
+    } else {
+        print_usage(stderr);
+        return EXIT_FAILURE;
+    }
+    opts.D = 0;
+    opts.T[0] = -16.0;
+    opts.T[1] = 16.0;
+    opts.M = 256;
+    opts.XI[0] = -4.0;
+    opts.XI[1] = 4.0;
+    opts.contspec_flag = 1;
+    opts.discspec_flag = 1;
+    opts.kappa = +1;
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.nthreads = ncpus > 0 ? (FNFT_UINT)ncpus : 1;
+    opts.nsev_opts = fnft_nsev_default_opts();
+    opts.nsep_opts = fnft_nsep_default_opts();
+    opts.kdvv_opts = fnft_kdvv_default_opts();
+    if (parse_args(argc, argv, &opts, &nrecords, &seed) != 0)
+        return EXIT_FAILURE;
+    if (opts.nthreads == 0)
+        opts.nthreads = 1;
+
+    if (strcmp(argv[1], "gen") == 0) {
+        if (opts.D < 2) {
+            fprintf(stderr, "fnft: gen requires --D >= 2\n");
+            return EXIT_FAILURE;
+        }
+        return run_gen(&opts, nrecords, seed);
+    }
+    if (strcmp(argv[1], "info") == 0)
+        return run_info(opts.output);
+    if (opts.input == NULL) {
+        fprintf(stderr, "fnft: input and output files are required\n");
+        return EXIT_FAILURE;
+    }
+    return run_transform(&opts);
+}
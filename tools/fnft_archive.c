@@ -0,0 +1,509 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Layout of the main file:
+//
+//   bytes 0-127    header_t
+//   bytes 128-191  commit block A (commit_t)
+//   bytes 192-255  commit block B (commit_t)
+//   bytes 256-     one slot per record: slot_t followed by ncontspec
+//                  complex values
+//
+// The commit with sequence number s is stored in block s % 2. The valid
+// commit with the highest sequence number determines the number of
+// records and the size of the heap. The heap file contains the values of
+// spec1 followed by those of spec2 for every record.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "fnft_archive.h"
+
+#define ARCHIVE_MAGIC "FNFTARC1"
+#define BYTE_ORDER_MARK 0x01020304u
+#define COMMIT_OFFSET 128
+#define COMMIT_SIZE 64
+#define DATA_OFFSET 256
+#define SLOT_HEADER_SIZE 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t transform;
+    uint32_t reserved0;
+    uint64_t D;
+    double T[2];
+    uint64_t M;
+    double XI[2];
+    uint64_t ncontspec;
+    uint8_t reserved[48];
+} header_t;
+
+typedef struct {
+    uint64_t seq;
+    uint64_t nrecords;
+    uint64_t heap_size;
+    uint64_t checksum;
+    uint64_t reserved[4];
+} commit_t;
+
+typedef struct {
+    int32_t ret_code;
+    uint32_t K1;
+    uint32_t K2;
+    uint32_t flags;
+    uint64_t heap_offset;
+    double stats[FNFT_ARCHIVE_NSTATS];
+    uint64_t reserved;
+} slot_t;
+
+struct fnft_archive_s {
+    int fd;
+    int heap_fd;
+    int append_flag;
+    header_t header;
+    commit_t commit;
+    uint64_t slot_size;
+    void *map;
+    size_t map_len;
+    void *heap_map;
+    size_t heap_map_len;
+};
+
+// 64-bit FNV-1a hash of the header and the fields of a commit block that
+// precede the checksum
+static uint64_t checksum(header_t const * const header,
+    commit_t const * const commit)
+{
+    uint64_t h = 14695981039346656037ULL;
+    unsigned char const *p;
+    size_t i;
+
+    p = (unsigned char const *)header;
+    for (i=0; i<sizeof(header_t); i++)
+        h = (h ^ p[i]) * 1099511628211ULL;
+    p = (unsigned char const *)commit;
+    for (i=0; i<offsetof(commit_t, checksum); i++)
+        h = (h ^ p[i]) * 1099511628211ULL;
+    return h;
+}
+
+static FNFT_INT write_all(int fd, void const *buf, size_t len,
+    uint64_t offset)
+{
+    char const *p = buf;
+    ssize_t n;
+    while (len > 0) {
+        n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FNFT_EC_OTHER;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return FNFT_SUCCESS;
+}
+
+static FNFT_INT read_all(int fd, void *buf, size_t len, uint64_t offset)
+{
+    char *p = buf;
+    ssize_t n;
+    while (len > 0) {
+        n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FNFT_EC_OTHER;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return FNFT_SUCCESS;
+}
+
+static char *heap_filename(const char *filename)
+{
+    const size_t len = strlen(filename);
+    char *name = malloc(len + 6);
+    if (name != NULL) {
+        memcpy(name, filename, len);
+        memcpy(name + len, ".heap", 6);
+    }
+    return name;
+}
+
+// Writes the commit block with the next sequence number and syncs it
+static FNFT_INT write_commit(fnft_archive_t * const ar,
+    const uint64_t nrecords, const uint64_t heap_size)
+{
+    commit_t commit;
+    FNFT_INT ret_code;
+
+    memset(&commit, 0, sizeof(commit));
+    commit.seq = ar->commit.seq + 1;
+    commit.nrecords = nrecords;
+    commit.heap_size = heap_size;
+    commit.checksum = checksum(&ar->header, &commit);
+    ret_code = write_all(ar->fd, &commit, sizeof(commit),
+        COMMIT_OFFSET + (commit.seq % 2)*COMMIT_SIZE);
+    if (ret_code != FNFT_SUCCESS)
+        return ret_code;
+    if (fsync(ar->fd) != 0)
+        return FNFT_EC_OTHER;
+    ar->commit = commit;
+    return FNFT_SUCCESS;
+}
+
+static FNFT_INT close_files(fnft_archive_t * const ar)
+{
+    FNFT_INT ret_code = FNFT_SUCCESS;
+    if (ar->map != NULL)
+        munmap(ar->map, ar->map_len);
+    if (ar->heap_map != NULL)
+        munmap(ar->heap_map, ar->heap_map_len);
+    if (ar->fd >= 0 && close(ar->fd) != 0)
+        ret_code = FNFT_EC_OTHER;
+    if (ar->heap_fd >= 0 && close(ar->heap_fd) != 0)
+        ret_code = FNFT_EC_OTHER;
+    return ret_code;
+}
+
+FNFT_INT fnft_archive_create(const char *filename,
+    fnft_archive_info_t const * const info, fnft_archive_t ** const ar_ptr)
+{
+    fnft_archive_t *ar = NULL;
+    char *hname = NULL;
+    commit_t empty;
+    FNFT_INT ret_code = FNFT_SUCCESS;
+
+    if (filename == NULL || info == NULL || ar_ptr == NULL)
+        return FNFT_EC_INVALID_ARGUMENT;
+    if (info->ncontspec > (UINT64_MAX - SLOT_HEADER_SIZE)
+        / sizeof(FNFT_COMPLEX))
+        return FNFT_EC_INVALID_ARGUMENT;
+
+    ar = calloc(1, sizeof(fnft_archive_t));
+    hname = heap_filename(filename);
+    if (ar == NULL || hname == NULL) {
+        ret_code = FNFT_EC_NOMEM;
+        goto release_mem;
+    }
+    ar->fd = -1;
+    ar->heap_fd = -1;
+    ar->append_flag = 1;
+    memcpy(ar->header.magic, ARCHIVE_MAGIC, 8);
+    ar->header.version = FNFT_ARCHIVE_VERSION;
+    ar->header.byte_order_mark = BYTE_ORDER_MARK;
+    ar->header.transform = info->transform;
+    ar->header.D = info->D;
+    ar->header.T[0] = info->T[0];
+    ar->header.T[1] = info->T[1];
+    ar->header.M = info->M;
+    ar->header.XI[0] = info->XI[0];
+    ar->header.XI[1] = info->XI[1];
+    ar->header.ncontspec = info->ncontspec;
+    ar->slot_size = SLOT_HEADER_SIZE + info->ncontspec*sizeof(FNFT_COMPLEX);
+
+    ar->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ar->heap_fd = open(hname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (ar->fd < 0 || ar->heap_fd < 0) {
+        ret_code = FNFT_EC_OTHER;
+        goto release_mem;
+    }
+
+    // Header, an empty block A and the first commit (sequence number one)
+    // in block B
+    memset(&empty, 0, sizeof(empty));
+    ret_code = write_all(ar->fd, &ar->header, sizeof(header_t), 0);
+    if (ret_code == FNFT_SUCCESS)
+        ret_code = write_all(ar->fd, &empty, sizeof(empty), COMMIT_OFFSET);
+    if (ret_code == FNFT_SUCCESS)
+        ret_code = write_commit(ar, 0, 0);
+
+release_mem:
+    free(hname);
+    if (ret_code != FNFT_SUCCESS && ar != NULL) {
+        close_files(ar);
+        free(ar);
+        ar = NULL;
+    }
+    *ar_ptr = ar;
+    return ret_code;
+}
+
+FNFT_INT fnft_archive_open(const char *filename, const FNFT_INT append_flag,
+    fnft_archive_t ** const ar_ptr)
+{
+    fnft_archive_t *ar = NULL;
+    char *hname = NULL;
+    commit_t commits[2];
+    struct stat st;
+    uint64_t main_size;
+    FNFT_INT i, ret_code = FNFT_SUCCESS;
+
+    if (filename == NULL || ar_ptr == NULL)
+        return FNFT_EC_INVALID_ARGUMENT;
+
+    ar = calloc(1, sizeof(fnft_archive_t));
+    hname = heap_filename(filename);
+    if (ar == NULL || hname == NULL) {
+        ret_code = FNFT_EC_NOMEM;
+        goto release_mem;
+    }
+    ar->fd = -1;
+    ar->heap_fd = -1;
+    ar->append_flag = append_flag;
+    ar->fd = open(filename, append_flag ? O_RDWR : O_RDONLY);
+    ar->heap_fd = open(hname, append_flag ? O_RDWR : O_RDONLY);
+    if (ar->fd < 0 || ar->heap_fd < 0) {
+        ret_code = FNFT_EC_OTHER;
+        goto release_mem;
+    }
+
+    // Header and the most recent valid commit
+    if (read_all(ar->fd, &ar->header, sizeof(header_t), 0) != FNFT_SUCCESS
+        || read_all(ar->fd, commits, sizeof(commits), COMMIT_OFFSET)
+        != FNFT_SUCCESS
+        || memcmp(ar->header.magic, ARCHIVE_MAGIC, 8) != 0
+        || ar->header.byte_order_mark != BYTE_ORDER_MARK
+        || ar->header.version != FNFT_ARCHIVE_VERSION
+        || ar->header.ncontspec > (UINT64_MAX - SLOT_HEADER_SIZE)
+        / sizeof(FNFT_COMPLEX)) {
+        ret_code = FNFT_EC_INVALID_ARGUMENT;
+        goto release_mem;
+    }
+    ar->slot_size = SLOT_HEADER_SIZE
+        + ar->header.ncontspec*sizeof(FNFT_COMPLEX);
+    for (i=0; i<2; i++) {
+        if (commits[i].seq % 2 != (uint64_t)i
+            || commits[i].checksum != checksum(&ar->header, &commits[i]))
+            continue;
+        if (ar->commit.seq == 0 || commits[i].seq > ar->commit.seq)
+            ar->commit = commits[i];
+    }
+    if (ar->commit.seq == 0
+        || ar->commit.nrecords > (UINT64_MAX - DATA_OFFSET)/ar->slot_size) {
+        ret_code = FNFT_EC_INVALID_ARGUMENT;
+        goto release_mem;
+    }
+    main_size = DATA_OFFSET + ar->commit.nrecords*ar->slot_size;
+
+    if (append_flag) {
+        // Discard data from interrupted appends
+        if (ftruncate(ar->fd, (off_t)main_size) != 0
+            || ftruncate(ar->heap_fd, (off_t)ar->commit.heap_size) != 0) {
+            ret_code = FNFT_EC_OTHER;
+            goto release_mem;
+        }
+    } else {
+        if (fstat(ar->fd, &st) != 0 || (uint64_t)st.st_size < main_size) {
+            ret_code = FNFT_EC_INVALID_ARGUMENT;
+            goto release_mem;
+        }
+        if (fstat(ar->heap_fd, &st) != 0
+            || (uint64_t)st.st_size < ar->commit.heap_size) {
+            ret_code = FNFT_EC_INVALID_ARGUMENT;
+            goto release_mem;
+        }
+        ar->map_len = (size_t)main_size;
+        ar->map = mmap(NULL, ar->map_len, PROT_READ, MAP_SHARED, ar->fd, 0);
+        if (ar->map == MAP_FAILED) {
+            ar->map = NULL;
+            ret_code = FNFT_EC_OTHER;
+            goto release_mem;
+        }
+        if (ar->commit.heap_size > 0) {
+            ar->heap_map_len = (size_t)ar->commit.heap_size;
+            ar->heap_map = mmap(NULL, ar->heap_map_len, PROT_READ,
+                MAP_SHARED, ar->heap_fd, 0);
+            if (ar->heap_map == MAP_FAILED) {
+                ar->heap_map = NULL;
+                ret_code = FNFT_EC_OTHER;
+                goto release_mem;
+            }
+        }
+    }
+
+release_mem:
+    free(hname);
+    if (ret_code != FNFT_SUCCESS && ar != NULL) {
+        close_files(ar);
+        free(ar);
+        ar = NULL;
+    }
+    *ar_ptr = ar;
+    return ret_code;
+}
+
+fnft_archive_info_t fnft_archive_info(fnft_archive_t const * const ar)
+{
+    fnft_archive_info_t info;
+    info.transform = ar->header.transform;
+    info.D = ar->header.D;
+    info.T[0] = ar->header.T[0];
+    info.T[1] = ar->header.T[1];
+    info.M = ar->header.M;
+    info.XI[0] = ar->header.XI[0];
+    info.XI[1] = ar->header.XI[1];
+    info.ncontspec = ar->header.ncontspec;
+    return info;
+}
+
+uint64_t fnft_archive_nrecords(fnft_archive_t const * const ar)
+{
+    return ar->commit.nrecords;
+}
+
+FNFT_INT fnft_archive_append(fnft_archive_t * const ar, const uint64_t n,
+    fnft_archive_record_t const * const recs)
+{
+    unsigned char *slots = NULL;
+    FNFT_COMPLEX *heap = NULL;
+    slot_t *slot;
+    uint64_t i, heap_len = 0, heap_offset;
+    const size_t contspec_len = ar == NULL ? 0
+        : (size_t)ar->header.ncontspec*sizeof(FNFT_COMPLEX);
+    FNFT_INT ret_code = FNFT_SUCCESS;
+
+    if (ar == NULL || !ar->append_flag)
+        return FNFT_EC_INVALID_ARGUMENT;
+    if (n == 0)
+        return FNFT_SUCCESS;
+    if (recs == NULL)
+        return FNFT_EC_INVALID_ARGUMENT;
+    for (i=0; i<n; i++) {
+        if ((recs[i].K1 > 0 && recs[i].spec1 == NULL)
+            || (recs[i].K2 > 0 && recs[i].spec2 == NULL)
+            || (recs[i].ret_code == FNFT_SUCCESS && contspec_len > 0
+            && recs[i].contspec == NULL))
+            return FNFT_EC_INVALID_ARGUMENT;
+        heap_len += (uint64_t)recs[i].K1 + recs[i].K2;
+    }
+
+    // Assemble the slots and the heap data of all records
+    slots = calloc(n, ar->slot_size);
+    heap = malloc((heap_len > 0 ? heap_len : 1) * sizeof(FNFT_COMPLEX));
+    if (slots == NULL || heap == NULL) {
+        ret_code = FNFT_EC_NOMEM;
+        goto release_mem;
+    }
+    heap_offset = 0;
+    for (i=0; i<n; i++) {
+        slot = (slot_t *)(slots + i*ar->slot_size);
+        slot->ret_code = recs[i].ret_code;
+        slot->K1 = recs[i].K1;
+        slot->K2 = recs[i].K2;
+        slot->heap_offset = ar->commit.heap_size
+            + heap_offset*sizeof(FNFT_COMPLEX);
+        memcpy(slot->stats, recs[i].stats, sizeof(slot->stats));
+        if (recs[i].ret_code == FNFT_SUCCESS && contspec_len > 0)
+            memcpy(slot + 1, recs[i].contspec, contspec_len);
+        if (recs[i].K1 > 0)
+            memcpy(heap + heap_offset, recs[i].spec1,
+                recs[i].K1*sizeof(FNFT_COMPLEX));
+        heap_offset += recs[i].K1;
+        if (recs[i].K2 > 0)
+            memcpy(heap + heap_offset, recs[i].spec2,
+                recs[i].K2*sizeof(FNFT_COMPLEX));
+        heap_offset += recs[i].K2;
+    }
+
+    // Write the data behind the committed parts of both files, make sure
+    // that it is on disk and only then commit it
+    ret_code = write_all(ar->fd, slots, n*ar->slot_size,
+        DATA_OFFSET + ar->commit.nrecords*ar->slot_size);
+    if (ret_code != FNFT_SUCCESS)
+        goto release_mem;
+    if (heap_len > 0) {
+        ret_code = write_all(ar->heap_fd, heap,
+            heap_len*sizeof(FNFT_COMPLEX), ar->commit.heap_size);
+        if (ret_code != FNFT_SUCCESS)
+            goto release_mem;
+        if (fsync(ar->heap_fd) != 0) {
+            ret_code = FNFT_EC_OTHER;
+            goto release_mem;
+        }
+    }
+    if (fsync(ar->fd) != 0) {
+        ret_code = FNFT_EC_OTHER;
+        goto release_mem;
+    }
+    ret_code = write_commit(ar, ar->commit.nrecords + n,
+        ar->commit.heap_size + heap_len*sizeof(FNFT_COMPLEX));
+
+release_mem:
+    free(slots);
+    free(heap);
+    return ret_code;
+}
+
+FNFT_INT fnft_archive_get(fnft_archive_t const * const ar, const uint64_t i,
+    fnft_archive_record_t * const rec)
+{
+    slot_t const *slot;
+    uint64_t heap_len;
+
+    if (ar == NULL || ar->map == NULL || rec == NULL
+        || i >= ar->commit.nrecords)
+        return FNFT_EC_INVALID_ARGUMENT;
+
+    slot = (slot_t const *)((char const *)ar->map + DATA_OFFSET
+        + i*ar->slot_size);
+    heap_len = ((uint64_t)slot->K1 + slot->K2)*sizeof(FNFT_COMPLEX);
+    if (slot->heap_offset > ar->commit.heap_size
+        || heap_len > ar->commit.heap_size - slot->heap_offset)
+        return FNFT_EC_SANITY_CHECK_FAILED;
+
+    rec->ret_code = slot->ret_code;
+    rec->K1 = slot->K1;
+    rec->K2 = slot->K2;
+    memcpy(rec->stats, slot->stats, sizeof(rec->stats));
+    rec->contspec = ar->header.ncontspec > 0
+        ? (FNFT_COMPLEX const *)(slot + 1) : NULL;
+    if (heap_len > 0) {
+        rec->spec1 = (FNFT_COMPLEX const *)((char const *)ar->heap_map
+            + slot->heap_offset);
+        rec->spec2 = rec->spec1 + slot->K1;
+    } else {
+        rec->spec1 = NULL;
+        rec->spec2 = NULL;
+    }
+    return FNFT_SUCCESS;
+}
+
+FNFT_INT fnft_archive_close(fnft_archive_t * const ar)
+{
+    FNFT_INT ret_code;
+    if (ar == NULL)
+        return FNFT_SUCCESS;
+    ret_code = close_files(ar);
+    free(ar);
+    return ret_code;
+}
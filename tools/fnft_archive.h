@@ -0,0 +1,201 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+/**
+ * @file fnft_archive.h
+ * @brief Indexed binary archives of nonlinear Fourier spectra (POSIX only).
+ *
+ * An archive stores the results of many transforms with the same
+ * parameters. It consists of two files. The main file starts with a header
+ * and contains one fixed-size slot per record, which holds the return
+ * code, the sizes of the discrete spectra, some statistics and the
+ * continuous spectrum. Record i can therefore be located directly. The
+ * discrete spectra, whose lengths vary, are stored in a side heap with
+ * the file name of the archive plus ".heap". The slots store the offsets
+ * into the heap.
+ *
+ * Appends are crash-safe: new slots and heap data are written behind the
+ * committed parts of the files and synced, before the new numbers of
+ * records and heap bytes are committed in the header. The header contains
+ * two commit blocks with sequence numbers and checksums, which are
+ * overwritten alternately. A torn commit thus leaves the previous one
+ * intact. Data behind the last commit is ignored by readers and discarded
+ * when the archive is opened for appending.
+ *
+ * Archives opened for reading are memory-mapped. The pointers returned by
+ * \link fnft_archive_get \endlink point directly into the mapping and are
+ * valid until the archive is closed. All values are stored in the native
+ * byte order. Archives from machines with a different byte order are
+ * rejected.
+ */
+
+#ifndef FNFT_ARCHIVE_H
+#define FNFT_ARCHIVE_H
+
+#include <stdint.h>
+#include "fnft.h"
+
+/**
+ * Version of the archive format written by this implementation.
+ */
+#define FNFT_ARCHIVE_VERSION 1
+
+/**
+ * Number of statistics stored per record.
+ */
+#define FNFT_ARCHIVE_NSTATS 4
+
+/**
+ * @brief Parameters that are shared by all records of an archive.
+ *
+ * @var fnft_archive_info_t::transform
+ *  User-defined code of the transform (e.g., 0=nsev, 1=nsep, 2=kdvv).
+ * @var fnft_archive_info_t::D
+ *  Number of samples of the signals.
+ * @var fnft_archive_info_t::T
+ *  Time interval of the signals.
+ * @var fnft_archive_info_t::M
+ *  Number of points of the frequency grid of the continuous spectrum.
+ * @var fnft_archive_info_t::XI
+ *  Range of the frequency grid of the continuous spectrum.
+ * @var fnft_archive_info_t::ncontspec
+ *  Number of complex values of the continuous spectrum per record (e.g.,
+ *  3*M for fnft_nsev_cstype_BOTH). Zero if there is no continuous spectrum.
+ */
+typedef struct {
+    uint32_t transform;
+    uint64_t D;
+    double T[2];
+    uint64_t M;
+    double XI[2];
+    uint64_t ncontspec;
+} fnft_archive_info_t;
+
+/**
+ * @brief A single record of an archive.
+ *
+ * @var fnft_archive_record_t::ret_code
+ *  Return code of the transform.
+ * @var fnft_archive_record_t::K1
+ *  Number of values in spec1.
+ * @var fnft_archive_record_t::K2
+ *  Number of values in spec2.
+ * @var fnft_archive_record_t::stats
+ *  User-defined statistics (e.g., run times of the stages).
+ * @var fnft_archive_record_t::contspec
+ *  Array with fnft_archive_info_t::ncontspec values of the continuous
+ *  spectrum. Ignored by \link fnft_archive_append \endlink if ret_code is
+ *  not FNFT_SUCCESS, in which case zeros are stored.
+ * @var fnft_archive_record_t::spec1
+ *  Array with K1 values of the (first) discrete spectrum, e.g. the bound
+ *  states or the main spectrum.
+ * @var fnft_archive_record_t::spec2
+ *  Array with K2 values of the second discrete spectrum, e.g. the norming
+ *  constants and/or residues or the auxiliary spectrum.
+ */
+typedef struct {
+    int32_t ret_code;
+    uint32_t K1;
+    uint32_t K2;
+    double stats[FNFT_ARCHIVE_NSTATS];
+    FNFT_COMPLEX const *contspec;
+    FNFT_COMPLEX const *spec1;
+    FNFT_COMPLEX const *spec2;
+} fnft_archive_record_t;
+
+/**
+ * @brief Opaque archive object.
+ */
+typedef struct fnft_archive_s fnft_archive_t;
+
+/**
+ * @brief Creates a new, empty archive that is open for appending.
+ *
+ * Existing files are overwritten.
+ *
+ * @param[in] filename Name of the main file.
+ * @param[in] info Parameters shared by all records.
+ * @param[out] ar_ptr Pointer to the new archive object.
+ * @return FNFT_SUCCESS or one of the FNFT_EC_... error codes. I/O errors are
+ *  reported as FNFT_EC_OTHER.
+ */
+FNFT_INT fnft_archive_create(const char *filename,
+    fnft_archive_info_t const * const info, fnft_archive_t ** const ar_ptr);
+
+/**
+ * @brief Opens an existing archive.
+ *
+ * @param[in] filename Name of the main file.
+ * @param[in] append_flag If zero, the archive is memory-mapped for reading.
+ *  Otherwise, it is opened for appending. Uncommitted data from an
+ *  interrupted append is discarded in that case.
+ * @param[out] ar_ptr Pointer to the new archive object.
+ * @return FNFT_SUCCESS or one of the FNFT_EC_... error codes. Files that
+ *  are not valid archives are reported as FNFT_EC_INVALID_ARGUMENT.
+ */
+FNFT_INT fnft_archive_open(const char *filename, const FNFT_INT append_flag,
+    fnft_archive_t ** const ar_ptr);
+
+/**
+ * @brief Returns the parameters shared by all records of an archive.
+ */
+fnft_archive_info_t fnft_archive_info(fnft_archive_t const * const ar);
+
+/**
+ * @brief Returns the number of committed records in an archive.
+ */
+uint64_t fnft_archive_nrecords(fnft_archive_t const * const ar);
+
+/**
+ * @brief Appends records to an archive and commits them.
+ *
+ * Either all n records are committed or, if the process is interrupted,
+ * none of them. Appending several records at once is more efficient since
+ * the files are synced only once per call.
+ *
+ * @param[in,out] ar Archive opened for appending.
+ * @param[in] n Number of records.
+ * @param[in] recs Array of n records.
+ * @return FNFT_SUCCESS or one of the FNFT_EC_... error codes.
+ */
+FNFT_INT fnft_archive_append(fnft_archive_t * const ar, const uint64_t n,
+    fnft_archive_record_t const * const recs);
+
+/**
+ * @brief Retrieves a record from an archive without copying.
+ *
+ * @param[in] ar Archive opened for reading.
+ * @param[in] i Index of the record, i<\link fnft_archive_nrecords \endlink.
+ * @param[out] rec The pointers in this record point into the memory
+ *  mapping of the archive.
+ * @return FNFT_SUCCESS or one of the FNFT_EC_... error codes.
+ *  FNFT_EC_SANITY_CHECK_FAILED is returned if the record refers to data
+ *  outside of the heap.
+ */
+FNFT_INT fnft_archive_get(fnft_archive_t const * const ar, const uint64_t i,
+    fnft_archive_record_t * const rec);
+
+/**
+ * @brief Closes an archive and frees the archive object.
+ *
+ * @return FNFT_SUCCESS or FNFT_EC_OTHER if closing the files failed.
+ */
+FNFT_INT fnft_archive_close(fnft_archive_t * const ar);
+
+#endif
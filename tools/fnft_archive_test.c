@@ -0,0 +1,232 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Tests of the archive format. The name of a scratch file is passed as
+// the first argument.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fnft_archive.h"
+
+#define NCONTSPEC 5
+#define MAX_K 4
+
+// Value j of the array with the given number (0=contspec, 1=spec1,
+// 2=spec2) of record i
+static FNFT_COMPLEX value(const uint64_t i, const int array, const int j)
+{
+    return (FNFT_REAL)i + 0.1*j + I*(FNFT_REAL)(array - 2*j);
+}
+
+// Fills the buffer and the record with the test data of record i. Every
+// third record is marked as failed.
+static void make_record(const uint64_t i, FNFT_COMPLEX *buf,
+    fnft_archive_record_t * const rec)
+{
+    int j;
+    memset(rec, 0, sizeof(fnft_archive_record_t));
+    rec->ret_code = (i % 3 == 2) ? FNFT_EC_OTHER : FNFT_SUCCESS;
+    rec->K1 = (uint32_t)(i % (MAX_K + 1));
+    rec->K2 = (uint32_t)((i + 2) % (MAX_K + 1));
+    rec->stats[0] = 0.5*i;
+    rec->stats[3] = -1.0*i;
+    for (j=0; j<NCONTSPEC; j++)
+        buf[j] = value(i, 0, j);
+    for (j=0; j<(int)rec->K1; j++)
+        buf[NCONTSPEC + j] = value(i, 1, j);
+    for (j=0; j<(int)rec->K2; j++)
+        buf[NCONTSPEC + MAX_K + j] = value(i, 2, j);
+    rec->contspec = buf;
+    rec->spec1 = buf + NCONTSPEC;
+    rec->spec2 = buf + NCONTSPEC + MAX_K;
+}
+
+static int append_records(fnft_archive_t * const ar, const uint64_t first,
+    const uint64_t n)
+{
+    FNFT_COMPLEX bufs[8][NCONTSPEC + 2*MAX_K];
+    fnft_archive_record_t recs[8];
+    uint64_t i;
+
+    for (i=0; i<n; i++)
+        make_record(first + i, bufs[i], &recs[i]);
+    return fnft_archive_append(ar, n, recs) == FNFT_SUCCESS ? 0 : -1;
+}
+
+// Opens the archive for reading and compares it with the test data
+static int check_archive(const char *filename, const uint64_t nrecords)
+{
+    fnft_archive_t *ar;
+    fnft_archive_info_t info;
+    fnft_archive_record_t rec;
+    uint64_t i;
+    int j, ret = 0;
+
+    if (fnft_archive_open(filename, 0, &ar) != FNFT_SUCCESS)
+        return -1;
+    info = fnft_archive_info(ar);
+    if (fnft_archive_nrecords(ar) != nrecords || info.transform != 1
+        || info.D != 64 || info.T[1] != 2.5 || info.M != NCONTSPEC
+        || info.XI[0] != -3.0 || info.ncontspec != NCONTSPEC)
+        ret = -1;
+    for (i=0; i<nrecords && ret == 0; i++) {
+        if (fnft_archive_get(ar, i, &rec) != FNFT_SUCCESS
+            || rec.ret_code != ((i % 3 == 2) ? FNFT_EC_OTHER : FNFT_SUCCESS)
+            || rec.K1 != i % (MAX_K + 1) || rec.K2 != (i + 2) % (MAX_K + 1)
+            || rec.stats[0] != 0.5*i || rec.stats[1] != 0.0
+            || rec.stats[3] != -1.0*i) {
+            ret = -1;
+            break;
+        }
+        for (j=0; j<NCONTSPEC; j++) {
+            if (rec.contspec[j] != (rec.ret_code == FNFT_SUCCESS
+                ? value(i, 0, j) : 0.0))
+                ret = -1;
+        }
+        for (j=0; j<(int)rec.K1; j++) {
+            if (rec.spec1[j] != value(i, 1, j))
+                ret = -1;
+        }
+        for (j=0; j<(int)rec.K2; j++) {
+            if (rec.spec2[j] != value(i, 2, j))
+                ret = -1;
+        }
+    }
+    if (fnft_archive_get(ar, nrecords, &rec) != FNFT_EC_INVALID_ARGUMENT)
+        ret = -1;
+    if (fnft_archive_close(ar) != FNFT_SUCCESS)
+        ret = -1;
+    return ret;
+}
+
+// Appends junk to the end of a file, as an interrupted append would
+static int append_junk(const char *filename, const size_t len)
+{
+    char junk[100];
+    int fd, ret = 0;
+    memset(junk, 0x5A, sizeof(junk));
+    fd = open(filename, O_WRONLY | O_APPEND);
+    if (fd < 0)
+        return -1;
+    if (write(fd, junk, len) != (ssize_t)len)
+        ret = -1;
+    close(fd);
+    return ret;
+}
+
+static int read_commit_blocks(const char *filename, unsigned char *buf)
+{
+    int fd, ret = 0;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (pread(fd, buf, 128, 128) != 128)
+        ret = -1;
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    fnft_archive_t *ar = NULL;
+    fnft_archive_info_t info;
+    char heap_name[4096];
+    unsigned char before[128], after[128];
+    int fd, k;
+
+    if (argc < 2 || strlen(argv[1]) + 6 > sizeof(heap_name))
+        return EXIT_FAILURE;
+    snprintf(heap_name, sizeof(heap_name), "%s.heap", argv[1]);
+
+    // Create an archive and append records in batches and one by one
+    memset(&info, 0, sizeof(info));
+    info.transform = 1;
+    info.D = 64;
+    info.T[0] = -2.5;
+    info.T[1] = 2.5;
+    info.M = NCONTSPEC;
+    info.XI[0] = -3.0;
+    info.XI[1] = 3.0;
+    info.ncontspec = NCONTSPEC;
+    if (fnft_archive_create(argv[1], &info, &ar) != FNFT_SUCCESS)
+        return EXIT_FAILURE;
+    if (append_records(ar, 0, 0) != 0 || append_records(ar, 0, 3) != 0
+        || append_records(ar, 3, 1) != 0 || append_records(ar, 4, 1) != 0
+        || fnft_archive_close(ar) != FNFT_SUCCESS)
+        return EXIT_FAILURE;
+    if (check_archive(argv[1], 5) != 0)
+        return EXIT_FAILURE;
+
+    // Uncommitted data from an interrupted append is ignored by readers and
+    // discarded when the archive is reopened for appending
+    if (append_junk(argv[1], 100) != 0 || append_junk(heap_name, 37) != 0)
+        return EXIT_FAILURE;
+    if (check_archive(argv[1], 5) != 0)
+        return EXIT_FAILURE;
+    if (fnft_archive_open(argv[1], 1, &ar) != FNFT_SUCCESS
+        || fnft_archive_nrecords(ar) != 5 || append_records(ar, 5, 8) != 0
+        || fnft_archive_close(ar) != FNFT_SUCCESS)
+        return EXIT_FAILURE;
+    if (check_archive(argv[1], 13) != 0)
+        return EXIT_FAILURE;
+
+    // A torn commit falls back to the previous one
+    if (read_commit_blocks(argv[1], before) != 0
+        || fnft_archive_open(argv[1], 1, &ar) != FNFT_SUCCESS
+        || append_records(ar, 13, 2) != 0
+        || fnft_archive_close(ar) != FNFT_SUCCESS
+        || read_commit_blocks(argv[1], after) != 0)
+        return EXIT_FAILURE;
+    if (check_archive(argv[1], 15) != 0)
+        return EXIT_FAILURE;
+    for (k=0; k<128 && before[k] == after[k]; k++)
+        ;
+    if (k == 128)
+        return EXIT_FAILURE;
+    after[k] ^= 0xFF;
+    fd = open(argv[1], O_WRONLY);
+    if (fd < 0 || pwrite(fd, after + k, 1, 128 + k) != 1)
+        return EXIT_FAILURE;
+    close(fd);
+    if (check_archive(argv[1], 13) != 0)
+        return EXIT_FAILURE;
+    if (fnft_archive_open(argv[1], 1, &ar) != FNFT_SUCCESS
+        || append_records(ar, 13, 1) != 0
+        || fnft_archive_close(ar) != FNFT_SUCCESS)
+        return EXIT_FAILURE;
+    if (check_archive(argv[1], 14) != 0)
+        return EXIT_FAILURE;
+
+    // Files that are not archives are rejected
+    fd = open(argv[1], O_WRONLY);
+    if (fd < 0 || pwrite(fd, "X", 1, 0) != 1)
+        return EXIT_FAILURE;
+    close(fd);
+    if (fnft_archive_open(argv[1], 0, &ar) != FNFT_EC_INVALID_ARGUMENT)
+        return EXIT_FAILURE;
+
+    remove(argv[1]);
+    remove(heap_name);
+    return EXIT_SUCCESS;
+}
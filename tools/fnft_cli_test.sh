@@ -0,0 +1,66 @@
+#!/bin/sh
+# This file is part of FNFT.
+#
+# FNFT is free software; you can redistribute it and/or
+# modify it under the terms of the version 2 of the GNU General
+# Public License as published by the Free Software Foundation.
+#
+# FNFT is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+# Contributors:
+# Sander Wahls (TU Delft) 2017-2018.
+
+# Runs the fnft command line tool (path given as first argument) on a
+# generated signal file and checks the summaries of the archives.
+
+set -e
+FNFT="$1"
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+"$FNFT" gen --D 256 --T -8 8 --records 12 --seed 7 "$DIR/sig.bin"
+
+"$FNFT" nsev --threads 3 --M 64 --XI -2 2 --discspec-type both \
+    "$DIR/sig.bin" "$DIR/nsev.res"
+"$FNFT" info "$DIR/nsev.res" > "$DIR/nsev.txt"
+grep -q "^records: 12$" "$DIR/nsev.txt"
+grep -q "^failed: 0$" "$DIR/nsev.txt"
+test -s "$DIR/nsev.res.heap"
+
+# The archive does not depend on the number of threads (apart from the
+# run times)
+"$FNFT" nsev --threads 1 --M 64 --XI -2 2 --discspec-type both \
+    "$DIR/sig.bin" "$DIR/nsev1.res"
+cmp "$DIR/nsev.res.heap" "$DIR/nsev1.res.heap"
+"$FNFT" info "$DIR/nsev1.res" | grep "^discrete" > "$DIR/nsev1.txt"
+grep "^discrete" "$DIR/nsev.txt" | cmp - "$DIR/nsev1.txt"
+
+# Same signals without header
+tail -c +65 "$DIR/sig.bin" > "$DIR/sig.raw"
+"$FNFT" nsev --raw --D 256 --T -8 8 --threads 2 --no-contspec \
+    --bound-state-localization newton "$DIR/sig.raw" "$DIR/raw.res"
+"$FNFT" info "$DIR/raw.res" | grep -q "^records: 12$"
+
+"$FNFT" nsep --threads 2 --T 0 6.283185307179586 --filtering manual \
+    --bounding-box -2 2 -2 2 "$DIR/sig.bin" "$DIR/nsep.res"
+"$FNFT" info "$DIR/nsep.res" | grep -q "^failed: 0$"
+
+"$FNFT" kdvv --threads 2 --discretization 2split3a --M 32 \
+    "$DIR/sig.bin" "$DIR/kdvv.res"
+"$FNFT" info "$DIR/kdvv.res" | grep -q "^records: 12$"
+
+# Invalid options and files must be rejected
+if "$FNFT" info "$DIR/sig.bin" 2>/dev/null; then
+    exit 1
+fi
+if "$FNFT" nsev --discretization unknown "$DIR/sig.bin" "$DIR/x.res" \
+    2>/dev/null; then
+    exit 1
+fi
+exit 0
@@ -0,0 +1,424 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Streaming pipeline, see fnft_stream.h.
+//
+// Sample position p of the stream is stored at ring[p % capacity]. The
+// first frame_len values of the ring are mirrored behind its end, so that
+// every frame is a contiguous view into the ring even if it wraps around.
+// The producer may write position p only if p < start(released) +
+// capacity, where released is the number of frames that the consumer has
+// finished with. With capacity = queue_len*hop + frame_len - 1, this also
+// guarantees that frame k can only become complete once the output slot
+// k % queue_len is free again. The workers therefore only have to wait for
+// samples, and the slots need no further synchronization.
+//
+// Counters that are shared between threads are accessed with the __atomic
+// builtins of gcc and clang (acquire/release). They are placed on separate
+// cache lines.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "fnft_stream.h"
+
+#define CACHE_LINE 64
+
+// Number of times a waiting thread yields before it starts to sleep
+#define SPINS_BEFORE_SLEEP 64
+
+// Sleep time of a waiting thread in nanoseconds
+#define SLEEP_NS 20000
+
+#define LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+// Output slot of a frame. t_avail is written by the producer, the other
+// fields by the worker that transforms the frame. seq is set to k+1 once
+// the result of frame k is ready.
+typedef struct {
+    uint64_t seq;
+    double t_avail;
+    FNFT_INT ret_code;
+    FNFT_UINT K;
+    double latency;
+    double compute_time;
+    FNFT_COMPLEX *contspec;
+    FNFT_COMPLEX *bound_states;
+    FNFT_COMPLEX *normconsts;
+    char pad[CACHE_LINE];
+} slot_t;
+
+// Per-thread plan of a worker. fnft_nsev changes the options temporarily,
+// which is why every worker needs its own copy.
+typedef struct {
+    fnft_stream_t *stream;
+    fnft_nsev_opts_t opts;
+    pthread_t thread;
+} worker_t;
+
+struct fnft_stream_s {
+    fnft_stream_config_t config;
+    size_t capacity;
+    size_t ncontspec;
+    size_t nnormconsts;
+    FNFT_COMPLEX *ring;
+    FNFT_COMPLEX *results;
+    slot_t *slots;
+    worker_t *workers;
+    size_t nworkers;
+    double t_created;
+
+    // Written by the producer
+    char pad1[CACHE_LINE];
+    uint64_t head;
+    uint64_t producer_waits;
+    uint64_t next_avail;
+    int finished;
+
+    // Claimed by the workers
+    char pad2[CACHE_LINE];
+    uint64_t next_frame;
+
+    // Written by the consumer
+    char pad3[CACHE_LINE];
+    uint64_t released;
+    uint64_t popped;
+    fnft_stream_stats_t stats;
+};
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static void backoff(const unsigned spins)
+{
+    struct timespec ts = { 0, SLEEP_NS };
+    if (spins < SPINS_BEFORE_SLEEP)
+        sched_yield();
+    else
+        nanosleep(&ts, NULL);
+}
+
+// Position of the first sample of frame k in the stream
+static inline uint64_t frame_start(fnft_stream_t const * const s,
+    const uint64_t k)
+{
+    return k*s->config.hop + s->config.guard;
+}
+
+// Position behind the last sample of frame k in the stream
+static inline uint64_t frame_end(fnft_stream_t const * const s,
+    const uint64_t k)
+{
+    return frame_start(s, k) + s->config.frame_len;
+}
+
+fnft_stream_config_t fnft_stream_default_config(void)
+{
+    fnft_stream_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    config.frame_len = 1024;
+    config.hop = 1024;
+    config.guard = 0;
+    config.T[0] = -1.0;
+    config.T[1] = 1.0;
+    config.M = 1024;
+    config.XI[0] = -1.0;
+    config.XI[1] = 1.0;
+    config.max_K = 64;
+    config.kappa = +1;
+    config.opts = fnft_nsev_default_opts();
+    config.nthreads = 1;
+    config.queue_len = 0;
+    config.diag_len = 0;
+    return config;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t * const w = arg;
+    fnft_stream_t * const s = w->stream;
+    fnft_stream_config_t const * const c = &s->config;
+    uint64_t k, end, head;
+    slot_t *slot;
+    FNFT_COMPLEX *q;
+    FNFT_UINT K;
+    unsigned spins;
+    double t0, t1;
+
+    // Errors that occur in the workers are recorded instead of printed if
+    // requested. Without support for this, they are printed.
+    if (c->diag_len > 0)
+        fnft_errwarn_setdiag(c->diag_len);
+
+    for (;;) {
+        // Claim the next frame and wait until all of its samples are in the
+        // ring buffer
+        k = __atomic_fetch_add(&s->next_frame, 1, __ATOMIC_RELAXED);
+        end = frame_end(s, k);
+        for (spins = 0; ; spins++) {
+            head = LOAD(&s->head);
+            if (head >= end)
+                break;
+            if (LOAD(&s->finished)) {
+                if (LOAD(&s->head) >= end)
+                    break;
+                fnft_errwarn_setdiag(0); // the buffer can be reused
+                return NULL; // the frame will never be complete
+            }
+            backoff(spins);
+        }
+
+        // Transform the frame in place
+        slot = &s->slots[k % c->queue_len];
+        q = s->ring + frame_start(s, k) % s->capacity;
+        K = c->max_K;
+        t0 = wall_time();
+        slot->ret_code = fnft_nsev(c->frame_len, q, c->T, c->M,
+            slot->contspec, c->XI, c->max_K > 0 ? &K : NULL,
+            slot->bound_states, slot->normconsts, c->kappa, &w->opts);
+        t1 = wall_time();
+        slot->K = (slot->ret_code == FNFT_SUCCESS && c->max_K > 0) ? K : 0;
+        slot->compute_time = t1 - t0;
+        slot->latency = t1 - slot->t_avail;
+        STORE(&slot->seq, k + 1);
+    }
+}
+
+FNFT_INT fnft_stream_create(fnft_stream_config_t const * const config,
+    fnft_stream_t ** const stream_ptr)
+{
+    fnft_stream_t *s;
+    fnft_stream_config_t c;
+    size_t i, per_slot, nslots_values;
+
+    if (config == NULL || stream_ptr == NULL)
+        return FNFT_EC_INVALID_ARGUMENT;
+    *stream_ptr = NULL;
+    c = *config;
+    if (c.queue_len == 0)
+        c.queue_len = 4*c.nthreads;
+    if (c.frame_len < 2 || c.hop == 0 || c.nthreads == 0
+        || c.queue_len == 0 || (c.kappa != 1 && c.kappa != -1)
+        || !(c.T[0] < c.T[1]) || (c.M > 0 && !(c.XI[0] < c.XI[1])))
+        return FNFT_EC_INVALID_ARGUMENT;
+    if (c.frame_len > SIZE_MAX/(4*sizeof(FNFT_COMPLEX))
+        || c.hop > (SIZE_MAX/(4*sizeof(FNFT_COMPLEX)) - c.frame_len)
+        / c.queue_len
+        || c.M > SIZE_MAX/(4*sizeof(FNFT_COMPLEX))
+        || c.max_K > SIZE_MAX/(4*sizeof(FNFT_COMPLEX)))
+        return FNFT_EC_INVALID_ARGUMENT;
+
+    s = calloc(1, sizeof(fnft_stream_t));
+    if (s == NULL)
+        return FNFT_EC_NOMEM;
+    s->config = c;
+    s->capacity = c.queue_len*c.hop + c.frame_len - 1;
+    switch (c.opts.contspec_type) {
+    case fnft_nsev_cstype_AB:
+        s->ncontspec = 2*c.M;
+        break;
+    case fnft_nsev_cstype_BOTH:
+        s->ncontspec = 3*c.M;
+        break;
+    default:
+        s->ncontspec = c.M;
+    }
+    s->nnormconsts = (c.opts.discspec_type == fnft_nsev_dstype_BOTH)
+        ? 2*c.max_K : c.max_K;
+
+    // Ring buffer with mirror, output slots and their arrays
+    per_slot = s->ncontspec + c.max_K + s->nnormconsts;
+    if (per_slot > 0 && c.queue_len > SIZE_MAX/sizeof(FNFT_COMPLEX)/per_slot)
+        goto fail;
+    nslots_values = c.queue_len*per_slot;
+    s->ring = malloc((s->capacity + c.frame_len)*sizeof(FNFT_COMPLEX));
+    s->results = malloc((nslots_values > 0 ? nslots_values : 1)
+        *sizeof(FNFT_COMPLEX));
+    s->slots = calloc(c.queue_len, sizeof(slot_t));
+    s->workers = calloc(c.nthreads, sizeof(worker_t));
+    if (s->ring == NULL || s->results == NULL || s->slots == NULL
+        || s->workers == NULL)
+        goto fail;
+    for (i=0; i<c.queue_len; i++) {
+        s->slots[i].contspec = c.M > 0 ? s->results + i*per_slot : NULL;
+        s->slots[i].bound_states = c.max_K > 0
+            ? s->results + i*per_slot + s->ncontspec : NULL;
+        s->slots[i].normconsts = c.max_K > 0
+            ? s->results + i*per_slot + s->ncontspec + c.max_K : NULL;
+    }
+    s->t_created = wall_time();
+
+    for (i=0; i<c.nthreads; i++) {
+        s->workers[i].stream = s;
+        s->workers[i].opts = c.opts;
+        s->workers[i].opts.nthreads = 1; // frames run in parallel already
+        if (pthread_create(&s->workers[i].thread, NULL, worker_main,
+            &s->workers[i]) != 0) {
+            fnft_stream_destroy(s);
+            return FNFT_EC_OTHER;
+        }
+        s->nworkers++;
+    }
+
+    *stream_ptr = s;
+    return FNFT_SUCCESS;
+
+fail:
+    free(s->ring);
+    free(s->results);
+    free(s->slots);
+    free(s->workers);
+    free(s);
+    return FNFT_EC_NOMEM;
+}
+
+FNFT_INT fnft_stream_push(fnft_stream_t * const s, const size_t n,
+    FNFT_COMPLEX const * const samples)
+{
+    FNFT_COMPLEX const *src = samples;
+    uint64_t head, limit, pos, chunk, nmirror;
+    size_t left = n;
+    unsigned spins = 0;
+    double t;
+
+    if (s == NULL || (n > 0 && samples == NULL) || s->finished)
+        return FNFT_EC_INVALID_ARGUMENT;
+
+    head = s->head;
+    while (left > 0) {
+        // Wait for space
+        limit = frame_start(s, LOAD(&s->released)) + s->capacity;
+        if (head >= limit) {
+            if (spins++ == 0)
+                __atomic_store_n(&s->producer_waits, s->producer_waits + 1,
+                    __ATOMIC_RELAXED);
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+
+        // Copy the largest contiguous chunk that fits
+        pos = head % s->capacity;
+        chunk = limit - head;
+        if (chunk > s->capacity - pos)
+            chunk = s->capacity - pos;
+        if (chunk > left)
+            chunk = left;
+        memcpy(s->ring + pos, src, chunk*sizeof(FNFT_COMPLEX));
+        if (pos < s->config.frame_len) {
+            nmirror = s->config.frame_len - pos;
+            if (nmirror > chunk)
+                nmirror = chunk;
+            memcpy(s->ring + s->capacity + pos, src,
+                nmirror*sizeof(FNFT_COMPLEX));
+        }
+        head += chunk;
+        src += chunk;
+        left -= chunk;
+
+        // Time stamps of the frames that have become complete, then publish
+        t = wall_time();
+        while (frame_end(s, s->next_avail) <= head) {
+            s->slots[s->next_avail % s->config.queue_len].t_avail = t;
+            s->next_avail++;
+        }
+        STORE(&s->head, head);
+    }
+    return FNFT_SUCCESS;
+}
+
+void fnft_stream_finish(fnft_stream_t * const s)
+{
+    if (s != NULL)
+        STORE(&s->finished, 1);
+}
+
+int fnft_stream_pop(fnft_stream_t * const s, fnft_stream_frame_t * const frame)
+{
+    const uint64_t k = s->popped;
+    slot_t * const slot = &s->slots[k % s->config.queue_len];
+    unsigned spins;
+
+    // The view of the previous frame is no longer needed
+    STORE(&s->released, k);
+
+    for (spins = 0; LOAD(&slot->seq) != k + 1; spins++) {
+        if (LOAD(&s->finished) && frame_end(s, k) > LOAD(&s->head))
+            return 0;
+        if (spins == 0)
+            s->stats.consumer_waits++;
+        backoff(spins);
+    }
+
+    frame->index = k;
+    frame->first_sample = frame_start(s, k);
+    frame->ret_code = slot->ret_code;
+    frame->K = slot->K;
+    frame->contspec = slot->contspec;
+    frame->bound_states = slot->bound_states;
+    frame->normconsts_or_residues = slot->normconsts;
+    frame->latency = slot->latency;
+    frame->compute_time = slot->compute_time;
+    s->popped = k + 1;
+
+    s->stats.frames++;
+    if (slot->ret_code != FNFT_SUCCESS)
+        s->stats.failed++;
+    s->stats.latency_sum += slot->latency;
+    if (slot->latency > s->stats.latency_max)
+        s->stats.latency_max = slot->latency;
+    s->stats.compute_time += slot->compute_time;
+    return 1;
+}
+
+fnft_stream_stats_t fnft_stream_stats(fnft_stream_t const * const s)
+{
+    fnft_stream_stats_t stats = s->stats;
+    stats.samples = LOAD(&s->head);
+    stats.producer_waits = __atomic_load_n(&s->producer_waits,
+        __ATOMIC_RELAXED);
+    stats.elapsed = wall_time() - s->t_created;
+    return stats;
+}
+
+void fnft_stream_destroy(fnft_stream_t * const s)
+{
+    size_t i;
+
+    if (s == NULL)
+        return;
+    fnft_stream_finish(s);
+    for (i=0; i<s->nworkers; i++)
+        pthread_join(s->workers[i].thread, NULL);
+    free(s->ring);
+    free(s->results);
+    free(s->slots);
+    free(s->workers);
+    free(s);
+}
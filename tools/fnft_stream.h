@@ -0,0 +1,244 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+/**
+ * @file fnft_stream.h
+ * @brief Pipeline that cuts a continuous stream of samples into frames and
+ * applies fnft_nsev to them in parallel (POSIX only).
+ *
+ * One producer thread pushes samples into a ring buffer with \link
+ * fnft_stream_push \endlink. A pool of worker threads claims the frames in
+ * order, transforms them directly in the ring buffer (no copies) and writes
+ * the results into the slots of an output queue. One consumer thread
+ * retrieves the results in the order of the frames with \link
+ * fnft_stream_pop \endlink.
+ *
+ * The frames are defined as follows. The stream is divided into periods of
+ * fnft_stream_config_t::hop samples. The first fnft_stream_config_t::guard
+ * samples of every period form the guard interval and are skipped. The
+ * next fnft_stream_config_t::frame_len samples form the frame. Frame k
+ * thus consists of the samples k*hop+guard, ..., k*hop+guard+frame_len-1
+ * of the stream. Frames may overlap (guard+frame_len>hop).
+ *
+ * The producer, the workers and the consumer only communicate via atomic
+ * counters. No locks are taken on the data path. A thread that has to wait
+ * (the producer for space in the ring buffer, a worker for samples, the
+ * consumer for a result) spins briefly and then sleeps for short periods.
+ * The ring buffer holds fnft_stream_config_t::queue_len frames. Its space
+ * is reused once the consumer has retrieved the frames.
+ */
+
+#ifndef FNFT_STREAM_H
+#define FNFT_STREAM_H
+
+#include <stdint.h>
+#include "fnft_nsev.h"
+
+/**
+ * @brief Configuration of a pipeline.
+ *
+ * The fields T, M, XI, kappa and opts have the same meaning as for
+ * fnft_nsev and are used for every frame. Use \link
+ * fnft_stream_default_config \endlink to initialize it.
+ *
+ * @var fnft_stream_config_t::frame_len
+ *  Number of samples D per frame.
+ * @var fnft_stream_config_t::hop
+ *  Distance between the first samples of consecutive frames (>0).
+ * @var fnft_stream_config_t::guard
+ *  Number of samples at the beginning of every period that are skipped.
+ * @var fnft_stream_config_t::M
+ *  Number of points of the continuous spectrum. Zero if it should not be
+ *  computed.
+ * @var fnft_stream_config_t::max_K
+ *  Maximum number of bound states per frame. Zero if the discrete spectrum
+ *  should not be computed.
+ * @var fnft_stream_config_t::nthreads
+ *  Number of worker threads.
+ * @var fnft_stream_config_t::queue_len
+ *  Number of frames that can be in flight, i.e. being transformed or
+ *  waiting for the consumer. Zero means four times the number of threads.
+ * @var fnft_stream_config_t::diag_len
+ *  If nonzero, the workers record errors and warnings in diagnostics
+ *  buffers of this length instead of printing them (see
+ *  fnft_errwarn_setdiag). They can be retrieved with fnft_errwarn_drain.
+ */
+typedef struct {
+    size_t frame_len;
+    size_t hop;
+    size_t guard;
+    FNFT_REAL T[2];
+    size_t M;
+    FNFT_REAL XI[2];
+    size_t max_K;
+    FNFT_INT kappa;
+    fnft_nsev_opts_t opts;
+    size_t nthreads;
+    size_t queue_len;
+    size_t diag_len;
+} fnft_stream_config_t;
+
+/**
+ * @brief Result of a frame, see \link fnft_stream_pop \endlink.
+ *
+ * @var fnft_stream_frame_t::index
+ *  Number of the frame, starting at zero.
+ * @var fnft_stream_frame_t::first_sample
+ *  Position of the first sample of the frame in the stream.
+ * @var fnft_stream_frame_t::ret_code
+ *  Return code of fnft_nsev.
+ * @var fnft_stream_frame_t::K
+ *  Number of bound states.
+ * @var fnft_stream_frame_t::contspec
+ *  Continuous spectrum (see fnft_nsev), or NULL if M is zero.
+ * @var fnft_stream_frame_t::bound_states
+ *  K bound states, or NULL if max_K is zero.
+ * @var fnft_stream_frame_t::normconsts_or_residues
+ *  Norming constants and/or residues as in fnft_nsev, or NULL if max_K is
+ *  zero.
+ * @var fnft_stream_frame_t::latency
+ *  Time from pushing the last sample of the frame until its result was
+ *  ready in seconds.
+ * @var fnft_stream_frame_t::compute_time
+ *  Run time of fnft_nsev in seconds.
+ */
+typedef struct {
+    uint64_t index;
+    uint64_t first_sample;
+    FNFT_INT ret_code;
+    FNFT_UINT K;
+    FNFT_COMPLEX const *contspec;
+    FNFT_COMPLEX const *bound_states;
+    FNFT_COMPLEX const *normconsts_or_residues;
+    double latency;
+    double compute_time;
+} fnft_stream_frame_t;
+
+/**
+ * @brief Counters of a pipeline.
+ *
+ * @var fnft_stream_stats_t::samples
+ *  Number of samples pushed.
+ * @var fnft_stream_stats_t::frames
+ *  Number of frames retrieved by the consumer.
+ * @var fnft_stream_stats_t::failed
+ *  Number of retrieved frames for which fnft_nsev returned an error.
+ * @var fnft_stream_stats_t::producer_waits
+ *  Number of times the producer had to wait for space.
+ * @var fnft_stream_stats_t::consumer_waits
+ *  Number of times the consumer had to wait for a result.
+ * @var fnft_stream_stats_t::elapsed
+ *  Time since the creation of the pipeline in seconds.
+ * @var fnft_stream_stats_t::latency_sum
+ *  Sum of the latencies of the retrieved frames in seconds.
+ * @var fnft_stream_stats_t::latency_max
+ *  Maximum latency of the retrieved frames in seconds.
+ * @var fnft_stream_stats_t::compute_time
+ *  Total run time of fnft_nsev for the retrieved frames in seconds.
+ */
+typedef struct {
+    uint64_t samples;
+    uint64_t frames;
+    uint64_t failed;
+    uint64_t producer_waits;
+    uint64_t consumer_waits;
+    double elapsed;
+    double latency_sum;
+    double latency_max;
+    double compute_time;
+} fnft_stream_stats_t;
+
+/**
+ * @brief Opaque pipeline.
+ */
+typedef struct fnft_stream_s fnft_stream_t;
+
+/**
+ * @brief Returns a configuration with default values.
+ *
+ * The frames have 1024 samples, no guard and do not overlap. T is [-1,1],
+ * the continuous spectrum is computed at 1024 points in [-1,1], at most 64
+ * bound states are computed for kappa=+1 and the default options of
+ * fnft_nsev are used. One worker thread is started.
+ */
+fnft_stream_config_t fnft_stream_default_config(void);
+
+/**
+ * @brief Creates a pipeline and starts its worker threads.
+ *
+ * @param[in] config Configuration.
+ * @param[out] stream_ptr The new pipeline.
+ * @return \link FNFT_SUCCESS \endlink, FNFT_EC_INVALID_ARGUMENT for invalid
+ *  configurations, FNFT_EC_NOMEM or FNFT_EC_OTHER if a thread could not be
+ *  started.
+ */
+FNFT_INT fnft_stream_create(fnft_stream_config_t const * const config,
+    fnft_stream_t ** const stream_ptr);
+
+/**
+ * @brief Appends samples to the stream (producer only).
+ *
+ * Blocks until all samples have been copied into the ring buffer.
+ *
+ * @param[in] stream Pipeline.
+ * @param[in] n Number of samples.
+ * @param[in] samples Array of length n.
+ * @return \link FNFT_SUCCESS \endlink or FNFT_EC_INVALID_ARGUMENT if the
+ *  stream has already been finished.
+ */
+FNFT_INT fnft_stream_push(fnft_stream_t * const stream, const size_t n,
+    FNFT_COMPLEX const * const samples);
+
+/**
+ * @brief Marks the end of the stream (producer only).
+ *
+ * Frames that are not complete are discarded.
+ */
+void fnft_stream_finish(fnft_stream_t * const stream);
+
+/**
+ * @brief Retrieves the result of the next frame (consumer only).
+ *
+ * Blocks until the result is available. The arrays in *frame belong to the
+ * pipeline and stay valid until the next call.
+ *
+ * @param[in] stream Pipeline.
+ * @param[out] frame Result of the next frame.
+ * @return 1 if a frame has been retrieved, 0 if the stream has been
+ *  finished and all complete frames have been retrieved.
+ */
+int fnft_stream_pop(fnft_stream_t * const stream,
+    fnft_stream_frame_t * const frame);
+
+/**
+ * @brief Returns the counters of a pipeline.
+ *
+ * Should be called by the consumer. The counters of the producer are
+ * updated concurrently and may lag slightly.
+ */
+fnft_stream_stats_t fnft_stream_stats(fnft_stream_t const * const stream);
+
+/**
+ * @brief Stops the worker threads and frees a pipeline.
+ *
+ * The stream is finished if this has not been done before.
+ */
+void fnft_stream_destroy(fnft_stream_t * const stream);
+
+#endif
@@ -0,0 +1,279 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Benchmark of the streaming pipeline. Usage:
+//
+//   fnft_stream_bench [--frames <n>] [--frame-len <n>] [--hop <n>]
+//       [--guard <n>] [--threads <n>] [--queue <n>] [--chunk <n>]
+//       [--diag <n>] [--verify]
+//
+// A generator thread produces a synthetic stream of noisy sech pulses, one
+// per period, and pushes it in chunks of random size (at most --chunk
+// samples). The main thread retrieves the results and prints the
+// throughput and the latencies. With --verify, every frame is also
+// transformed directly with fnft_nsev and the results are compared. The
+// exit code is then nonzero if a comparison fails. With --diag, the workers
+// record errors and warnings in diagnostics buffers of the given length
+// instead of printing them, and a summary is printed at the end.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fnft_stream.h"
+
+typedef struct {
+    fnft_stream_t *stream;
+    fnft_stream_config_t const *config;
+    uint64_t nsamples;
+    size_t chunk;
+    int ret;
+} generator_t;
+
+// Deterministic pseudo-random number in [-0.5, 0.5) for position p
+static double noise(uint64_t p)
+{
+    p = p*6364136223846793005ull + 1442695040888963407ull;
+    p ^= p >> 29;
+    p *= 0xbf58476d1ce4e5b9ull;
+    p ^= p >> 32;
+    return (double)(p >> 11) / 9007199254740992.0 - 0.5;
+}
+
+// Sample at position p of the synthetic stream. Every period contains a
+// sech pulse in the middle of its frame, whose amplitude cycles through
+// three values.
+static FNFT_COMPLEX sample(fnft_stream_config_t const * const c,
+    const uint64_t p)
+{
+    const uint64_t k = p / c->hop;
+    const double center = k*c->hop + c->guard + 0.5*(c->frame_len - 1);
+    const double eps_t = (c->T[1] - c->T[0])/(c->frame_len - 1);
+    const double t = (p - center)*eps_t;
+    const double A = 0.8 + 0.7*(k % 3);
+    return A/FNFT_COSH(t) + 0.01*(noise(2*p) + I*noise(2*p + 1));
+}
+
+static void *generator_main(void *arg)
+{
+    generator_t * const g = arg;
+    FNFT_COMPLEX *buf;
+    uint64_t p = 0, rnd = 1;
+    size_t i, n;
+
+    buf = malloc(g->chunk*sizeof(FNFT_COMPLEX));
+    if (buf == NULL) {
+        fnft_stream_finish(g->stream);
+        return NULL;
+    }
+    while (p < g->nsamples) {
+        rnd = rnd*6364136223846793005ull + 1442695040888963407ull;
+        n = 1 + (rnd >> 33) % g->chunk;
+        if (n > g->nsamples - p)
+            n = g->nsamples - p;
+        for (i=0; i<n; i++)
+            buf[i] = sample(g->config, p + i);
+        if (fnft_stream_push(g->stream, n, buf) != FNFT_SUCCESS)
+            break;
+        p += n;
+    }
+    g->ret = (p == g->nsamples) ? 0 : -1;
+    fnft_stream_finish(g->stream);
+    free(buf);
+    return NULL;
+}
+
+// Transforms frame k directly and compares the results. The continuous
+// spectra have to agree exactly. The polynomial root finder uses random
+// shifts, which is why the bound states are compared with a tolerance.
+static int verify(fnft_stream_config_t const * const c,
+    fnft_stream_frame_t const * const frame)
+{
+    FNFT_COMPLEX *q, *contspec, *bound_states;
+    fnft_nsev_opts_t opts = c->opts;
+    FNFT_UINT K = c->max_K, i, j;
+    FNFT_INT ret_code;
+    double dist;
+    int ret = 0;
+
+    q = malloc(c->frame_len*sizeof(FNFT_COMPLEX));
+    contspec = malloc(3*c->M*sizeof(FNFT_COMPLEX) + 1);
+    bound_states = malloc(c->max_K*sizeof(FNFT_COMPLEX) + 1);
+    if (q == NULL || contspec == NULL || bound_states == NULL) {
+        ret = -1;
+        goto release_mem;
+    }
+    for (i=0; i<c->frame_len; i++)
+        q[i] = sample(c, frame->first_sample + i);
+    ret_code = fnft_nsev(c->frame_len, q, c->T, c->M, contspec, c->XI, &K,
+        bound_states, NULL, c->kappa, &opts);
+    if (ret_code != frame->ret_code || K != frame->K
+        || memcmp(contspec, frame->contspec, c->M*sizeof(FNFT_COMPLEX))
+        != 0) {
+        ret = -1;
+        goto release_mem;
+    }
+    for (i=0; i<K; i++) {
+        dist = 1.0;
+        for (j=0; j<K; j++) {
+            if (FNFT_CABS(bound_states[i] - frame->bound_states[j]) < dist)
+                dist = FNFT_CABS(bound_states[i] - frame->bound_states[j]);
+        }
+        if (!(dist <= 1e-10))
+            ret = -1;
+    }
+
+release_mem:
+    free(q);
+    free(contspec);
+    free(bound_states);
+    return ret;
+}
+
+static int parse_size(const char *s, size_t * const val)
+{
+    char *end;
+    unsigned long v = strtoul(s, &end, 10);
+    if (*s == '\0' || *end != '\0')
+        return -1;
+    *val = v;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    fnft_stream_config_t config = fnft_stream_default_config();
+    fnft_stream_t *stream = NULL;
+    fnft_stream_frame_t frame;
+    fnft_stream_stats_t stats;
+    fnft_errwarn_summary_t diag;
+    fnft_errwarn_event_t event;
+    generator_t gen;
+    pthread_t thread;
+    size_t nframes = 64, chunk = 4096, *val;
+    uint64_t expected, next_index = 0;
+    int i, do_verify = 0, ret = EXIT_SUCCESS;
+
+    config.frame_len = 1024;
+    config.hop = 1280;
+    config.guard = 128;
+    config.T[0] = -16.0;
+    config.T[1] = 16.0;
+    config.M = 256;
+    config.XI[0] = -4.0;
+    config.XI[1] = 4.0;
+    config.max_K = 16;
+    config.opts.discspec_type = fnft_nsev_dstype_RESIDUES;
+    config.nthreads = 4;
+
+    for (i=1; i<argc; i++) {
+        val = NULL;
+        if (strcmp(argv[i], "--verify") == 0) {
+            do_verify = 1;
+            continue;
+        } else if (strcmp(argv[i], "--frames") == 0)
+            val = &nframes;
+        else if (strcmp(argv[i], "--frame-len") == 0)
+            val = &config.frame_len;
+        else if (strcmp(argv[i], "--hop") == 0)
+            val = &config.hop;
+        else if (strcmp(argv[i], "--guard") == 0)
+            val = &config.guard;
+        else if (strcmp(argv[i], "--threads") == 0)
+            val = &config.nthreads;
+        else if (strcmp(argv[i], "--queue") == 0)
+            val = &config.queue_len;
+        else if (strcmp(argv[i], "--chunk") == 0)
+            val = &chunk;
+        else if (strcmp(argv[i], "--diag") == 0)
+            val = &config.diag_len;
+        if (val == NULL || i + 1 >= argc || parse_size(argv[++i], val) != 0
+            || chunk == 0) {
+            fprintf(stderr, "fnft_stream_bench: invalid arguments\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (nframes == 0
+        || fnft_stream_create(&config, &stream) != FNFT_SUCCESS) {
+        fprintf(stderr, "fnft_stream_bench: invalid configuration\n");
+        return EXIT_FAILURE;
+    }
+
+    // The stream ends in the middle of the frame after the last one
+    gen.stream = stream;
+    gen.config = &config;
+    gen.nsamples = nframes*config.hop + config.guard + config.frame_len/2;
+    gen.chunk = chunk;
+    gen.ret = -1;
+    if (pthread_create(&thread, NULL, generator_main, &gen) != 0) {
+        fnft_stream_destroy(stream);
+        return EXIT_FAILURE;
+    }
+    expected = (gen.nsamples - config.guard - config.frame_len)/config.hop
+        + 1;
+
+    // Retrieve the results, which have to arrive in order
+    while (fnft_stream_pop(stream, &frame)) {
+        if (frame.index != next_index++
+            || frame.first_sample != frame.index*config.hop + config.guard
+            || frame.ret_code != FNFT_SUCCESS
+            || (do_verify && verify(&config, &frame) != 0)) {
+            fprintf(stderr, "fnft_stream_bench: frame %lu failed\n",
+                (unsigned long)frame.index);
+            ret = EXIT_FAILURE;
+        }
+    }
+    stats = fnft_stream_stats(stream);
+    pthread_join(thread, NULL);
+    fnft_stream_destroy(stream);
+
+    if (gen.ret != 0 || stats.frames != expected
+        || stats.samples != gen.nsamples) {
+        fprintf(stderr, "fnft_stream_bench: expected %lu frames, got %lu\n",
+            (unsigned long)expected, (unsigned long)stats.frames);
+        ret = EXIT_FAILURE;
+    }
+
+    printf("frames:          %lu (%lu failed)\n",
+        (unsigned long)stats.frames, (unsigned long)stats.failed);
+    printf("samples:         %lu\n", (unsigned long)stats.samples);
+    printf("elapsed time:    %.3f s\n", stats.elapsed);
+    printf("throughput:      %.4g samples/s, %.4g frames/s\n",
+        stats.samples/stats.elapsed, stats.frames/stats.elapsed);
+    if (stats.frames > 0) {
+        printf("latency:         %.3f ms (mean), %.3f ms (max)\n",
+            1e3*stats.latency_sum/stats.frames, 1e3*stats.latency_max);
+        printf("compute time:    %.3f ms per frame\n",
+            1e3*stats.compute_time/stats.frames);
+    }
+    printf("producer waits:  %lu\n", (unsigned long)stats.producer_waits);
+    printf("consumer waits:  %lu\n", (unsigned long)stats.consumer_waits);
+    if (config.diag_len > 0) {
+        diag = fnft_errwarn_summary();
+        printf("diagnostics:     %lu errors, %lu warnings (%lu dropped)\n",
+            (unsigned long)diag.errors, (unsigned long)diag.warnings,
+            (unsigned long)diag.dropped);
+        while (fnft_errwarn_drain(&event, 1) == 1)
+            fnft_errwarn_print_event(&event);
+    }
+    return ret;
+}
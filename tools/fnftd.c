@@ -0,0 +1,737 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// FNFT daemon. See fnftd.h for the protocol. Usage:
+//
+//   fnftd --socket <path> [--threads <n>] [--queue <n>]
+//
+// Every connection is served by its own thread, which reads the requests,
+// answers statistics requests directly and puts transform requests into a
+// bounded queue. Requests that do not fit into the queue are rejected
+// (backpressure). A fixed pool of worker threads processes the queue and
+// writes the responses. SIGTERM or SIGINT stop the daemon after the queued
+// requests have been processed.
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // for CMSG_SPACE and CMSG_LEN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "fnftd.h"
+
+// Number of plans that are cached by every worker
+#define PLANS_PER_WORKER 8
+
+// Shared buffer of a connection. It is unmapped when the last reference
+// is released.
+typedef struct {
+    void *base;
+    size_t len;
+    unsigned refs;
+} shared_buf_t;
+
+typedef struct server_s server_t;
+
+// State of a connection. The mutex protects buf and pending and
+// serializes the responses on fd.
+typedef struct {
+    server_t *server;
+    int fd;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    shared_buf_t *buf;
+    unsigned pending;
+} conn_t;
+
+typedef struct {
+    fnftd_request_t req;
+    conn_t *conn;
+    shared_buf_t *buf;
+    double t_received;
+    double deadline;
+} job_t;
+
+// The parameters that determine a plan
+typedef struct {
+    uint64_t D;
+    uint64_t M;
+    uint64_t max_K;
+    uint32_t flags;
+    uint32_t opts[7];
+} plan_key_t;
+
+typedef struct {
+    plan_key_t key;
+    int valid;
+    uint64_t last_used;
+    fnft_nsev_opts_t opts;
+    uint64_t max_K;
+    uint64_t ncontspec;
+    uint64_t nnormconsts;
+    FNFT_COMPLEX *q;
+} plan_t;
+
+// State shared by all threads. The mutex protects the queue, shutdown and
+// stats.
+struct server_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    job_t *queue;
+    size_t capacity;
+    size_t head;
+    size_t len;
+    int shutdown;
+    fnftd_stats_t stats;
+};
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void handle_signal(int sig)
+{
+    (void)sig;
+    stop_flag = 1;
+}
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static int send_all(const int fd, void const *buf, size_t len)
+{
+    char const *p = buf;
+    ssize_t n;
+    while (len > 0) {
+        n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Receives a request. The last file descriptor passed along with it is
+// stored in *buf_fd (-1 if none). Returns -1 on errors and if the
+// connection has been closed.
+static int recv_request(const int fd, fnftd_request_t * const req,
+    int * const buf_fd)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        char buf[CMSG_SPACE(4*sizeof(int))];
+        struct cmsghdr align;
+    } ctrl;
+    struct cmsghdr *cmsg;
+    char *p = (char *)req;
+    size_t len = sizeof(fnftd_request_t), i, nfds;
+    ssize_t n;
+    int fds[4];
+
+    *buf_fd = -1;
+    while (len > 0) {
+        memset(&msg, 0, sizeof(msg));
+        iov.iov_base = p;
+        iov.iov_len = len;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl.buf;
+        msg.msg_controllen = sizeof(ctrl.buf);
+        n = recvmsg(fd, &msg, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+            cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET
+                || cmsg->cmsg_type != SCM_RIGHTS)
+                continue;
+            nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            if (nfds > 4)
+                nfds = 4;
+            memcpy(fds, CMSG_DATA(cmsg), nfds*sizeof(int));
+            for (i=0; i<nfds; i++) {
+                if (*buf_fd >= 0)
+                    close(*buf_fd);
+                *buf_fd = fds[i];
+            }
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    if (len > 0 && *buf_fd >= 0) {
+        close(*buf_fd);
+        *buf_fd = -1;
+    }
+    return len == 0 ? 0 : -1;
+}
+
+// Releases a reference to a shared buffer. The mutex of the connection
+// has to be locked.
+static void release_buf(shared_buf_t * const buf)
+{
+    if (buf == NULL)
+        return;
+    if (--buf->refs == 0) {
+        munmap(buf->base, buf->len);
+        free(buf);
+    }
+}
+
+static void send_response(conn_t * const conn, fnftd_response_t * const resp,
+    fnftd_stats_t const * const stats)
+{
+    resp->magic = FNFTD_MAGIC;
+    pthread_mutex_lock(&conn->mutex);
+    if (send_all(conn->fd, resp, sizeof(fnftd_response_t)) == 0
+        && stats != NULL)
+        send_all(conn->fd, stats, sizeof(fnftd_stats_t));
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+// Computes the numbers of values in the results. Returns -1 if the
+// request is invalid.
+static int result_sizes(fnftd_request_t const * const req,
+    uint64_t * const max_K, uint64_t * const ncontspec,
+    uint64_t * const nnormconsts)
+{
+    fnft_nsev_opts_t opts;
+
+    if (req->D < 2 || (req->kappa != 1 && req->kappa != -1)
+        || req->D > SIZE_MAX / sizeof(FNFT_COMPLEX))
+        return -1;
+    *ncontspec = 0;
+    if (req->flags & FNFTD_CONTSPEC) {
+        if (req->M == 0 || req->M > SIZE_MAX / (3*sizeof(FNFT_COMPLEX)))
+            return -1;
+        switch (req->contspec_type) {
+        case fnft_nsev_cstype_AB:
+            *ncontspec = 2*req->M;
+            break;
+        case fnft_nsev_cstype_BOTH:
+            *ncontspec = 3*req->M;
+            break;
+        default:
+            *ncontspec = req->M;
+        }
+    }
+    *max_K = 0;
+    *nnormconsts = 0;
+    if (req->flags & FNFTD_DISCSPEC) {
+        *max_K = req->max_K;
+        if (*max_K == 0) {
+            opts = fnft_nsev_default_opts();
+            opts.discretization = req->discretization;
+            *max_K = fnft_nsev_max_K(req->D, &opts);
+            if (*max_K == 0)
+                return -1;
+        }
+        if (*max_K > SIZE_MAX / (4*sizeof(FNFT_COMPLEX)))
+            return -1;
+        *nnormconsts = (req->discspec_type == fnft_nsev_dstype_BOTH)
+            ? 2*(*max_K) : *max_K;
+    }
+    return 0;
+}
+
+// Checks that the range [offset, offset+n*sizeof(FNFT_COMPLEX)) is in the
+// shared buffer and aligned
+static int check_range(shared_buf_t const * const buf, const uint64_t offset,
+    const uint64_t n)
+{
+    const uint64_t len = n*sizeof(FNFT_COMPLEX);
+    return buf != NULL && offset % sizeof(double) == 0
+        && len <= buf->len && offset <= buf->len - len;
+}
+
+// Returns the plan for a request from the cache of a worker. A plan is
+// created and the least recently used one replaced if necessary. Returns
+// NULL if no memory is available.
+static plan_t *get_plan(plan_t * const plans, fnftd_request_t const * const req,
+    const uint64_t now, int * const hit)
+{
+    plan_key_t key;
+    plan_t *plan = NULL;
+    size_t i;
+
+    memset(&key, 0, sizeof(key));
+    key.D = req->D;
+    key.M = (req->flags & FNFTD_CONTSPEC) ? req->M : 0;
+    key.max_K = req->max_K;
+    key.flags = req->flags;
+    key.opts[0] = req->discretization;
+    key.opts[1] = req->normalization_flag;
+    key.opts[2] = req->bound_state_filtering;
+    key.opts[3] = req->bound_state_localization;
+    key.opts[4] = req->niter;
+    key.opts[5] = req->discspec_type;
+    key.opts[6] = req->contspec_type;
+
+    for (i=0; i<PLANS_PER_WORKER; i++) {
+        if (plans[i].valid && memcmp(&plans[i].key, &key, sizeof(key)) == 0) {
+            plans[i].last_used = now;
+            *hit = 1;
+            return &plans[i];
+        }
+        if (plan == NULL || !plans[i].valid
+            || (plan->valid && plans[i].last_used < plan->last_used))
+            plan = &plans[i];
+    }
+
+    *hit = 0;
+    free(plan->q);
+    memset(plan, 0, sizeof(plan_t));
+    plan->q = malloc(req->D * sizeof(FNFT_COMPLEX));
+    if (plan->q == NULL)
+        return NULL;
+    if (result_sizes(req, &plan->max_K, &plan->ncontspec,
+        &plan->nnormconsts) != 0) {
+        free(plan->q);
+        plan->q = NULL;
+        return NULL;
+    }
+    plan->opts = fnft_nsev_default_opts();
+    plan->opts.discretization = req->discretization;
+    plan->opts.normalization_flag = req->normalization_flag;
+    plan->opts.bound_state_filtering = req->bound_state_filtering;
+    plan->opts.bound_state_localization = req->bound_state_localization;
+    plan->opts.niter = req->niter;
+    plan->opts.nthreads = 1; // requests are served by a pool of workers
+    plan->opts.discspec_type = req->discspec_type;
+    plan->opts.contspec_type = req->contspec_type;
+    plan->key = key;
+    plan->valid = 1;
+    plan->last_used = now;
+    return plan;
+}
+
+static void *worker(void *arg)
+{
+    server_t * const server = arg;
+    plan_t plans[PLANS_PER_WORKER];
+    plan_t *plan;
+    job_t job;
+    fnftd_response_t resp;
+    fnftd_request_t const *req;
+    fnft_nsev_opts_t opts;
+    FNFT_COMPLEX *contspec, *bound_states, *normconsts;
+    FNFT_UINT K;
+    uint64_t njobs = 0;
+    double t_start, t_end;
+    size_t i;
+    int hit = 0, expired;
+
+    memset(plans, 0, sizeof(plans));
+    while (1) {
+        pthread_mutex_lock(&server->mutex);
+        while (server->len == 0 && !server->shutdown)
+            pthread_cond_wait(&server->cond, &server->mutex);
+        if (server->len == 0) {
+            pthread_mutex_unlock(&server->mutex);
+            break;
+        }
+        job = server->queue[server->head];
+        server->head = (server->head + 1) % server->capacity;
+        server->len--;
+        pthread_mutex_unlock(&server->mutex);
+
+        req = &job.req;
+        memset(&resp, 0, sizeof(resp));
+        resp.id = req->id;
+        resp.type = req->type;
+        t_start = wall_time();
+        resp.queue_time = t_start - job.t_received;
+        expired = job.deadline > 0 && t_start > job.deadline;
+        plan = NULL;
+        if (expired) {
+            resp.status = fnftd_status_DEADLINE;
+        } else {
+            resp.status = fnftd_status_OK;
+            plan = get_plan(plans, req, ++njobs, &hit);
+        }
+        if (plan == NULL && !expired) {
+            resp.ret_code = FNFT_EC_NOMEM;
+        } else if (plan != NULL) {
+            // The samples are copied because fnft_nsev may modify them.
+            // The results are written directly into the shared buffer.
+            memcpy(plan->q, (char const *)job.buf->base + req->in_offset,
+                req->D * sizeof(FNFT_COMPLEX));
+            contspec = (FNFT_COMPLEX *)((char *)job.buf->base
+                + req->out_offset);
+            bound_states = contspec + plan->ncontspec;
+            normconsts = bound_states + plan->max_K;
+            K = plan->max_K;
+            opts = plan->opts;
+            resp.ret_code = fnft_nsev(req->D, plan->q, req->T,
+                plan->ncontspec > 0 ? req->M : 0,
+                plan->ncontspec > 0 ? contspec : NULL, req->XI,
+                plan->max_K > 0 ? &K : NULL,
+                plan->max_K > 0 ? bound_states : NULL,
+                plan->max_K > 0 ? normconsts : NULL, req->kappa, &opts);
+            if (resp.ret_code == FNFT_SUCCESS) {
+                resp.K = plan->max_K > 0 ? K : 0;
+                resp.ncontspec = plan->ncontspec;
+            }
+        }
+        t_end = wall_time();
+        resp.compute_time = t_end - t_start;
+
+        pthread_mutex_lock(&server->mutex);
+        if (expired) {
+            server->stats.rejected_deadline++;
+        } else {
+            server->stats.completed++;
+            if (resp.ret_code != FNFT_SUCCESS)
+                server->stats.failed++;
+            if (hit)
+                server->stats.plan_hits++;
+            else
+                server->stats.plan_misses++;
+            server->stats.queue_time += resp.queue_time;
+            server->stats.compute_time += resp.compute_time;
+        }
+        pthread_mutex_unlock(&server->mutex);
+
+        send_response(job.conn, &resp, NULL);
+        pthread_mutex_lock(&job.conn->mutex);
+        release_buf(job.buf);
+        job.conn->pending--;
+        pthread_cond_broadcast(&job.conn->cond);
+        pthread_mutex_unlock(&job.conn->mutex);
+    }
+
+    for (i=0; i<PLANS_PER_WORKER; i++)
+        free(plans[i].q);
+    return NULL;
+}
+
+// Maps a shared buffer that has been passed by a client and makes it the
+// buffer of the connection
+static void register_buf(conn_t * const conn, const int buf_fd)
+{
+    struct stat st;
+    shared_buf_t *buf = NULL;
+    void *base = MAP_FAILED;
+
+    if (fstat(buf_fd, &st) == 0 && st.st_size > 0)
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED, buf_fd, 0);
+    close(buf_fd);
+    if (base != MAP_FAILED) {
+        buf = malloc(sizeof(shared_buf_t));
+        if (buf == NULL) {
+            munmap(base, (size_t)st.st_size);
+        } else {
+            buf->base = base;
+            buf->len = (size_t)st.st_size;
+            buf->refs = 1;
+        }
+    }
+    pthread_mutex_lock(&conn->mutex);
+    release_buf(conn->buf);
+    conn->buf = buf;
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+// Validates a transform request and puts it into the queue. Returns the
+// status of the response that has to be sent if this fails.
+static fnftd_status_t enqueue(conn_t * const conn,
+    fnftd_request_t const * const req, const double t_received)
+{
+    server_t * const server = conn->server;
+    uint64_t max_K, ncontspec, nnormconsts;
+    job_t *job;
+    int valid;
+
+    if (result_sizes(req, &max_K, &ncontspec, &nnormconsts) != 0)
+        return fnftd_status_BAD_REQUEST;
+    pthread_mutex_lock(&conn->mutex);
+    valid = check_range(conn->buf, req->in_offset, req->D)
+        && check_range(conn->buf, req->out_offset,
+        ncontspec + max_K + nnormconsts);
+    if (valid) {
+        conn->buf->refs++;
+        conn->pending++;
+    }
+    pthread_mutex_unlock(&conn->mutex);
+    if (!valid)
+        return fnftd_status_BAD_REQUEST;
+
+    pthread_mutex_lock(&server->mutex);
+    if (server->len < server->capacity && !server->shutdown) {
+        job = &server->queue[(server->head + server->len) % server->capacity];
+        job->req = *req;
+        job->conn = conn;
+        job->buf = conn->buf;
+        job->t_received = t_received;
+        job->deadline = req->timeout_ms > 0
+            ? t_received + 1e-3*req->timeout_ms : 0.0;
+        server->len++;
+        pthread_cond_signal(&server->cond);
+        pthread_mutex_unlock(&server->mutex);
+        return fnftd_status_OK;
+    }
+    server->stats.rejected_busy++;
+    pthread_mutex_unlock(&server->mutex);
+
+    pthread_mutex_lock(&conn->mutex);
+    release_buf(conn->buf);
+    conn->pending--;
+    pthread_mutex_unlock(&conn->mutex);
+    return fnftd_status_BUSY;
+}
+
+static void *connection(void *arg)
+{
+    conn_t * const conn = arg;
+    server_t * const server = conn->server;
+    fnftd_request_t req;
+    fnftd_response_t resp;
+    fnftd_stats_t stats;
+    int buf_fd;
+    double t_received;
+
+    while (recv_request(conn->fd, &req, &buf_fd) == 0) {
+        t_received = wall_time();
+        if (buf_fd >= 0)
+            register_buf(conn, buf_fd);
+        if (req.magic != FNFTD_MAGIC)
+            break; // the client does not speak the protocol
+        pthread_mutex_lock(&server->mutex);
+        server->stats.requests++;
+        pthread_mutex_unlock(&server->mutex);
+
+        memset(&resp, 0, sizeof(resp));
+        resp.id = req.id;
+        resp.type = req.type;
+        if (req.type == fnftd_req_STATS) {
+            pthread_mutex_lock(&server->mutex);
+            stats = server->stats;
+            stats.queue_length = server->len;
+            pthread_mutex_unlock(&server->mutex);
+            resp.status = fnftd_status_OK;
+            send_response(conn, &resp, &stats);
+            continue;
+        }
+        resp.status = req.type == fnftd_req_NSEV
+            ? enqueue(conn, &req, t_received) : fnftd_status_BAD_REQUEST;
+        if (resp.status == fnftd_status_BAD_REQUEST) {
+            pthread_mutex_lock(&server->mutex);
+            server->stats.bad_requests++;
+            pthread_mutex_unlock(&server->mutex);
+        }
+        if (resp.status != fnftd_status_OK)
+            send_response(conn, &resp, NULL);
+    }
+
+    // Wait for the queued requests of this connection
+    pthread_mutex_lock(&conn->mutex);
+    while (conn->pending > 0)
+        pthread_cond_wait(&conn->cond, &conn->mutex);
+    release_buf(conn->buf);
+    pthread_mutex_unlock(&conn->mutex);
+    close(conn->fd);
+    pthread_cond_destroy(&conn->cond);
+    pthread_mutex_destroy(&conn->mutex);
+    free(conn);
+
+    pthread_mutex_lock(&server->mutex);
+    server->stats.connections--;
+    pthread_mutex_unlock(&server->mutex);
+    return NULL;
+}
+
+static void print_usage(FILE *f)
+{
+    fprintf(f,
+"Usage: fnftd --socket <path> [--threads <n>] [--queue <n>]\n"
+"\n"
+"Serves fnft_nsev requests over a UNIX domain socket (see tools/fnftd.h).\n"
+"\n"
+"  --socket <path>   path of the socket\n"
+"  --threads <n>     number of worker threads (default: number of CPUs)\n"
+"  --queue <n>       maximum number of queued requests (default: 4 per\n"
+"                    worker); further requests are rejected as busy\n");
+}
+
+int main(int argc, char *argv[])
+{
+    server_t server;
+    struct sockaddr_un addr;
+    struct sigaction sa;
+    struct pollfd pfd;
+    pthread_t *threads = NULL, thread;
+    pthread_attr_t attr;
+    conn_t *conn;
+    const char *path = NULL;
+    size_t nthreads = 0, nthreads_started = 0, i;
+    long ncpus;
+    int listen_fd = -1, fd, ret = EXIT_FAILURE;
+
+    memset(&server, 0, sizeof(server));
+    for (i=1; i<(size_t)argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < (size_t)argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i+1 < (size_t)argc) {
+            nthreads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < (size_t)argc) {
+            server.capacity = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(stdout);
+            return EXIT_SUCCESS;
+        } else {
+            print_usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+    if (path == NULL || strlen(path) >= sizeof(addr.sun_path)) {
+        print_usage(stderr);
+        return EXIT_FAILURE;
+    }
+    if (nthreads == 0) {
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpus > 0 ? (size_t)ncpus : 1;
+    }
+    if (server.capacity == 0)
+        server.capacity = 4*nthreads;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    pthread_mutex_init(&server.mutex, NULL);
+    pthread_cond_init(&server.cond, NULL);
+    server.stats.queue_capacity = server.capacity;
+    server.stats.nthreads = nthreads;
+    server.queue = malloc(server.capacity * sizeof(job_t));
+    threads = malloc(nthreads * sizeof(pthread_t));
+    if (server.queue == NULL || threads == NULL) {
+        fprintf(stderr, "fnftd: out of memory\n");
+        goto release_mem;
+    }
+
+    // Socket
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0
+        || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || listen(listen_fd, 64) != 0) {
+        fprintf(stderr, "fnftd: cannot listen on %s: %s\n", path,
+            strerror(errno));
+        goto release_mem;
+    }
+
+    for (i=0; i<nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, worker, &server) != 0)
+            break;
+        nthreads_started++;
+    }
+    if (nthreads_started == 0) {
+        fprintf(stderr, "fnftd: cannot start worker threads\n");
+        goto release_mem;
+    }
+    fprintf(stderr, "fnftd: listening on %s with %lu threads\n", path,
+        (unsigned long)nthreads_started);
+
+    // Accept connections until a signal arrives
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+    while (!stop_flag) {
+        if (poll(&pfd, 1, 200) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        conn = calloc(1, sizeof(conn_t));
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        conn->server = &server;
+        conn->fd = fd;
+        pthread_mutex_init(&conn->mutex, NULL);
+        pthread_cond_init(&conn->cond, NULL);
+        pthread_mutex_lock(&server.mutex);
+        server.stats.connections++;
+        pthread_mutex_unlock(&server.mutex);
+        if (pthread_create(&thread, &attr, connection, conn) != 0) {
+            close(fd);
+            pthread_mutex_destroy(&conn->mutex);
+            pthread_cond_destroy(&conn->cond);
+            free(conn);
+            pthread_mutex_lock(&server.mutex);
+            server.stats.connections--;
+            pthread_mutex_unlock(&server.mutex);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    ret = EXIT_SUCCESS;
+
+release_mem:
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(path);
+    }
+    pthread_mutex_lock(&server.mutex);
+    server.shutdown = 1;
+    pthread_cond_broadcast(&server.cond);
+    pthread_mutex_unlock(&server.mutex);
+    for (i=0; i<nthreads_started; i++)
+        pthread_join(threads[i], NULL);
+    if (ret == EXIT_SUCCESS) {
+        pthread_mutex_lock(&server.mutex);
+        fprintf(stderr, "fnftd: %lu requests, %lu completed, %lu busy, "
+            "%lu expired\n", (unsigned long)server.stats.requests,
+            (unsigned long)server.stats.completed,
+            (unsigned long)server.stats.rejected_busy,
+            (unsigned long)server.stats.rejected_deadline);
+        pthread_mutex_unlock(&server.mutex);
+    }
+    // Connection threads may still be running, so the server state is not
+    // freed
+    free(threads);
+    return ret;
+}
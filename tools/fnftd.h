@@ -0,0 +1,266 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+/**
+ * @file fnftd.h
+ * @brief Protocol of the FNFT daemon fnftd and client functions (POSIX
+ * only).
+ *
+ * The daemon computes nonlinear Fourier transforms for several client
+ * processes with a shared pool of worker threads. Clients connect to a
+ * UNIX domain socket and send requests of type \link fnftd_request_t
+ * \endlink. Every request is answered with a \link fnftd_response_t
+ * \endlink. Requests on the same connection may be pipelined. The
+ * responses then arrive in the order in which the requests have been
+ * completed and can be matched using the request ids.
+ *
+ * The samples and the results are not sent over the socket. Instead, the
+ * client passes the file descriptor of a shared buffer (e.g., from
+ * shm_open or a file) along with a request, see \link fnftd_send
+ * \endlink. The daemon maps the buffer, reads the samples from it and
+ * writes the results directly into it. The buffer stays registered for all
+ * further requests on the connection until another file descriptor is
+ * passed. Results are at the offset fnftd_request_t::out_offset in the
+ * order contspec (see \link fnftd_request_t \endlink::M), bound states
+ * (max_K values) and normconsts_or_residues (max_K values, or 2*max_K
+ * values for fnft_nsev_dstype_BOTH).
+ *
+ * The daemon keeps a small cache of plans per worker, keyed by D, M and
+ * the options. A plan holds the validated options, the sizes of the
+ * results and the work buffers, so that repeated requests with the same
+ * parameters do not allocate memory in the daemon.
+ */
+
+#ifndef FNFTD_H
+#define FNFTD_H
+
+#include <stdint.h>
+#include "fnft_nsev.h"
+
+/**
+ * Magic number at the start of every request and response.
+ */
+#define FNFTD_MAGIC 0x44544e46u
+
+/**
+ * Flag for fnftd_request_t::flags: compute the continuous spectrum.
+ */
+#define FNFTD_CONTSPEC 1u
+
+/**
+ * Flag for fnftd_request_t::flags: compute the discrete spectrum.
+ */
+#define FNFTD_DISCSPEC 2u
+
+/**
+ * @brief Types of requests.
+ *
+ * fnftd_req_NSEV: Apply fnft_nsev to samples in the shared buffer.\n
+ * fnftd_req_STATS: Query the statistics of the daemon. The response is
+ * followed by a \link fnftd_stats_t \endlink.
+ */
+typedef enum {
+    fnftd_req_NSEV = 1,
+    fnftd_req_STATS = 2
+} fnftd_req_t;
+
+/**
+ * @brief Status of a response.
+ *
+ * fnftd_status_OK: The request has been processed. For fnftd_req_NSEV,
+ *  fnftd_response_t::ret_code contains the return code of fnft_nsev.\n
+ * fnftd_status_BUSY: The queue of the daemon was full. The request has been
+ *  rejected and can be repeated later.\n
+ * fnftd_status_DEADLINE: The request has not been started before its
+ *  deadline. Requests that have been started are always completed.\n
+ * fnftd_status_BAD_REQUEST: The request was malformed, e.g. because no
+ *  shared buffer has been registered or the data is outside of it.
+ */
+typedef enum {
+    fnftd_status_OK = 0,
+    fnftd_status_BUSY = 1,
+    fnftd_status_DEADLINE = 2,
+    fnftd_status_BAD_REQUEST = 3
+} fnftd_status_t;
+
+/**
+ * @brief Request to the daemon (128 bytes).
+ *
+ * The fields D, T, M, XI and kappa have the same meaning as for
+ * fnft_nsev. The fields discretization to contspec_type correspond to the
+ * fields of fnft_nsev_opts_t. The function \link fnftd_request_init
+ * \endlink sets them to the default options.
+ *
+ * @var fnftd_request_t::max_K
+ *  Number of values reserved for the bound states in the shared buffer. If
+ *  zero, fnft_nsev_max_K is used.
+ * @var fnftd_request_t::in_offset
+ *  Offset of the D samples (complex doubles) in the shared buffer.
+ * @var fnftd_request_t::out_offset
+ *  Offset of the results in the shared buffer.
+ * @var fnftd_request_t::timeout_ms
+ *  The request is rejected if it has not been started within this many
+ *  milliseconds after it has been received. Zero means no deadline.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint64_t id;
+    uint64_t D;
+    uint64_t M;
+    double T[2];
+    double XI[2];
+    int32_t kappa;
+    uint32_t flags;
+    uint64_t max_K;
+    uint64_t in_offset;
+    uint64_t out_offset;
+    uint32_t timeout_ms;
+    uint32_t discretization;
+    uint32_t normalization_flag;
+    uint32_t bound_state_filtering;
+    uint32_t bound_state_localization;
+    uint32_t niter;
+    uint32_t discspec_type;
+    uint32_t contspec_type;
+} fnftd_request_t;
+
+/**
+ * @brief Response of the daemon (64 bytes).
+ *
+ * @var fnftd_response_t::status
+ *  See \link fnftd_status_t \endlink.
+ * @var fnftd_response_t::ret_code
+ *  Return code of fnft_nsev.
+ * @var fnftd_response_t::type
+ *  Type of the request. Responses with status fnftd_status_OK to requests
+ *  of type fnftd_req_STATS are followed by a \link fnftd_stats_t \endlink.
+ * @var fnftd_response_t::K
+ *  Number of bound states.
+ * @var fnftd_response_t::ncontspec
+ *  Number of values of the continuous spectrum that have been written.
+ * @var fnftd_response_t::queue_time
+ *  Time between receiving the request and starting it in seconds.
+ * @var fnftd_response_t::compute_time
+ *  Run time of the transform in seconds.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t status;
+    uint64_t id;
+    int32_t ret_code;
+    uint32_t type;
+    uint64_t K;
+    uint64_t ncontspec;
+    double queue_time;
+    double compute_time;
+    uint64_t reserved1;
+} fnftd_response_t;
+
+/**
+ * @brief Statistics of the daemon since its start.
+ *
+ * @var fnftd_stats_t::requests
+ *  Number of received requests.
+ * @var fnftd_stats_t::completed
+ *  Number of transforms that have been run.
+ * @var fnftd_stats_t::failed
+ *  Number of transforms that returned an error code.
+ * @var fnftd_stats_t::rejected_busy
+ *  Number of requests that were rejected because the queue was full.
+ * @var fnftd_stats_t::rejected_deadline
+ *  Number of requests that were rejected because of their deadlines.
+ * @var fnftd_stats_t::bad_requests
+ *  Number of malformed requests.
+ * @var fnftd_stats_t::plan_hits
+ *  Number of transforms that used a cached plan.
+ * @var fnftd_stats_t::plan_misses
+ *  Number of transforms that had to create a plan.
+ * @var fnftd_stats_t::queue_length
+ *  Current number of queued requests.
+ * @var fnftd_stats_t::queue_capacity
+ *  Maximum number of queued requests.
+ * @var fnftd_stats_t::nthreads
+ *  Number of worker threads.
+ * @var fnftd_stats_t::connections
+ *  Number of open connections.
+ * @var fnftd_stats_t::queue_time
+ *  Total queue time of the completed transforms in seconds.
+ * @var fnftd_stats_t::compute_time
+ *  Total run time of the completed transforms in seconds.
+ */
+typedef struct {
+    uint64_t requests;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t rejected_busy;
+    uint64_t rejected_deadline;
+    uint64_t bad_requests;
+    uint64_t plan_hits;
+    uint64_t plan_misses;
+    uint64_t queue_length;
+    uint64_t queue_capacity;
+    uint64_t nthreads;
+    uint64_t connections;
+    double queue_time;
+    double compute_time;
+} fnftd_stats_t;
+
+/**
+ * @brief Initializes a request with default values.
+ *
+ * The type is set to fnftd_req_NSEV, both spectra are requested, kappa is
+ * +1 and the options are set to fnft_nsev_default_opts().
+ */
+void fnftd_request_init(fnftd_request_t * const req);
+
+/**
+ * @brief Connects to a daemon.
+ *
+ * @param[in] path Path of the socket of the daemon.
+ * @return File descriptor of the connection or -1.
+ */
+int fnftd_connect(const char *path);
+
+/**
+ * @brief Sends a request.
+ *
+ * @param[in] fd Connection.
+ * @param[in] req Request.
+ * @param[in] buf_fd File descriptor of a shared buffer that should be used
+ *  for this and all further requests on the connection, or -1 to keep the
+ *  current buffer.
+ * @return 0 on success, -1 on errors.
+ */
+int fnftd_send(const int fd, fnftd_request_t const * const req,
+    const int buf_fd);
+
+/**
+ * @brief Receives a response.
+ *
+ * @param[in] fd Connection.
+ * @param[out] resp Response.
+ * @param[out] stats Statistics, if the response belongs to a request of
+ *  type fnftd_req_STATS. Can be NULL otherwise.
+ * @return 0 on success, -1 on errors.
+ */
+int fnftd_recv(const int fd, fnftd_response_t * const resp,
+    fnftd_stats_t * const stats);
+
+#endif
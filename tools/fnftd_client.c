@@ -0,0 +1,148 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Client side of the fnftd protocol, see fnftd.h.
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // for CMSG_SPACE and CMSG_LEN
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "fnftd.h"
+
+void fnftd_request_init(fnftd_request_t * const req)
+{
+    fnft_nsev_opts_t opts = fnft_nsev_default_opts();
+
+    memset(req, 0, sizeof(fnftd_request_t));
+    req->magic = FNFTD_MAGIC;
+    req->type = fnftd_req_NSEV;
+    req->kappa = +1;
+    req->flags = FNFTD_CONTSPEC | FNFTD_DISCSPEC;
+    req->discretization = opts.discretization;
+    req->normalization_flag = opts.normalization_flag;
+    req->bound_state_filtering = opts.bound_state_filtering;
+    req->bound_state_localization = opts.bound_state_localization;
+    req->niter = opts.niter;
+    req->discspec_type = opts.discspec_type;
+    req->contspec_type = opts.contspec_type;
+}
+
+int fnftd_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int fnftd_send(const int fd, fnftd_request_t const * const req,
+    const int buf_fd)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctrl;
+    struct cmsghdr *cmsg;
+    char const *p = (char const *)req;
+    size_t len = sizeof(fnftd_request_t);
+    ssize_t n;
+
+    // The file descriptor is sent along with the first byte
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = (void *)p;
+    iov.iov_len = len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (buf_fd >= 0) {
+        memset(&ctrl, 0, sizeof(ctrl));
+        msg.msg_control = ctrl.buf;
+        msg.msg_controllen = sizeof(ctrl.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &buf_fd, sizeof(int));
+    }
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return -1;
+    p += n;
+    len -= (size_t)n;
+    while (len > 0) {
+        n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int recv_all(const int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    ssize_t n;
+    while (len > 0) {
+        n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int fnftd_recv(const int fd, fnftd_response_t * const resp,
+    fnftd_stats_t * const stats)
+{
+    fnftd_stats_t dummy;
+
+    if (recv_all(fd, resp, sizeof(fnftd_response_t)) != 0
+        || resp->magic != FNFTD_MAGIC)
+        return -1;
+    if (resp->status == fnftd_status_OK && resp->type == fnftd_req_STATS)
+        return recv_all(fd, stats != NULL ? stats : &dummy,
+            sizeof(fnftd_stats_t));
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*
+* This file is part of FNFT.
+*
+* FNFT is free software; you can redistribute it and/or
+* modify it under the terms of the version 2 of the GNU General
+* Public License as published by the Free Software Foundation.
+*
+* FNFT is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+* Contributors:
+* Sander Wahls (TU Delft) 2017-2018.
+*/
+
+// Tests of the FNFT daemon. Usage: fnftd_test <path of fnftd> <socket>
+//
+// The daemon is started with a single worker thread and a queue of length
+// two. The results are compared with direct calls of fnft_nsev. A file
+// next to the socket serves as shared buffer.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "fnftd.h"
+
+#define ND 256
+#define ND_LARGE 2048
+#define NM 64
+#define NPIPELINE 8
+
+// Layout of the shared buffer (in complex values): samples of the small
+// signals, results of the small signals, samples of the large signal,
+// results of the pipelined requests
+#define MAX_K 512
+#define RESULT_LEN (3*NM + 3*MAX_K)
+#define IN_OFFSET(i) ((size_t)(i)*ND)
+#define OUT_OFFSET(i) (4*ND + (size_t)(i)*RESULT_LEN)
+#define LARGE_OFFSET (4*ND + 4*RESULT_LEN)
+#define PIPE_OFFSET(i) (LARGE_OFFSET + ND_LARGE + (size_t)(i)*RESULT_LEN)
+#define BUF_LEN (PIPE_OFFSET(NPIPELINE))
+
+static const double T[2] = { -8.0, 8.0 }, XI[2] = { -3.0, 3.0 };
+
+static void make_signal(const size_t n, FNFT_COMPLEX * const q,
+    const double A, const double chirp)
+{
+    size_t i;
+    double t;
+    for (i=0; i<n; i++) {
+        t = T[0] + i*(T[1] - T[0])/(n - 1);
+        q[i] = A/FNFT_COSH(t) * FNFT_CEXP(I*chirp*t);
+    }
+}
+
+static void init_request(fnftd_request_t * const req, const uint64_t id)
+{
+    fnftd_request_init(req);
+    req->id = id;
+    req->D = ND;
+    req->M = NM;
+    req->T[0] = T[0];
+    req->T[1] = T[1];
+    req->XI[0] = XI[0];
+    req->XI[1] = XI[1];
+    req->max_K = MAX_K;
+    req->contspec_type = fnft_nsev_cstype_BOTH;
+    req->discspec_type = fnft_nsev_dstype_BOTH;
+}
+
+// Compares the results in the shared buffer with a direct call of
+// fnft_nsev
+static int check_results(FNFT_COMPLEX const * const buf, const size_t i,
+    fnftd_response_t const * const resp)
+{
+    FNFT_COMPLEX q[ND], contspec[3*NM], bound_states[MAX_K];
+    FNFT_COMPLEX normconsts[2*MAX_K];
+    FNFT_COMPLEX const *out = buf + OUT_OFFSET(i);
+    fnft_nsev_opts_t opts = fnft_nsev_default_opts();
+    FNFT_UINT K = MAX_K;
+    FNFT_INT ret_code;
+
+    memcpy(q, buf + IN_OFFSET(i), sizeof(q));
+    opts.contspec_type = fnft_nsev_cstype_BOTH;
+    opts.discspec_type = fnft_nsev_dstype_BOTH;
+    ret_code = fnft_nsev(ND, q, T, NM, contspec, XI, &K, bound_states,
+        normconsts, +1, &opts);
+    if (ret_code != FNFT_SUCCESS || resp->status != fnftd_status_OK
+        || resp->ret_code != FNFT_SUCCESS || resp->K != K
+        || resp->ncontspec != 3*NM)
+        return -1;
+    if (memcmp(out, contspec, sizeof(contspec)) != 0
+        || memcmp(out + 3*NM, bound_states, K*sizeof(FNFT_COMPLEX)) != 0
+        || memcmp(out + 3*NM + MAX_K, normconsts, 2*K*sizeof(FNFT_COMPLEX))
+        != 0)
+        return -1;
+    return 0;
+}
+
+static int run_tests(const int fd, const int buf_fd, FNFT_COMPLEX *buf)
+{
+    fnftd_request_t req;
+    fnftd_response_t resp;
+    fnftd_stats_t stats;
+    size_t i, nbusy = 0, nexpired = 0, nok = 0;
+    int ids[NPIPELINE + 1];
+
+    // Transform requests one after the other. The shared buffer is passed
+    // with the first request only.
+    for (i=0; i<4; i++) {
+        make_signal(ND, buf + IN_OFFSET(i), 1.0 + 0.5*i, 0.3*i);
+        init_request(&req, 100 + i);
+        req.in_offset = IN_OFFSET(i)*sizeof(FNFT_COMPLEX);
+        req.out_offset = OUT_OFFSET(i)*sizeof(FNFT_COMPLEX);
+        if (fnftd_send(fd, &req, i == 0 ? buf_fd : -1) != 0
+            || fnftd_recv(fd, &resp, NULL) != 0 || resp.id != 100 + i
+            || check_results(buf, i, &resp) != 0) {
+            fprintf(stderr, "fnftd_test: request %lu failed\n",
+                (unsigned long)i);
+            return -1;
+        }
+    }
+
+    // Malformed requests
+    init_request(&req, 200);
+    req.out_offset = (BUF_LEN - 1)*sizeof(FNFT_COMPLEX);
+    if (fnftd_send(fd, &req, -1) != 0 || fnftd_recv(fd, &resp, NULL) != 0
+        || resp.id != 200 || resp.status != fnftd_status_BAD_REQUEST)
+        return -1;
+    init_request(&req, 201);
+    req.D = 1;
+    if (fnftd_send(fd, &req, -1) != 0 || fnftd_recv(fd, &resp, NULL) != 0
+        || resp.id != 201 || resp.status != fnftd_status_BAD_REQUEST)
+        return -1;
+
+    // Backpressure and deadlines: A slow request occupies the worker, the
+    // pipelined requests behind it either wait in the queue and expire, or
+    // are rejected.
+    make_signal(ND_LARGE, buf + LARGE_OFFSET, 2.0, 0.1);
+    init_request(&req, 300);
+    req.D = ND_LARGE;
+    req.flags = FNFTD_DISCSPEC;
+    req.discspec_type = fnft_nsev_dstype_NORMING_CONSTANTS;
+    req.in_offset = LARGE_OFFSET*sizeof(FNFT_COMPLEX);
+    req.out_offset = PIPE_OFFSET(0)*sizeof(FNFT_COMPLEX);
+    if (fnftd_send(fd, &req, -1) != 0)
+        return -1;
+    for (i=0; i<NPIPELINE; i++) {
+        init_request(&req, 301 + i);
+        req.timeout_ms = 1;
+        req.in_offset = IN_OFFSET(0)*sizeof(FNFT_COMPLEX);
+        req.out_offset = PIPE_OFFSET(i)*sizeof(FNFT_COMPLEX);
+        if (fnftd_send(fd, &req, -1) != 0)
+            return -1;
+    }
+    memset(ids, 0, sizeof(ids));
+    for (i=0; i<NPIPELINE + 1; i++) {
+        if (fnftd_recv(fd, &resp, NULL) != 0 || resp.id < 300
+            || resp.id > 300 + NPIPELINE || ids[resp.id - 300]++ != 0)
+            return -1;
+        if (resp.status == fnftd_status_BUSY)
+            nbusy++;
+        else if (resp.status == fnftd_status_DEADLINE)
+            nexpired++;
+        else if (resp.status == fnftd_status_OK
+            && resp.ret_code == FNFT_SUCCESS)
+            nok++;
+    }
+    if (nbusy == 0 || nexpired == 0 || nok == 0
+        || nbusy + nexpired + nok != NPIPELINE + 1) {
+        fprintf(stderr, "fnftd_test: busy=%lu expired=%lu ok=%lu\n",
+            (unsigned long)nbusy, (unsigned long)nexpired,
+            (unsigned long)nok);
+        return -1;
+    }
+
+    // Statistics
+    init_request(&req, 400);
+    req.type = fnftd_req_STATS;
+    if (fnftd_send(fd, &req, -1) != 0
+        || fnftd_recv(fd, &resp, &stats) != 0 || resp.id != 400
+        || resp.status != fnftd_status_OK)
+        return -1;
+    if (stats.requests != 4 + 2 + NPIPELINE + 2
+        || stats.completed != 4 + nok || stats.failed != 0
+        || stats.rejected_busy != nbusy
+        || stats.rejected_deadline != nexpired || stats.bad_requests != 2
+        || stats.plan_hits + stats.plan_misses != stats.completed
+        || stats.plan_misses != 2
+        || stats.queue_capacity != 2 || stats.nthreads != 1
+        || stats.connections != 1) {
+        fprintf(stderr, "fnftd_test: unexpected statistics\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char buf_name[4096];
+    FNFT_COMPLEX *buf = MAP_FAILED;
+    pid_t pid;
+    int fd = -1, buf_fd = -1, status, i, ret = EXIT_FAILURE;
+    struct timespec ts = { 0, 20000000 };
+
+    if (argc < 3 || strlen(argv[2]) + 5 > sizeof(buf_name))
+        return EXIT_FAILURE;
+    snprintf(buf_name, sizeof(buf_name), "%s.buf", argv[2]);
+
+    pid = fork();
+    if (pid < 0)
+        return EXIT_FAILURE;
+    if (pid == 0) {
+        execl(argv[1], argv[1], "--socket", argv[2], "--threads", "1",
+            "--queue", "2", (char *)NULL);
+        _exit(127);
+    }
+
+    // Wait until the daemon accepts connections
+    for (i=0; i<250 && fd < 0; i++) {
+        fd = fnftd_connect(argv[2]);
+        if (fd < 0)
+            nanosleep(&ts, NULL);
+    }
+    buf_fd = open(buf_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || buf_fd < 0
+        || ftruncate(buf_fd, BUF_LEN*sizeof(FNFT_COMPLEX)) != 0)
+        goto release_mem;
+    unlink(buf_name);
+    buf = mmap(NULL, BUF_LEN*sizeof(FNFT_COMPLEX), PROT_READ | PROT_WRITE,
+        MAP_SHARED, buf_fd, 0);
+    if (buf == MAP_FAILED)
+        goto release_mem;
+
+    if (run_tests(fd, buf_fd, buf) == 0)
+        ret = EXIT_SUCCESS;
+
+release_mem:
+    if (buf != MAP_FAILED)
+        munmap(buf, BUF_LEN*sizeof(FNFT_COMPLEX));
+    if (buf_fd >= 0)
+        close(buf_fd);
+    if (fd >= 0)
+        close(fd);
+    kill(pid, SIGTERM);
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)
+        || WEXITSTATUS(status) != 0)
+        ret = EXIT_FAILURE;
+    return ret;
+}